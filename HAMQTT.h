@@ -33,7 +33,17 @@
 #pragma once
 
 #include "HAMQTT/hamqtt_device.h"
+#include "HAMQTT/hamqtt_trace.h"
 
 // Components
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
 #include "HAMQTT/hamqtt_binary_sensor.h"
+#endif
+
+#if CONFIG_HAMQTT_COMPONENT_BUTTON
 #include "HAMQTT/hamqtt_button.h"
+#endif
+
+#if CONFIG_HAMQTT_COMPONENT_GROUP
+#include "HAMQTT/hamqtt_group.h"
+#endif
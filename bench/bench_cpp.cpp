@@ -0,0 +1,266 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file bench_cpp.cpp
+ * @brief Compares the header-only C++ API in hamqtt.hpp with the equivalent C calls.
+ *
+ * The same device, a binary sensor and a button, is built once with `hamqtt::Device` and
+ * once with `hamqtt_device_create`, each on its own mock transport. The C device is given
+ * the C++ device's discovery payload as its template, so neither side needs cJSON. Both
+ * then route a press, route a message no component subscribes to, and run the update loop
+ * with and without a state change, timed over batches like bench_routing.
+ *
+ * This file is also the only place the tree compiles hamqtt.hpp, so it is built with
+ * `-Wall -Wextra` to keep the header clean for applications that enable them.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include "HAMQTT/hamqtt.hpp"
+#include "HAMQTT/hamqtt_transport_mock.h"
+#include "hamqtt_bench.h"
+
+#define WARMUP_OPS 1000
+#define BATCH_SIZE 256
+
+static const char *TAG = "Bench_Cpp";
+
+static const char *const press_topic = "bench_cpp/bell/press";
+static const char *const miss_topic = "bench_cpp/bell/xxxxx";
+
+static bool door_open;
+static uint64_t bell_presses;
+
+struct Bench_Node {
+    static constexpr auto unique_id = hamqtt::literal("bench_cpp");
+    static constexpr auto name = hamqtt::literal("Bench Cpp");
+};
+
+struct Bench_Door {
+    static constexpr auto unique_id = hamqtt::literal("door");
+    static constexpr auto name = hamqtt::literal("Door");
+    static bool get_state() { return door_open; }
+};
+
+struct Bench_Bell {
+    static constexpr auto unique_id = hamqtt::literal("bell");
+    static constexpr auto name = hamqtt::literal("Bell");
+    static void on_press() { bell_presses++; }
+};
+
+using Bench_Cpp_Device = hamqtt::Device<Bench_Node, hamqtt::BinarySensor<Bench_Door>, hamqtt::Button<Bench_Bell>>;
+
+static const char *const c_fragments[] = { Bench_Cpp_Device::discovery_payload.c_str() };
+
+static bool bench_cpp_door_get_state(void *) {
+    return door_open;
+}
+
+static void bench_cpp_bell_on_press(void *) {
+    bell_presses++;
+}
+
+typedef enum {
+    BENCH_CPP_PRESS,
+    BENCH_CPP_MISS,
+    BENCH_CPP_LOOP_UNCHANGED,
+    BENCH_CPP_LOOP_CHANGED,
+    BENCH_CPP_CASE_COUNT,
+} Bench_Cpp_Case;
+
+static const char *const case_names[] = { "press", "no_match", "loop_unchanged", "loop_changed" };
+
+/**
+ * @brief One side of the comparison. Exactly one of `c_device` and `cpp_device` is set.
+ */
+typedef struct {
+    const char *api;
+    HAMQTT_Transport *transport;
+    HAMQTT_Device *c_device;
+    Bench_Cpp_Device *cpp_device;
+} Bench_Cpp_Target;
+
+static inline void bench_cpp_op(const Bench_Cpp_Target *target, Bench_Cpp_Case bench_case) {
+    switch (bench_case) {
+        case BENCH_CPP_PRESS:
+            hamqtt_transport_mock_inject_message(target->transport, press_topic, "PRESS", 5);
+            return;
+        case BENCH_CPP_MISS:
+            hamqtt_transport_mock_inject_message(target->transport, miss_topic, "PRESS", 5);
+            return;
+        case BENCH_CPP_LOOP_CHANGED:
+            door_open = !door_open;
+            break;
+        default:
+            break;
+    }
+
+    if (target->c_device) {
+        hamqtt_device_loop(target->c_device);
+    } else {
+        target->cpp_device->loop();
+    }
+}
+
+static esp_err_t bench_cpp_run(HAMQTT_Bench_Report *report, const Bench_Cpp_Target *target, Bench_Cpp_Case bench_case) {
+    for (int i = 0; i < WARMUP_OPS; ++i) {
+        bench_cpp_op(target, bench_case);
+    }
+
+    size_t ops = 0;
+    uint64_t total_ns = 0;
+    uint64_t deadline_ns = (uint64_t)report->min_time_ms * 1000000ULL;
+    uint64_t presses = bell_presses;
+
+    hamqtt_bench_alloc_reset();
+
+    while (total_ns < deadline_ns) {
+        // Keep the mock recording every publish of the batch
+        hamqtt_transport_mock_clear_publishes(target->transport);
+
+        uint64_t start = hamqtt_bench_now_ns();
+        for (int i = 0; i < BATCH_SIZE; ++i) {
+            bench_cpp_op(target, bench_case);
+        }
+        total_ns += hamqtt_bench_now_ns() - start;
+        ops += BATCH_SIZE;
+    }
+
+    HAMQTT_Bench_Alloc_Stats stats = hamqtt_bench_alloc_get_stats();
+    presses = bell_presses - presses;
+
+    size_t publishes = hamqtt_transport_mock_get_publish_count(target->transport);
+    size_t expected_publishes = bench_case == BENCH_CPP_LOOP_CHANGED ? BATCH_SIZE : 0;
+
+    ESP_RETURN_ON_FALSE(presses == (bench_case == BENCH_CPP_PRESS ? ops : 0) && publishes == expected_publishes,
+                        ESP_FAIL,
+                        TAG,
+                        "%s %s made %llu presses and %u publishes in its last batch",
+                        target->api,
+                        case_names[bench_case],
+                        (unsigned long long)presses,
+                        (unsigned)publishes);
+
+    double ns_per_op = (double)total_ns / (double)ops;
+
+    hamqtt_bench_report_row_begin(report);
+    hamqtt_bench_report_str(report, "api", target->api);
+    hamqtt_bench_report_str(report, "case", case_names[bench_case]);
+    hamqtt_bench_report_u64(report, "ops", ops);
+    hamqtt_bench_report_f64(report, "ns_per_op", ns_per_op);
+    hamqtt_bench_report_f64(report, "allocs_per_op", (double)stats.allocs / (double)ops);
+    hamqtt_bench_report_row_end(report);
+
+    return ESP_OK;
+}
+
+static esp_err_t bench_cpp_run_all(HAMQTT_Bench_Report *report, const Bench_Cpp_Target *target) {
+    for (int bench_case = 0; bench_case < BENCH_CPP_CASE_COUNT; ++bench_case) {
+        ESP_RETURN_ON_ERROR(bench_cpp_run(report, target, (Bench_Cpp_Case)bench_case), TAG, "Run failed");
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t bench_cpp_run_c(HAMQTT_Bench_Report *report) {
+    esp_err_t ret = ESP_OK;
+
+    // HAMQTT_Device_Config takes mutable strings
+    static char uri[] = "mock://bench";
+    static auto unique_id = Bench_Node::unique_id;
+    static auto name = Bench_Node::name;
+
+    HAMQTT_Device_Config device_config = hamqtt_device_config_default();
+    device_config.mqtt_uri = uri;
+    device_config.unique_id = unique_id.chars;
+    device_config.name = name.chars;
+
+    HAMQTT_Binary_Sensor_Config sensor_config = hamqtt_binary_sensor_config_default();
+    sensor_config.unique_id = Bench_Door::unique_id.c_str();
+    sensor_config.name = Bench_Door::name.c_str();
+
+    HAMQTT_Button_Config button_config = hamqtt_button_config_default();
+    button_config.unique_id = Bench_Bell::unique_id.c_str();
+    button_config.name = Bench_Bell::name.c_str();
+
+    HAMQTT_Discovery_Template discovery = {};
+    discovery.fragments = c_fragments;
+    discovery.fragment_count = 1;
+    discovery.component_count = 2;
+
+    HAMQTT_Transport_Mock_Config transport_config = hamqtt_transport_mock_config_default();
+    HAMQTT_Transport *transport = hamqtt_transport_mock_create(&transport_config);
+    HAMQTT_Device *device = hamqtt_device_create(&device_config);
+    HAMQTT_Binary_Sensor *sensor = hamqtt_binary_sensor_create(&sensor_config, bench_cpp_door_get_state, NULL);
+    HAMQTT_Button *button = hamqtt_button_create(&button_config, bench_cpp_bell_on_press, NULL);
+
+    Bench_Cpp_Target target = { "c", transport, device, NULL };
+
+    ESP_GOTO_ON_FALSE(transport && device && sensor && button, ESP_ERR_NO_MEM, cleanup, TAG, "Failed to create the C device");
+    ESP_GOTO_ON_ERROR(hamqtt_device_add_component(device, (HAMQTT_Component *)sensor), cleanup, TAG, "Failed to add sensor");
+    ESP_GOTO_ON_ERROR(hamqtt_device_add_component(device, (HAMQTT_Component *)button), cleanup, TAG, "Failed to add button");
+    ESP_GOTO_ON_ERROR(hamqtt_device_set_discovery_template(device, &discovery), cleanup, TAG, "Failed to set discovery template");
+    ESP_GOTO_ON_ERROR(hamqtt_device_set_transport(device, transport), cleanup, TAG, "Failed to set transport");
+    ESP_GOTO_ON_ERROR(hamqtt_device_connect(device), cleanup, TAG, "Failed to connect the C device");
+
+    ret = bench_cpp_run_all(report, &target);
+
+cleanup:
+    hamqtt_device_destroy(device);
+    hamqtt_binary_sensor_destroy(sensor);
+    hamqtt_button_destroy(button);
+    hamqtt_transport_destroy(transport);
+    return ret;
+}
+
+static esp_err_t bench_cpp_run_cpp(HAMQTT_Bench_Report *report) {
+    esp_err_t ret = ESP_OK;
+
+    HAMQTT_Transport_Mock_Config transport_config = hamqtt_transport_mock_config_default();
+    HAMQTT_Transport *transport = hamqtt_transport_mock_create(&transport_config);
+    ESP_RETURN_ON_FALSE(transport, ESP_ERR_NO_MEM, TAG, "Failed to create mock transport");
+
+    {
+        Bench_Cpp_Device device;
+        Bench_Cpp_Target target = { "cpp", transport, NULL, &device };
+
+        device.set_transport(transport);
+        ret = device.connect("mock://bench");
+        if (ret == ESP_OK) ret = bench_cpp_run_all(report, &target);
+    }
+
+    hamqtt_transport_destroy(transport);
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    HAMQTT_Bench_Report report;
+    if (hamqtt_bench_report_open(&report, "cpp", argc, argv) != ESP_OK) {
+        fprintf(stderr, "usage: %s [--format csv|json] [--output <path>] [--min-time-ms <ms>]\n", argv[0]);
+        return 2;
+    }
+
+    int rc = 0;
+    if (bench_cpp_run_c(&report) != ESP_OK) rc = 1;
+    if (bench_cpp_run_cpp(&report) != ESP_OK) rc = 1;
+
+    hamqtt_bench_report_close(&report);
+
+    return rc;
+}
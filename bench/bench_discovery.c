@@ -0,0 +1,125 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file bench_discovery.c
+ * @brief Measures how building and serializing the discovery payload scales with entity count.
+ *
+ * For each component count and field richness the benchmark repeatedly calls
+ * `hamqtt_device_build_discovery_payload` and reports the time per build, heap
+ * allocations and peak heap per build, and the payload size.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include "hamqtt_bench.h"
+
+#define WARMUP_ITERATIONS 3
+#define MIN_ITERATIONS 10
+#define MAX_SAMPLES 100000
+
+static const char *TAG = "Bench_Discovery";
+
+static const size_t component_counts[] = { 1, 16, 64, 256, 1024 };
+
+static esp_err_t bench_discovery_run(HAMQTT_Bench_Report *report, size_t component_count, bool full_fields, uint64_t *samples) {
+    HAMQTT_Bench_Device bench;
+    HAMQTT_Bench_Device_Config config = {
+        .component_count = component_count,
+        .full_fields = full_fields,
+    };
+
+    ESP_RETURN_ON_ERROR(hamqtt_bench_device_create(&bench, &config), TAG, "Failed to create benchmark device");
+
+    esp_err_t ret = ESP_OK;
+    char *payload = NULL;
+    size_t payload_bytes = 0;
+
+    for (int i = 0; i < WARMUP_ITERATIONS; ++i) {
+        ESP_GOTO_ON_ERROR(hamqtt_device_build_discovery_payload(bench.device, &payload), cleanup, TAG, "Failed to build discovery payload");
+        payload_bytes = strlen(payload);
+        hamqtt_device_free_discovery_payload(bench.device, payload);
+    }
+
+    size_t iterations = 0;
+    uint64_t total_ns = 0;
+    uint64_t deadline_ns = (uint64_t)report->min_time_ms * 1000000ULL;
+
+    hamqtt_bench_alloc_reset();
+
+    while ((total_ns < deadline_ns || iterations < MIN_ITERATIONS) && iterations < MAX_SAMPLES) {
+        uint64_t start = hamqtt_bench_now_ns();
+        esp_err_t err = hamqtt_device_build_discovery_payload(bench.device, &payload);
+        hamqtt_device_free_discovery_payload(bench.device, payload);
+        uint64_t elapsed = hamqtt_bench_now_ns() - start;
+
+        ESP_GOTO_ON_ERROR(err, cleanup, TAG, "Failed to build discovery payload");
+
+        samples[iterations++] = elapsed;
+        total_ns += elapsed;
+    }
+
+    HAMQTT_Bench_Alloc_Stats stats = hamqtt_bench_alloc_get_stats();
+
+    hamqtt_bench_report_row_begin(report);
+    hamqtt_bench_report_str(report, "fields", full_fields ? "full" : "minimal");
+    hamqtt_bench_report_u64(report, "components", component_count);
+    hamqtt_bench_report_u64(report, "iterations", iterations);
+    hamqtt_bench_report_f64(report, "ns_per_build", (double)total_ns / (double)iterations);
+    hamqtt_bench_report_u64(report, "ns_min", hamqtt_bench_percentile(samples, iterations, 0));
+    hamqtt_bench_report_u64(report, "ns_p50", hamqtt_bench_percentile(samples, iterations, 50));
+    hamqtt_bench_report_u64(report, "ns_p99", hamqtt_bench_percentile(samples, iterations, 99));
+    hamqtt_bench_report_f64(report, "allocs_per_build", (double)stats.allocs / (double)iterations);
+    hamqtt_bench_report_u64(report, "peak_bytes", stats.peak_bytes > 0 ? stats.peak_bytes : 0);
+    hamqtt_bench_report_u64(report, "payload_bytes", payload_bytes);
+    hamqtt_bench_report_row_end(report);
+
+cleanup:
+    hamqtt_bench_device_destroy(&bench);
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    HAMQTT_Bench_Report report;
+    if (hamqtt_bench_report_open(&report, "discovery", argc, argv) != ESP_OK) {
+        fprintf(stderr, "usage: %s [--format csv|json] [--output <path>] [--min-time-ms <ms>]\n", argv[0]);
+        return 2;
+    }
+
+    uint64_t *samples = malloc(MAX_SAMPLES * sizeof(uint64_t));
+    if (!samples) return 1;
+
+    int rc = 0;
+
+    for (int full_fields = 0; full_fields <= 1; ++full_fields) {
+        for (size_t i = 0; i < sizeof(component_counts) / sizeof(component_counts[0]); ++i) {
+            if (component_counts[i] > HAMQTT_DEVICE_MAX_COMPONENTS) {
+                ESP_LOGW(TAG, "Skipping %d components, configure with -DCONFIG_HAMQTT_DEVICE_MAX_COMPONENTS=%d",
+                         (int)component_counts[i], (int)component_counts[i]);
+                continue;
+            }
+
+            if (bench_discovery_run(&report, component_counts[i], full_fields, samples) != ESP_OK) rc = 1;
+        }
+    }
+
+    free(samples);
+    hamqtt_bench_report_close(&report);
+
+    return rc;
+}
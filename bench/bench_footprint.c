@@ -0,0 +1,199 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file bench_footprint.c
+ * @brief Measures the heap a device holds for 1, 16 and 64 entities.
+ *
+ * Entity configurations are set up before counting starts, as an application would keep
+ * them in static storage, so only memory allocated by HAMQTT (and cJSON) is counted. The
+ * heap is measured after the device is created, after its entities are added and after it
+ * has connected to the mock transport, along with the peak reached while connecting.
+ * Entities alternate between binary sensors and buttons. Sizes are `malloc_usable_size`,
+ * so allocator rounding is included. `tools/hamqtt_footprint.py` combines these numbers
+ * with the section sizes of each build configuration.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include "HAMQTT/hamqtt_transport_mock.h"
+#include "hamqtt_bench.h"
+
+static const char *TAG = "Bench_Footprint";
+
+static const size_t entity_counts[] = { 1, 16, 64 };
+
+#if !HAMQTT_RUNTIME_DISCOVERY
+static const char *const placeholder_fragments[] = { "{}" };
+#endif
+
+typedef union {
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+    HAMQTT_Binary_Sensor_Config binary_sensor;
+#endif
+#if CONFIG_HAMQTT_COMPONENT_BUTTON
+    HAMQTT_Button_Config button;
+#endif
+} Footprint_Entity_Config;
+
+static bool bench_footprint_get_state(void *args) {
+    return false;
+}
+
+static void bench_footprint_on_press(void *args) {
+}
+
+static bool bench_footprint_is_button(size_t index) {
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR && CONFIG_HAMQTT_COMPONENT_BUTTON
+    return index % 2 == 1;
+#else
+    return CONFIG_HAMQTT_COMPONENT_BUTTON;
+#endif
+}
+
+static HAMQTT_Component *bench_footprint_create_entity(Footprint_Entity_Config *config, const char *id, size_t index) {
+    if (bench_footprint_is_button(index)) {
+#if CONFIG_HAMQTT_COMPONENT_BUTTON
+        config->button = hamqtt_button_config_default();
+        config->button.unique_id = id;
+        config->button.name = "Footprint Button";
+        return (HAMQTT_Component *)hamqtt_button_create(&config->button, bench_footprint_on_press, NULL);
+#endif
+    } else {
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+        config->binary_sensor = hamqtt_binary_sensor_config_default();
+        config->binary_sensor.unique_id = id;
+        config->binary_sensor.name = "Footprint Binary Sensor";
+        return (HAMQTT_Component *)hamqtt_binary_sensor_create(&config->binary_sensor, bench_footprint_get_state, NULL);
+#endif
+    }
+
+    return NULL;
+}
+
+static void bench_footprint_destroy_entity(HAMQTT_Component *component) {
+#if CONFIG_HAMQTT_COMPONENT_BUTTON
+    if (component->v == &hamqtt_button_vtable) {
+        hamqtt_button_destroy((HAMQTT_Button *)component);
+        return;
+    }
+#endif
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+    if (component->v == &hamqtt_binary_sensor_vtable) hamqtt_binary_sensor_destroy((HAMQTT_Binary_Sensor *)component);
+#endif
+}
+
+static esp_err_t bench_footprint_run(HAMQTT_Bench_Report *report, size_t entity_count) {
+    HAMQTT_Device_Config device_config = hamqtt_device_config_default();
+    device_config.mqtt_uri = "mock://footprint";
+    device_config.unique_id = "footprint-node";
+    device_config.name = "Footprint Node";
+
+    Footprint_Entity_Config *configs = calloc(entity_count, sizeof(Footprint_Entity_Config));
+    HAMQTT_Component **components = calloc(entity_count, sizeof(HAMQTT_Component *));
+    char (*ids)[16] = calloc(entity_count, sizeof(*ids));
+
+    HAMQTT_Transport_Mock_Config transport_config = hamqtt_transport_mock_config_default();
+    HAMQTT_Transport *transport = hamqtt_transport_mock_create(&transport_config);
+
+    HAMQTT_Device *device = NULL;
+    esp_err_t ret = ESP_OK;
+
+    ESP_GOTO_ON_FALSE(configs && components && ids && transport, ESP_ERR_NO_MEM, cleanup, TAG, "Unable to allocate benchmark fixtures");
+
+    for (size_t i = 0; i < entity_count; ++i) {
+        snprintf(ids[i], sizeof(ids[i]), "entity_%zu", i);
+    }
+
+    hamqtt_bench_alloc_reset();
+
+    device = hamqtt_device_create(&device_config);
+    ESP_GOTO_ON_FALSE(device, ESP_ERR_NO_MEM, cleanup, TAG, "Unable to create device");
+    int64_t device_bytes = hamqtt_bench_alloc_get_stats().current_bytes;
+
+    for (size_t i = 0; i < entity_count; ++i) {
+        components[i] = bench_footprint_create_entity(&configs[i], ids[i], i);
+        ESP_GOTO_ON_FALSE(components[i], ESP_ERR_NO_MEM, cleanup, TAG, "Unable to create entity %d", (int)i);
+        ESP_GOTO_ON_ERROR(hamqtt_device_add_component(device, components[i]), cleanup, TAG, "Unable to add entity %d", (int)i);
+    }
+    HAMQTT_Bench_Alloc_Stats added = hamqtt_bench_alloc_get_stats();
+
+#if !HAMQTT_RUNTIME_DISCOVERY
+    HAMQTT_Discovery_Template discovery = {
+        .fragments = placeholder_fragments,
+        .fragment_count = 1,
+        .component_count = entity_count,
+    };
+    hamqtt_device_set_discovery_template(device, &discovery);
+#endif
+
+    // The mock transport was created before counting started, so only the device is measured
+    hamqtt_device_set_transport(device, transport);
+    ESP_GOTO_ON_ERROR(hamqtt_device_connect(device), cleanup, TAG, "Failed to connect");
+    HAMQTT_Bench_Alloc_Stats connected = hamqtt_bench_alloc_get_stats();
+
+    int64_t entity_bytes = added.current_bytes - device_bytes;
+
+    hamqtt_bench_report_row_begin(report);
+    hamqtt_bench_report_u64(report, "entities", entity_count);
+    hamqtt_bench_report_u64(report, "max_components", HAMQTT_DEVICE_MAX_COMPONENTS);
+    hamqtt_bench_report_u64(report, "device_bytes", device_bytes);
+    hamqtt_bench_report_u64(report, "entity_bytes", entity_bytes);
+    hamqtt_bench_report_f64(report, "bytes_per_entity", (double)entity_bytes / (double)entity_count);
+    hamqtt_bench_report_u64(report, "connected_bytes", connected.current_bytes);
+    hamqtt_bench_report_f64(report, "connected_bytes_per_entity", (double)(connected.current_bytes - device_bytes) / (double)entity_count);
+    hamqtt_bench_report_u64(report, "connect_peak_bytes", connected.peak_bytes);
+    hamqtt_bench_report_u64(report, "blocks", connected.allocs - connected.frees);
+    hamqtt_bench_report_row_end(report);
+
+cleanup:
+    if (device) hamqtt_device_destroy(device);
+    for (size_t i = 0; components && i < entity_count; ++i) {
+        if (components[i]) bench_footprint_destroy_entity(components[i]);
+    }
+    if (transport) hamqtt_transport_destroy(transport);
+    free(ids);
+    free(components);
+    free(configs);
+
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    HAMQTT_Bench_Report report;
+    if (hamqtt_bench_report_open(&report, "footprint", argc, argv) != ESP_OK) {
+        fprintf(stderr, "usage: %s [--format csv|json] [--output <path>]\n", argv[0]);
+        return 2;
+    }
+
+    int rc = 0;
+
+    for (size_t i = 0; i < sizeof(entity_counts) / sizeof(entity_counts[0]); ++i) {
+        if (entity_counts[i] > HAMQTT_DEVICE_MAX_COMPONENTS) {
+            ESP_LOGW(TAG, "Skipping %d entities, configure with -DCONFIG_HAMQTT_DEVICE_MAX_COMPONENTS=%d",
+                     (int)entity_counts[i], (int)entity_counts[i]);
+            continue;
+        }
+
+        if (bench_footprint_run(&report, entity_counts[i]) != ESP_OK) rc = 1;
+    }
+
+    hamqtt_bench_report_close(&report);
+
+    return rc;
+}
@@ -0,0 +1,778 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file bench_replay.c
+ * @brief Replays traffic recorded from a real device and measures the library's cost on it.
+ *
+ * The device is rebuilt from the discovery payload in the recording, with a binary sensor
+ * or button for each component, and connected to the mock transport. Diagnostic sensors are
+ * added by the device itself, and their reports, which hold live heap and timing figures,
+ * are left out of the comparison, as are latency probes, which carry the time they were
+ * sent. Records are then
+ * replayed in order: inbound messages are injected through the mock transport, reconnects
+ * are replayed as mock connect/disconnect events, and each recorded state publish sets the
+ * matching sensor's state before `hamqtt_device_loop` runs. A disconnect right after the
+ * device published `offline` to its availability topic was asked for by the application,
+ * and is replayed with `hamqtt_device_disconnect`; any other is a dropped connection.
+ * Everything the device publishes is compared with what the real device published.
+ *
+ * The replay repeats at full speed until the minimum time is reached, or runs once in real
+ * time with `--realtime`. CPU time and allocations per replay can be compared against a
+ * JSON report from an earlier run with `--baseline`, failing if they regress.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <time.h>
+#include <unistd.h>
+
+#include "HAMQTT/hamqtt_transport_mock.h"
+#include "HAMQTT/hamqtt_transport_record.h"
+#include "hamqtt_bench.h"
+
+static const char *TAG = "Bench_Replay";
+
+typedef struct {
+    const char *path;
+    bool realtime;
+    double speed;
+    uint32_t loop_interval_ms;
+    const char *baseline;
+    double max_regression_pct;
+} Replay_Options;
+
+typedef struct {
+    uint8_t *buf;
+    HAMQTT_Transport_Record *records;
+    int *sensor_index;                  // For each record, the sensor a PUBLISH record reports, or -1
+    bool *clean_disconnect;             // For each record, whether a DISCONNECTED record was hamqtt_device_disconnect
+    size_t record_count;
+
+    size_t inbound_count;
+    size_t publish_count;
+    size_t buffer_size;                 // Bytes of topics and payloads published
+
+    cJSON *discovery;
+    char *device_id;
+    char *config_prefix;
+    const char *availability_topic;     // Points into `discovery`
+    char config_topic[HAMQTT_MAX_CHAR_BUF_SIZE];
+    char diagnostics_topic[HAMQTT_MAX_CHAR_BUF_SIZE];
+    char latency_probe_topic[HAMQTT_MAX_CHAR_BUF_SIZE];
+
+    bool has_diagnostics;
+    bool diagnostics_enabled_by_default;
+
+    size_t component_count;
+    cJSON *component_json[HAMQTT_DEVICE_MAX_COMPONENTS];
+    const char *state_topics[HAMQTT_DEVICE_MAX_COMPONENTS];
+    bool initial_states[HAMQTT_DEVICE_MAX_COMPONENTS];
+} Replay_Recording;
+
+typedef struct {
+    HAMQTT_Device_Config device_config;
+    HAMQTT_Device *device;
+    HAMQTT_Transport *transport;
+
+    HAMQTT_Component *components[HAMQTT_DEVICE_MAX_COMPONENTS];
+    HAMQTT_Binary_Sensor_Config sensor_configs[HAMQTT_DEVICE_MAX_COMPONENTS];
+    HAMQTT_Button_Config button_configs[HAMQTT_DEVICE_MAX_COMPONENTS];
+    bool states[HAMQTT_DEVICE_MAX_COMPONENTS];
+} Replay_Device;
+
+typedef struct {
+    size_t mismatches;
+    size_t first_mismatch;
+} Replay_Result;
+
+static uint64_t bench_replay_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static const char *bench_replay_json_string(const cJSON *object, const char *key) {
+    const cJSON *item = cJSON_GetObjectItemCaseSensitive(object, key);
+    return cJSON_IsString(item) ? item->valuestring : NULL;
+}
+
+static bool bench_replay_json_bool(const cJSON *object, const char *key, bool fallback) {
+    const cJSON *item = cJSON_GetObjectItemCaseSensitive(object, key);
+    return cJSON_IsBool(item) ? cJSON_IsTrue(item) : fallback;
+}
+
+static int bench_replay_json_int(const cJSON *object, const char *key, int fallback) {
+    const cJSON *item = cJSON_GetObjectItemCaseSensitive(object, key);
+    return cJSON_IsNumber(item) ? item->valueint : fallback;
+}
+
+static bool bench_replay_topic_equals(const HAMQTT_Transport_Record *record, const char *topic) {
+    return topic && strlen(topic) == record->topic_len && memcmp(record->topic, topic, record->topic_len) == 0;
+}
+
+/**
+ * @brief Whether a topic carries live figures that cannot be reproduced, and is left out of the comparison.
+ */
+static bool bench_replay_is_live_topic(const Replay_Recording *recording, const char *topic, size_t topic_len) {
+    return (strlen(recording->diagnostics_topic) == topic_len && memcmp(topic, recording->diagnostics_topic, topic_len) == 0)
+        || (strlen(recording->latency_probe_topic) == topic_len && memcmp(topic, recording->latency_probe_topic, topic_len) == 0);
+}
+
+/**
+ * @brief Whether a component of the recorded discovery payload is one of the device's own diagnostic sensors.
+ */
+static bool bench_replay_is_diagnostic(const Replay_Recording *recording, const cJSON *component) {
+    const char *category = bench_replay_json_string(component, "entity_category");
+    const char *state_topic = bench_replay_json_string(component, "state_topic");
+
+    return category && strcmp(category, "diagnostic") == 0
+        && state_topic && strcmp(state_topic, recording->diagnostics_topic) == 0;
+}
+
+static bool bench_replay_is_platform(const cJSON *component, const char *platform) {
+    const char *value = bench_replay_json_string(component, "p");
+    return value && strcmp(value, platform) == 0;
+}
+
+/* ----- Loading ----- */
+
+static esp_err_t bench_replay_read_file(const char *path, uint8_t **buf, size_t *len) {
+    FILE *file = fopen(path, "rb");
+    ESP_RETURN_ON_FALSE(file, ESP_ERR_NOT_FOUND, TAG, "Unable to open %s", path);
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    *buf = size > 0 ? malloc(size) : NULL;
+    bool ok = *buf && fread(*buf, 1, size, file) == (size_t)size;
+    fclose(file);
+
+    ESP_RETURN_ON_FALSE(ok, ESP_FAIL, TAG, "Unable to read %s", path);
+    *len = (size_t)size;
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Find the discovery payload in the recording and rebuild the device description from it.
+ */
+static esp_err_t bench_replay_parse_discovery(Replay_Recording *recording) {
+    const HAMQTT_Transport_Record *discovery = NULL;
+
+    // Discovery goes to <prefix>/device/<unique_id>/config
+    for (size_t i = 0; i < recording->record_count && !discovery; ++i) {
+        const HAMQTT_Transport_Record *record = &recording->records[i];
+        if (record->type != HAMQTT_TRANSPORT_RECORD_PUBLISH || record->topic_len >= sizeof(recording->config_topic)) continue;
+
+        memcpy(recording->config_topic, record->topic, record->topic_len);
+        recording->config_topic[record->topic_len] = '\0';
+
+        char *device = strstr(recording->config_topic, "/device/");
+        char *suffix = strrchr(recording->config_topic, '/');
+        if (!device || strcmp(suffix, "/config") != 0 || suffix <= device + 8) continue;
+
+        recording->config_prefix = strndup(recording->config_topic, device - recording->config_topic);
+        recording->device_id = strndup(device + 8, suffix - (device + 8));
+        discovery = record;
+    }
+
+    ESP_RETURN_ON_FALSE(discovery, ESP_ERR_NOT_FOUND, TAG, "The recording does not contain a discovery publish");
+
+    recording->discovery = cJSON_ParseWithLength(discovery->data, discovery->data_len);
+    ESP_RETURN_ON_FALSE(recording->discovery, ESP_ERR_INVALID_ARG, TAG, "The recorded discovery payload is not valid JSON");
+
+    recording->availability_topic = bench_replay_json_string(recording->discovery, "availability_topic");
+    snprintf(recording->diagnostics_topic, sizeof(recording->diagnostics_topic), "%s/diagnostics/state", recording->device_id);
+    snprintf(recording->latency_probe_topic, sizeof(recording->latency_probe_topic), "%s/latency_probe", recording->device_id);
+
+    const cJSON *components = cJSON_GetObjectItemCaseSensitive(recording->discovery, "cmps");
+    ESP_RETURN_ON_FALSE(cJSON_IsObject(components), ESP_ERR_INVALID_ARG, TAG, "The recorded discovery payload has no components");
+
+    cJSON *component;
+    cJSON_ArrayForEach(component, components) {
+        if (bench_replay_is_diagnostic(recording, component)) {
+            recording->has_diagnostics = true;
+            recording->diagnostics_enabled_by_default = bench_replay_json_bool(component, "enabled_by_default", true);
+            continue;
+        }
+
+        ESP_RETURN_ON_FALSE(bench_replay_is_platform(component, "binary_sensor") || bench_replay_is_platform(component, "button"),
+                            ESP_ERR_NOT_SUPPORTED,
+                            TAG,
+                            "Component %s has platform %s, only binary sensors and buttons can be replayed",
+                            component->string,
+                            bench_replay_json_string(component, "p") ?: "(none)");
+
+        ESP_RETURN_ON_FALSE(recording->component_count < HAMQTT_DEVICE_MAX_COMPONENTS,
+                            ESP_ERR_NO_MEM,
+                            TAG,
+                            "The recording has more than %d components, configure with a larger CONFIG_HAMQTT_DEVICE_MAX_COMPONENTS",
+                            HAMQTT_DEVICE_MAX_COMPONENTS);
+
+        size_t index = recording->component_count++;
+        recording->component_json[index] = component;
+
+        if (bench_replay_is_platform(component, "binary_sensor")) {
+            recording->state_topics[index] = bench_replay_json_string(component, "state_topic");
+        }
+    }
+
+#if !HAMQTT_DIAGNOSTICS
+    ESP_RETURN_ON_FALSE(!recording->has_diagnostics,
+                        ESP_ERR_NOT_SUPPORTED,
+                        TAG,
+                        "The recording has diagnostic sensors, replay it in a build with CONFIG_HAMQTT_DIAGNOSTICS");
+#endif
+
+    return ESP_OK;
+}
+
+static esp_err_t bench_replay_load(Replay_Recording *recording, const char *path) {
+    size_t len = 0;
+    ESP_RETURN_ON_ERROR(bench_replay_read_file(path, &recording->buf, &len), TAG, "Failed to read recording");
+
+    HAMQTT_Transport_Record_Reader *reader = malloc(sizeof(HAMQTT_Transport_Record_Reader));
+    ESP_RETURN_ON_FALSE(reader, ESP_ERR_NO_MEM, TAG, "Unable to allocate recording reader");
+
+    esp_err_t ret = hamqtt_transport_record_reader_init(reader, recording->buf, len);
+    size_t capacity = 0;
+
+    while (ret == ESP_OK) {
+        if (recording->record_count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            HAMQTT_Transport_Record *records = realloc(recording->records, capacity * sizeof(HAMQTT_Transport_Record));
+            ESP_GOTO_ON_FALSE(records, ESP_ERR_NO_MEM, cleanup, TAG, "Unable to allocate records");
+            recording->records = records;
+        }
+
+        ret = hamqtt_transport_record_reader_next(reader, &recording->records[recording->record_count]);
+        if (ret == ESP_OK) recording->record_count++;
+    }
+
+    if (ret == ESP_ERR_NOT_FOUND) ret = ESP_OK;
+    ESP_GOTO_ON_ERROR(ret, cleanup, TAG, "Failed to decode %s", path);
+    ESP_GOTO_ON_ERROR(bench_replay_parse_discovery(recording), cleanup, TAG, "Failed to rebuild the device from %s", path);
+
+    recording->sensor_index = malloc(recording->record_count * sizeof(int));
+    recording->clean_disconnect = calloc(recording->record_count, sizeof(bool));
+    ESP_GOTO_ON_FALSE((recording->sensor_index && recording->clean_disconnect) || !recording->record_count,
+                      ESP_ERR_NO_MEM,
+                      cleanup,
+                      TAG,
+                      "Unable to allocate records");
+
+    // Resolve which sensor each state publish belongs to once, so the replay itself only does the library's work
+    bool seen[HAMQTT_DEVICE_MAX_COMPONENTS] = { false };
+    bool offline_published = false;     // The last record other than an acknowledgement published `offline`
+
+    for (size_t i = 0; i < recording->record_count; ++i) {
+        const HAMQTT_Transport_Record *record = &recording->records[i];
+        recording->sensor_index[i] = -1;
+
+        if (record->type == HAMQTT_TRANSPORT_RECORD_DISCONNECTED) recording->clean_disconnect[i] = offline_published;
+        if (record->type != HAMQTT_TRANSPORT_RECORD_PUBLISHED) {
+            offline_published = record->type == HAMQTT_TRANSPORT_RECORD_PUBLISH
+                             && bench_replay_topic_equals(record, recording->availability_topic)
+                             && record->data_len == 7 && memcmp(record->data, "offline", 7) == 0;
+        }
+
+        if (record->type == HAMQTT_TRANSPORT_RECORD_DATA) recording->inbound_count++;
+        if (record->type != HAMQTT_TRANSPORT_RECORD_PUBLISH) continue;
+
+        recording->publish_count++;
+        recording->buffer_size += record->topic_len + record->data_len + 2;
+
+        for (size_t j = 0; j < recording->component_count; ++j) {
+            if (!bench_replay_topic_equals(record, recording->state_topics[j])) continue;
+
+            recording->sensor_index[i] = (int)j;
+            if (!seen[j]) {
+                recording->initial_states[j] = record->data_len == 2 && memcmp(record->data, "ON", 2) == 0;
+                seen[j] = true;
+            }
+            break;
+        }
+    }
+
+cleanup:
+    free(reader);
+    return ret;
+}
+
+static void bench_replay_unload(Replay_Recording *recording) {
+    cJSON_Delete(recording->discovery);
+    free(recording->config_prefix);
+    free(recording->device_id);
+    free(recording->sensor_index);
+    free(recording->clean_disconnect);
+    free(recording->records);
+    free(recording->buf);
+}
+
+/* ----- Device ----- */
+
+static bool bench_replay_get_state(void *arg) {
+    return *(bool *)arg;
+}
+
+static void bench_replay_on_press(void *arg) {
+    hamqtt_bench_press_count++;
+}
+
+static void bench_replay_device_destroy(Replay_Device *replay, size_t component_count) {
+    if (replay->device) hamqtt_device_destroy(replay->device);
+
+    for (size_t i = 0; i < component_count; ++i) {
+        HAMQTT_Component *component = replay->components[i];
+        if (!component) continue;
+
+        if (component->v == &hamqtt_button_vtable) hamqtt_button_destroy((HAMQTT_Button *)component);
+        else if (component->v == &hamqtt_binary_sensor_vtable) hamqtt_binary_sensor_destroy((HAMQTT_Binary_Sensor *)component);
+    }
+
+    hamqtt_transport_destroy(replay->transport);
+}
+
+static esp_err_t bench_replay_device_create(Replay_Device *replay, const Replay_Recording *recording) {
+    memset(replay, 0, sizeof(*replay));
+
+    const cJSON *device_json = cJSON_GetObjectItemCaseSensitive(recording->discovery, "device");
+    const cJSON *origin_json = cJSON_GetObjectItemCaseSensitive(recording->discovery, "origin");
+
+    HAMQTT_Device_Config *config = &replay->device_config;
+    *config = hamqtt_device_config_default();
+    config->mqtt_config_topic_prefix = recording->config_prefix;
+    config->mqtt_uri = "mock://replay";
+    config->unique_id = recording->device_id;
+    config->name = (char *)bench_replay_json_string(device_json, "name");
+    config->manufacturer = (char *)bench_replay_json_string(device_json, "mf");
+    config->model = (char *)bench_replay_json_string(device_json, "mdl");
+    config->sw_version = (char *)bench_replay_json_string(device_json, "sw");
+    config->hw_version = (char *)bench_replay_json_string(device_json, "hw");
+    config->serial_number = (char *)bench_replay_json_string(device_json, "sn");
+    config->origin_url = (char *)bench_replay_json_string(origin_json, "url");
+    if (!config->name) config->name = recording->device_id;
+
+    esp_err_t ret = ESP_OK;
+
+    replay->device = hamqtt_device_create(config);
+    ESP_GOTO_ON_FALSE(replay->device, ESP_ERR_NO_MEM, cleanup, TAG, "Unable to create replay device");
+
+#if HAMQTT_DIAGNOSTICS
+    // The device announces its diagnostic sensors itself, exactly when the recorded one did
+    HAMQTT_Diagnostics_Config diagnostics_config = hamqtt_diagnostics_config_default();
+    if (!recording->has_diagnostics) diagnostics_config.interval_ms = 0;
+    diagnostics_config.enabled_by_default = recording->diagnostics_enabled_by_default;
+    hamqtt_device_set_diagnostics_config(replay->device, &diagnostics_config);
+#endif
+
+    for (size_t i = 0; i < recording->component_count; ++i) {
+        const cJSON *json = recording->component_json[i];
+        const char *unique_id = json->string;
+        const char *name = bench_replay_json_string(json, "name");
+
+        if (bench_replay_is_platform(json, "binary_sensor")) {
+            HAMQTT_Binary_Sensor_Config *sensor_config = &replay->sensor_configs[i];
+            *sensor_config = hamqtt_binary_sensor_config_default();
+            sensor_config->unique_id = unique_id;
+            sensor_config->name = name ? name : unique_id;
+            sensor_config->device_class = bench_replay_json_string(json, "device_class");
+            sensor_config->entity_picture = bench_replay_json_string(json, "entity_picture");
+            sensor_config->icon = bench_replay_json_string(json, "icon");
+            sensor_config->enabled_by_default = bench_replay_json_bool(json, "enabled_by_default", true);
+            sensor_config->force_update = bench_replay_json_bool(json, "force_update", false);
+            sensor_config->expire_after = bench_replay_json_int(json, "expire_after", -1);
+            sensor_config->off_delay = bench_replay_json_int(json, "off_delay", -1);
+
+            replay->states[i] = recording->initial_states[i];
+            replay->components[i] = (HAMQTT_Component *)hamqtt_binary_sensor_create(sensor_config, bench_replay_get_state, &replay->states[i]);
+        } else if (bench_replay_is_platform(json, "button")) {
+            HAMQTT_Button_Config *button_config = &replay->button_configs[i];
+            *button_config = hamqtt_button_config_default();
+            button_config->unique_id = unique_id;
+            button_config->name = name ? name : unique_id;
+            button_config->device_class = bench_replay_json_string(json, "device_class");
+            button_config->entity_picture = bench_replay_json_string(json, "entity_picture");
+            button_config->icon = bench_replay_json_string(json, "icon");
+            button_config->enabled_by_default = bench_replay_json_bool(json, "enabled_by_default", true);
+
+            replay->components[i] = (HAMQTT_Component *)hamqtt_button_create(button_config, bench_replay_on_press, NULL);
+        } else {
+            ESP_GOTO_ON_FALSE(false, ESP_ERR_NOT_SUPPORTED, cleanup, TAG, "Component %s cannot be replayed", unique_id);
+        }
+
+        ESP_GOTO_ON_FALSE(replay->components[i], ESP_ERR_NO_MEM, cleanup, TAG, "Unable to create component %s", unique_id);
+        ESP_GOTO_ON_ERROR(hamqtt_device_add_component(replay->device, replay->components[i]), cleanup, TAG, "Failed to add component %s", unique_id);
+    }
+
+    HAMQTT_Transport_Mock_Config transport_config = hamqtt_transport_mock_config_default();
+    transport_config.max_publishes = recording->publish_count * 2 + 64;
+    transport_config.buffer_size = recording->buffer_size * 2 + 4096;
+    transport_config.max_subscriptions = 2 * HAMQTT_DEVICE_MAX_COMPONENTS + 16;
+    transport_config.auto_ack = true;
+
+    replay->transport = hamqtt_transport_mock_create(&transport_config);
+    ESP_GOTO_ON_FALSE(replay->transport, ESP_ERR_NO_MEM, cleanup, TAG, "Unable to create mock transport");
+    ESP_GOTO_ON_ERROR(hamqtt_device_set_transport(replay->device, replay->transport), cleanup, TAG, "Failed to set transport");
+
+    return ESP_OK;
+
+cleanup:
+    bench_replay_device_destroy(replay, recording->component_count);
+    memset(replay, 0, sizeof(*replay));
+    return ret;
+}
+
+/* ----- Replay ----- */
+
+/**
+ * @brief Index of the next publish of the replayed device from `index` on, skipping diagnostic
+ * reports and latency probes.
+ */
+static size_t bench_replay_next_publish(const Replay_Recording *recording, const Replay_Device *replay, size_t index) {
+    size_t actual_count = hamqtt_transport_mock_get_publish_count(replay->transport);
+
+    while (index < actual_count) {
+        const char *topic = hamqtt_transport_mock_get_publish(replay->transport, index)->topic;
+        if (!bench_replay_is_live_topic(recording, topic, strlen(topic))) break;
+        index++;
+    }
+
+    return index;
+}
+
+/**
+ * @brief Compare the device's publishes with the recorded ones. Discovery payloads are compared
+ * as JSON, since recordings made with a precomputed template are formatted differently.
+ * Diagnostic reports and latency probes are skipped on both sides.
+ */
+static Replay_Result bench_replay_compare(const Replay_Recording *recording, const Replay_Device *replay) {
+    Replay_Result result = { .mismatches = 0, .first_mismatch = SIZE_MAX };
+    size_t actual_count = hamqtt_transport_mock_get_publish_count(replay->transport);
+    size_t index = 0;
+
+    for (size_t i = 0; i < recording->record_count; ++i) {
+        const HAMQTT_Transport_Record *expected = &recording->records[i];
+        if (expected->type != HAMQTT_TRANSPORT_RECORD_PUBLISH) continue;
+        if (bench_replay_is_live_topic(recording, expected->topic, expected->topic_len)) continue;
+
+        index = bench_replay_next_publish(recording, replay, index);
+        const HAMQTT_Transport_Mock_Publish *actual = hamqtt_transport_mock_get_publish(replay->transport, index++);
+        bool match = actual
+                  && bench_replay_topic_equals(expected, actual->topic)
+                  && actual->qos == expected->qos
+                  && (bool)actual->retain == expected->retain;
+
+        if (match && ((size_t)actual->data_len != expected->data_len || memcmp(actual->data, expected->data, expected->data_len) != 0)) {
+            match = false;
+
+            if (bench_replay_topic_equals(expected, recording->config_topic)) {
+                cJSON *actual_json = cJSON_ParseWithLength(actual->data, actual->data_len);
+                match = cJSON_Compare(actual_json, recording->discovery, true);
+                cJSON_Delete(actual_json);
+            }
+        }
+
+        if (!match) {
+            if (result.mismatches == 0) result.first_mismatch = index - 1;
+            result.mismatches++;
+        }
+    }
+
+    // Anything the replayed device published beyond the recording
+    for (index = bench_replay_next_publish(recording, replay, index); index < actual_count;
+         index = bench_replay_next_publish(recording, replay, index + 1)) {
+        if (result.mismatches == 0) result.first_mismatch = index;
+        result.mismatches++;
+    }
+
+    return result;
+}
+
+static void bench_replay_wait_until(uint64_t start_ns, int64_t time_us, double speed) {
+    uint64_t target_ns = start_ns + (uint64_t)((double)time_us * 1000.0 / speed);
+    uint64_t now_ns = hamqtt_bench_now_ns();
+    if (target_ns > now_ns) usleep((useconds_t)((target_ns - now_ns) / 1000));
+}
+
+/**
+ * @brief Replay the whole recording into a freshly created device.
+ */
+static esp_err_t bench_replay_run(const Replay_Recording *recording, const Replay_Options *options, bool realtime, Replay_Result *result) {
+    Replay_Device *replay = malloc(sizeof(Replay_Device));
+    ESP_RETURN_ON_FALSE(replay, ESP_ERR_NO_MEM, TAG, "Unable to allocate replay device");
+
+    esp_err_t ret = bench_replay_device_create(replay, recording);
+    if (ret != ESP_OK) {
+        free(replay);
+        return ret;
+    }
+
+    bool connected = false;
+    int64_t loop_interval_us = (int64_t)options->loop_interval_ms * 1000;
+    int64_t next_loop_us = 0;
+    uint64_t start_ns = hamqtt_bench_now_ns();
+
+    for (size_t i = 0; i < recording->record_count; ++i) {
+        const HAMQTT_Transport_Record *record = &recording->records[i];
+
+        if (realtime) bench_replay_wait_until(start_ns, record->time_us, options->speed);
+
+        // Periodic loop calls the real device made between recorded events
+        while (connected && loop_interval_us > 0 && next_loop_us <= record->time_us) {
+            hamqtt_device_loop(replay->device);
+            next_loop_us += loop_interval_us;
+        }
+
+        switch (record->type) {
+        case HAMQTT_TRANSPORT_RECORD_CONNECTED:
+            if (!connected) {
+                ESP_GOTO_ON_ERROR(hamqtt_device_connect(replay->device), cleanup, TAG, "Failed to connect replay device");
+                connected = true;
+                next_loop_us = record->time_us;
+            } else {
+                hamqtt_transport_mock_connect(replay->transport);
+            }
+            break;
+
+        case HAMQTT_TRANSPORT_RECORD_DISCONNECTED:
+            if (!connected) break;
+
+            if (recording->clean_disconnect[i]) {
+                // Publishes `offline` again and stops the transport, the next CONNECTED connects anew
+                ESP_GOTO_ON_ERROR(hamqtt_device_disconnect(replay->device), cleanup, TAG, "Failed to disconnect replay device");
+                connected = false;
+            } else {
+                hamqtt_transport_mock_disconnect(replay->transport);
+            }
+            break;
+
+        case HAMQTT_TRANSPORT_RECORD_DATA: {
+            // A probe that came back would only time the replay
+            if (bench_replay_is_live_topic(recording, record->topic, record->topic_len)) break;
+
+            char topic[HAMQTT_MAX_CHAR_BUF_SIZE];
+            size_t topic_len = record->topic_len < sizeof(topic) - 1 ? record->topic_len : sizeof(topic) - 1;
+            memcpy(topic, record->topic, topic_len);
+            topic[topic_len] = '\0';
+
+            if (record->data_len) {
+                hamqtt_transport_mock_inject_message(replay->transport, topic, record->data, (int)record->data_len);
+            } else {
+                hamqtt_transport_mock_inject_message(replay->transport, topic, "", 0);
+            }
+            break;
+        }
+
+        case HAMQTT_TRANSPORT_RECORD_PUBLISH: {
+            int sensor = recording->sensor_index[i];
+            if (sensor < 0 || !connected) break;
+
+            replay->states[sensor] = record->data_len == 2 && memcmp(record->data, "ON", 2) == 0;
+            hamqtt_device_loop(replay->device);
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    *result = bench_replay_compare(recording, replay);
+
+cleanup:
+    bench_replay_device_destroy(replay, recording->component_count);
+    free(replay);
+    return ret;
+}
+
+/* ----- Baseline ----- */
+
+/**
+ * @brief Read `key` from the baseline row for `name`, or -1 if there is none.
+ */
+static double bench_replay_baseline_value(const cJSON *baseline, const char *name, const char *key) {
+    const cJSON *results = cJSON_GetObjectItemCaseSensitive(baseline, "results");
+    const cJSON *row;
+
+    cJSON_ArrayForEach(row, results) {
+        const char *recording = bench_replay_json_string(row, "recording");
+        const cJSON *value = cJSON_GetObjectItemCaseSensitive(row, key);
+        if (recording && strcmp(recording, name) == 0 && cJSON_IsNumber(value)) return value->valuedouble;
+    }
+
+    return -1;
+}
+
+static cJSON *bench_replay_load_baseline(const char *path) {
+    uint8_t *buf = NULL;
+    size_t len = 0;
+    if (bench_replay_read_file(path, &buf, &len) != ESP_OK) return NULL;
+
+    cJSON *baseline = cJSON_ParseWithLength((const char *)buf, len);
+    free(buf);
+
+    if (!baseline) ESP_LOGE(TAG, "Baseline %s is not a JSON report", path);
+    return baseline;
+}
+
+/* ----- Main ----- */
+
+static void bench_replay_usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s --recording <path> [--realtime] [--speed <x>] [--loop-interval-ms <ms>]\n"
+            "          [--baseline <report.json>] [--max-regression-pct <pct>]\n"
+            "          [--format csv|json] [--output <path>] [--min-time-ms <ms>]\n",
+            argv0);
+}
+
+/**
+ * @brief Take the replay options out of `argv`, leaving the report options in `report_argv`.
+ */
+static bool bench_replay_parse_args(Replay_Options *options, int argc, char **argv, int *report_argc, char **report_argv) {
+    *options = (Replay_Options){ .speed = 1.0, .max_regression_pct = 5.0 };
+    *report_argc = 0;
+    report_argv[(*report_argc)++] = argv[0];
+
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+
+        if (strcmp(argv[i], "--realtime") == 0) {
+            options->realtime = true;
+        } else if (strcmp(argv[i], "--recording") == 0 && has_value) {
+            options->path = argv[++i];
+        } else if (strcmp(argv[i], "--speed") == 0 && has_value) {
+            options->speed = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--loop-interval-ms") == 0 && has_value) {
+            options->loop_interval_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--baseline") == 0 && has_value) {
+            options->baseline = argv[++i];
+        } else if (strcmp(argv[i], "--max-regression-pct") == 0 && has_value) {
+            options->max_regression_pct = strtod(argv[++i], NULL);
+        } else {
+            report_argv[(*report_argc)++] = argv[i];
+        }
+    }
+
+    return options->path && options->speed > 0;
+}
+
+int main(int argc, char **argv) {
+    Replay_Options options;
+    int report_argc;
+    char **report_argv = calloc(argc + 1, sizeof(char *));
+
+    HAMQTT_Bench_Report report;
+    if (!report_argv ||
+        !bench_replay_parse_args(&options, argc, argv, &report_argc, report_argv) ||
+        hamqtt_bench_report_open(&report, "replay", report_argc, report_argv) != ESP_OK) {
+        bench_replay_usage(argv[0]);
+        return 2;
+    }
+
+    // Recorded disconnects would otherwise log a warning on every replay
+    hamqtt_port_log_level = HAMQTT_PORT_LOG_ERROR;
+
+    Replay_Recording *recording = calloc(1, sizeof(Replay_Recording));
+    if (!recording || bench_replay_load(recording, options.path) != ESP_OK) return 1;
+
+    const char *name = strrchr(options.path, '/') ? strrchr(options.path, '/') + 1 : options.path;
+    int rc = 0;
+
+    // A first pass checks the output; in real time it is also the only pass
+    Replay_Result result;
+    if (bench_replay_run(recording, &options, options.realtime, &result) != ESP_OK) return 1;
+
+    if (result.mismatches > 0) {
+        ESP_LOGE(TAG, "%d publishes differ from the recording, starting at publish %d",
+                 (int)result.mismatches, (int)result.first_mismatch);
+        rc = 1;
+    }
+
+    size_t iterations = 0;
+    uint64_t wall_ns = 0;
+    uint64_t cpu_ns = 0;
+    uint64_t deadline_ns = options.realtime ? 0 : (uint64_t)report.min_time_ms * 1000000ULL;
+
+    hamqtt_bench_alloc_reset();
+
+    do {
+        uint64_t wall_start = hamqtt_bench_now_ns();
+        uint64_t cpu_start = bench_replay_cpu_ns();
+
+        if (!options.realtime && bench_replay_run(recording, &options, false, &result) != ESP_OK) return 1;
+
+        cpu_ns += bench_replay_cpu_ns() - cpu_start;
+        wall_ns += hamqtt_bench_now_ns() - wall_start;
+        iterations++;
+    } while (wall_ns < deadline_ns);
+
+    HAMQTT_Bench_Alloc_Stats stats = hamqtt_bench_alloc_get_stats();
+
+    size_t messages = recording->inbound_count + recording->publish_count;
+    double cpu_per_replay = (double)cpu_ns / (double)iterations;
+    double allocs_per_replay = (double)stats.allocs / (double)iterations;
+
+    hamqtt_bench_report_row_begin(&report);
+    hamqtt_bench_report_str(&report, "recording", name);
+    hamqtt_bench_report_u64(&report, "components", recording->component_count);
+    hamqtt_bench_report_u64(&report, "records", recording->record_count);
+    hamqtt_bench_report_u64(&report, "inbound", recording->inbound_count);
+    hamqtt_bench_report_u64(&report, "outbound", recording->publish_count);
+    hamqtt_bench_report_u64(&report, "duration_ms", recording->record_count ? recording->records[recording->record_count - 1].time_us / 1000 : 0);
+    hamqtt_bench_report_u64(&report, "mismatches", result.mismatches);
+    hamqtt_bench_report_u64(&report, "iterations", options.realtime ? 0 : iterations);
+    hamqtt_bench_report_f64(&report, "cpu_ns_per_replay", options.realtime ? 0 : cpu_per_replay);
+    hamqtt_bench_report_f64(&report, "cpu_ns_per_message", options.realtime || !messages ? 0 : cpu_per_replay / (double)messages);
+    hamqtt_bench_report_f64(&report, "allocs_per_replay", options.realtime ? 0 : allocs_per_replay);
+    hamqtt_bench_report_u64(&report, "peak_heap_bytes", stats.peak_bytes);
+
+    cJSON *baseline = options.baseline ? bench_replay_load_baseline(options.baseline) : NULL;
+    if (options.baseline && !baseline) rc = 1;
+
+    if (baseline && !options.realtime) {
+        double base_cpu = bench_replay_baseline_value(baseline, name, "cpu_ns_per_replay");
+        double base_allocs = bench_replay_baseline_value(baseline, name, "allocs_per_replay");
+        double cpu_change = base_cpu > 0 ? (cpu_per_replay - base_cpu) * 100.0 / base_cpu : 0;
+        double allocs_change = base_allocs > 0 ? (allocs_per_replay - base_allocs) * 100.0 / base_allocs : 0;
+
+        hamqtt_bench_report_f64(&report, "cpu_change_pct", cpu_change);
+        hamqtt_bench_report_f64(&report, "allocs_change_pct", allocs_change);
+
+        if (base_cpu < 0) {
+            ESP_LOGE(TAG, "Baseline has no result for %s", name);
+            rc = 1;
+        } else if (cpu_change > options.max_regression_pct || allocs_change > options.max_regression_pct) {
+            ESP_LOGE(TAG, "Regression against baseline: CPU %+.1f%%, allocations %+.1f%% (limit %.1f%%)",
+                     cpu_change, allocs_change, options.max_regression_pct);
+            rc = 1;
+        }
+    }
+
+    hamqtt_bench_report_row_end(&report);
+    hamqtt_bench_report_close(&report);
+
+    cJSON_Delete(baseline);
+    bench_replay_unload(recording);
+    free(recording);
+    free(report_argv);
+
+    return rc;
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file bench_routing.c
+ * @brief Measures how fast inbound messages are routed to the component they address.
+ *
+ * A device made only of buttons is connected to the mock transport, and messages are
+ * injected through `hamqtt_transport_mock_inject_message` so they take the same path as a
+ * broker delivery. For each component count, topic length and payload size the benchmark
+ * sends messages addressed to the first component, to the last component, and to a topic
+ * no component subscribes to. Throughput is timed over batches so the clock does not
+ * dominate, and the latency distribution is sampled one message at a time.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include "HAMQTT/hamqtt_transport_mock.h"
+#include "hamqtt_bench.h"
+
+#define WARMUP_MESSAGES 1000
+#define BATCH_SIZE 256
+#define MAX_SAMPLES 100000
+
+static const char *TAG = "Bench_Routing";
+
+static const size_t component_counts[] = { 1, 16, 64, 256, 1024 };
+static const size_t id_lengths[] = { 16, 48, 96 };
+static const size_t payload_sizes[] = { 5, 64, 1024 };
+
+typedef enum {
+    BENCH_ROUTING_MATCH_FIRST,
+    BENCH_ROUTING_MATCH_LAST,
+    BENCH_ROUTING_NO_MATCH,
+} Bench_Routing_Case;
+
+static const char *const case_names[] = { "match_first", "match_last", "no_match" };
+
+/**
+ * Routing does not depend on discovery, so connect with a placeholder template rather than
+ * paying for (or requiring) cJSON.
+ */
+static const char *const placeholder_fragments[] = { "{}" };
+
+/**
+ * @brief Build a payload of `size` bytes. Payloads of exactly 5 bytes are a valid press.
+ */
+static void bench_routing_fill_payload(char *payload, size_t size) {
+    if (size == 5) {
+        memcpy(payload, "PRESS", 6);
+        return;
+    }
+
+    memset(payload, 'x', size);
+    payload[size] = '\0';
+}
+
+static esp_err_t bench_routing_run(HAMQTT_Bench_Report *report,
+                                   HAMQTT_Transport *transport,
+                                   const HAMQTT_Bench_Device *bench,
+                                   Bench_Routing_Case routing_case,
+                                   size_t id_length,
+                                   const char *payload,
+                                   size_t payload_size,
+                                   uint64_t *samples) {
+    char topic[HAMQTT_MAX_CHAR_BUF_SIZE];
+
+    if (routing_case == BENCH_ROUTING_NO_MATCH) {
+        // Same length as a real command topic, differing only in the last segment
+        const char *real = hamqtt_bench_device_get_command_topic(bench, bench->component_count - 1);
+        snprintf(topic, sizeof(topic), "%s", real);
+        size_t len = strlen(topic);
+        memcpy(topic + len - 5, "xxxxx", 5);
+    } else {
+        size_t index = routing_case == BENCH_ROUTING_MATCH_FIRST ? 0 : bench->component_count - 1;
+        snprintf(topic, sizeof(topic), "%s", hamqtt_bench_device_get_command_topic(bench, index));
+    }
+
+    for (int i = 0; i < WARMUP_MESSAGES; ++i) {
+        hamqtt_transport_mock_inject_message(transport, topic, payload, (int)payload_size);
+    }
+
+    // Throughput, timed over whole batches
+    size_t messages = 0;
+    uint64_t total_ns = 0;
+    uint64_t deadline_ns = (uint64_t)report->min_time_ms * 1000000ULL;
+    uint64_t presses = hamqtt_bench_press_count;
+
+    hamqtt_bench_alloc_reset();
+
+    while (total_ns < deadline_ns) {
+        uint64_t start = hamqtt_bench_now_ns();
+        for (int i = 0; i < BATCH_SIZE; ++i) {
+            hamqtt_transport_mock_inject_message(transport, topic, payload, (int)payload_size);
+        }
+        total_ns += hamqtt_bench_now_ns() - start;
+        messages += BATCH_SIZE;
+    }
+
+    HAMQTT_Bench_Alloc_Stats stats = hamqtt_bench_alloc_get_stats();
+    presses = hamqtt_bench_press_count - presses;
+
+    // Latency distribution, one message per sample
+    size_t sample_count = messages < MAX_SAMPLES ? messages : MAX_SAMPLES;
+    for (size_t i = 0; i < sample_count; ++i) {
+        uint64_t start = hamqtt_bench_now_ns();
+        hamqtt_transport_mock_inject_message(transport, topic, payload, (int)payload_size);
+        samples[i] = hamqtt_bench_now_ns() - start;
+    }
+
+    bool expect_press = routing_case != BENCH_ROUTING_NO_MATCH && payload_size == 5;
+    ESP_RETURN_ON_FALSE(presses == (expect_press ? messages : 0),
+                        ESP_FAIL,
+                        TAG,
+                        "%s delivered %llu presses for %llu messages",
+                        case_names[routing_case],
+                        (unsigned long long)presses,
+                        (unsigned long long)messages);
+
+    double ns_per_message = (double)total_ns / (double)messages;
+
+    hamqtt_bench_report_row_begin(report);
+    hamqtt_bench_report_str(report, "case", case_names[routing_case]);
+    hamqtt_bench_report_u64(report, "components", bench->component_count);
+    hamqtt_bench_report_u64(report, "id_length", id_length);
+    hamqtt_bench_report_u64(report, "topic_bytes", strlen(topic));
+    hamqtt_bench_report_u64(report, "payload_bytes", payload_size);
+    hamqtt_bench_report_u64(report, "messages", messages);
+    hamqtt_bench_report_f64(report, "messages_per_s", 1e9 / ns_per_message);
+    hamqtt_bench_report_f64(report, "ns_per_message", ns_per_message);
+    hamqtt_bench_report_u64(report, "ns_p50", hamqtt_bench_percentile(samples, sample_count, 50));
+    hamqtt_bench_report_u64(report, "ns_p99", hamqtt_bench_percentile(samples, sample_count, 99));
+    hamqtt_bench_report_u64(report, "ns_max", hamqtt_bench_percentile(samples, sample_count, 100));
+    hamqtt_bench_report_f64(report, "allocs_per_message", (double)stats.allocs / (double)messages);
+    hamqtt_bench_report_row_end(report);
+
+    return ESP_OK;
+}
+
+static esp_err_t bench_routing_run_device(HAMQTT_Bench_Report *report,
+                                          size_t component_count,
+                                          size_t id_length,
+                                          char *payload,
+                                          uint64_t *samples) {
+    HAMQTT_Bench_Device bench;
+    HAMQTT_Bench_Device_Config config = {
+        .component_count = component_count,
+        .id_length = id_length,
+        .buttons_only = true,
+    };
+
+    ESP_RETURN_ON_ERROR(hamqtt_bench_device_create(&bench, &config), TAG, "Failed to create benchmark device");
+
+    esp_err_t ret = ESP_OK;
+
+    HAMQTT_Discovery_Template discovery = {
+        .fragments = placeholder_fragments,
+        .fragment_count = 1,
+        .component_count = component_count,
+    };
+
+    HAMQTT_Transport_Mock_Config transport_config = hamqtt_transport_mock_config_default();
+    HAMQTT_Transport *transport = hamqtt_transport_mock_create(&transport_config);
+    ESP_GOTO_ON_FALSE(transport, ESP_ERR_NO_MEM, cleanup, TAG, "Failed to create mock transport");
+
+    ESP_GOTO_ON_ERROR(hamqtt_device_set_discovery_template(bench.device, &discovery), cleanup, TAG, "Failed to set discovery template");
+    ESP_GOTO_ON_ERROR(hamqtt_device_set_transport(bench.device, transport), cleanup, TAG, "Failed to set transport");
+    ESP_GOTO_ON_ERROR(hamqtt_device_connect(bench.device), cleanup, TAG, "Failed to connect benchmark device");
+
+    for (size_t i = 0; i < sizeof(payload_sizes) / sizeof(payload_sizes[0]); ++i) {
+        bench_routing_fill_payload(payload, payload_sizes[i]);
+
+        for (int routing_case = 0; routing_case <= BENCH_ROUTING_NO_MATCH; ++routing_case) {
+            ESP_GOTO_ON_ERROR(bench_routing_run(report, transport, &bench, routing_case, id_length, payload, payload_sizes[i], samples),
+                              cleanup,
+                              TAG,
+                              "Routing run failed");
+        }
+    }
+
+cleanup:
+    hamqtt_bench_device_destroy(&bench);
+    hamqtt_transport_destroy(transport);
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    HAMQTT_Bench_Report report;
+    if (hamqtt_bench_report_open(&report, "routing", argc, argv) != ESP_OK) {
+        fprintf(stderr, "usage: %s [--format csv|json] [--output <path>] [--min-time-ms <ms>]\n", argv[0]);
+        return 2;
+    }
+
+    uint64_t *samples = malloc(MAX_SAMPLES * sizeof(uint64_t));
+    char *payload = malloc(payload_sizes[sizeof(payload_sizes) / sizeof(payload_sizes[0]) - 1] + 1);
+    if (!samples || !payload) return 1;
+
+    int rc = 0;
+
+    for (size_t i = 0; i < sizeof(component_counts) / sizeof(component_counts[0]); ++i) {
+        if (component_counts[i] > HAMQTT_DEVICE_MAX_COMPONENTS) {
+            ESP_LOGW(TAG, "Skipping %d components, configure with -DCONFIG_HAMQTT_DEVICE_MAX_COMPONENTS=%d",
+                     (int)component_counts[i], (int)component_counts[i]);
+            continue;
+        }
+
+        for (size_t j = 0; j < sizeof(id_lengths) / sizeof(id_lengths[0]); ++j) {
+            if (bench_routing_run_device(&report, component_counts[i], id_lengths[j], payload, samples) != ESP_OK) rc = 1;
+        }
+    }
+
+    free(payload);
+    free(samples);
+    hamqtt_bench_report_close(&report);
+
+    return rc;
+}
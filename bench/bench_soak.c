@@ -0,0 +1,254 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file bench_soak.c
+ * @brief Soak test for heap leaks and fragmentation across connect/disconnect cycles.
+ *
+ * A device is connected to the mock transport and disconnected again, over and over. In
+ * each cycle it publishes discovery, availability and a state change, handles a button
+ * press, and on every fourth cycle also loses and regains its connection without being
+ * told to disconnect. Every sample is taken at the same point of a cycle, so the device
+ * holds exactly the same memory each time.
+ *
+ * Each row reports the bytes and blocks HAMQTT and cJSON have allocated, and the shape of
+ * the glibc heap. glibc does not report its largest free block, so the free space at the
+ * top of the heap, which large allocations are carved from, is reported instead, along
+ * with the free space trapped in holes below it. The run fails if the allocated bytes or
+ * blocks at the end differ from the first sample, or if the heap or its holes grew by more
+ * than `--max-growth-pct`.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <malloc.h>
+
+#include "HAMQTT/hamqtt_transport_mock.h"
+#include "hamqtt_bench.h"
+
+#define SOAK_COMPONENTS 16
+
+/**
+ * Heap growth below this many bytes is allocator noise rather than a trend.
+ */
+#define SOAK_GROWTH_FLOOR_BYTES 4096
+
+static const char *TAG = "Bench_Soak";
+
+#if !HAMQTT_RUNTIME_DISCOVERY
+static const char *const placeholder_fragments[] = { "{}" };
+#endif
+
+typedef struct {
+    uint64_t cycles;
+    uint32_t samples;
+    double max_growth_pct;
+} Soak_Options;
+
+typedef struct {
+    int64_t live_bytes;
+    int64_t live_blocks;
+    int64_t heap_bytes;
+    int64_t heap_top_free_bytes;
+    int64_t heap_hole_bytes;
+} Soak_Sample;
+
+static Soak_Sample bench_soak_sample(void) {
+    HAMQTT_Bench_Alloc_Stats stats = hamqtt_bench_alloc_get_stats();
+
+    Soak_Sample sample = {
+        .live_bytes = stats.current_bytes,
+        .live_blocks = (int64_t)(stats.allocs - stats.frees),
+    };
+
+#ifdef __GLIBC__
+    struct mallinfo2 info = mallinfo2();
+    sample.heap_bytes = (int64_t)info.arena;
+    sample.heap_top_free_bytes = (int64_t)info.keepcost;
+    sample.heap_hole_bytes = (int64_t)(info.fordblks - info.keepcost);
+#endif
+
+    return sample;
+}
+
+static bool bench_soak_grew(int64_t first, int64_t last, double max_growth_pct) {
+    int64_t allowed = (int64_t)((double)first * max_growth_pct / 100.0);
+    if (allowed < SOAK_GROWTH_FLOOR_BYTES) allowed = SOAK_GROWTH_FLOOR_BYTES;
+
+    return last - first > allowed;
+}
+
+static esp_err_t bench_soak_cycle(HAMQTT_Bench_Device *bench, HAMQTT_Transport *transport, const char *press_topic, uint64_t cycle) {
+    ESP_RETURN_ON_ERROR(hamqtt_device_connect(bench->device), TAG, "Failed to connect in cycle %llu", (unsigned long long)cycle);
+
+    hamqtt_bench_sensor_state = !hamqtt_bench_sensor_state;
+    hamqtt_device_loop(bench->device);
+
+    if (press_topic) hamqtt_transport_mock_inject_message(transport, press_topic, "PRESS", 5);
+
+    // A dropped connection that the transport recovers from on its own
+    if (cycle % 4 == 3) {
+        hamqtt_transport_mock_disconnect(transport);
+        hamqtt_transport_mock_connect(transport);
+        hamqtt_device_loop(bench->device);
+    }
+
+    ESP_RETURN_ON_ERROR(hamqtt_device_disconnect(bench->device), TAG, "Failed to disconnect in cycle %llu", (unsigned long long)cycle);
+
+    hamqtt_transport_mock_clear_publishes(transport);
+
+    return ESP_OK;
+}
+
+static void bench_soak_usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [--cycles <n>] [--samples <n>] [--max-growth-pct <pct>]\n"
+            "          [--format csv|json] [--output <path>]\n",
+            argv0);
+}
+
+/**
+ * @brief Take the soak options out of `argv`, leaving the report options in `report_argv`.
+ */
+static bool bench_soak_parse_args(Soak_Options *options, int argc, char **argv, int *report_argc, char **report_argv) {
+    *options = (Soak_Options){ .cycles = 100000, .samples = 20, .max_growth_pct = 5.0 };
+    *report_argc = 0;
+    report_argv[(*report_argc)++] = argv[0];
+
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+
+        if (strcmp(argv[i], "--cycles") == 0 && has_value) {
+            options->cycles = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--samples") == 0 && has_value) {
+            options->samples = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-growth-pct") == 0 && has_value) {
+            options->max_growth_pct = strtod(argv[++i], NULL);
+        } else {
+            report_argv[(*report_argc)++] = argv[i];
+        }
+    }
+
+    return options->samples >= 2 && options->cycles >= options->samples;
+}
+
+int main(int argc, char **argv) {
+    Soak_Options options;
+    int report_argc;
+    char **report_argv = calloc(argc + 1, sizeof(char *));
+
+    HAMQTT_Bench_Report report;
+    if (!report_argv ||
+        !bench_soak_parse_args(&options, argc, argv, &report_argc, report_argv) ||
+        hamqtt_bench_report_open(&report, "soak", report_argc, report_argv) != ESP_OK) {
+        bench_soak_usage(argv[0]);
+        return 2;
+    }
+
+    // Every cycle disconnects on purpose, which would otherwise log warnings
+    hamqtt_port_log_level = HAMQTT_PORT_LOG_ERROR;
+
+    HAMQTT_Bench_Device bench;
+    HAMQTT_Bench_Device_Config config = {
+        .component_count = SOAK_COMPONENTS < HAMQTT_DEVICE_MAX_COMPONENTS ? SOAK_COMPONENTS : HAMQTT_DEVICE_MAX_COMPONENTS,
+        .full_fields = true,
+    };
+    if (hamqtt_bench_device_create(&bench, &config) != ESP_OK) return 1;
+
+    HAMQTT_Transport_Mock_Config transport_config = hamqtt_transport_mock_config_default();
+    transport_config.auto_ack = true;
+    HAMQTT_Transport *transport = hamqtt_transport_mock_create(&transport_config);
+    if (!transport) return 1;
+
+    hamqtt_device_set_transport(bench.device, transport);
+
+#if !HAMQTT_RUNTIME_DISCOVERY
+    HAMQTT_Discovery_Template discovery = {
+        .fragments = placeholder_fragments,
+        .fragment_count = 1,
+        .component_count = bench.component_count,
+    };
+    hamqtt_device_set_discovery_template(bench.device, &discovery);
+#endif
+
+    // The first cycle builds the device's topics, which it keeps until it is destroyed
+    int rc = bench_soak_cycle(&bench, transport, NULL, 0) == ESP_OK ? 0 : 1;
+
+    const char *press_topic = NULL;
+    for (size_t i = 0; i < bench.component_count && !press_topic; ++i) {
+        press_topic = hamqtt_bench_device_get_command_topic(&bench, i);
+    }
+
+    hamqtt_bench_alloc_reset();
+
+    Soak_Sample first = {0};
+    Soak_Sample last = {0};
+    uint64_t cycles_per_sample = options.cycles / options.samples;
+    uint64_t presses = hamqtt_bench_press_count;
+    uint64_t cycle = 1;
+
+    for (uint32_t s = 0; s < options.samples && rc == 0; ++s) {
+        uint64_t start = hamqtt_bench_now_ns();
+
+        for (uint64_t i = 0; i < cycles_per_sample && rc == 0; ++i, ++cycle) {
+            if (bench_soak_cycle(&bench, transport, press_topic, cycle) != ESP_OK) rc = 1;
+        }
+
+        uint64_t elapsed_ns = hamqtt_bench_now_ns() - start;
+
+        last = bench_soak_sample();
+        if (s == 0) first = last;
+
+        hamqtt_bench_report_row_begin(&report);
+        hamqtt_bench_report_u64(&report, "cycles", cycle - 1);
+        hamqtt_bench_report_f64(&report, "ns_per_cycle", (double)elapsed_ns / (double)cycles_per_sample);
+        hamqtt_bench_report_u64(&report, "live_bytes", last.live_bytes);
+        hamqtt_bench_report_u64(&report, "live_blocks", last.live_blocks);
+        hamqtt_bench_report_u64(&report, "heap_bytes", last.heap_bytes);
+        hamqtt_bench_report_u64(&report, "heap_top_free_bytes", last.heap_top_free_bytes);
+        hamqtt_bench_report_u64(&report, "heap_hole_bytes", last.heap_hole_bytes);
+        hamqtt_bench_report_row_end(&report);
+    }
+
+    if (press_topic && hamqtt_bench_press_count - presses != cycle - 1) {
+        ESP_LOGE(TAG, "%llu presses were delivered in %llu cycles",
+                 (unsigned long long)(hamqtt_bench_press_count - presses), (unsigned long long)(cycle - 1));
+        rc = 1;
+    }
+
+    if (last.live_bytes != first.live_bytes || last.live_blocks != first.live_blocks) {
+        ESP_LOGE(TAG, "Leak: %+lld bytes in %+lld blocks since the first sample",
+                 (long long)(last.live_bytes - first.live_bytes), (long long)(last.live_blocks - first.live_blocks));
+        rc = 1;
+    }
+
+    if (bench_soak_grew(first.heap_bytes, last.heap_bytes, options.max_growth_pct) ||
+        bench_soak_grew(first.heap_hole_bytes, last.heap_hole_bytes, options.max_growth_pct)) {
+        ESP_LOGE(TAG, "Fragmentation: heap grew from %lld to %lld bytes, holes from %lld to %lld bytes",
+                 (long long)first.heap_bytes, (long long)last.heap_bytes,
+                 (long long)first.heap_hole_bytes, (long long)last.heap_hole_bytes);
+        rc = 1;
+    }
+
+    hamqtt_bench_device_destroy(&bench);
+    hamqtt_transport_destroy(transport);
+    hamqtt_bench_report_close(&report);
+    free(report_argv);
+
+    return rc;
+}
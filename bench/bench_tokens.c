@@ -0,0 +1,143 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file bench_tokens.c
+ * @brief Compares the shared command payload decoder with a chain of `strcmp` calls.
+ *
+ * The chain tests the payloads in the order of @ref HAMQTT_TOKEN_LIST, as a component with an
+ * `if (strcmp(...))` per payload would. Each payload is decoded both ways, the first and last
+ * of the chain show its best and worst case, and unknown payloads of a known length, of an
+ * unknown length and longer than any payload show how cheaply each rejects them.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include "HAMQTT/hamqtt_token_internal.h"
+#include "hamqtt_bench.h"
+
+#define BATCH_SIZE 1024
+
+static const char *TAG = "Bench_Tokens";
+
+typedef enum {
+    BENCH_TOKENS_DECODER,
+    BENCH_TOKENS_STRCMP,
+} Bench_Tokens_Method;
+
+static const char *const method_names[] = { "decoder", "strcmp" };
+
+typedef struct {
+    const char *name;
+    const char *payload;
+    HAMQTT_Token expected;
+} Bench_Tokens_Case;
+
+static char long_payload[256];
+
+static const Bench_Tokens_Case cases[] = {
+#define BENCH_TOKENS_CASE(name, text, last) { #name, text, HAMQTT_TOKEN_##name },
+    HAMQTT_TOKEN_LIST(BENCH_TOKENS_CASE)
+#undef BENCH_TOKENS_CASE
+    { "unknown_known_length", "PRESX", HAMQTT_TOKEN_UNKNOWN },
+    { "unknown_length", "TOGGLE_ALL", HAMQTT_TOKEN_UNKNOWN },
+    { "unknown_long", long_payload, HAMQTT_TOKEN_UNKNOWN },
+    { "empty", "", HAMQTT_TOKEN_UNKNOWN },
+};
+
+/**
+ * @brief The chain components would otherwise write. Not inlined, like a handler's chain in
+ * another translation unit.
+ */
+__attribute__((noinline)) static HAMQTT_Token bench_tokens_strcmp(const char *data) {
+#define BENCH_TOKENS_STRCMP(name, text, last) if (strcmp(data, text) == 0) return HAMQTT_TOKEN_##name;
+    HAMQTT_TOKEN_LIST(BENCH_TOKENS_STRCMP)
+#undef BENCH_TOKENS_STRCMP
+    return HAMQTT_TOKEN_UNKNOWN;
+}
+
+__attribute__((noinline)) static HAMQTT_Token bench_tokens_decoder(const char *data) {
+    return hamqtt_token_decode_str(data);
+}
+
+static HAMQTT_Token bench_tokens_decode(Bench_Tokens_Method method, const char *data) {
+    return method == BENCH_TOKENS_DECODER ? bench_tokens_decoder(data) : bench_tokens_strcmp(data);
+}
+
+static esp_err_t bench_tokens_run(HAMQTT_Bench_Report *report, const Bench_Tokens_Case *bench_case, Bench_Tokens_Method method) {
+    // Read through a volatile pointer so the payload is not folded into the loop
+    const char *volatile payload = bench_case->payload;
+
+    HAMQTT_Token token = bench_tokens_decode(method, payload);
+    ESP_RETURN_ON_FALSE(token == bench_case->expected,
+                        ESP_FAIL,
+                        TAG,
+                        "%s decoded %s as %d instead of %d",
+                        method_names[method], bench_case->name, (int)token, (int)bench_case->expected);
+
+    size_t decodes = 0;
+    size_t mismatches = 0;
+    uint64_t total_ns = 0;
+    uint64_t deadline_ns = (uint64_t)report->min_time_ms * 1000000ULL;
+
+    while (total_ns < deadline_ns) {
+        uint64_t start = hamqtt_bench_now_ns();
+        for (int i = 0; i < BATCH_SIZE; ++i) {
+            if (bench_tokens_decode(method, payload) != bench_case->expected) mismatches++;
+        }
+        total_ns += hamqtt_bench_now_ns() - start;
+        decodes += BATCH_SIZE;
+    }
+
+    ESP_RETURN_ON_FALSE(mismatches == 0, ESP_FAIL, TAG, "%s mis-decoded %s", method_names[method], bench_case->name);
+
+    double ns_per_decode = (double)total_ns / (double)decodes;
+
+    hamqtt_bench_report_row_begin(report);
+    hamqtt_bench_report_str(report, "method", method_names[method]);
+    hamqtt_bench_report_str(report, "payload", bench_case->name);
+    hamqtt_bench_report_u64(report, "payload_bytes", strlen(bench_case->payload));
+    hamqtt_bench_report_u64(report, "decodes", decodes);
+    hamqtt_bench_report_f64(report, "ns_per_decode", ns_per_decode);
+    hamqtt_bench_report_f64(report, "decodes_per_s", 1e9 / ns_per_decode);
+    hamqtt_bench_report_row_end(report);
+
+    return ESP_OK;
+}
+
+int main(int argc, char **argv) {
+    HAMQTT_Bench_Report report;
+    if (hamqtt_bench_report_open(&report, "tokens", argc, argv) != ESP_OK) {
+        fprintf(stderr, "usage: %s [--format csv|json] [--output <path>] [--min-time-ms <ms>]\n", argv[0]);
+        return 2;
+    }
+
+    memset(long_payload, 'x', sizeof(long_payload) - 1);
+
+    int rc = 0;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        for (int method = BENCH_TOKENS_DECODER; method <= BENCH_TOKENS_STRCMP; ++method) {
+            if (bench_tokens_run(&report, &cases[i], method) != ESP_OK) rc = 1;
+        }
+    }
+
+    hamqtt_bench_report_close(&report);
+
+    return rc;
+}
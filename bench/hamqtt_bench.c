@@ -0,0 +1,407 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_bench.c
+ * @brief Shared helpers for the HAMQTT host benchmarks.
+ *
+ * Heap accounting relies on the benchmarks being linked with
+ * `-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free`, which redirects every
+ * allocation made by HAMQTT (and by cJSON, through its hooks) to the functions below.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <malloc.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "hamqtt_bench.h"
+
+static const char *TAG = "HAMQTT_Bench";
+
+/* ----- Clock ----- */
+
+uint64_t hamqtt_bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* ----- Heap accounting ----- */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static atomic_uint_fast64_t alloc_count;
+static atomic_uint_fast64_t free_count;
+static atomic_int_fast64_t current_bytes;
+static atomic_int_fast64_t peak_bytes;
+
+static void hamqtt_bench_alloc_add(int64_t bytes) {
+    int64_t current = atomic_fetch_add_explicit(&current_bytes, bytes, memory_order_relaxed) + bytes;
+    int64_t peak = atomic_load_explicit(&peak_bytes, memory_order_relaxed);
+
+    while (current > peak &&
+           !atomic_compare_exchange_weak_explicit(&peak_bytes, &peak, current, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+void *__wrap_malloc(size_t size) {
+    void *ptr = __real_malloc(size);
+    if (ptr) {
+        atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+        hamqtt_bench_alloc_add((int64_t)malloc_usable_size(ptr));
+    }
+    return ptr;
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    void *ptr = __real_calloc(count, size);
+    if (ptr) {
+        atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+        hamqtt_bench_alloc_add((int64_t)malloc_usable_size(ptr));
+    }
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    int64_t old_size = ptr ? (int64_t)malloc_usable_size(ptr) : 0;
+
+    void *new_ptr = __real_realloc(ptr, size);
+    if (!new_ptr) return NULL;
+
+    if (!ptr) atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+    hamqtt_bench_alloc_add((int64_t)malloc_usable_size(new_ptr) - old_size);
+
+    return new_ptr;
+}
+
+void __wrap_free(void *ptr) {
+    if (!ptr) return;
+
+    atomic_fetch_add_explicit(&free_count, 1, memory_order_relaxed);
+    hamqtt_bench_alloc_add(-(int64_t)malloc_usable_size(ptr));
+
+    __real_free(ptr);
+}
+
+void hamqtt_bench_alloc_reset(void) {
+    atomic_store(&alloc_count, 0);
+    atomic_store(&free_count, 0);
+    atomic_store(&current_bytes, 0);
+    atomic_store(&peak_bytes, 0);
+}
+
+HAMQTT_Bench_Alloc_Stats hamqtt_bench_alloc_get_stats(void) {
+    HAMQTT_Bench_Alloc_Stats stats = {
+        .allocs = atomic_load(&alloc_count),
+        .frees = atomic_load(&free_count),
+        .current_bytes = atomic_load(&current_bytes),
+        .peak_bytes = atomic_load(&peak_bytes),
+    };
+    return stats;
+}
+
+/* ----- Statistics ----- */
+
+static int hamqtt_bench_compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+uint64_t hamqtt_bench_percentile(uint64_t *samples, size_t count, double p) {
+    if (count == 0) return 0;
+
+    qsort(samples, count, sizeof(uint64_t), hamqtt_bench_compare_u64);
+
+    size_t index = (size_t)(p / 100.0 * (double)(count - 1) + 0.5);
+    return samples[index < count ? index : count - 1];
+}
+
+/* ----- Device fixture ----- */
+
+uint64_t hamqtt_bench_press_count;
+bool hamqtt_bench_sensor_state;
+
+typedef union {
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+    HAMQTT_Binary_Sensor_Config binary_sensor;
+#endif
+#if CONFIG_HAMQTT_COMPONENT_BUTTON
+    HAMQTT_Button_Config button;
+#endif
+    char unused;
+} HAMQTT_Bench_Component_Config;
+
+static bool hamqtt_bench_get_state(void *args) {
+    return hamqtt_bench_sensor_state;
+}
+
+static void hamqtt_bench_on_press(void *args) {
+    hamqtt_bench_press_count++;
+}
+
+static bool hamqtt_bench_is_button(const HAMQTT_Bench_Device_Config *config, size_t index) {
+#if CONFIG_HAMQTT_COMPONENT_BUTTON && CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+    return config->buttons_only || index % 2 == 1;
+#elif CONFIG_HAMQTT_COMPONENT_BUTTON
+    return true;
+#else
+    return false;
+#endif
+}
+
+esp_err_t hamqtt_bench_device_create(HAMQTT_Bench_Device *bench, const HAMQTT_Bench_Device_Config *config) {
+    memset(bench, 0, sizeof(*bench));
+
+    ESP_RETURN_ON_FALSE(config->component_count <= HAMQTT_DEVICE_MAX_COMPONENTS,
+                        ESP_ERR_INVALID_SIZE,
+                        TAG,
+                        "%d components requested but CONFIG_HAMQTT_DEVICE_MAX_COMPONENTS is %d",
+                        (int)config->component_count,
+                        HAMQTT_DEVICE_MAX_COMPONENTS);
+
+    bench->device_config = hamqtt_device_config_default();
+    bench->device_config.mqtt_uri = "mock://bench";
+    bench->device_config.unique_id = "bench-node";
+    bench->device_config.name = "Benchmark Node";
+
+    if (config->full_fields) {
+        bench->device_config.manufacturer = "HAMQTT";
+        bench->device_config.model = "Benchmark Node";
+        bench->device_config.serial_number = "SN-000000000001";
+        bench->device_config.sw_version = "1.0.0";
+        bench->device_config.hw_version = "rev-b";
+        bench->device_config.origin_url = "https://github.com/EdenBarnes/HAMQTT";
+    }
+
+    bench->device = hamqtt_device_create(&bench->device_config);
+    ESP_RETURN_ON_FALSE(bench->device, ESP_ERR_NO_MEM, TAG, "Unable to create benchmark device");
+
+    bench->component_count = config->component_count;
+    bench->id_size = (config->id_length > 16 ? config->id_length : 16) + 1;
+    bench->components = calloc(config->component_count, sizeof(HAMQTT_Component *));
+    bench->component_configs = calloc(config->component_count, sizeof(HAMQTT_Bench_Component_Config));
+    bench->ids = calloc(config->component_count, bench->id_size);
+
+    if (config->component_count && (!bench->components || !bench->component_configs || !bench->ids)) {
+        hamqtt_bench_device_destroy(bench);
+        ESP_LOGE(TAG, "Unable to allocate benchmark components");
+        return ESP_ERR_NO_MEM;
+    }
+
+    HAMQTT_Bench_Component_Config *configs = bench->component_configs;
+
+    for (size_t i = 0; i < config->component_count; ++i) {
+        char *id = bench->ids + i * bench->id_size;
+        int id_len = snprintf(id, bench->id_size, "entity_%zu", i);
+        while ((size_t)id_len < config->id_length) id[id_len++] = 'x';
+        id[id_len] = '\0';
+
+        HAMQTT_Component *component = NULL;
+
+        if (hamqtt_bench_is_button(config, i)) {
+#if CONFIG_HAMQTT_COMPONENT_BUTTON
+            HAMQTT_Button_Config *button_config = &configs[i].button;
+            *button_config = hamqtt_button_config_default();
+            button_config->unique_id = id;
+            button_config->name = "Benchmark Button";
+            if (config->full_fields) {
+                button_config->device_class = "restart";
+                button_config->icon = "mdi:restart";
+                button_config->entity_picture = "https://example.com/button.png";
+                button_config->enabled_by_default = false;
+            }
+            component = (HAMQTT_Component *)hamqtt_button_create(button_config, hamqtt_bench_on_press, NULL);
+#endif
+        } else {
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+            HAMQTT_Binary_Sensor_Config *sensor_config = &configs[i].binary_sensor;
+            *sensor_config = hamqtt_binary_sensor_config_default();
+            sensor_config->unique_id = id;
+            sensor_config->name = "Benchmark Binary Sensor";
+            if (config->full_fields) {
+                sensor_config->device_class = "door";
+                sensor_config->icon = "mdi:door";
+                sensor_config->entity_picture = "https://example.com/sensor.png";
+                sensor_config->expire_after = 300;
+                sensor_config->force_update = true;
+                sensor_config->off_delay = 5;
+            }
+            component = (HAMQTT_Component *)hamqtt_binary_sensor_create(sensor_config, hamqtt_bench_get_state, NULL);
+#endif
+        }
+
+        bench->components[i] = component;
+
+        if (!component || hamqtt_device_add_component(bench->device, component) != ESP_OK) {
+            hamqtt_bench_device_destroy(bench);
+            ESP_LOGE(TAG, "Unable to create benchmark component %d", (int)i);
+            return ESP_FAIL;
+        }
+    }
+
+    return ESP_OK;
+}
+
+const char *hamqtt_bench_device_get_command_topic(const HAMQTT_Bench_Device *bench, size_t index) {
+    size_t count = 0;
+    const char *const *topics = hamqtt_component_get_subscribed_topics(bench->components[index], &count);
+    return count > 0 ? topics[0] : NULL;
+}
+
+void hamqtt_bench_device_destroy(HAMQTT_Bench_Device *bench) {
+    if (bench->device) hamqtt_device_destroy(bench->device);
+
+    for (size_t i = 0; bench->components && i < bench->component_count; ++i) {
+        HAMQTT_Component *component = bench->components[i];
+        if (!component) continue;
+
+        // Read once, the component is freed by the first matching destroy
+        const HAMQTT_Component_VTable *v = component->v;
+#if CONFIG_HAMQTT_COMPONENT_BUTTON
+        if (v == &hamqtt_button_vtable) hamqtt_button_destroy((HAMQTT_Button *)component);
+#endif
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+        if (v == &hamqtt_binary_sensor_vtable) hamqtt_binary_sensor_destroy((HAMQTT_Binary_Sensor *)component);
+#endif
+    }
+
+    free(bench->components);
+    free(bench->component_configs);
+    free(bench->ids);
+    memset(bench, 0, sizeof(*bench));
+}
+
+/* ----- Reports ----- */
+
+esp_err_t hamqtt_bench_report_open(HAMQTT_Bench_Report *report, const char *name, int argc, char **argv) {
+    memset(report, 0, sizeof(*report));
+    report->name = name;
+    report->out = stdout;
+    report->format = HAMQTT_BENCH_FORMAT_CSV;
+    report->min_time_ms = 200;
+
+    const char *output = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        ESP_RETURN_ON_FALSE(i + 1 < argc, ESP_ERR_INVALID_ARG, TAG, "Missing value for %s", argv[i]);
+
+        if (strcmp(argv[i], "--format") == 0) {
+            const char *format = argv[++i];
+            if (strcmp(format, "csv") == 0) {
+                report->format = HAMQTT_BENCH_FORMAT_CSV;
+            } else if (strcmp(format, "json") == 0) {
+                report->format = HAMQTT_BENCH_FORMAT_JSON;
+            } else {
+                ESP_LOGE(TAG, "Unknown format %s, expected csv or json", format);
+                return ESP_ERR_INVALID_ARG;
+            }
+        } else if (strcmp(argv[i], "--output") == 0) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--min-time-ms") == 0) {
+            report->min_time_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else {
+            ESP_LOGE(TAG, "Unknown argument %s", argv[i]);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    if (output) {
+        report->out = fopen(output, "w");
+        ESP_RETURN_ON_FALSE(report->out, ESP_ERR_INVALID_ARG, TAG, "Unable to open %s", output);
+    }
+
+    hamqtt_port_log_level = HAMQTT_PORT_LOG_WARN;
+
+#if HAMQTT_RUNTIME_DISCOVERY
+    // Count cJSON's allocations even when it is a shared library
+    cJSON_Hooks hooks = { .malloc_fn = malloc, .free_fn = free };
+    cJSON_InitHooks(&hooks);
+#endif
+
+    if (report->format == HAMQTT_BENCH_FORMAT_JSON) {
+        fprintf(report->out, "{\n  \"benchmark\": \"%s\",\n  \"max_components\": %d,\n  \"results\": [",
+                name, HAMQTT_DEVICE_MAX_COMPONENTS);
+    }
+
+    return ESP_OK;
+}
+
+static void hamqtt_bench_report_field(HAMQTT_Bench_Report *report, const char *key, const char *value, bool quote) {
+    size_t header_len = strlen(report->header);
+    size_t row_len = strlen(report->row);
+    const char *separator = report->field_count > 0 ? "," : "";
+
+    if (report->format == HAMQTT_BENCH_FORMAT_CSV) {
+        if (report->row_count == 0) {
+            snprintf(report->header + header_len, sizeof(report->header) - header_len, "%s%s", separator, key);
+        }
+        snprintf(report->row + row_len, sizeof(report->row) - row_len, "%s%s", separator, value);
+    } else {
+        snprintf(report->row + row_len, sizeof(report->row) - row_len, "%s\"%s\": %s%s%s",
+                 report->field_count > 0 ? ", " : "", key, quote ? "\"" : "", value, quote ? "\"" : "");
+    }
+
+    report->field_count++;
+}
+
+void hamqtt_bench_report_row_begin(HAMQTT_Bench_Report *report) {
+    report->row[0] = '\0';
+    report->field_count = 0;
+}
+
+void hamqtt_bench_report_str(HAMQTT_Bench_Report *report, const char *key, const char *value) {
+    hamqtt_bench_report_field(report, key, value, true);
+}
+
+void hamqtt_bench_report_u64(HAMQTT_Bench_Report *report, const char *key, uint64_t value) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%llu", (unsigned long long)value);
+    hamqtt_bench_report_field(report, key, buf, false);
+}
+
+void hamqtt_bench_report_f64(HAMQTT_Bench_Report *report, const char *key, double value) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.2f", value);
+    hamqtt_bench_report_field(report, key, buf, false);
+}
+
+void hamqtt_bench_report_row_end(HAMQTT_Bench_Report *report) {
+    if (report->format == HAMQTT_BENCH_FORMAT_CSV) {
+        if (report->row_count == 0) fprintf(report->out, "%s\n", report->header);
+        fprintf(report->out, "%s\n", report->row);
+    } else {
+        fprintf(report->out, "%s\n    {%s}", report->row_count > 0 ? "," : "", report->row);
+    }
+
+    fflush(report->out);
+    report->row_count++;
+}
+
+void hamqtt_bench_report_close(HAMQTT_Bench_Report *report) {
+    if (report->format == HAMQTT_BENCH_FORMAT_JSON) {
+        fprintf(report->out, "\n  ]\n}\n");
+    }
+
+    if (report->out != stdout) fclose(report->out);
+}
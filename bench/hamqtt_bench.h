@@ -0,0 +1,183 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_bench.h
+ * @brief Shared helpers for the HAMQTT host benchmarks.
+ *
+ * Provides a monotonic clock, heap accounting through linker-wrapped `malloc`/`free`,
+ * a device fixture with a configurable number of components, and a report writer that
+ * emits CSV or JSON so results can be compared across versions.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "HAMQTT.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----- Clock ----- */
+
+/**
+ * @brief Returns a monotonic timestamp in nanoseconds.
+ */
+uint64_t hamqtt_bench_now_ns(void);
+
+/* ----- Heap accounting ----- */
+
+/**
+ * @brief Heap activity observed since the last @ref hamqtt_bench_alloc_reset.
+ */
+typedef struct {
+    uint64_t allocs;        ///< Number of successful malloc, calloc and realloc(NULL, ...) calls.
+    uint64_t frees;         ///< Number of free calls on non-NULL pointers.
+    int64_t current_bytes;  ///< Bytes currently allocated, relative to the reset.
+    int64_t peak_bytes;     ///< Highest value of `current_bytes`.
+} HAMQTT_Bench_Alloc_Stats;
+
+/**
+ * @brief Zero the counters and start measuring peak usage from the current heap size.
+ */
+void hamqtt_bench_alloc_reset(void);
+
+/**
+ * @brief Get the heap activity since the last reset.
+ */
+HAMQTT_Bench_Alloc_Stats hamqtt_bench_alloc_get_stats(void);
+
+/* ----- Statistics ----- */
+
+/**
+ * @brief Sort `samples` in place and return the value at percentile `p` (0 to 100).
+ */
+uint64_t hamqtt_bench_percentile(uint64_t *samples, size_t count, double p);
+
+/* ----- Device fixture ----- */
+
+/**
+ * @brief Shape of the device built by @ref hamqtt_bench_device_create.
+ */
+typedef struct {
+    size_t component_count;     ///< Number of components to add.
+    bool full_fields;           ///< Fill every optional discovery field instead of only the required ones.
+    size_t id_length;           ///< Pad component unique ids to at least this many characters.
+    bool buttons_only;          ///< Only create buttons, so every component subscribes to a topic.
+} HAMQTT_Bench_Device_Config;
+
+/**
+ * @brief A device with generated components, and the storage backing their configurations.
+ */
+typedef struct {
+    HAMQTT_Device_Config device_config;
+    HAMQTT_Device *device;
+
+    HAMQTT_Component **components;
+    void *component_configs;
+    char *ids;
+    size_t component_count;
+    size_t id_size;
+} HAMQTT_Bench_Device;
+
+/**
+ * @brief Number of times a benchmark button has been pressed.
+ */
+extern uint64_t hamqtt_bench_press_count;
+
+/**
+ * @brief State reported by every benchmark binary sensor.
+ */
+extern bool hamqtt_bench_sensor_state;
+
+/**
+ * @brief Build a device with generated components. Components alternate between binary
+ * sensors and buttons, depending on which component types are enabled.
+ *
+ * @param[out] bench The fixture to initialize.
+ * @param config Shape of the device.
+ * @return ESP_OK on success, or an appropriate error code on failure.
+ */
+esp_err_t hamqtt_bench_device_create(HAMQTT_Bench_Device *bench, const HAMQTT_Bench_Device_Config *config);
+
+/**
+ * @brief Get the topic a component subscribes to, or NULL if it does not subscribe to any.
+ *
+ * The device must have built its topics, e.g. through `hamqtt_device_build_discovery_payload`.
+ */
+const char *hamqtt_bench_device_get_command_topic(const HAMQTT_Bench_Device *bench, size_t index);
+
+/**
+ * @brief Destroy the device, its components and their configurations.
+ */
+void hamqtt_bench_device_destroy(HAMQTT_Bench_Device *bench);
+
+/* ----- Reports ----- */
+
+/**
+ * @brief Output formats of a benchmark report.
+ */
+typedef enum {
+    HAMQTT_BENCH_FORMAT_CSV,
+    HAMQTT_BENCH_FORMAT_JSON,
+} HAMQTT_Bench_Format;
+
+/**
+ * @brief Writer for a table of benchmark results.
+ */
+typedef struct {
+    const char *name;
+    FILE *out;
+    HAMQTT_Bench_Format format;
+    uint32_t min_time_ms;
+    size_t row_count;
+    size_t field_count;
+    char header[1024];
+    char row[2048];
+} HAMQTT_Bench_Report;
+
+/**
+ * @brief Parse the common benchmark arguments and open the report.
+ *
+ * Recognized arguments are `--format csv|json`, `--output <path>` and `--min-time-ms <ms>`.
+ * Also lowers the HAMQTT log level and routes cJSON allocations through the heap accounting.
+ *
+ * @param[out] report The report to open.
+ * @param name Name of the benchmark, written into JSON reports.
+ * @param argc Argument count from `main`.
+ * @param argv Arguments from `main`.
+ * @return ESP_OK on success, or ESP_ERR_INVALID_ARG if the arguments could not be parsed.
+ */
+esp_err_t hamqtt_bench_report_open(HAMQTT_Bench_Report *report, const char *name, int argc, char **argv);
+
+void hamqtt_bench_report_row_begin(HAMQTT_Bench_Report *report);
+void hamqtt_bench_report_str(HAMQTT_Bench_Report *report, const char *key, const char *value);
+void hamqtt_bench_report_u64(HAMQTT_Bench_Report *report, const char *key, uint64_t value);
+void hamqtt_bench_report_f64(HAMQTT_Bench_Report *report, const char *key, double value);
+void hamqtt_bench_report_row_end(HAMQTT_Bench_Report *report);
+
+/**
+ * @brief Finish the report and close its output file.
+ */
+void hamqtt_bench_report_close(HAMQTT_Bench_Report *report);
+
+#ifdef __cplusplus
+}
+#endif
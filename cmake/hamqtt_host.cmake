@@ -0,0 +1,106 @@
+# Copyright 2025 Ethan Barnes
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Native Linux build of HAMQTT.
+#
+# Mirrors the Kconfig options as CONFIG_* cache variables and writes them to a generated
+# sdkconfig.h, so the library sources build unchanged. cJSON is needed for runtime
+# discovery and libmosquitto for the POSIX transport; both are optional.
+
+set(CONFIG_HAMQTT_DEVICE_MAX_COMPONENTS 16 CACHE STRING "Max HAMQTT Device Components")
+set(CONFIG_HAMQTT_MAX_CHAR_BUF_SIZE 128 CACHE STRING "Maximum Character Buffer Size")
+set(CONFIG_HAMQTT_MQTT_CONNECT_TIMEOUT_MS 10000 CACHE STRING "MQTT Connection Timeout (ms)")
+option(CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR "Build the binary sensor component" ON)
+option(CONFIG_HAMQTT_COMPONENT_BUTTON "Build the button component" ON)
+option(CONFIG_HAMQTT_COMPONENT_GROUP "Build the group component" ON)
+option(CONFIG_HAMQTT_RUNTIME_DISCOVERY "Build discovery payloads at runtime (needs cJSON)" ON)
+option(CONFIG_HAMQTT_TRANSPORT_MOCK "Build the in-process mock transport" ON)
+option(CONFIG_HAMQTT_TRANSPORT_RECORD "Build the traffic recording transport" ON)
+option(CONFIG_HAMQTT_LATENCY "Latency instrumentation" OFF)
+set(CONFIG_HAMQTT_LATENCY_PROBE_INTERVAL_MS 0 CACHE STRING "Loopback probe interval (ms)")
+option(CONFIG_HAMQTT_DIAGNOSTICS "Diagnostic sensors" OFF)
+option(CONFIG_HAMQTT_CONSOLE "Console command" OFF)
+option(CONFIG_HAMQTT_PIPELINE "Dual-core pipeline" OFF)
+set(CONFIG_HAMQTT_PIPELINE_EXECUTION_CORE 1 CACHE STRING "Execution task core")
+set(CONFIG_HAMQTT_PIPELINE_RING_SIZE 8 CACHE STRING "Command ring slots")
+option(CONFIG_HAMQTT_RULES "Local automation rules" OFF)
+option(CONFIG_HAMQTT_SCENE "Scenes" OFF)
+set(CONFIG_HAMQTT_SCENE_MAX_PAYLOAD 512 CACHE STRING "Largest scene in bytes")
+set(CONFIG_HAMQTT_SCENE_MAX_ENTITIES 16 CACHE STRING "Most entities in a scene")
+option(CONFIG_HAMQTT_ATTRIBUTES "Entity attributes" OFF)
+option(CONFIG_HAMQTT_TRACE "Chrome trace event export (host only)" OFF)
+option(HAMQTT_BUILD_EXAMPLES "Build the Linux examples (needs libmosquitto)" ON)
+option(HAMQTT_BUILD_BENCHMARKS "Build the host benchmarks in bench/" ON)
+option(HAMQTT_BUILD_TOOLS "Build the host tools in tools/ (needs libmosquitto)" ON)
+option(HAMQTT_BUILD_TESTS "Build the host tests in test/ and register them with CTest" ON)
+
+find_package(PkgConfig QUIET)
+find_package(Threads REQUIRED)
+
+if(PKG_CONFIG_FOUND)
+    pkg_check_modules(CJSON IMPORTED_TARGET libcjson)
+    pkg_check_modules(MOSQUITTO IMPORTED_TARGET libmosquitto)
+endif()
+
+if(CONFIG_HAMQTT_RUNTIME_DISCOVERY AND NOT CJSON_FOUND)
+    message(WARNING "HAMQTT: cJSON not found, building without runtime discovery")
+    set(CONFIG_HAMQTT_RUNTIME_DISCOVERY OFF CACHE BOOL "Build discovery payloads at runtime (needs cJSON)" FORCE)
+endif()
+
+# Diagnostic sensors are announced through runtime discovery, as in Kconfig
+if(CONFIG_HAMQTT_DIAGNOSTICS AND NOT CONFIG_HAMQTT_RUNTIME_DISCOVERY)
+    message(WARNING "HAMQTT: diagnostics need runtime discovery, building without them")
+    set(CONFIG_HAMQTT_DIAGNOSTICS OFF CACHE BOOL "Diagnostic sensors" FORCE)
+endif()
+
+if(MOSQUITTO_FOUND)
+    set(CONFIG_HAMQTT_TRANSPORT_POSIX ON)
+else()
+    message(STATUS "HAMQTT: libmosquitto not found, building without the POSIX transport")
+    set(CONFIG_HAMQTT_TRANSPORT_POSIX OFF)
+endif()
+
+set(HAMQTT_HOST_CONFIG_DIR "${CMAKE_CURRENT_BINARY_DIR}/hamqtt_config")
+configure_file("${CMAKE_CURRENT_LIST_DIR}/hamqtt_host_sdkconfig.h.in" "${HAMQTT_HOST_CONFIG_DIR}/sdkconfig.h")
+
+# hamqtt_host_add_library(<target> <sources>...)
+#
+# Builds the HAMQTT library for the host from the same source list as the ESP-IDF component.
+
+function(hamqtt_host_add_library target)
+    set(srcs ${ARGN} "src/port/hamqtt_port_linux.c")
+    if(CONFIG_HAMQTT_TRANSPORT_POSIX)
+        list(APPEND srcs "src/transport/hamqtt_transport_posix.c")
+    endif()
+    if(CONFIG_HAMQTT_TRACE)
+        list(APPEND srcs "src/hamqtt_trace.c")
+    endif()
+
+    add_library(${target} STATIC ${srcs})
+    target_include_directories(${target} PUBLIC
+        "${CMAKE_CURRENT_SOURCE_DIR}/include"
+        "${CMAKE_CURRENT_SOURCE_DIR}"
+        "${HAMQTT_HOST_CONFIG_DIR}"
+    )
+    target_compile_features(${target} PUBLIC c_std_11)
+    target_compile_options(${target} PRIVATE -Wall -Wextra -Wno-unused-parameter -Wno-sign-compare)
+    target_link_libraries(${target} PUBLIC Threads::Threads)
+
+    if(CONFIG_HAMQTT_RUNTIME_DISCOVERY)
+        target_link_libraries(${target} PUBLIC PkgConfig::CJSON)
+    endif()
+    if(CONFIG_HAMQTT_TRANSPORT_POSIX)
+        target_link_libraries(${target} PUBLIC PkgConfig::MOSQUITTO)
+    endif()
+endfunction()
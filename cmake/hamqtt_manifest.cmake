@@ -0,0 +1,50 @@
+# Copyright 2025 Ethan Barnes
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# hamqtt_generate_discovery(<target> <manifest>)
+#
+# Generates <manifest-stem>_hamqtt.{c,h} from a device manifest at build time and
+# adds them to <target>. See tools/hamqtt_manifest.py for the manifest format.
+
+set(HAMQTT_MANIFEST_TOOL "${CMAKE_CURRENT_LIST_DIR}/../tools/hamqtt_manifest.py")
+
+function(hamqtt_generate_discovery target manifest)
+    get_filename_component(manifest "${manifest}" ABSOLUTE)
+    get_filename_component(name "${manifest}" NAME_WE)
+
+    if(COMMAND idf_build_get_property)
+        idf_build_get_property(python PYTHON)
+    else()
+        find_package(Python3 REQUIRED COMPONENTS Interpreter)
+        set(python "${Python3_EXECUTABLE}")
+    endif()
+
+    set(out_dir "${CMAKE_CURRENT_BINARY_DIR}/hamqtt_generated")
+    set(out_src "${out_dir}/${name}_hamqtt.c")
+    set(out_hdr "${out_dir}/${name}_hamqtt.h")
+
+    add_custom_command(
+        OUTPUT "${out_src}" "${out_hdr}"
+        COMMAND "${python}" "${HAMQTT_MANIFEST_TOOL}"
+                --manifest "${manifest}"
+                --out-dir "${out_dir}"
+                --name "${name}"
+        DEPENDS "${manifest}" "${HAMQTT_MANIFEST_TOOL}"
+        COMMENT "Generating HAMQTT discovery payload from ${name}"
+        VERBATIM
+    )
+
+    target_sources(${target} PRIVATE "${out_src}")
+    target_include_directories(${target} PRIVATE "${out_dir}")
+endfunction()
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file main.c
+ * @brief Minimal HAMQTT device running natively on Linux against a local mosquitto broker.
+ *
+ * Usage: `hamqtt_linux_basic [mqtt://host:port]`. The binary sensor toggles every five
+ * seconds, and pressing the button in Home Assistant logs a message. In builds with
+ * `CONFIG_HAMQTT_TRACE`, setting `HAMQTT_TRACE=<path>` writes a Chrome trace of the run.
+ * Setting `HAMQTT_RECORD=<path>` records the device's MQTT traffic for `bench_replay`.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <time.h>
+#include <unistd.h>
+
+#include "HAMQTT.h"
+
+#if CONFIG_HAMQTT_TRANSPORT_RECORD
+#include "HAMQTT/hamqtt_transport_record.h"
+#endif
+
+static const char *TAG = "Linux_Basic";
+
+static bool door_open_get_state(void *arg) {
+    return (time(NULL) / 5) % 2;
+}
+
+static void bell_on_press(void *arg) {
+    ESP_LOGI(TAG, "Bell pressed");
+}
+
+#if CONFIG_HAMQTT_TRANSPORT_RECORD
+static void record_write(void *arg, const void *data, size_t len) {
+    fwrite(data, 1, len, (FILE *)arg);
+    fflush((FILE *)arg);
+}
+#endif
+
+int main(int argc, char **argv) {
+#if HAMQTT_TRACE
+    const char *trace_path = getenv("HAMQTT_TRACE");
+    if (trace_path) hamqtt_trace_start(trace_path);
+#endif
+
+    HAMQTT_Device_Config dev_cfg = hamqtt_device_config_default();
+    dev_cfg.mqtt_uri   = argc > 1 ? argv[1] : "mqtt://localhost:1883";
+    dev_cfg.unique_id  = "linux-hall-node";
+    dev_cfg.name       = "Linux Hall Node";
+
+    HAMQTT_Device *device = hamqtt_device_create(&dev_cfg);
+    if (!device) return 1;
+
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+    HAMQTT_Binary_Sensor_Config bin_cfg = hamqtt_binary_sensor_config_default();
+    bin_cfg.unique_id = "hall_door_state";
+    bin_cfg.name      = "Hall Door";
+
+    HAMQTT_Binary_Sensor *door = hamqtt_binary_sensor_create(&bin_cfg, door_open_get_state, NULL);
+    hamqtt_device_add_component(device, (HAMQTT_Component *)door);
+#endif
+
+#if CONFIG_HAMQTT_COMPONENT_BUTTON
+    HAMQTT_Button_Config btn_cfg = hamqtt_button_config_default();
+    btn_cfg.unique_id = "hall_bell";
+    btn_cfg.name      = "Hall Bell";
+
+    HAMQTT_Button *bell = hamqtt_button_create(&btn_cfg, bell_on_press, NULL);
+    hamqtt_device_add_component(device, (HAMQTT_Component *)bell);
+#endif
+
+#if CONFIG_HAMQTT_TRANSPORT_RECORD
+    const char *record_path = getenv("HAMQTT_RECORD");
+    if (record_path) {
+        FILE *record_file = fopen(record_path, "wb");
+        HAMQTT_Transport_Record_Config record_cfg = {
+            .inner = hamqtt_transport_default_create(),
+            .write_func = record_write,
+            .write_func_args = record_file,
+        };
+
+        HAMQTT_Transport *recorder = record_file && record_cfg.inner ? hamqtt_transport_record_create(&record_cfg) : NULL;
+        if (!recorder) {
+            ESP_LOGE(TAG, "Unable to record to %s", record_path);
+            return 1;
+        }
+        hamqtt_device_set_transport(device, recorder);
+    }
+#endif
+
+    if (hamqtt_device_connect(device) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to connect to %s", dev_cfg.mqtt_uri);
+        hamqtt_device_destroy(device);
+        return 1;
+    }
+
+    while (true) {
+        hamqtt_device_loop(device);
+        usleep(500 * 1000);
+    }
+}
@@ -34,21 +34,88 @@
 
 #include <stdbool.h>
 
-#include "cJSON.h"
-
-#include "esp_system.h"
-#include "esp_log.h"
-#include "esp_err.h"
-#include "esp_check.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
-#include "freertos/event_groups.h"
-
-#include "mqtt_client.h"
-
 #include "sdkconfig.h"
 
+#include "hamqtt_port.h"
+
 #define HAMQTT_DEVICE_MAX_COMPONENTS CONFIG_HAMQTT_DEVICE_MAX_COMPONENTS
 #define HAMQTT_MAX_CHAR_BUF_SIZE CONFIG_HAMQTT_MAX_CHAR_BUF_SIZE
 
-#define HAMQTT_MQTT_CONNECT_TIMEOUT_MS CONFIG_HAMQTT_MQTT_CONNECT_TIMEOUT_MS
\ No newline at end of file
+#define HAMQTT_MQTT_CONNECT_TIMEOUT_MS CONFIG_HAMQTT_MQTT_CONNECT_TIMEOUT_MS
+
+#ifdef CONFIG_HAMQTT_RUNTIME_DISCOVERY
+#define HAMQTT_RUNTIME_DISCOVERY 1
+#else
+#define HAMQTT_RUNTIME_DISCOVERY 0
+#endif
+
+#ifdef CONFIG_HAMQTT_LATENCY
+#define HAMQTT_LATENCY 1
+#else
+#define HAMQTT_LATENCY 0
+#endif
+
+#ifdef CONFIG_HAMQTT_DIAGNOSTICS
+#define HAMQTT_DIAGNOSTICS 1
+#else
+#define HAMQTT_DIAGNOSTICS 0
+#endif
+
+#ifdef CONFIG_HAMQTT_CONSOLE
+#define HAMQTT_CONSOLE 1
+#else
+#define HAMQTT_CONSOLE 0
+#endif
+
+#ifdef CONFIG_HAMQTT_PIPELINE
+#define HAMQTT_PIPELINE 1
+#else
+#define HAMQTT_PIPELINE 0
+#endif
+
+// Rules are triggered by binary sensors
+#if defined(CONFIG_HAMQTT_RULES) && defined(CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR)
+#define HAMQTT_RULES 1
+#else
+#define HAMQTT_RULES 0
+#endif
+
+#ifdef CONFIG_HAMQTT_SCENE
+#define HAMQTT_SCENE 1
+#else
+#define HAMQTT_SCENE 0
+#endif
+
+#ifdef CONFIG_HAMQTT_ATTRIBUTES
+#define HAMQTT_ATTRIBUTES 1
+#else
+#define HAMQTT_ATTRIBUTES 0
+#endif
+
+// Trace export writes to a file, so it is only available in host builds
+#if defined(CONFIG_HAMQTT_TRACE) && !defined(ESP_PLATFORM)
+#define HAMQTT_TRACE 1
+#else
+#define HAMQTT_TRACE 0
+#endif
+
+#if HAMQTT_RUNTIME_DISCOVERY
+#include "cJSON.h"
+#else
+typedef struct cJSON cJSON;
+#endif
+
+/**
+ * @brief Suppresses override warnings in designated initializers that layer user fields over defaults.
+ *
+ * Used by the static `*_DEFINE` macros, which start from a component's default configuration.
+ */
+#define HAMQTT_OVERRIDE_INIT_BEGIN \
+    _Pragma("GCC diagnostic push") \
+    _Pragma("GCC diagnostic ignored \"-Woverride-init\"")
+
+/**
+ * @brief Restores the warnings suppressed by @ref HAMQTT_OVERRIDE_INIT_BEGIN.
+ */
+#define HAMQTT_OVERRIDE_INIT_END \
+    _Pragma("GCC diagnostic pop")
@@ -0,0 +1,460 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt.hpp
+ * @brief Header-only C++17 API with compile-time topics and devirtualized dispatch.
+ *
+ * For firmware whose device and entities are fixed at compile time, this layer computes
+ * every topic string and the full discovery payload with `constexpr`, keeps all state in
+ * statically sized storage and dispatches `update` / `handle_message` through templates,
+ * so there are no heap objects, no indirect calls and no runtime `snprintf`.
+ *
+ * Entities and the device are described by traits structs with `static constexpr` strings
+ * created with @ref hamqtt::literal :
+ *
+ * @code
+ * struct Node {
+ *     static constexpr auto unique_id = hamqtt::literal("hall_node");
+ *     static constexpr auto name = hamqtt::literal("Hall Sensor Node");
+ * };
+ *
+ * struct Door {
+ *     static constexpr auto unique_id = hamqtt::literal("hall_door_state");
+ *     static constexpr auto name = hamqtt::literal("Hall Door");
+ *     static constexpr auto device_class = hamqtt::literal("door");
+ *     static bool get_state() { return gpio_get_level(DOOR_GPIO); }
+ * };
+ *
+ * struct Bell {
+ *     static constexpr auto unique_id = hamqtt::literal("hall_bell");
+ *     static constexpr auto name = hamqtt::literal("Hall Bell");
+ *     static void on_press() { ring(); }
+ * };
+ *
+ * hamqtt::Device<Node, hamqtt::BinarySensor<Door>, hamqtt::Button<Bell>> device;
+ *
+ * device.connect("mqtt://broker");
+ * while (true) {
+ *     device.loop();
+ *     vTaskDelay(pdMS_TO_TICKS(500));
+ * }
+ * @endcode
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "common.h"
+#include "hamqtt_transport.h"
+
+namespace hamqtt {
+
+/* ----- Compile-time strings ----- */
+
+/**
+ * @brief A fixed-length string usable in constant expressions.
+ *
+ * @tparam N Length of the string, excluding the NUL terminator.
+ */
+template <std::size_t N>
+struct FixedString {
+    char chars[N + 1] = {};
+
+    constexpr FixedString() = default;
+
+    constexpr FixedString(const char (&str)[N + 1]) {
+        for (std::size_t i = 0; i < N; ++i) chars[i] = str[i];
+    }
+
+    static constexpr std::size_t size() { return N; }
+    constexpr const char *c_str() const { return chars; }
+    constexpr char operator[](std::size_t i) const { return chars[i]; }
+};
+
+/**
+ * @brief Create a @ref FixedString from a string literal.
+ */
+template <std::size_t N>
+constexpr FixedString<N - 1> literal(const char (&str)[N]) {
+    return FixedString<N - 1>(str);
+}
+
+/**
+ * @brief Concatenate any number of @ref FixedString values at compile time.
+ */
+template <std::size_t... Ns>
+constexpr FixedString<(Ns + ... + 0)> concat(const FixedString<Ns> &...parts) {
+    FixedString<(Ns + ... + 0)> out;
+    std::size_t pos = 0;
+    auto append = [&out, &pos](const auto &part) {
+        for (std::size_t i = 0; i < part.size(); ++i) out.chars[pos++] = part[i];
+    };
+    (append(parts), ...);
+    return out;
+}
+
+namespace detail {
+
+constexpr FixedString<0> join_comma() { return {}; }
+
+template <std::size_t N, std::size_t... Ns>
+constexpr auto join_comma(const FixedString<N> &first, const FixedString<Ns> &...rest) {
+    if constexpr (sizeof...(Ns) == 0) {
+        return first;
+    } else {
+        return concat(first, literal(","), join_comma(rest...));
+    }
+}
+
+/**
+ * Strings are spliced into the discovery JSON verbatim, so they must not need escaping.
+ */
+template <std::size_t N>
+constexpr bool is_json_safe(const FixedString<N> &str) {
+    for (std::size_t i = 0; i < N; ++i) {
+        char c = str[i];
+        if (c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20) return false;
+    }
+    return true;
+}
+
+template <std::size_t N>
+inline bool matches(const FixedString<N> &expected, const char *str, int len) {
+    return len == static_cast<int>(N) && std::memcmp(expected.c_str(), str, N) == 0;
+}
+
+/**
+ * Declares `has_<member><T>` and `optional_<member><T>()`, which yields `,"<key>":"<value>"`
+ * when the traits struct `T` defines `member`, or an empty string otherwise.
+ */
+#define HAMQTT_DETAIL_OPTIONAL_FIELD(member, key)                                                   \
+    template <typename T, typename = void>                                                          \
+    struct has_##member : std::false_type {};                                                       \
+    template <typename T>                                                                           \
+    struct has_##member<T, std::void_t<decltype(T::member)>> : std::true_type {};                   \
+    template <typename T>                                                                           \
+    constexpr auto optional_##member() {                                                            \
+        if constexpr (has_##member<T>::value) {                                                     \
+            static_assert(is_json_safe(T::member), #member " must not need JSON escaping");         \
+            return concat(literal(",\"" key "\":\""), T::member, literal("\""));                    \
+        } else {                                                                                    \
+            return FixedString<0>{};                                                                \
+        }                                                                                           \
+    }
+
+HAMQTT_DETAIL_OPTIONAL_FIELD(device_class, "device_class")
+HAMQTT_DETAIL_OPTIONAL_FIELD(entity_picture, "entity_picture")
+HAMQTT_DETAIL_OPTIONAL_FIELD(icon, "icon")
+HAMQTT_DETAIL_OPTIONAL_FIELD(manufacturer, "mf")
+HAMQTT_DETAIL_OPTIONAL_FIELD(model, "mdl")
+HAMQTT_DETAIL_OPTIONAL_FIELD(sw_version, "sw")
+HAMQTT_DETAIL_OPTIONAL_FIELD(hw_version, "hw")
+HAMQTT_DETAIL_OPTIONAL_FIELD(origin_url, "url")
+
+#undef HAMQTT_DETAIL_OPTIONAL_FIELD
+
+template <typename T, typename = void>
+struct has_discovery_prefix : std::false_type {};
+template <typename T>
+struct has_discovery_prefix<T, std::void_t<decltype(T::discovery_prefix)>> : std::true_type {};
+
+template <typename Entity>
+constexpr auto entity_common_fields() {
+    static_assert(is_json_safe(Entity::unique_id), "unique_id must not need JSON escaping");
+    static_assert(is_json_safe(Entity::name), "name must not need JSON escaping");
+
+    return concat(literal(",\"unique_id\":\""), Entity::unique_id,
+                  literal("\",\"name\":\""), Entity::name, literal("\""),
+                  optional_device_class<Entity>(),
+                  optional_entity_picture<Entity>(),
+                  optional_icon<Entity>());
+}
+
+} // namespace detail
+
+/* ----- Components ----- */
+
+/**
+ * @brief A binary sensor whose state is read from `Entity::get_state()`.
+ *
+ * `Entity` must define `unique_id`, `name` and `static bool get_state()`, and may define
+ * `device_class`, `entity_picture` and `icon`.
+ */
+template <typename Entity>
+class BinarySensor {
+public:
+    template <typename Dev>
+    static constexpr auto state_topic = concat(Dev::unique_id, literal("/"), Entity::unique_id, literal("/state"));
+
+    template <typename Dev>
+    static constexpr auto discovery = concat(literal("\""), Entity::unique_id,
+                                             literal("\":{\"p\":\"binary_sensor\",\"state_topic\":\""),
+                                             state_topic<Dev>, literal("\""),
+                                             detail::entity_common_fields<Entity>(),
+                                             literal("}"));
+
+    template <typename Dev>
+    void subscribe(HAMQTT_Transport * /* transport */) {}
+
+    template <typename Dev>
+    bool handle_message(const char * /* topic */, int /* topic_len */, const char * /* data */, int /* data_len */) {
+        return false;
+    }
+
+    template <typename Dev>
+    void update(HAMQTT_Transport *transport) {
+        bool state = Entity::get_state();
+
+        if (has_sent_state_ && state == previous_state_) return;
+        has_sent_state_ = true;
+        previous_state_ = state;
+
+        hamqtt_transport_publish(transport, state_topic<Dev>.c_str(), state ? "ON" : "OFF", state ? 2 : 3, 1, 1);
+    }
+
+private:
+    bool has_sent_state_ = false;
+    bool previous_state_ = false;
+};
+
+/**
+ * @brief A button which calls `Entity::on_press()` when pressed in Home Assistant.
+ *
+ * `Entity` must define `unique_id`, `name` and `static void on_press()`, and may define
+ * `device_class`, `entity_picture` and `icon`.
+ */
+template <typename Entity>
+class Button {
+public:
+    template <typename Dev>
+    static constexpr auto command_topic = concat(Dev::unique_id, literal("/"), Entity::unique_id, literal("/press"));
+
+    template <typename Dev>
+    static constexpr auto discovery = concat(literal("\""), Entity::unique_id,
+                                             literal("\":{\"p\":\"button\",\"command_topic\":\""),
+                                             command_topic<Dev>, literal("\""),
+                                             detail::entity_common_fields<Entity>(),
+                                             literal("}"));
+
+    template <typename Dev>
+    void subscribe(HAMQTT_Transport *transport) {
+        hamqtt_transport_subscribe(transport, command_topic<Dev>.c_str(), 1);
+    }
+
+    template <typename Dev>
+    bool handle_message(const char *topic, int topic_len, const char *data, int data_len) {
+        if (!detail::matches(command_topic<Dev>, topic, topic_len)) return false;
+
+        if (detail::matches(literal("PRESS"), data, data_len)) Entity::on_press();
+
+        return true;
+    }
+
+    template <typename Dev>
+    void update(HAMQTT_Transport * /* transport */) {}
+};
+
+/* ----- Device ----- */
+
+/**
+ * @brief A Home Assistant device made of a fixed set of components.
+ *
+ * `DeviceTraits` must define `unique_id` and `name`, and may define `manufacturer`, `model`,
+ * `sw_version`, `hw_version`, `origin_url` and `discovery_prefix` (defaults to `homeassistant`).
+ *
+ * @tparam DeviceTraits Traits struct describing the device.
+ * @tparam Components Component types, e.g. `BinarySensor<Door>`.
+ */
+template <typename DeviceTraits, typename... Components>
+class Device {
+    static_assert(detail::is_json_safe(DeviceTraits::unique_id), "unique_id must not need JSON escaping");
+    static_assert(detail::is_json_safe(DeviceTraits::name), "name must not need JSON escaping");
+
+    static constexpr auto discovery_prefix() {
+        if constexpr (detail::has_discovery_prefix<DeviceTraits>::value) {
+            return DeviceTraits::discovery_prefix;
+        } else {
+            return literal("homeassistant");
+        }
+    }
+
+public:
+    static constexpr auto availability_topic = concat(DeviceTraits::unique_id, literal("/availability"));
+
+    static constexpr auto config_topic = concat(discovery_prefix(), literal("/device/"),
+                                                DeviceTraits::unique_id, literal("/config"));
+
+    static constexpr auto discovery_payload = concat(
+        literal("{\"device\":{\"ids\":\""), DeviceTraits::unique_id,
+        literal("\",\"name\":\""), DeviceTraits::name, literal("\""),
+        detail::optional_manufacturer<DeviceTraits>(),
+        detail::optional_model<DeviceTraits>(),
+        detail::optional_sw_version<DeviceTraits>(),
+        detail::optional_hw_version<DeviceTraits>(),
+        literal("},\"origin\":{\"name\":\""), DeviceTraits::name, literal("\""),
+        detail::optional_sw_version<DeviceTraits>(),
+        detail::optional_origin_url<DeviceTraits>(),
+        literal("},\"cmps\":{"),
+        detail::join_comma(Components::template discovery<DeviceTraits>...),
+        literal("},\"availability_topic\":\""), availability_topic,
+        literal("\",\"qos\":\"1\"}"));
+
+    Device() = default;
+    Device(const Device &) = delete;
+    Device &operator=(const Device &) = delete;
+
+    ~Device() {
+        if (owns_transport_) hamqtt_transport_destroy(transport_);
+    }
+
+    /**
+     * @brief Use an application-provided transport instead of the platform default.
+     *
+     * Must be called before `connect`. The transport is not destroyed by the device.
+     */
+    void set_transport(HAMQTT_Transport *transport) {
+        if (owns_transport_) hamqtt_transport_destroy(transport_);
+        transport_ = transport;
+        owns_transport_ = false;
+    }
+
+    /**
+     * @brief Connect to the MQTT broker and publish the precomputed discovery payload.
+     *
+     * @param uri The URI of the MQTT broker.
+     * @param username The MQTT username, or nullptr.
+     * @param password The MQTT password, or nullptr.
+     * @return ESP_OK on success, or an error code on failure.
+     */
+    esp_err_t connect(const char *uri, const char *username = nullptr, const char *password = nullptr) {
+        if (!transport_) {
+            transport_ = hamqtt_transport_default_create();
+            ESP_RETURN_ON_FALSE(transport_, ESP_FAIL, TAG, "Unable to create MQTT transport");
+            owns_transport_ = true;
+        }
+
+        HAMQTT_Transport_Config transport_config = {};
+        transport_config.uri = uri;
+        transport_config.username = username;
+        transport_config.password = password;
+
+        transport_config.will_topic = availability_topic.c_str();
+        transport_config.will_msg = "offline";
+        transport_config.will_qos = 1;
+        transport_config.will_retain = true;
+
+        hamqtt_transport_set_event_handler(transport_, &Device::transport_event_handler, this);
+
+        ESP_RETURN_ON_ERROR(hamqtt_transport_init(transport_, &transport_config), TAG, "Failed to initialize MQTT transport");
+        ESP_RETURN_ON_ERROR(hamqtt_transport_start(transport_), TAG, "Failed to start MQTT transport");
+        ESP_RETURN_ON_ERROR(hamqtt_transport_wait_connected(transport_, HAMQTT_MQTT_CONNECT_TIMEOUT_MS),
+                            TAG, "MQTT Failed to connect within timeout");
+
+        ESP_LOGI(TAG, "Publishing Configuration");
+        hamqtt_transport_publish(transport_, config_topic.c_str(), discovery_payload.c_str(),
+                                 discovery_payload.size(), 1, 1);
+
+        return ESP_OK;
+    }
+
+    /**
+     * @brief Publish the device as offline and disconnect from the MQTT broker.
+     *
+     * The transport is kept, so `connect` can be called again.
+     */
+    esp_err_t disconnect() {
+        ESP_RETURN_ON_FALSE(transport_, ESP_ERR_INVALID_STATE, TAG, "Tried to disconnect before MQTT connection was created");
+
+        publish_availability(false);
+
+        return hamqtt_transport_stop(transport_);
+    }
+
+    /**
+     * @brief Publish an availability message to Home Assistant.
+     */
+    esp_err_t publish_availability(bool availability) {
+        ESP_RETURN_ON_FALSE(transport_, ESP_ERR_INVALID_STATE, TAG, "Tried to publish availability before MQTT connection was created");
+
+        hamqtt_transport_publish(transport_, availability_topic.c_str(), availability ? "online" : "offline", 0, 1, 1);
+
+        return ESP_OK;
+    }
+
+    /**
+     * @brief Update the state of all components and publish to MQTT.
+     */
+    void loop() {
+        std::apply([this](auto &...components) {
+            (components.template update<DeviceTraits>(transport_), ...);
+        }, components_);
+    }
+
+    /**
+     * @brief Route an inbound MQTT message to the component subscribed to its topic.
+     *
+     * The topic and payload do not need to be NUL terminated.
+     */
+    void handle_mqtt_message(const char *topic, int topic_len, const char *data, int data_len) {
+        std::apply([&](auto &...components) {
+            (components.template handle_message<DeviceTraits>(topic, topic_len, data, data_len) || ...);
+        }, components_);
+    }
+
+private:
+    static constexpr const char *TAG = "HAMQTT_Device";
+
+    static void transport_event_handler(void *handler_args, const HAMQTT_Transport_Event *event) {
+        Device *device = static_cast<Device *>(handler_args);
+
+        switch (event->type) {
+        case HAMQTT_TRANSPORT_EVENT_CONNECTED:
+            ESP_LOGI(TAG, "MQTT Connected");
+            device->publish_availability(true);
+            std::apply([device](auto &...components) {
+                (components.template subscribe<DeviceTraits>(device->transport_), ...);
+            }, device->components_);
+            break;
+
+        case HAMQTT_TRANSPORT_EVENT_DISCONNECTED:
+            ESP_LOGW(TAG, "MQTT Lost Connection");
+            break;
+
+        case HAMQTT_TRANSPORT_EVENT_DATA:
+            device->handle_mqtt_message(event->topic, event->topic_len, event->data, event->data_len);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    std::tuple<Components...> components_;
+    HAMQTT_Transport *transport_ = nullptr;
+    bool owns_transport_ = false;
+};
+
+} // namespace hamqtt
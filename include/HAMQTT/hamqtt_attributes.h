@@ -0,0 +1,132 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_attributes.h
+ * @brief Extra Home Assistant attributes for any component, published to its json_attributes_topic.
+ *
+ * A set of attributes is a fixed list of typed slots, such as a firmware string, a calibration
+ * offset or a signal quality. Setting a slot to a new value marks it dirty; setting it to the
+ * value it already has does nothing. `hamqtt_device_loop` then rewrites only the dirty slots
+ * in a buffer sized for the largest values when the set was created, and publishes the object
+ * once, retained, to `<device unique_id>/<component unique_id>/attributes`.
+ *
+ * Home Assistant replaces all attributes of an entity with each message, so every publish
+ * carries every slot that has a value. Slots that were never set are left out.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "common.h"
+#include "hamqtt_component.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Type of an attribute slot.
+ */
+typedef enum {
+    HAMQTT_ATTRIBUTE_BOOL,
+    HAMQTT_ATTRIBUTE_INT,
+    HAMQTT_ATTRIBUTE_FLOAT,
+    HAMQTT_ATTRIBUTE_STRING,
+} HAMQTT_Attribute_Type;
+
+/**
+ * @brief Description of one attribute slot.
+ */
+typedef struct {
+    const char *key;                ///< Attribute name. Must not need JSON escaping.
+    HAMQTT_Attribute_Type type;     ///< Type of the values the slot takes.
+    uint8_t precision;              ///< Decimals written for floats, at most 6.
+    uint8_t max_len;                ///< Longest string value in bytes, for strings. Longer values are truncated.
+} HAMQTT_Attribute_Config;
+
+/**
+ * @struct HAMQTT_Attributes
+ * @brief Attribute values and their serialized form.
+ */
+typedef struct HAMQTT_Attributes HAMQTT_Attributes;
+
+/**
+ * @brief Create a set of attributes.
+ *
+ * @param slots Slot descriptions. The array is only read here, but the keys must outlive the set.
+ * @param slot_count Number of slots.
+ * @return Pointer to the attributes, or NULL if a key is missing or needs escaping, a
+ *         precision is above 6, or memory ran out.
+ *
+ * @memberof HAMQTT_Attributes
+ */
+HAMQTT_Attributes *hamqtt_attributes_create(const HAMQTT_Attribute_Config *slots, size_t slot_count);
+
+/**
+ * @brief Destroy a set of attributes, after the component it is attached to.
+ *
+ * @memberof HAMQTT_Attributes
+ */
+void hamqtt_attributes_destroy(HAMQTT_Attributes *attributes);
+
+/**
+ * @brief Set a boolean slot.
+ *
+ * The setters may be called from any task.
+ *
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG if the slot does not exist or has another type.
+ *
+ * @memberof HAMQTT_Attributes
+ */
+esp_err_t hamqtt_attributes_set_bool(HAMQTT_Attributes *attributes, size_t slot, bool value);
+
+/**
+ * @brief Set an integer slot. See @ref hamqtt_attributes_set_bool.
+ *
+ * @memberof HAMQTT_Attributes
+ */
+esp_err_t hamqtt_attributes_set_int(HAMQTT_Attributes *attributes, size_t slot, int64_t value);
+
+/**
+ * @brief Set a float slot. NaN and infinities are published as `null`. See @ref hamqtt_attributes_set_bool.
+ *
+ * @memberof HAMQTT_Attributes
+ */
+esp_err_t hamqtt_attributes_set_float(HAMQTT_Attributes *attributes, size_t slot, float value);
+
+/**
+ * @brief Set a string slot to a copy of `value`, truncated to the slot's `max_len`. See
+ * @ref hamqtt_attributes_set_bool.
+ *
+ * @memberof HAMQTT_Attributes
+ */
+esp_err_t hamqtt_attributes_set_string(HAMQTT_Attributes *attributes, size_t slot, const char *value);
+
+/**
+ * @brief Rewrite every slot and publish them on the next loop, even if nothing changed.
+ * The device does this itself whenever it connects.
+ *
+ * @memberof HAMQTT_Attributes
+ */
+void hamqtt_attributes_resync(HAMQTT_Attributes *attributes);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_attributes_internal.h
+ * @brief Internal attribute publishing used by HAMQTT_Device.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "hamqtt_attributes.h"
+#include "hamqtt_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @internal
+ * @brief Build the attributes topic. Kept until the attributes are destroyed.
+ */
+esp_err_t hamqtt_attributes_build_topic(HAMQTT_Attributes *attributes, const char *device_unique_id, const char *component_unique_id);
+
+/**
+ * @internal
+ * @brief The attributes topic, or NULL before it was built.
+ */
+const char *hamqtt_attributes_get_topic(const HAMQTT_Attributes *attributes);
+
+/**
+ * @internal
+ * @brief Rewrite the dirty slots, or all of them after a resync, and publish the attributes
+ * if any changed. The publish happens after the lock is released. Called from
+ * `hamqtt_device_loop` only.
+ */
+void hamqtt_attributes_update(HAMQTT_Attributes *attributes, HAMQTT_Transport *transport);
+
+#ifdef __cplusplus
+}
+#endif
@@ -29,20 +29,25 @@
 #pragma once
 
 #include "common.h"
+#include "hamqtt_component.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /**
  * @brief Configuration parameters for a HAMQTT binary sensor.
  */
 typedef struct {
-    char *device_class;         ///< The class of the sensor, which alters how its state and icon is rendered. @note Optional.
-    bool enabled_by_default;    ///< Set to `false` if the sensor should not be enabled when the sensor is first added.
-    char *entity_picture;       ///< URL to a picture for the sensor. @note Optional.
-    int expire_after;           ///< Number of seconds a sensor's state expires, if it's not updated. Set to `-1` to disable expiration.
-    bool force_update;          ///< Set to `true` if Home Assistant should always send update events, even when the sensor's state doesn't change.
-    char *icon;                 ///< Icon for the sensor. @note Optional.
-    char *name;                 ///< The name of the sensor shown in Home Assistant.
-    int off_delay;              ///< Number of seconds after the sensor turns on that Home Assistant turns it back off. Set to `-1` to disable this feature.
-    char *unique_id;            ///< Unique identifier used for discovery in Home Assistant.
+    const char *device_class;       ///< The class of the sensor, which alters how its state and icon is rendered. @note Optional.
+    bool enabled_by_default;        ///< Set to `false` if the sensor should not be enabled when the sensor is first added.
+    const char *entity_picture;     ///< URL to a picture for the sensor. @note Optional.
+    int expire_after;               ///< Number of seconds a sensor's state expires, if it's not updated. Set to `-1` to disable expiration.
+    bool force_update;              ///< Set to `true` if Home Assistant should always send update events, even when the sensor's state doesn't change.
+    const char *icon;               ///< Icon for the sensor. @note Optional.
+    const char *name;               ///< The name of the sensor shown in Home Assistant.
+    int off_delay;                  ///< Number of seconds after the sensor turns on that Home Assistant turns it back off. Set to `-1` to disable this feature.
+    const char *unique_id;          ///< Unique identifier used for discovery in Home Assistant.
 } HAMQTT_Binary_Sensor_Config;
 
 /**
@@ -57,10 +62,20 @@ typedef struct {
 HAMQTT_Binary_Sensor_Config hamqtt_binary_sensor_config_default(void);
 
 /**
- * @struct HAMQTT_Binary_Sensor
- * @brief Internal representation of a Home Assistant MQTT binary sensor.
+ * @brief Designated initializers for the default binary sensor configuration.
+ *
+ * Matches @ref hamqtt_binary_sensor_config_default, but can be used in constant initializers.
  */
-typedef struct HAMQTT_Binary_Sensor HAMQTT_Binary_Sensor;
+#define HAMQTT_BINARY_SENSOR_CONFIG_DEFAULT_FIELDS \
+    .device_class = NULL,                          \
+    .enabled_by_default = true,                    \
+    .entity_picture = NULL,                        \
+    .expire_after = -1,                            \
+    .force_update = false,                         \
+    .icon = NULL,                                  \
+    .name = "ESP32 Binary Sensor",                 \
+    .off_delay = -1,                               \
+    .unique_id = NULL
 
 /**
  * @typedef HAMQTT_Binary_Sensor_Get_State_Func
@@ -75,6 +90,80 @@ typedef struct HAMQTT_Binary_Sensor HAMQTT_Binary_Sensor;
  */
 typedef bool (*HAMQTT_Binary_Sensor_Get_State_Func)(void *args);
 
+/**
+ * @struct HAMQTT_Binary_Sensor
+ * @brief Internal representation of a Home Assistant MQTT binary sensor.
+ *
+ * The definition is public so that binary sensors can be statically allocated with
+ * @ref HAMQTT_BINARY_SENSOR_DEFINE. Its fields must not be accessed directly, and like
+ * @ref HAMQTT_Component its layout does not depend on the feature options.
+ */
+typedef struct HAMQTT_Binary_Sensor {
+    HAMQTT_Component base;
+
+    const HAMQTT_Binary_Sensor_Config *component_config;
+    HAMQTT_Binary_Sensor_Get_State_Func get_state_func;
+    void *get_state_func_args;
+
+    char *state_topic;
+    bool has_sent_state;
+    bool previous_state;
+    bool is_static;
+
+    const struct HAMQTT_Rule_Slice *rules;      // Local automation rules it triggers, set by its device
+    HAMQTT_Component *group;                    // Group that reports its state, if any
+} HAMQTT_Binary_Sensor;
+
+/**
+ * @internal
+ * @brief Virtual function table shared by every binary sensor.
+ */
+extern const HAMQTT_Component_VTable hamqtt_binary_sensor_vtable;
+
+/**
+ * @internal
+ * @brief Sample the binary sensor and run its local rules if the state changed.
+ *
+ * @return true if the state should be reported: it changed, or it was never reported.
+ */
+bool hamqtt_binary_sensor_poll(HAMQTT_Binary_Sensor *sensor);
+
+/**
+ * @brief Statically define a binary sensor whose configuration lives in flash.
+ *
+ * Defines a `static const HAMQTT_Binary_Sensor_Config <var>_config` holding the immutable
+ * descriptor, and a `static HAMQTT_Binary_Sensor <var>` holding only the runtime state.
+ * Neither is allocated on the heap. Any fields not given keep their default values.
+ *
+ * @code
+ * HAMQTT_BINARY_SENSOR_DEFINE(door, door_open_get_state, NULL,
+ *                             .unique_id = "hall_door_state",
+ *                             .name = "Hall Door",
+ *                             .device_class = "door");
+ *
+ * hamqtt_device_add_component(device, (HAMQTT_Component *)&door);
+ * @endcode
+ *
+ * @param var Name of the binary sensor variable.
+ * @param func Function pointer for retrieving the state of the binary sensor.
+ * @param func_args A constant pointer to the arguments to be passed to `func`.
+ * @param ... Designated initializers for @ref HAMQTT_Binary_Sensor_Config.
+ */
+#define HAMQTT_BINARY_SENSOR_DEFINE(var, func, func_args, ...) \
+    HAMQTT_OVERRIDE_INIT_BEGIN                                 \
+    static const HAMQTT_Binary_Sensor_Config var##_config = {  \
+        HAMQTT_BINARY_SENSOR_CONFIG_DEFAULT_FIELDS,            \
+        __VA_ARGS__                                            \
+    };                                                         \
+    HAMQTT_OVERRIDE_INIT_END                                   \
+    static HAMQTT_Binary_Sensor var = {                        \
+        .base = { .v = &hamqtt_binary_sensor_vtable },         \
+        .component_config = &var##_config,                     \
+        .get_state_func = (func),                              \
+        .get_state_func_args = (func_args),                    \
+        .is_static = true                                      \
+    }
+
 /**
  * @brief Create a new HAMQTT binary sensor.
  *
@@ -85,11 +174,13 @@ typedef bool (*HAMQTT_Binary_Sensor_Get_State_Func)(void *args);
  * 
  * @memberof HAMQTT_Binary_Sensor
  */
-HAMQTT_Binary_Sensor *hamqtt_binary_sensor_create(HAMQTT_Binary_Sensor_Config *config, HAMQTT_Binary_Sensor_Get_State_Func get_state_func, void *get_state_func_args);
+HAMQTT_Binary_Sensor *hamqtt_binary_sensor_create(const HAMQTT_Binary_Sensor_Config *config, HAMQTT_Binary_Sensor_Get_State_Func get_state_func, void *get_state_func_args);
 
 /**
  * @brief Destroy a HAMQTT binary sensor and free all resources.
  *
+ * Statically defined binary sensors only release their runtime topics.
+ *
  * @param sensor Pointer to the binary sensor to destroy. Must not be NULL.
  * 
  * @memberof HAMQTT_Binary_Sensor
@@ -106,3 +197,6 @@ void hamqtt_binary_sensor_destroy(HAMQTT_Binary_Sensor *sensor);
  */
 const HAMQTT_Binary_Sensor_Config *hamqtt_binary_sensor_get_config(const HAMQTT_Binary_Sensor *sensor);
 
+#ifdef __cplusplus
+}
+#endif
@@ -29,17 +29,22 @@
 #pragma once
 
 #include "common.h"
+#include "hamqtt_component.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /**
  * @brief Configuration parameters for a HAMQTT button.
  */
 typedef struct {
-    char *device_class;         ///< The class of the button, which alters how its state and icon is rendered. @note Optional.
-    bool enabled_by_default;    ///< Set to `false` if the button should not be enabled when the button is first added.
-    char *entity_picture;       ///< URL to a picture for the button. @note Optional.
-    char *icon;                 ///< Icon for the button. @note Optional.
-    char *name;                 ///< The name of the button shown in Home Assistant.
-    char *unique_id;            ///< Unique identifier used for discovery in Home Assistant.
+    const char *device_class;       ///< The class of the button, which alters how its state and icon is rendered. @note Optional.
+    bool enabled_by_default;        ///< Set to `false` if the button should not be enabled when the button is first added.
+    const char *entity_picture;     ///< URL to a picture for the button. @note Optional.
+    const char *icon;               ///< Icon for the button. @note Optional.
+    const char *name;               ///< The name of the button shown in Home Assistant.
+    const char *unique_id;          ///< Unique identifier used for discovery in Home Assistant.
 } HAMQTT_Button_Config;
 
 /**
@@ -54,10 +59,17 @@ typedef struct {
 HAMQTT_Button_Config hamqtt_button_config_default(void);
 
 /**
- * @struct HAMQTT_Button
- * @brief Internal representation of a Home Assistant MQTT button.
- */ 
-typedef struct HAMQTT_Button HAMQTT_Button;
+ * @brief Designated initializers for the default button configuration.
+ *
+ * Matches @ref hamqtt_button_config_default, but can be used in constant initializers.
+ */
+#define HAMQTT_BUTTON_CONFIG_DEFAULT_FIELDS \
+    .device_class = NULL,                   \
+    .enabled_by_default = true,             \
+    .entity_picture = NULL,                 \
+    .icon = NULL,                           \
+    .name = "ESP32 Button",                 \
+    .unique_id = NULL
 
 /**
  * @typedef HAMQTT_Button_On_Press_Func
@@ -70,6 +82,67 @@ typedef struct HAMQTT_Button HAMQTT_Button;
  */
 typedef void (*HAMQTT_Button_On_Press_Func)(void *args);
 
+/**
+ * @struct HAMQTT_Button
+ * @brief Internal representation of a Home Assistant MQTT button.
+ *
+ * The definition is public so that buttons can be statically allocated with
+ * @ref HAMQTT_BUTTON_DEFINE. Its fields must not be accessed directly, and like
+ * @ref HAMQTT_Component its layout does not depend on the feature options.
+ */
+typedef struct HAMQTT_Button {
+    HAMQTT_Component base;
+
+    const HAMQTT_Button_Config *component_config;
+    HAMQTT_Button_On_Press_Func on_press_func;
+    void *on_press_func_args;
+
+    char *command_topic;
+    const char *subscribed_topics[1];
+    bool is_static;
+} HAMQTT_Button;
+
+/**
+ * @internal
+ * @brief Virtual function table shared by every button.
+ */
+extern const HAMQTT_Component_VTable hamqtt_button_vtable;
+
+/**
+ * @brief Statically define a button whose configuration lives in flash.
+ *
+ * Defines a `static const HAMQTT_Button_Config <var>_config` holding the immutable
+ * descriptor, and a `static HAMQTT_Button <var>` holding only the runtime state.
+ * Neither is allocated on the heap. Any fields not given keep their default values.
+ *
+ * @code
+ * HAMQTT_BUTTON_DEFINE(bell, bell_on_press, NULL,
+ *                      .unique_id = "hall_bell",
+ *                      .name = "Hall Bell");
+ *
+ * hamqtt_device_add_component(device, (HAMQTT_Component *)&bell);
+ * @endcode
+ *
+ * @param var Name of the button variable.
+ * @param func Function pointer for handling pressing the button.
+ * @param func_args A constant pointer to the arguments to be passed to `func`.
+ * @param ... Designated initializers for @ref HAMQTT_Button_Config.
+ */
+#define HAMQTT_BUTTON_DEFINE(var, func, func_args, ...) \
+    HAMQTT_OVERRIDE_INIT_BEGIN                          \
+    static const HAMQTT_Button_Config var##_config = {  \
+        HAMQTT_BUTTON_CONFIG_DEFAULT_FIELDS,            \
+        __VA_ARGS__                                     \
+    };                                                  \
+    HAMQTT_OVERRIDE_INIT_END                            \
+    static HAMQTT_Button var = {                        \
+        .base = { .v = &hamqtt_button_vtable },         \
+        .component_config = &var##_config,              \
+        .on_press_func = (func),                        \
+        .on_press_func_args = (func_args),              \
+        .is_static = true                               \
+    }
+
 /**
  * @brief Create a new HAMQTT button.
  *
@@ -80,11 +153,13 @@ typedef void (*HAMQTT_Button_On_Press_Func)(void *args);
  * 
  * @memberof HAMQTT_Button
  */
-HAMQTT_Button *hamqtt_button_create(HAMQTT_Button_Config *config, HAMQTT_Button_On_Press_Func on_press_func, void *on_press_func_args);
+HAMQTT_Button *hamqtt_button_create(const HAMQTT_Button_Config *config, HAMQTT_Button_On_Press_Func on_press_func, void *on_press_func_args);
 
 /**
  * @brief Destroy a HAMQTT button and free all resources.
  *
+ * Statically defined buttons only release their runtime topics.
+ *
  * @param button Pointer to the button to destroy. Must not be NULL.
  * 
  * @memberof HAMQTT_Button
@@ -101,3 +176,6 @@ void hamqtt_button_destroy(HAMQTT_Button *button);
  */
 const HAMQTT_Button_Config *hamqtt_button_get_config(const HAMQTT_Button *button);
 
+#ifdef __cplusplus
+}
+#endif
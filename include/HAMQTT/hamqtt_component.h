@@ -31,8 +31,28 @@
 #pragma once
 
 #include "common.h"
+#include "hamqtt_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 typedef struct HAMQTT_Component HAMQTT_Component;
+typedef struct HAMQTT_Component_VTable HAMQTT_Component_VTable;
+typedef struct HAMQTT_Attributes HAMQTT_Attributes;
+
+/**
+ * @brief Base struct representing a generic Home Assistant MQTT component.
+ *
+ * The definition is public so that components can be statically allocated, but its
+ * fields are only meant to be accessed by component implementations. Its layout must not
+ * depend on the feature options, as an application may be built with other options than the
+ * library: fields of optional features are always present and left unused when they are off.
+ */
+struct HAMQTT_Component {
+    const HAMQTT_Component_VTable *v;
+    HAMQTT_Attributes *attributes;      // Published to the component's json_attributes_topic, or NULL
+};
 
 /* ----- Dispatch helpers ----- */
 
@@ -43,8 +63,11 @@ typedef struct HAMQTT_Component HAMQTT_Component;
  * for the specified component. This information is used by Home Assistant to
  * automatically set up the entity.
  *
+ * If `root` is NULL, the discovery payload was precomputed at build time and the component
+ * must only prepare the runtime topics it publishes and subscribes to.
+ *
  * @param component Pointer to the component instance.
- * @param root Pointer to the cJSON object to populate.
+ * @param root Pointer to the cJSON object to populate, or NULL to only prepare topics.
  * @param device_uid Unique ID of the parent device to associate with the component.
  * @return esp_err_t ESP_OK on success, or an appropriate error code on failure.
  * 
@@ -78,12 +101,12 @@ void hamqtt_component_handle_mqtt_message(
  * to publish state changes or perform maintenance tasks.
  *
  * @param component Pointer to the component instance.
- * @param client MQTT client handle to use for publishing.
+ * @param transport MQTT transport to use for publishing.
  * 
  * @memberof HAMQTT_Component
  */
 void hamqtt_component_update(
-        HAMQTT_Component *component, esp_mqtt_client_handle_t client);
+        HAMQTT_Component *component, HAMQTT_Transport *transport);
 
 /**
  * @brief Returns the unique ID of the component.
@@ -101,7 +124,9 @@ const char *hamqtt_component_get_unique_id(
 /**
  * @brief Returns the list of topics the component wants to subscribe to.
  *
- * The component uses these topics to receive control or data messages.
+ * The component uses these topics to receive control or data messages. A topic may be an
+ * MQTT filter with `+` and `#` levels, e.g. `<device>/<component>/set/+`; the component then
+ * gets the topic each message was published to.
  *
  * @param component Pointer to the component instance.
  * @param count Pointer to a size_t to receive the number of topics.
@@ -110,4 +135,25 @@ const char *hamqtt_component_get_unique_id(
  * @memberof HAMQTT_Component
  */
 const char * const *hamqtt_component_get_subscribed_topics(
-        HAMQTT_Component *component, size_t *count);
\ No newline at end of file
+        HAMQTT_Component *component, size_t *count);
+
+#if HAMQTT_ATTRIBUTES
+/**
+ * @brief Give the component extra attributes. See hamqtt_attributes.h.
+ *
+ * Must be called before the component's device connects. The discovery payload then points
+ * the entity's `json_attributes_topic` at `<device unique_id>/<component unique_id>/attributes`.
+ *
+ * @param component Pointer to the component instance.
+ * @param attributes The attributes. Must outlive the component's device.
+ * @return ESP_OK, or ESP_ERR_INVALID_STATE if either already has attributes or a component.
+ *
+ * @memberof HAMQTT_Component
+ */
+esp_err_t hamqtt_component_set_attributes(
+        HAMQTT_Component *component, HAMQTT_Attributes *attributes);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -19,7 +19,7 @@
  * @brief Internal declarations for the HAMQTT_Component system.
  *
  * This internal header defines the `HAMQTT_Component_VTable` structure used for
- * polymorphic behavior and the internal fields of the `HAMQTT_Component` base type.
+ * polymorphic behavior of the `HAMQTT_Component` base type.
  * This header should only be included by component implementations or core library code.
  *
  * @note This file is not part of the public API and may change without notice.
@@ -31,8 +31,6 @@
 #pragma once
 #include "hamqtt_component.h"
 
-typedef struct HAMQTT_Component_VTable HAMQTT_Component_VTable;
-
 /* ----- V-Table (interface) ----- */
 
 /**
@@ -51,7 +49,7 @@ struct HAMQTT_Component_VTable {
                                 const char *data);
 
     void (*update)(HAMQTT_Component *component,
-                   esp_mqtt_client_handle_t mqtt_client);
+                   HAMQTT_Transport *transport);
 
     const char *(*get_unique_id)(HAMQTT_Component *component);
     
@@ -60,11 +58,15 @@ struct HAMQTT_Component_VTable {
 
 };
 
-/* ----- Base Object ----- */
+/* ----- Unique ids ----- */
 
 /**
- * @brief Base struct representing a generic Home Assistant MQTT component.
+ * @internal
+ * @brief Checks that a device or component unique id can be spliced into JSON and MQTT
+ * topics as is.
+ *
+ * @param id The unique id to check.
+ * @return false if it needs JSON escaping or holds an MQTT wildcard or topic separator, true
+ *         otherwise.
  */
-struct HAMQTT_Component {
-    const HAMQTT_Component_VTable *v;
-};
\ No newline at end of file
+bool hamqtt_component_is_plain_id(const char *id);
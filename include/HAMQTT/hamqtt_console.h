@@ -0,0 +1,89 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_console.h
+ * @brief A `hamqtt` console command for inspecting live devices.
+ *
+ * With `CONFIG_HAMQTT_CONSOLE` enabled, every device counts the publishes and inbound
+ * messages of each of its entities and remembers the last value each one published. The
+ * `hamqtt` command prints these along with the component table, the routing table, the
+ * MQTT outbox, the heap and, when enabled, the diagnostic counters and latency histograms:
+ *
+ * @code
+ * hamqtt [status|components|routes|memory|latency|reset|help] [<device unique_id or index>]
+ * @endcode
+ *
+ * On ESP-IDF, including its linux target, register the command with esp_console through
+ * @ref hamqtt_console_register. Elsewhere @ref hamqtt_console_run can be called from any shell.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Size of @ref HAMQTT_Entity_Stats::last_value, including the NUL.
+ */
+#define HAMQTT_ENTITY_STATS_VALUE_SIZE 24
+
+/**
+ * @brief Traffic counters of one entity, since the device was created or its stats were reset.
+ */
+typedef struct {
+    uint32_t publishes;                                 ///< Publishes made by the entity's updates.
+    uint32_t publish_failures;                          ///< Publishes the transport rejected.
+    uint32_t messages;                                  ///< Inbound messages routed to the entity.
+    int64_t last_publish_us;                            ///< Time of the last publish, 0 if none.
+    int64_t last_message_us;                            ///< Time of the last inbound message, 0 if none.
+    char last_value[HAMQTT_ENTITY_STATS_VALUE_SIZE];    ///< Last published payload, truncated.
+} HAMQTT_Entity_Stats;
+
+/**
+ * @brief Run the `hamqtt` command and print its output to stdout.
+ *
+ * Reads device state without locking, so values may be slightly out of date. Devices must
+ * not be destroyed while the command runs.
+ *
+ * @param argc Number of arguments, including the command name.
+ * @param argv Arguments, starting with the command name.
+ * @return 0 on success, 1 on a usage error or unknown device.
+ */
+int hamqtt_console_run(int argc, char **argv);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Register the `hamqtt` command with esp_console.
+ *
+ * Call after `esp_console_init` or `esp_console_new_repl_*`. Devices created before or after
+ * are all listed.
+ *
+ * @return ESP_OK on success, or the error from `esp_console_cmd_register`.
+ */
+esp_err_t hamqtt_console_register(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
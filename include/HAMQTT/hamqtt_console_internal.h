@@ -0,0 +1,101 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_console_internal.h
+ * @brief Internal entity counters and device registry used by the console command.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "hamqtt_console.h"
+#include "hamqtt_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct HAMQTT_Device HAMQTT_Device;
+
+/**
+ * @internal
+ * @brief Per-device entity counters, and a transport that attributes publishes to entities.
+ */
+typedef struct HAMQTT_Console_Stats HAMQTT_Console_Stats;
+
+/**
+ * @internal
+ * @brief Allocate counters for `entity_count` entities.
+ */
+HAMQTT_Console_Stats *hamqtt_console_stats_create(size_t entity_count);
+
+/**
+ * @internal
+ */
+void hamqtt_console_stats_destroy(HAMQTT_Console_Stats *stats);
+
+/**
+ * @internal
+ * @brief Zero every counter.
+ */
+void hamqtt_console_stats_reset(HAMQTT_Console_Stats *stats);
+
+/**
+ * @internal
+ * @brief Get a transport that forwards to `inner` and counts each publish against the
+ * current publisher. Pass it to component updates instead of `inner`.
+ *
+ * The returned transport is owned by the stats and is reused by later calls.
+ */
+HAMQTT_Transport *hamqtt_console_stats_wrap_transport(HAMQTT_Console_Stats *stats, HAMQTT_Transport *inner);
+
+/**
+ * @internal
+ * @brief Set the entity that publishes through the wrapped transport are attributed to.
+ */
+void hamqtt_console_stats_set_publisher(HAMQTT_Console_Stats *stats, size_t entity);
+
+/**
+ * @internal
+ * @brief Count an inbound message routed to `entity`.
+ */
+void hamqtt_console_stats_record_message(HAMQTT_Console_Stats *stats, size_t entity, int64_t arrival_us);
+
+/**
+ * @internal
+ * @brief Get a copy of an entity's counters.
+ */
+esp_err_t hamqtt_console_stats_get(const HAMQTT_Console_Stats *stats, size_t entity, HAMQTT_Entity_Stats *out);
+
+/**
+ * @internal
+ * @brief List a device in the `hamqtt` command. Fails when the registry is full.
+ */
+esp_err_t hamqtt_console_add_device(HAMQTT_Device *device);
+
+/**
+ * @internal
+ * @brief Remove a device from the `hamqtt` command.
+ */
+void hamqtt_console_remove_device(HAMQTT_Device *device);
+
+#ifdef __cplusplus
+}
+#endif
@@ -33,6 +33,17 @@
 
 #include "common.h"
 #include "hamqtt_component.h"
+#include "hamqtt_transport.h"
+#include "hamqtt_latency.h"
+#include "hamqtt_diagnostics.h"
+#include "hamqtt_console.h"
+#include "hamqtt_pipeline.h"
+#include "hamqtt_rules.h"
+#include "hamqtt_attributes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /**
  * @struct HAMQTT_Device_Config
@@ -64,6 +75,20 @@ typedef struct {
  */
 HAMQTT_Device_Config hamqtt_device_config_default(void);
 
+/**
+ * @struct HAMQTT_Discovery_Template
+ * @brief A discovery payload precomputed at build time from a device manifest.
+ *
+ * The payload is stored as a list of fragments which are joined by the device's
+ * `unique_id` at runtime, so that a single firmware image can be flashed to many units.
+ * Instances are normally emitted by `tools/hamqtt_manifest.py` rather than written by hand.
+ */
+typedef struct {
+    const char *const *fragments;   ///< Payload fragments. The device unique_id is inserted between each pair.
+    size_t fragment_count;          ///< Number of entries in `fragments`.
+    size_t component_count;         ///< Number of components described by the payload.
+} HAMQTT_Discovery_Template;
+
 /**
  * @struct HAMQTT_Device
  * @brief Internal representation of a Home Assistant MQTT device.
@@ -90,19 +115,141 @@ HAMQTT_Device *hamqtt_device_create(HAMQTT_Device_Config *config);
 void hamqtt_device_destroy(HAMQTT_Device *device);
 
 /**
- * @brief Add a component (e.g. sensor, switch) to the device.
+ * @brief Add a component (e.g. sensor, switch) to the device. Must be called before the
+ * device first connects.
  *
  * @param device Pointer to the device.
  * @param component Pointer to a component implementing the HAMQTT_Component interface.
  * @return
  * - ESP_OK on success
  * - ESP_ERR_NO_MEM if component buffer is full
- * - ESP_ERR_INVALID_ARG if inputs are invalid
+ * - ESP_ERR_INVALID_ARG if inputs are invalid, or the component's unique id is `scene` while
+ *   scenes are enabled, since its topics would be the scene's
+ * - ESP_ERR_INVALID_STATE if the device has already connected
  * 
  * @memberof HAMQTT_Device
  */
 esp_err_t hamqtt_device_add_component(HAMQTT_Device *device, HAMQTT_Component *component);
 
+#if HAMQTT_RULES
+/**
+ * @brief Compile local automation rules for the device's components. See hamqtt_rules.h.
+ *
+ * Triggers and targets are looked up by unique id among the components added so far, and
+ * `rules` is not used after this returns. Each rule then runs from `hamqtt_device_loop` as soon
+ * as its trigger changes state, before the new state is published.
+ *
+ * Without the dual-core pipeline, a button pressed by a rule runs its callback on the task
+ * calling `hamqtt_device_loop`, while presses from Home Assistant run on the transport's task.
+ *
+ * @param device Pointer to the device.
+ * @param rules Array of rules.
+ * @param rule_count Number of rules.
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_STATE if rules were already set, the device has connected, or a trigger
+ *   already has rules from another device
+ * - ESP_ERR_NOT_FOUND if a trigger or target is not a component of the device
+ * - ESP_ERR_INVALID_ARG if a trigger is not a binary sensor, a target is not a button, or a
+ *   rule has no states or function
+ * - ESP_ERR_NO_MEM if the dispatch table could not be allocated
+ *
+ * @note Destroy the device before the binary sensors its rules are triggered by.
+ *
+ * @memberof HAMQTT_Device
+ */
+esp_err_t hamqtt_device_set_rules(HAMQTT_Device *device, const HAMQTT_Rule *rules, size_t rule_count);
+#endif
+
+#if HAMQTT_SCENE
+/**
+ * @brief Apply a scene as if it had been published to `<device unique_id>/scene/set`.
+ *
+ * A scene is a JSON object mapping component unique ids to commands, for example
+ * `{"relay_1":"PRESS","relay_2":"PRESS"}`. Every entry is checked before any component sees
+ * its command, so a scene is applied whole or not at all. The callbacks run back to back on
+ * the caller's task, and once connected the scene is published retained to
+ * `<device unique_id>/scene/state`.
+ *
+ * @param device Pointer to the device.
+ * @param json The scene. Need not be NUL terminated.
+ * @param len Length of `json` in bytes.
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if `json` is not a flat object of strings, numbers and literals
+ * - ESP_ERR_NOT_FOUND if a unique id is not a component of the device that takes commands, or
+ *   the device has not connected yet
+ * - ESP_ERR_INVALID_SIZE if the scene exceeds `CONFIG_HAMQTT_SCENE_MAX_PAYLOAD` or
+ *   `CONFIG_HAMQTT_SCENE_MAX_ENTITIES`
+ * - ESP_ERR_INVALID_STATE if another scene is being applied
+ *
+ * @memberof HAMQTT_Device
+ */
+esp_err_t hamqtt_device_apply_scene(HAMQTT_Device *device, const char *json, size_t len);
+#endif
+
+/**
+ * @brief Use a precomputed discovery payload instead of building one at runtime.
+ *
+ * When set, `hamqtt_device_connect` publishes the template (with the device's `unique_id`
+ * patched in) and skips building the discovery config through cJSON. The components added to
+ * the device must match the ones described by the template, in the same order.
+ *
+ * @param device Pointer to the device.
+ * @param discovery Pointer to the template. Must remain valid for the lifetime of the device.
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if inputs are invalid
+ *
+ * @memberof HAMQTT_Device
+ */
+esp_err_t hamqtt_device_set_discovery_template(HAMQTT_Device *device, const HAMQTT_Discovery_Template *discovery);
+
+/**
+ * @brief Build the Home Assistant discovery payload of the device without publishing it.
+ *
+ * Renders the discovery template when one is set, and otherwise builds the payload through
+ * cJSON. This is the payload `hamqtt_device_connect` publishes.
+ *
+ * @param device Pointer to the device.
+ * @param[out] payload Set to the NUL terminated payload. Must be released with `hamqtt_device_free_discovery_payload`.
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_STATE if required configuration fields are missing
+ * - ESP_ERR_NOT_SUPPORTED if no template is set and runtime discovery is disabled
+ * - ESP_ERR_NO_MEM if the payload could not be allocated
+ *
+ * @memberof HAMQTT_Device
+ */
+esp_err_t hamqtt_device_build_discovery_payload(HAMQTT_Device *device, char **payload);
+
+/**
+ * @brief Release a payload returned by `hamqtt_device_build_discovery_payload`.
+ *
+ * @param device Pointer to the device that built the payload.
+ * @param payload The payload to release. May be NULL.
+ *
+ * @memberof HAMQTT_Device
+ */
+void hamqtt_device_free_discovery_payload(const HAMQTT_Device *device, char *payload);
+
+/**
+ * @brief Use an application-provided transport instead of the platform default.
+ *
+ * By default `hamqtt_device_connect` creates the platform's default transport (see
+ * `hamqtt_transport_default_create`) and destroys it with the device. A transport set here
+ * is not destroyed by the device.
+ *
+ * @param device Pointer to the device.
+ * @param transport Pointer to the transport. Must remain valid for the lifetime of the device.
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if inputs are invalid
+ *
+ * @memberof HAMQTT_Device
+ */
+esp_err_t hamqtt_device_set_transport(HAMQTT_Device *device, HAMQTT_Transport *transport);
+
 /**
  * @brief Connect the device to the MQTT broker and publish its Home Assistant discovery config.
  *
@@ -111,12 +258,28 @@ esp_err_t hamqtt_device_add_component(HAMQTT_Device *device, HAMQTT_Component *c
  * @param device Pointer to the device.
  * @return
  * - ESP_OK on success
+ * - ESP_ERR_INVALID_STATE if a grouped binary sensor's group was not added to the device
  * - ESP_FAIL or MQTT-related error code on failure
  * 
  * @memberof HAMQTT_Device
  */
 esp_err_t hamqtt_device_connect(HAMQTT_Device *device);
 
+/**
+ * @brief Publish the device as offline and disconnect from the MQTT broker.
+ *
+ * The transport and the device's topics are kept, so `hamqtt_device_connect` can be called
+ * again without allocating them anew.
+ *
+ * @param device Pointer to the device.
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_STATE if the device has not connected to MQTT
+ *
+ * @memberof HAMQTT_Device
+ */
+esp_err_t hamqtt_device_disconnect(HAMQTT_Device *device);
+
 /**
  * @brief Publish an availability message to Home Assistant.
  *
@@ -149,4 +312,179 @@ void hamqtt_device_loop(const HAMQTT_Device *device);
  * 
  * @memberof HAMQTT_Device
  */
-const HAMQTT_Device_Config *hamqtt_device_get_config(const HAMQTT_Device *device);
\ No newline at end of file
+const HAMQTT_Device_Config *hamqtt_device_get_config(const HAMQTT_Device *device);
+
+/**
+ * @brief Get the number of components added to the device.
+ *
+ * @memberof HAMQTT_Device
+ */
+size_t hamqtt_device_get_component_count(const HAMQTT_Device *device);
+
+/**
+ * @brief Get a component by the order it was added in.
+ *
+ * @param device Pointer to the device.
+ * @param index Index of the component.
+ * @return The component, or NULL if the index is out of range.
+ *
+ * @memberof HAMQTT_Device
+ */
+HAMQTT_Component *hamqtt_device_get_component(const HAMQTT_Device *device, size_t index);
+
+/**
+ * @brief Get the transport the device publishes through.
+ *
+ * @return The transport, or NULL if the device has not connected and none was set.
+ *
+ * @memberof HAMQTT_Device
+ */
+HAMQTT_Transport *hamqtt_device_get_transport(const HAMQTT_Device *device);
+
+#if HAMQTT_LATENCY
+/**
+ * @brief Get a copy of a latency histogram recorded by the device.
+ *
+ * Histograms are written from the transport's event task, so a copy taken while messages
+ * are arriving may have a sample half applied.
+ *
+ * @param device Pointer to the device.
+ * @param component_index Index of the component, in the order components were added.
+ *                        Ignored for `HAMQTT_LATENCY_STAGE_PROBE_RTT`.
+ * @param stage Stage to read.
+ * @param[out] histogram Set to a copy of the histogram.
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the component index or stage is out of range
+ *
+ * @memberof HAMQTT_Device
+ */
+esp_err_t hamqtt_device_get_latency(const HAMQTT_Device *device,
+                                    size_t component_index,
+                                    HAMQTT_Latency_Stage stage,
+                                    HAMQTT_Latency_Histogram *histogram);
+
+/**
+ * @brief Clear every latency histogram of the device.
+ *
+ * @memberof HAMQTT_Device
+ */
+void hamqtt_device_reset_latency(HAMQTT_Device *device);
+
+/**
+ * @brief Publish a loopback probe to `<unique_id>/latency_probe`.
+ *
+ * The device subscribes to the probe topic, so the probe comes back through the broker and
+ * its round trip is recorded under `HAMQTT_LATENCY_STAGE_PROBE_RTT`. Probes are also sent from
+ * `hamqtt_device_loop` when `CONFIG_HAMQTT_LATENCY_PROBE_INTERVAL_MS` is non-zero.
+ *
+ * @param device Pointer to the device.
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_STATE if the device has not connected to MQTT
+ * - ESP_FAIL if the probe could not be published
+ *
+ * @memberof HAMQTT_Device
+ */
+esp_err_t hamqtt_device_send_latency_probe(const HAMQTT_Device *device);
+
+/**
+ * @brief Log the p50, p99 and maximum of every non-empty latency histogram.
+ *
+ * @memberof HAMQTT_Device
+ */
+void hamqtt_device_log_latency(const HAMQTT_Device *device);
+#endif
+
+#if HAMQTT_DIAGNOSTICS
+/**
+ * @brief Set the report schedule and deadbands of the device's diagnostic sensors.
+ *
+ * Call before `hamqtt_device_connect`, since whether the sensors are discovered at all depends
+ * on `interval_ms`. See hamqtt_diagnostics.h.
+ *
+ * @param device Pointer to the device.
+ * @param config Configuration to copy.
+ *
+ * @memberof HAMQTT_Device
+ */
+void hamqtt_device_set_diagnostics_config(HAMQTT_Device *device, const HAMQTT_Diagnostics_Config *config);
+
+/**
+ * @brief Get the device's counters, heap and outbox gauges and current loop window.
+ *
+ * Counters are updated from the transport's event task, so a copy taken from another task
+ * may be slightly out of date. This does not publish anything.
+ *
+ * @param device Pointer to the device.
+ * @param[out] stats Set to the current stats.
+ *
+ * @memberof HAMQTT_Device
+ */
+void hamqtt_device_get_stats(const HAMQTT_Device *device, HAMQTT_Device_Stats *stats);
+#endif
+
+#if HAMQTT_CONSOLE
+/**
+ * @brief Get the publish and message counters of one component.
+ *
+ * @param device Pointer to the device.
+ * @param component_index Index of the component, in the order components were added.
+ * @param[out] stats Set to a copy of the counters.
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the component index is out of range
+ *
+ * @memberof HAMQTT_Device
+ */
+esp_err_t hamqtt_device_get_entity_stats(const HAMQTT_Device *device, size_t component_index, HAMQTT_Entity_Stats *stats);
+
+/**
+ * @brief Clear the publish and message counters of every component.
+ *
+ * @memberof HAMQTT_Device
+ */
+void hamqtt_device_reset_entity_stats(HAMQTT_Device *device);
+#endif
+
+#if HAMQTT_PIPELINE
+/**
+ * @brief Start the device's execution task. See hamqtt_pipeline.h.
+ *
+ * From now on inbound commands are run by the execution task, which also calls
+ * `hamqtt_device_loop` every `loop_interval_ms`; the application should stop calling it.
+ *
+ * @param device Pointer to the device.
+ * @param config Execution task settings.
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_STATE if the device has not connected to MQTT or the pipeline already runs
+ * - ESP_ERR_INVALID_ARG if the core or interval is invalid
+ * - ESP_ERR_NO_MEM if the ring or the task could not be allocated
+ *
+ * @memberof HAMQTT_Device
+ */
+esp_err_t hamqtt_device_start_pipeline(HAMQTT_Device *device, const HAMQTT_Pipeline_Config *config);
+
+/**
+ * @brief Stop the execution task. Commands still waiting are run on the caller, and later
+ * ones run on the transport's task again.
+ *
+ * @memberof HAMQTT_Device
+ */
+void hamqtt_device_stop_pipeline(HAMQTT_Device *device);
+
+/**
+ * @brief Get the pipeline's counters and the per-core utilization since the previous call.
+ *
+ * @param device Pointer to the device.
+ * @param[out] stats Set to the current stats.
+ *
+ * @memberof HAMQTT_Device
+ */
+void hamqtt_device_get_pipeline_stats(HAMQTT_Device *device, HAMQTT_Pipeline_Stats *stats);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_diagnostics.h
+ * @brief Diagnostic sensors that HAMQTT publishes about its own health.
+ *
+ * With `CONFIG_HAMQTT_DIAGNOSTICS` enabled, every device adds a set of sensors with the
+ * `diagnostic` entity category to its discovery payload: uptime, free and minimum free heap,
+ * reconnects, publishes, failed publishes, the p99 duration of `hamqtt_device_loop` and the
+ * depth of the MQTT outbox. All of them read one retained JSON state topic,
+ * `<unique_id>/diagnostics/state`.
+ *
+ * Reports are sent from `hamqtt_device_loop`, at most once per `interval_ms` spread by a
+ * random jitter, so a fleet of devices does not report in lockstep. A due report is only
+ * sent if a value moved past its deadband, a connection was (re)established, or
+ * `heartbeat_ms` passed since the last one. With the defaults that is at most one small
+ * publish a minute, and usually one every ten.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Schedule and deadbands of the diagnostic reports.
+ */
+typedef struct {
+    uint32_t interval_ms;           ///< Time between checks for a report. 0 disables the diagnostic sensors.
+    uint8_t jitter_pct;             ///< Each interval is randomly lengthened or shortened by up to this percentage.
+    uint32_t heartbeat_ms;          ///< Report even if nothing moved once this much time has passed.
+    uint32_t heap_deadband_bytes;   ///< Report when the free or minimum free heap moved by at least this much.
+    uint32_t outbox_deadband_bytes; ///< Report when the outbox depth moved by at least this much.
+    uint32_t loop_deadband_us;      ///< Report when the loop p99 moved by at least this much.
+    bool enabled_by_default;        ///< Whether Home Assistant enables the sensors when they are first discovered.
+} HAMQTT_Diagnostics_Config;
+
+/**
+ * @brief Returns a HAMQTT_Diagnostics_Config with the default schedule.
+ */
+HAMQTT_Diagnostics_Config hamqtt_diagnostics_config_default(void);
+
+/**
+ * @brief Counters and gauges a device keeps about itself.
+ *
+ * Counters are totals since the device was created. Loop percentiles cover the calls to
+ * `hamqtt_device_loop` since the last diagnostic report.
+ */
+typedef struct {
+    uint64_t uptime_ms;             ///< Time since the device was created.
+    uint32_t connects;              ///< Connections to the broker.
+    uint32_t reconnects;            ///< Connections made after one was lost without `hamqtt_device_disconnect`.
+    uint32_t disconnects;           ///< Connections that were lost without `hamqtt_device_disconnect`.
+    uint32_t messages_received;     ///< Messages received on any subscribed topic.
+    uint32_t publishes;             ///< Publishes made through the device's transport, including diagnostics.
+    uint32_t publish_failures;      ///< Publishes the transport rejected or dropped.
+    uint32_t diagnostics_publishes; ///< Diagnostic reports sent.
+    uint32_t loops;                 ///< Calls to `hamqtt_device_loop` in the current window.
+    uint32_t loop_p99_us;           ///< Upper bound of the loop p99 in the current window.
+    uint32_t loop_max_us;           ///< Longest loop in the current window.
+    size_t heap_free;               ///< Free heap in bytes.
+    size_t heap_min_free;           ///< Lowest free heap seen, in bytes.
+    int outbox_bytes;               ///< Bytes waiting in the MQTT outbox, or -1 if the transport cannot tell.
+} HAMQTT_Device_Stats;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_diagnostics_internal.h
+ * @brief Internal diagnostics state used by HAMQTT_Device.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "hamqtt_diagnostics.h"
+#include "hamqtt_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @internal
+ * @brief Per-device counters, the loop histogram and the report schedule.
+ */
+typedef struct HAMQTT_Diagnostics HAMQTT_Diagnostics;
+
+/**
+ * @internal
+ * @brief Allocate diagnostics with the default configuration.
+ */
+HAMQTT_Diagnostics *hamqtt_diagnostics_create(void);
+
+/**
+ * @internal
+ */
+void hamqtt_diagnostics_destroy(HAMQTT_Diagnostics *diagnostics);
+
+/**
+ * @internal
+ * @brief Replace the configuration. Takes effect from the next scheduled check.
+ */
+void hamqtt_diagnostics_set_config(HAMQTT_Diagnostics *diagnostics, const HAMQTT_Diagnostics_Config *config);
+
+/**
+ * @internal
+ * @brief Build the state topic. Kept until the diagnostics are destroyed.
+ */
+esp_err_t hamqtt_diagnostics_build_topics(HAMQTT_Diagnostics *diagnostics, const char *device_unique_id);
+
+#if HAMQTT_RUNTIME_DISCOVERY
+/**
+ * @internal
+ * @brief Add the diagnostic sensors to a device's `cmps` discovery object.
+ */
+esp_err_t hamqtt_diagnostics_add_discovery(const HAMQTT_Diagnostics *diagnostics, cJSON *components, const char *device_unique_id);
+#endif
+
+/**
+ * @internal
+ * @brief Record a connection, and send a report from the next loop.
+ */
+void hamqtt_diagnostics_handle_connected(HAMQTT_Diagnostics *diagnostics);
+
+/**
+ * @internal
+ * @brief Record a lost connection, unless @ref hamqtt_diagnostics_handle_stop was called first.
+ */
+void hamqtt_diagnostics_handle_disconnected(HAMQTT_Diagnostics *diagnostics);
+
+/**
+ * @internal
+ * @brief Note that the application is disconnecting on purpose.
+ */
+void hamqtt_diagnostics_handle_stop(HAMQTT_Diagnostics *diagnostics);
+
+/**
+ * @internal
+ * @brief Record a received message.
+ */
+void hamqtt_diagnostics_handle_message(HAMQTT_Diagnostics *diagnostics);
+
+/**
+ * @internal
+ * @brief Record the duration of one `hamqtt_device_loop`, and publish a report through
+ * `transport` if one is due.
+ */
+void hamqtt_diagnostics_update(HAMQTT_Diagnostics *diagnostics, HAMQTT_Transport *transport, int64_t loop_us);
+
+/**
+ * @internal
+ * @brief Fill `stats` from the counters and `transport`, which may be NULL before connecting.
+ */
+void hamqtt_diagnostics_get_stats(const HAMQTT_Diagnostics *diagnostics, HAMQTT_Transport *transport, HAMQTT_Device_Stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
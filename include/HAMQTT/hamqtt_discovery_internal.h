@@ -0,0 +1,93 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_discovery_internal.h
+ * @brief Table-driven emitter for Home Assistant discovery fields.
+ *
+ * Components describe the discovery fields of their configuration struct with a
+ * const table of @ref HAMQTT_Discovery_Field entries, and a single generic emitter
+ * walks the table to populate the component's cJSON discovery object.
+ *
+ * @note This file is not part of the public API and may change without notice.
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @internal
+ * @brief The C type of a discovery field, which determines how it is read and serialized.
+ */
+typedef enum {
+    HAMQTT_DISCOVERY_FIELD_STRING,  ///< A `const char *`. Omitted when NULL.
+    HAMQTT_DISCOVERY_FIELD_BOOL,    ///< A `bool`. Omitted when equal to `omit_value`.
+    HAMQTT_DISCOVERY_FIELD_INT,     ///< An `int`. Omitted when equal to `omit_value`.
+} HAMQTT_Discovery_Field_Type;
+
+/**
+ * @internal
+ * @brief Describes a single discovery field stored in a configuration struct.
+ */
+typedef struct {
+    const char *key;        ///< JSON key of the field.
+    uint16_t offset;        ///< Offset of the field inside the configuration struct.
+    uint8_t type;           ///< A @ref HAMQTT_Discovery_Field_Type.
+    int omit_value;         ///< Value for which the field is left out, because Home Assistant defaults to it.
+} HAMQTT_Discovery_Field;
+
+/** @internal @brief Describe a string field. It is omitted when NULL. */
+#define HAMQTT_DISCOVERY_STRING(json_key, config_type, member) \
+    { .key = (json_key), .offset = offsetof(config_type, member), .type = HAMQTT_DISCOVERY_FIELD_STRING, .omit_value = 0 }
+
+/** @internal @brief Describe a bool field. It is omitted when equal to `omit`. */
+#define HAMQTT_DISCOVERY_BOOL(json_key, config_type, member, omit) \
+    { .key = (json_key), .offset = offsetof(config_type, member), .type = HAMQTT_DISCOVERY_FIELD_BOOL, .omit_value = (omit) }
+
+/** @internal @brief Describe an int field. It is omitted when equal to `omit`. */
+#define HAMQTT_DISCOVERY_INT(json_key, config_type, member, omit) \
+    { .key = (json_key), .offset = offsetof(config_type, member), .type = HAMQTT_DISCOVERY_FIELD_INT, .omit_value = (omit) }
+
+/**
+ * @internal
+ * @brief Adds every non-default field in `fields` to a discovery object.
+ *
+ * @param root The cJSON object to populate.
+ * @param config Pointer to the configuration struct the field offsets refer to.
+ * @param fields Table of fields to emit.
+ * @param field_count Number of entries in `fields`.
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_NO_MEM if a field could not be added
+ */
+esp_err_t hamqtt_discovery_add_fields(cJSON *root,
+                                      const void *config,
+                                      const HAMQTT_Discovery_Field *fields,
+                                      size_t field_count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_group.h
+ * @brief HAMQTT Group component interface for Home Assistant MQTT discovery.
+ *
+ * A group is a button in Home Assistant with one command topic. A command sent to it is handed
+ * to every member that takes commands in a single pass, without routing each one. The binary
+ * sensors among the members are reported together: the group samples them in
+ * `hamqtt_device_loop` and publishes one JSON object mapping their unique ids to `ON` or `OFF`,
+ * which their discovery payloads read with a value template.
+ *
+ * Members are still added to the device on their own, so they keep their own entities and
+ * command topics.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "common.h"
+#include "hamqtt_component.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Configuration parameters for a HAMQTT group.
+ */
+typedef struct {
+    bool enabled_by_default;        ///< Set to `false` if the group should not be enabled when the group is first added.
+    const char *entity_picture;     ///< URL to a picture for the group. @note Optional.
+    const char *icon;               ///< Icon for the group. @note Optional.
+    const char *name;               ///< The name of the group shown in Home Assistant.
+    const char *unique_id;          ///< Unique identifier used for discovery in Home Assistant.
+} HAMQTT_Group_Config;
+
+/**
+ * @brief Returns a default-initialized group configuration.
+ *
+ * Caller is still responsible for assigning unique_id
+ *
+ * @return A default-initialized HAMQTT_Group_Config struct.
+ *
+ * @memberof HAMQTT_Group_Config
+ */
+HAMQTT_Group_Config hamqtt_group_config_default(void);
+
+/**
+ * @struct HAMQTT_Group
+ * @brief Internal representation of a group of components.
+ */
+typedef struct HAMQTT_Group HAMQTT_Group;
+
+/**
+ * @internal
+ * @brief Virtual function table shared by every group.
+ */
+extern const HAMQTT_Component_VTable hamqtt_group_vtable;
+
+/**
+ * @brief Create a new HAMQTT group.
+ *
+ * Each command sent to the group's topic is passed unchanged to every member that subscribes
+ * to a topic, as if it had been sent to the member's first topic. The member binary sensors
+ * stop publishing to their own state topics and are reported by the group instead, so the
+ * group must be added to the device as well: @ref hamqtt_device_connect fails otherwise.
+ *
+ * @param config Pointer to a group configuration. Must remain valid for the lifetime of the group.
+ * @param members Components in the group. The array is copied, the components must outlive the group.
+ * @param member_count Number of components in `members`. Must not be 0.
+ * @return Pointer to the created HAMQTT_Group, or NULL on failure, including when a member
+ *         binary sensor is already in another group, its device already connected, or its
+ *         unique id holds a quote, a backslash, an MQTT wildcard, a slash or a control character.
+ *
+ * @memberof HAMQTT_Group
+ */
+HAMQTT_Group *hamqtt_group_create(const HAMQTT_Group_Config *config, HAMQTT_Component *const *members, size_t member_count);
+
+/**
+ * @brief Destroy a HAMQTT group and free all resources. Its binary sensors report their own
+ * state again once their device next connects.
+ *
+ * @param group Pointer to the group to destroy. Must not be NULL.
+ *
+ * @memberof HAMQTT_Group
+ */
+void hamqtt_group_destroy(HAMQTT_Group *group);
+
+/**
+ * @brief Get the configuration used to initialize the group.
+ *
+ * @param group Pointer to the group.
+ * @return Pointer to the original configuration struct.
+ *
+ * @memberof HAMQTT_Group
+ */
+const HAMQTT_Group_Config *hamqtt_group_get_config(const HAMQTT_Group *group);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_latency.h
+ * @brief Latency histograms for commands, state publishes and broker round trips.
+ *
+ * With `CONFIG_HAMQTT_LATENCY` enabled, each device timestamps the stages an inbound command
+ * passes through (arrival, route lookup, queue wait, component callback) and the time from
+ * a QoS 1 state publish to its PUBACK, and accumulates them into one histogram per entity
+ * and stage. A loopback probe publishes a timestamp to a topic the device subscribes to,
+ * measuring the round trip through the broker.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Number of buckets in a @ref HAMQTT_Latency_Histogram.
+ *
+ * Bucket 0 counts samples under 1 µs, bucket `i` counts samples in `[2^(i-1), 2^i)` µs, and
+ * the last bucket also counts everything above it (about 0.5 s).
+ */
+#define HAMQTT_LATENCY_BUCKETS 20
+
+/**
+ * @brief Stages that latency is measured for.
+ */
+typedef enum {
+    HAMQTT_LATENCY_STAGE_ROUTE,         ///< Message arrival until the addressed component is found.
+    HAMQTT_LATENCY_STAGE_QUEUE_WAIT,    ///< Component found until its handler starts.
+    HAMQTT_LATENCY_STAGE_CALLBACK,      ///< Duration of the component's handler, including user callbacks.
+    HAMQTT_LATENCY_STAGE_COMMAND,       ///< Message arrival until the component's handler returns.
+    HAMQTT_LATENCY_STAGE_PUBLISH_ACK,   ///< State publish until the broker acknowledges it (QoS 1 only).
+    HAMQTT_LATENCY_STAGE_PROBE_RTT,     ///< Loopback probe publish until it is received back. Recorded per device.
+    HAMQTT_LATENCY_STAGE_COUNT,
+} HAMQTT_Latency_Stage;
+
+/**
+ * @brief A log2 histogram of latencies in microseconds.
+ */
+typedef struct {
+    uint32_t buckets[HAMQTT_LATENCY_BUCKETS];   ///< Sample counts, see @ref HAMQTT_LATENCY_BUCKETS.
+    uint32_t count;                             ///< Total number of samples.
+    uint32_t max_us;                            ///< Largest sample.
+    uint64_t total_us;                          ///< Sum of all samples.
+} HAMQTT_Latency_Histogram;
+
+/**
+ * @brief Add a sample to a histogram.
+ *
+ * @param histogram Histogram to update.
+ * @param us Latency in microseconds. Negative values are recorded as 0.
+ */
+void hamqtt_latency_histogram_add(HAMQTT_Latency_Histogram *histogram, int64_t us);
+
+/**
+ * @brief Estimate a percentile from a histogram.
+ *
+ * @param histogram Histogram to read.
+ * @param p Percentile, from 0 to 100.
+ * @return Upper bound of the bucket holding the percentile, in microseconds, capped at the
+ *         largest sample. 0 if the histogram is empty.
+ */
+uint32_t hamqtt_latency_histogram_percentile(const HAMQTT_Latency_Histogram *histogram, double p);
+
+/**
+ * @brief Get a printable name for a stage.
+ */
+const char *hamqtt_latency_stage_name(HAMQTT_Latency_Stage stage);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_latency_internal.h
+ * @brief Internal latency recorder used by HAMQTT_Device.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "hamqtt_latency.h"
+#include "hamqtt_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @internal
+ * @brief Per-device latency histograms, and the state needed to match PUBACKs to publishes.
+ */
+typedef struct HAMQTT_Latency HAMQTT_Latency;
+
+/**
+ * @internal
+ * @brief Allocate a recorder for `entity_count` entities.
+ */
+HAMQTT_Latency *hamqtt_latency_create(size_t entity_count);
+
+/**
+ * @internal
+ */
+void hamqtt_latency_destroy(HAMQTT_Latency *latency);
+
+/**
+ * @internal
+ * @brief Zero every histogram.
+ */
+void hamqtt_latency_reset(HAMQTT_Latency *latency);
+
+/**
+ * @internal
+ * @brief Record a sample. `entity` is ignored for @ref HAMQTT_LATENCY_STAGE_PROBE_RTT.
+ */
+void hamqtt_latency_record(HAMQTT_Latency *latency, size_t entity, HAMQTT_Latency_Stage stage, int64_t us);
+
+/**
+ * @internal
+ * @brief Get a copy of a histogram.
+ */
+esp_err_t hamqtt_latency_get(const HAMQTT_Latency *latency, size_t entity, HAMQTT_Latency_Stage stage, HAMQTT_Latency_Histogram *histogram);
+
+/**
+ * @internal
+ * @brief Get a transport that forwards to `inner` and remembers when each QoS 1 publish was
+ * made, and by which entity. Pass it to component updates instead of `inner`.
+ *
+ * The returned transport is owned by the recorder and is reused by later calls.
+ */
+HAMQTT_Transport *hamqtt_latency_wrap_transport(HAMQTT_Latency *latency, HAMQTT_Transport *inner);
+
+/**
+ * @internal
+ * @brief Set the entity that publishes through the wrapped transport are attributed to.
+ */
+void hamqtt_latency_set_publisher(HAMQTT_Latency *latency, size_t entity);
+
+/**
+ * @internal
+ * @brief Record the publish to PUBACK latency of a message, if it was made through the wrapped transport.
+ */
+void hamqtt_latency_handle_ack(HAMQTT_Latency *latency, int msg_id);
+
+/**
+ * @internal
+ * @brief Returns true, at most once per `interval_ms`, when a loopback probe is due.
+ */
+bool hamqtt_latency_probe_due(HAMQTT_Latency *latency, uint32_t interval_ms);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_pipeline.h
+ * @brief Split network work and application work across two cores.
+ *
+ * With `CONFIG_HAMQTT_PIPELINE` enabled, a device can hand its application work to an
+ * execution task pinned to one core, while the MQTT client task keeps the other:
+ *
+ * - The MQTT task receives messages and HAMQTT routes them to components, as without the
+ *   pipeline. Instead of calling the component, it copies the command into a slot of a
+ *   single-producer, single-consumer ring and wakes the execution task.
+ * - The execution task runs the queued command callbacks and calls `hamqtt_device_loop` at a
+ *   fixed interval, which samples every component. Its publishes are enqueued for the MQTT
+ *   task to send, so socket writes stay on the network core.
+ *
+ * On ESP-IDF the MQTT task is pinned with esp-mqtt's own "Enable MQTT task core selection"
+ * option; choose the other core for the execution task. Commands that arrive while the ring
+ * is full are dropped and counted.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Cores the pipeline reports utilization for.
+ */
+#define HAMQTT_PIPELINE_MAX_CORES HAMQTT_PORT_MAX_CORES
+
+/**
+ * @brief Execution task settings.
+ */
+typedef struct {
+    int execution_core;         ///< Core the execution task is pinned to, or -1 to let the scheduler choose.
+    uint32_t loop_interval_ms;  ///< Time between the execution task's calls to `hamqtt_device_loop`.
+    uint32_t stack_size;        ///< Stack of the execution task in bytes. Ignored on the host.
+    uint8_t priority;           ///< FreeRTOS priority of the execution task. Ignored on the host.
+} HAMQTT_Pipeline_Config;
+
+/**
+ * @brief Returns a HAMQTT_Pipeline_Config pinned to `CONFIG_HAMQTT_PIPELINE_EXECUTION_CORE`,
+ * sampling every 500 ms.
+ */
+HAMQTT_Pipeline_Config hamqtt_pipeline_config_default(void);
+
+/**
+ * @brief Share of one core's time over the stats window, in percent.
+ */
+typedef struct {
+    float routing_pct;          ///< Routing inbound commands, on the MQTT task.
+    float execution_pct;        ///< Command callbacks and `hamqtt_device_loop`, on the execution task.
+    float load_pct;             ///< Time the core was not idle, or -1 if the platform cannot tell.
+} HAMQTT_Core_Utilization;
+
+/**
+ * @brief Counters of a device's pipeline and per-core utilization since the previous read.
+ */
+typedef struct {
+    bool running;                                           ///< Whether the execution task is running.
+    int routing_core;                                       ///< Core the last command was routed on, -1 before the first.
+    int execution_core;                                     ///< Core the execution task last ran on, -1 before it ran.
+    uint32_t commands;                                      ///< Commands handed to the execution task.
+    uint32_t commands_dropped;                              ///< Commands dropped because the ring was full.
+    uint32_t ring_slots;                                    ///< Slots in the command ring.
+    uint32_t ring_high_water;                               ///< Most commands waiting at once.
+    uint32_t loops;                                         ///< Calls to `hamqtt_device_loop` made by the execution task.
+    uint64_t window_us;                                     ///< Time the utilization covers.
+    size_t core_count;                                      ///< Entries of `cores` in use.
+    HAMQTT_Core_Utilization cores[HAMQTT_PIPELINE_MAX_CORES];
+} HAMQTT_Pipeline_Stats;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_pipeline_internal.h
+ * @brief Internal command ring and execution task used by HAMQTT_Device.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "hamqtt_component.h"
+#include "hamqtt_pipeline.h"
+#include "hamqtt_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @internal
+ * @brief A routed command waiting for the execution task. Topic and payload are copies.
+ */
+typedef struct {
+    HAMQTT_Component *component;
+    size_t index;                               ///< Index of the component in the device.
+    int64_t arrival_us;
+    int64_t routed_us;
+    char topic[HAMQTT_MAX_CHAR_BUF_SIZE];
+    char data[HAMQTT_MAX_CHAR_BUF_SIZE];
+} HAMQTT_Pipeline_Command;
+
+/**
+ * @internal
+ * @brief Work the execution task does on behalf of the device.
+ */
+typedef struct {
+    void (*execute)(void *context, const HAMQTT_Pipeline_Command *command);
+    void (*loop)(void *context);
+    void *context;
+} HAMQTT_Pipeline_Callbacks;
+
+/**
+ * @internal
+ * @brief The command ring, the execution task and their counters.
+ */
+typedef struct HAMQTT_Pipeline HAMQTT_Pipeline;
+
+/**
+ * @internal
+ * @brief Allocate a stopped pipeline. The ring is allocated by the first start.
+ */
+HAMQTT_Pipeline *hamqtt_pipeline_create(const HAMQTT_Pipeline_Callbacks *callbacks);
+
+/**
+ * @internal
+ * @brief Stop the pipeline if it runs and free it.
+ */
+void hamqtt_pipeline_destroy(HAMQTT_Pipeline *pipeline);
+
+/**
+ * @internal
+ * @brief Start the execution task. Commands submitted from now on are run by it.
+ */
+esp_err_t hamqtt_pipeline_start(HAMQTT_Pipeline *pipeline, const HAMQTT_Pipeline_Config *config);
+
+/**
+ * @internal
+ * @brief Stop the execution task and run the commands still in the ring on the caller.
+ */
+void hamqtt_pipeline_stop(HAMQTT_Pipeline *pipeline);
+
+/**
+ * @internal
+ * @brief Get the next free slot for the producer to fill. Only one task may submit.
+ *
+ * @return
+ * - ESP_OK if `command` was set to a free slot
+ * - ESP_ERR_INVALID_STATE if the pipeline is not running
+ * - ESP_ERR_NO_MEM if the ring is full, in which case the command is counted as dropped
+ */
+esp_err_t hamqtt_pipeline_begin_submit(HAMQTT_Pipeline *pipeline, HAMQTT_Pipeline_Command **command);
+
+/**
+ * @internal
+ * @brief Hand the slot from @ref hamqtt_pipeline_begin_submit to the execution task.
+ */
+void hamqtt_pipeline_end_submit(HAMQTT_Pipeline *pipeline);
+
+/**
+ * @internal
+ * @brief Count time spent routing on the calling core.
+ */
+void hamqtt_pipeline_record_routing(HAMQTT_Pipeline *pipeline, int64_t busy_us);
+
+/**
+ * @internal
+ * @brief Whether the caller is the execution task.
+ */
+bool hamqtt_pipeline_is_execution_task(const HAMQTT_Pipeline *pipeline);
+
+/**
+ * @internal
+ * @brief Get a transport that forwards to `inner` but enqueues publishes instead of sending
+ * them, so the MQTT task writes them to the socket. Owned by the pipeline.
+ */
+HAMQTT_Transport *hamqtt_pipeline_wrap_transport(HAMQTT_Pipeline *pipeline, HAMQTT_Transport *inner);
+
+/**
+ * @internal
+ * @brief Read the counters and the utilization since the previous call, and start a new window.
+ */
+void hamqtt_pipeline_get_stats(HAMQTT_Pipeline *pipeline, HAMQTT_Pipeline_Stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
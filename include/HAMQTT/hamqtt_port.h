@@ -0,0 +1,307 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_port.h
+ * @brief Platform layer that lets HAMQTT build for ESP-IDF and for a Linux host.
+ *
+ * On ESP-IDF this simply pulls in the ESP-IDF headers HAMQTT relies on. On a host build
+ * it provides the small subset of `esp_err.h`, `esp_log.h` and `esp_check.h` that the
+ * library uses, so that the same sources compile unchanged.
+ *
+ * This file is included internally by @ref common.h and should not typically be included
+ * directly by user applications.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+
+#include "esp_system.h"
+#include "esp_random.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+/**
+ * @brief Returns a monotonic timestamp in microseconds.
+ */
+static inline int64_t hamqtt_port_time_us(void) {
+    return esp_timer_get_time();
+}
+
+/**
+ * @brief Returns the number of free heap bytes.
+ */
+static inline size_t hamqtt_port_heap_free(void) {
+    return esp_get_free_heap_size();
+}
+
+/**
+ * @brief Returns the lowest number of free heap bytes since boot.
+ */
+static inline size_t hamqtt_port_heap_min_free(void) {
+    return esp_get_minimum_free_heap_size();
+}
+
+/**
+ * @brief Returns a random number. Not suitable for cryptography on the host.
+ */
+static inline uint32_t hamqtt_port_random(void) {
+    return esp_random();
+}
+
+/**
+ * @brief Upper bound on the cores @ref hamqtt_port_core_id can return.
+ */
+#define HAMQTT_PORT_MAX_CORES portNUM_PROCESSORS
+
+/**
+ * @brief Returns the core the caller is running on.
+ */
+static inline int hamqtt_port_core_id(void) {
+    return (int)xPortGetCoreID();
+}
+
+/**
+ * @brief Returns the number of cores.
+ */
+static inline int hamqtt_port_core_count(void) {
+    return portNUM_PROCESSORS;
+}
+
+/**
+ * @brief Reads the time a core has spent idle, in microseconds. The counter wraps, so only
+ * differences between two reads are meaningful.
+ *
+ * @return false if the time is not available, which needs `CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS`.
+ */
+static inline bool hamqtt_port_core_idle_us(int core, uint32_t *idle_us) {
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    *idle_us = (uint32_t)ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(core));
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief A mutex that can be held across blocking calls.
+ */
+typedef SemaphoreHandle_t HAMQTT_Port_Mutex;
+
+static inline esp_err_t hamqtt_port_mutex_init(HAMQTT_Port_Mutex *mutex) {
+    *mutex = xSemaphoreCreateMutex();
+    return *mutex ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static inline void hamqtt_port_mutex_lock(HAMQTT_Port_Mutex *mutex) {
+    xSemaphoreTake(*mutex, portMAX_DELAY);
+}
+
+static inline void hamqtt_port_mutex_unlock(HAMQTT_Port_Mutex *mutex) {
+    xSemaphoreGive(*mutex);
+}
+
+static inline void hamqtt_port_mutex_destroy(HAMQTT_Port_Mutex *mutex) {
+    vSemaphoreDelete(*mutex);
+}
+
+#else /* Host build */
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int esp_err_t;
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_NO_MEM          0x101
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_INVALID_SIZE    0x104
+#define ESP_ERR_NOT_FOUND       0x105
+#define ESP_ERR_NOT_SUPPORTED   0x106
+#define ESP_ERR_TIMEOUT         0x107
+
+#ifndef BIT0
+#define BIT0 (1U << 0)
+#define BIT1 (1U << 1)
+#define BIT2 (1U << 2)
+#define BIT3 (1U << 3)
+#endif
+
+/**
+ * @brief Log levels of the host logger, matching `esp_log_level_t`.
+ */
+typedef enum {
+    HAMQTT_PORT_LOG_NONE,
+    HAMQTT_PORT_LOG_ERROR,
+    HAMQTT_PORT_LOG_WARN,
+    HAMQTT_PORT_LOG_INFO,
+    HAMQTT_PORT_LOG_DEBUG,
+    HAMQTT_PORT_LOG_VERBOSE,
+} HAMQTT_Port_Log_Level;
+
+/**
+ * @brief Messages above this level are discarded by the host logger. Defaults to `HAMQTT_PORT_LOG_INFO`.
+ */
+extern HAMQTT_Port_Log_Level hamqtt_port_log_level;
+
+/**
+ * @brief Writes a log line to stderr on the host build.
+ */
+void hamqtt_port_log(HAMQTT_Port_Log_Level level, const char *tag, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Returns a monotonic timestamp in microseconds, like `esp_timer_get_time`.
+ */
+int64_t hamqtt_port_time_us(void);
+
+/**
+ * @brief Make @ref hamqtt_port_time_us return `clock(args)`, or the monotonic clock again if
+ * `clock` is NULL.
+ *
+ * Used by the mock transport's `drive_port_clock`. Must not be called while other threads
+ * may be reading the clock.
+ */
+void hamqtt_port_set_clock(int64_t (*clock)(void *args), void *args);
+
+/**
+ * @brief Returns the bytes free in the malloc arenas (`mallinfo2().fordblks`).
+ *
+ * Unlike an ESP32 heap, the host heap grows on demand, so this counts the free memory malloc
+ * already holds rather than a limit allocations can reach.
+ */
+size_t hamqtt_port_heap_free(void);
+
+/**
+ * @brief Returns the lowest value @ref hamqtt_port_heap_free has returned.
+ */
+size_t hamqtt_port_heap_min_free(void);
+
+/**
+ * @brief Returns a random number. Not suitable for cryptography on the host.
+ */
+uint32_t hamqtt_port_random(void);
+
+/**
+ * @brief Upper bound on the cores @ref hamqtt_port_core_id can return. Cores above it are
+ * not told apart.
+ */
+#define HAMQTT_PORT_MAX_CORES 16
+
+/**
+ * @brief Returns the CPU the calling thread is running on, clamped below @ref HAMQTT_PORT_MAX_CORES.
+ */
+int hamqtt_port_core_id(void);
+
+/**
+ * @brief Returns the number of online CPUs, at most @ref HAMQTT_PORT_MAX_CORES.
+ */
+int hamqtt_port_core_count(void);
+
+/**
+ * @brief Reads the time a CPU has spent idle from `/proc/stat`, in microseconds. The
+ * counter wraps, so only differences between two reads are meaningful.
+ *
+ * @return false if the time is not available.
+ */
+bool hamqtt_port_core_idle_us(int core, uint32_t *idle_us);
+
+/**
+ * @brief A mutex that can be held across blocking calls.
+ */
+typedef pthread_mutex_t HAMQTT_Port_Mutex;
+
+static inline esp_err_t hamqtt_port_mutex_init(HAMQTT_Port_Mutex *mutex) {
+    return pthread_mutex_init(mutex, NULL) == 0 ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static inline void hamqtt_port_mutex_lock(HAMQTT_Port_Mutex *mutex) {
+    pthread_mutex_lock(mutex);
+}
+
+static inline void hamqtt_port_mutex_unlock(HAMQTT_Port_Mutex *mutex) {
+    pthread_mutex_unlock(mutex);
+}
+
+static inline void hamqtt_port_mutex_destroy(HAMQTT_Port_Mutex *mutex) {
+    pthread_mutex_destroy(mutex);
+}
+
+#define ESP_LOGE(tag, format, ...) hamqtt_port_log(HAMQTT_PORT_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) hamqtt_port_log(HAMQTT_PORT_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) hamqtt_port_log(HAMQTT_PORT_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) hamqtt_port_log(HAMQTT_PORT_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) hamqtt_port_log(HAMQTT_PORT_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+#define ESP_RETURN_ON_ERROR(x, log_tag, format, ...) do {                       \
+        esp_err_t err_rc_ = (x);                                                \
+        if (err_rc_ != ESP_OK) {                                                \
+            ESP_LOGE(log_tag, "%s(%d): " format, __func__, __LINE__, ##__VA_ARGS__); \
+            return err_rc_;                                                     \
+        }                                                                       \
+    } while (0)
+
+#define ESP_RETURN_ON_FALSE(a, err_code, log_tag, format, ...) do {             \
+        if (!(a)) {                                                             \
+            ESP_LOGE(log_tag, "%s(%d): " format, __func__, __LINE__, ##__VA_ARGS__); \
+            return err_code;                                                    \
+        }                                                                       \
+    } while (0)
+
+#define ESP_GOTO_ON_ERROR(x, goto_tag, log_tag, format, ...) do {               \
+        esp_err_t err_rc_ = (x);                                                \
+        if (err_rc_ != ESP_OK) {                                                \
+            ESP_LOGE(log_tag, "%s(%d): " format, __func__, __LINE__, ##__VA_ARGS__); \
+            ret = err_rc_;                                                      \
+            goto goto_tag;                                                      \
+        }                                                                       \
+    } while (0)
+
+#define ESP_GOTO_ON_FALSE(a, err_code, goto_tag, log_tag, format, ...) do {     \
+        if (!(a)) {                                                             \
+            ESP_LOGE(log_tag, "%s(%d): " format, __func__, __LINE__, ##__VA_ARGS__); \
+            ret = err_code;                                                     \
+            goto goto_tag;                                                      \
+        }                                                                       \
+    } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESP_PLATFORM */
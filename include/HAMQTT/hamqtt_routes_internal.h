@@ -0,0 +1,155 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_routes_internal.h
+ * @brief Internal component and route table shared by the loop and the transport's task.
+ *
+ * The device publishes an immutable snapshot of its components and the topics they
+ * subscribe to. Readers enter a read-side section, use the current snapshot and leave,
+ * without taking a lock. Publishing a new snapshot swaps a pointer; the old snapshot is
+ * retired and only freed once every reader that could still hold it has left.
+ *
+ * Subscribed topics may be MQTT filters with `+` and `#` levels. Each snapshot indexes its
+ * exact topics in a hash table and its filters in a trie of topic levels, so matching a topic
+ * costs one hash probe plus, if there are filters, one step per level, however many
+ * components subscribe.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "hamqtt_component.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @internal
+ * @brief A subscribed topic and the component it is routed to.
+ */
+typedef struct {
+    const char *topic;              ///< Copy owned by the table.
+    HAMQTT_Component *component;
+    size_t index;                   ///< Index of the component in the table.
+} HAMQTT_Route;
+
+/**
+ * @internal
+ * @brief An immutable snapshot of a device's components and routes.
+ */
+typedef struct {
+    size_t component_count;
+    HAMQTT_Component *const *components;
+    size_t route_count;
+    const HAMQTT_Route *routes;
+} HAMQTT_Route_Table;
+
+/**
+ * @internal
+ * @brief Called by @ref hamqtt_routes_match for each route a topic matches.
+ */
+typedef void (*HAMQTT_Route_Visitor)(const HAMQTT_Route *route, void *context);
+
+/**
+ * @internal
+ * @brief Readers that may use the table at the same time. Each has its own counters, so
+ * they do not contend with each other.
+ *
+ * A reader must only be used by one task at a time. Retired snapshots are freed once the
+ * reader's sections drop back to zero, which the overlapping sections of two tasks could
+ * keep from ever happening.
+ */
+typedef enum {
+    HAMQTT_ROUTES_READER_LOOP,          ///< The task running `hamqtt_device_loop`.
+    HAMQTT_ROUTES_READER_TRANSPORT,     ///< The transport's event task.
+    HAMQTT_ROUTES_READER_SCENE,         ///< The task applying a scene, one at a time.
+    HAMQTT_ROUTES_READER_COUNT,
+} HAMQTT_Routes_Reader;
+
+/**
+ * @internal
+ * @brief The current snapshot, the readers' counters and the retired snapshots.
+ */
+typedef struct HAMQTT_Routes HAMQTT_Routes;
+
+/**
+ * @internal
+ * @brief Allocate routes with an empty table.
+ */
+HAMQTT_Routes *hamqtt_routes_create(void);
+
+/**
+ * @internal
+ * @brief Free the routes and every snapshot. No reader may be inside a read-side section.
+ */
+void hamqtt_routes_destroy(HAMQTT_Routes *routes);
+
+/**
+ * @internal
+ * @brief Publish a snapshot of `components` and their subscribed topics, unless it matches
+ * the current one, and free retired snapshots no reader can still hold.
+ *
+ * Topics that are still NULL are left out. Only one task may publish at a time.
+ */
+esp_err_t hamqtt_routes_publish(HAMQTT_Routes *routes, HAMQTT_Component *const *components, size_t component_count);
+
+/**
+ * @internal
+ * @brief Enter a read-side section and get the current snapshot. Never blocks. Sections
+ * may nest.
+ */
+const HAMQTT_Route_Table *hamqtt_routes_enter(HAMQTT_Routes *routes, HAMQTT_Routes_Reader reader);
+
+/**
+ * @internal
+ * @brief Call `visit` for every route whose topic or filter matches `topic`.
+ *
+ * Routes with exactly that topic come first, in table order, then routes whose filter
+ * matches. As in MQTT, `#` also matches the parent level, and filters starting with a
+ * wildcard do not match topics starting with `$`.
+ *
+ * @param table A snapshot from @ref hamqtt_routes_enter.
+ * @param topic The topic. Need not be NUL terminated.
+ * @param topic_len Length of `topic` in bytes.
+ * @return The number of routes visited.
+ */
+size_t hamqtt_routes_match(const HAMQTT_Route_Table *table,
+                           const char *topic,
+                           size_t topic_len,
+                           HAMQTT_Route_Visitor visit,
+                           void *context);
+
+/**
+ * @internal
+ * @brief Leave a read-side section. The snapshot must not be used afterwards.
+ */
+void hamqtt_routes_exit(HAMQTT_Routes *routes, HAMQTT_Routes_Reader reader);
+
+/**
+ * @internal
+ * @brief Number of retired snapshots that are not freed yet. Only the publishing task may
+ * call it.
+ */
+size_t hamqtt_routes_retired_count(const HAMQTT_Routes *routes);
+
+#ifdef __cplusplus
+}
+#endif
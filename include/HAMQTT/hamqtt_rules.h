@@ -0,0 +1,94 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_rules.h
+ * @brief Local automation rules that run on the device without a broker round trip.
+ *
+ * With `CONFIG_HAMQTT_RULES` enabled, a device can react to its own binary sensors: a rule
+ * such as "when `hall_switch` turns ON, press `relay_toggle`" runs from the binary sensor's
+ * state-change path in `hamqtt_device_loop`, before the new state is published to Home
+ * Assistant. Rules keep working while the broker or Home Assistant is unreachable.
+ *
+ * Rules refer to components by unique id and are compiled into a dispatch table by
+ * @ref hamqtt_device_set_rules, so the loop only walks the actions of the sensor that changed.
+ *
+ * @code
+ * static const HAMQTT_Rule rules[] = {
+ *     { .trigger = "hall_switch", .when = HAMQTT_RULE_WHEN_ON,
+ *       .action = HAMQTT_RULE_ACTION_PRESS, .target = "relay_toggle" },
+ *     { .trigger = "hall_door", .when = HAMQTT_RULE_WHEN_CHANGED,
+ *       .action = HAMQTT_RULE_ACTION_CALL, .func = set_hall_light, .func_args = &hall_light },
+ * };
+ *
+ * hamqtt_device_set_rules(device, rules, sizeof(rules) / sizeof(rules[0]));
+ * @endcode
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief State changes of the trigger that run a rule.
+ */
+typedef enum {
+    HAMQTT_RULE_WHEN_ON = 1 << 0,                                       ///< The trigger turned ON.
+    HAMQTT_RULE_WHEN_OFF = 1 << 1,                                      ///< The trigger turned OFF.
+    HAMQTT_RULE_WHEN_CHANGED = HAMQTT_RULE_WHEN_ON | HAMQTT_RULE_WHEN_OFF,  ///< The trigger turned ON or OFF.
+} HAMQTT_Rule_When;
+
+/**
+ * @brief What a rule does when it runs.
+ */
+typedef enum {
+    HAMQTT_RULE_ACTION_PRESS,       ///< Press the button `target`, as if Home Assistant had pressed it.
+    HAMQTT_RULE_ACTION_CALL,        ///< Call `func` with the trigger's new state.
+} HAMQTT_Rule_Action;
+
+/**
+ * @brief Function called by a @ref HAMQTT_RULE_ACTION_CALL rule.
+ *
+ * @param state The new state of the trigger.
+ * @param args The rule's `func_args`.
+ */
+typedef void (*HAMQTT_Rule_Func)(bool state, void *args);
+
+/**
+ * @brief A local automation rule.
+ *
+ * Rules are only read by @ref hamqtt_device_set_rules, so they may live on the stack.
+ */
+typedef struct {
+    const char *trigger;            ///< Unique id of the binary sensor whose state changes run the rule.
+    HAMQTT_Rule_When when;          ///< State changes of the trigger that run the rule.
+    HAMQTT_Rule_Action action;      ///< What the rule does.
+    const char *target;             ///< Unique id of the button to press. Only used by @ref HAMQTT_RULE_ACTION_PRESS.
+    HAMQTT_Rule_Func func;          ///< Function to call. Only used by @ref HAMQTT_RULE_ACTION_CALL.
+    void *func_args;                ///< Passed to `func`.
+} HAMQTT_Rule;
+
+#ifdef __cplusplus
+}
+#endif
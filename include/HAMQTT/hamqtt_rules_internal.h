@@ -0,0 +1,103 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_rules_internal.h
+ * @brief Internal dispatch table compiled from a device's local automation rules.
+ *
+ * Each trigger sensor points at its own slice of the table, which holds one run of actions
+ * for turning OFF and one for turning ON. A rule that fires on both is copied into both runs,
+ * so dispatching is an index by the new state and a loop over resolved function pointers.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "hamqtt_component.h"
+#include "hamqtt_rules.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @internal
+ * @brief A resolved rule action.
+ */
+typedef struct {
+    HAMQTT_Rule_Func func;
+    void *args;
+} HAMQTT_Rule_Entry;
+
+/**
+ * @internal
+ * @brief The actions of one trigger sensor, indexed by its new state.
+ */
+typedef struct HAMQTT_Rule_Slice {
+    const HAMQTT_Rule_Entry *entries[2];
+    size_t count[2];
+} HAMQTT_Rule_Slice;
+
+/**
+ * @internal
+ * @brief A compiled rule table and the sensors it is attached to.
+ */
+typedef struct HAMQTT_Rules HAMQTT_Rules;
+
+/**
+ * @internal
+ * @brief Resolve `rules` against `components`, build the dispatch table and attach each
+ * trigger sensor to its slice.
+ *
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_NOT_FOUND if a trigger or target is not one of `components`
+ * - ESP_ERR_INVALID_ARG if a trigger is not a binary sensor, a target is not a button, or a
+ *   rule has no states or function
+ * - ESP_ERR_INVALID_STATE if a trigger already has rules from another device
+ * - ESP_ERR_NO_MEM if the table could not be allocated
+ */
+esp_err_t hamqtt_rules_compile(const HAMQTT_Rule *rules,
+                               size_t rule_count,
+                               HAMQTT_Component *const *components,
+                               size_t component_count,
+                               HAMQTT_Rules **compiled);
+
+/**
+ * @internal
+ * @brief Detach the trigger sensors and free the table.
+ */
+void hamqtt_rules_destroy(HAMQTT_Rules *rules);
+
+/**
+ * @internal
+ * @brief Run the actions of `slice` for a change to `state`.
+ */
+static inline void hamqtt_rules_dispatch(const HAMQTT_Rule_Slice *slice, bool state) {
+    const HAMQTT_Rule_Entry *entries = slice->entries[state];
+    size_t count = slice->count[state];
+
+    for (size_t i = 0; i < count; ++i) {
+        entries[i].func(state, entries[i].args);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_scene_internal.h
+ * @brief Internal scene endpoint used by HAMQTT_Device.
+ *
+ * A scene is one JSON object mapping component unique ids to the command each should get,
+ * e.g. `{"relay_1":"PRESS","relay_2":"PRESS"}`. It is parsed in place into buffers
+ * allocated with the device, checked as a whole, and only then handed to every component
+ * back to back. The applied scene is published once as the consolidated state.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "hamqtt_routes_internal.h"
+#include "hamqtt_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @internal
+ * @brief Topics, parse buffers and the scene waiting for the execution task.
+ */
+typedef struct HAMQTT_Scene HAMQTT_Scene;
+
+/**
+ * @internal
+ * @brief Allocate a scene endpoint with all its buffers.
+ */
+HAMQTT_Scene *hamqtt_scene_create(void);
+
+/**
+ * @internal
+ */
+void hamqtt_scene_destroy(HAMQTT_Scene *scene);
+
+/**
+ * @internal
+ * @brief Build the command and state topics. Kept until the scene is destroyed.
+ */
+esp_err_t hamqtt_scene_build_topics(HAMQTT_Scene *scene, const char *device_unique_id);
+
+/**
+ * @internal
+ * @brief The command topic, or NULL before the topics were built.
+ */
+const char *hamqtt_scene_get_topic(const HAMQTT_Scene *scene);
+
+/**
+ * @internal
+ * @brief Whether a topic that is not NUL terminated is the command topic.
+ */
+bool hamqtt_scene_is_topic(const HAMQTT_Scene *scene, const char *topic, int topic_len);
+
+/**
+ * @internal
+ * @brief Parse `payload`, run every command in it if all of them are valid, and publish it
+ * to the state topic.
+ *
+ * The route table is only entered once the scene is held, so @ref HAMQTT_ROUTES_READER_SCENE
+ * is never used by two tasks at once.
+ *
+ * @param routes Routes to resolve the unique ids with.
+ * @param reader Reader to enter the routes as.
+ * @param transport Transport to publish the state with, or NULL to not publish it.
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the payload is not a flat JSON object of strings, numbers and literals
+ * - ESP_ERR_NOT_FOUND if a unique id is not a component of `table` that takes commands
+ * - ESP_ERR_INVALID_SIZE if the payload, a value or the number of entities exceeds the configured limits
+ * - ESP_ERR_INVALID_STATE if a scene is already being applied or waits for the execution task
+ */
+esp_err_t hamqtt_scene_apply(HAMQTT_Scene *scene,
+                             HAMQTT_Routes *routes,
+                             HAMQTT_Routes_Reader reader,
+                             HAMQTT_Transport *transport,
+                             const char *payload,
+                             size_t payload_len);
+
+/**
+ * @internal
+ * @brief Copy `payload` into the scene for @ref hamqtt_scene_apply_deferred to apply on another task.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if it does not fit, or ESP_ERR_INVALID_STATE if a
+ * scene is already waiting or being applied.
+ */
+esp_err_t hamqtt_scene_defer(HAMQTT_Scene *scene, const char *payload, size_t payload_len);
+
+/**
+ * @internal
+ * @brief Apply the scene copied by @ref hamqtt_scene_defer.
+ */
+esp_err_t hamqtt_scene_apply_deferred(HAMQTT_Scene *scene, const HAMQTT_Route_Table *table, HAMQTT_Transport *transport);
+
+#ifdef __cplusplus
+}
+#endif
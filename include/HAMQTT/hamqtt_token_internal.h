@@ -0,0 +1,148 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_token_internal.h
+ * @brief Decoder for the command payloads Home Assistant sends, shared by all components.
+ *
+ * Every known payload has a slot in a table picked by a perfect hash of its length and last
+ * character. A lookup checks the length against a bitmask of known lengths, hashes, and
+ * confirms the one candidate with a single `memcmp`, instead of a `strcmp` per payload.
+ *
+ * Components decode their command payloads with it, so each payload is spelled once, here.
+ * The lookup costs about as much as two or three `strcmp` calls whatever the number of
+ * payloads (see bench_tokens). Groups and scenes hand payloads on to their members unchanged
+ * and do not decode them.
+ *
+ * To add a payload, add it to @ref HAMQTT_TOKEN_LIST with its last character. If it lands in
+ * a used slot a static assertion in hamqtt_token.c fails the build; change the hash. C cannot
+ * check the last character at compile time, so test/test_tokens.c decodes every payload.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @internal
+ * @brief Known payloads as `X(name, text, last character of text)`.
+ */
+#define HAMQTT_TOKEN_LIST(X)                                    \
+    X(PRESS,             "PRESS",             'S')              \
+    X(ON,                "ON",                'N')              \
+    X(OFF,               "OFF",               'F')              \
+    X(OPEN,              "OPEN",              'N')              \
+    X(CLOSE,             "CLOSE",             'E')              \
+    X(STOP,              "STOP",              'P')              \
+    X(LOCK,              "LOCK",              'K')              \
+    X(UNLOCK,            "UNLOCK",            'K')              \
+    X(ARM_HOME,          "ARM_HOME",          'E')              \
+    X(ARM_AWAY,          "ARM_AWAY",          'Y')              \
+    X(ARM_NIGHT,         "ARM_NIGHT",         'T')              \
+    X(ARM_VACATION,      "ARM_VACATION",      'N')              \
+    X(ARM_CUSTOM_BYPASS, "ARM_CUSTOM_BYPASS", 'S')              \
+    X(DISARM,            "DISARM",            'M')              \
+    X(TRIGGER,           "TRIGGER",           'R')
+
+/**
+ * @internal
+ * @brief A decoded payload.
+ */
+typedef enum {
+    HAMQTT_TOKEN_UNKNOWN = 0,
+#define HAMQTT_TOKEN_ENUM(name, text, last) HAMQTT_TOKEN_##name,
+    HAMQTT_TOKEN_LIST(HAMQTT_TOKEN_ENUM)
+#undef HAMQTT_TOKEN_ENUM
+    HAMQTT_TOKEN_COUNT
+} HAMQTT_Token;
+
+/**
+ * @internal
+ * @brief Number of slots in the table, a power of two.
+ */
+#define HAMQTT_TOKEN_SLOTS 32
+
+/**
+ * @internal
+ * @brief Length of the longest payload. Must stay below 32 for the length mask.
+ */
+#define HAMQTT_TOKEN_MAX_LEN 17
+
+/**
+ * @internal
+ * @brief Slot of a payload of `len` bytes ending in `last`. Usable in constant expressions.
+ */
+#define HAMQTT_TOKEN_HASH(len, last) (((size_t)(len) + (unsigned char)(last)) & (HAMQTT_TOKEN_SLOTS - 1))
+
+#define HAMQTT_TOKEN_LENGTH_BIT(name, text, last) | (1u << (sizeof(text) - 1))
+
+/**
+ * @internal
+ * @brief Bit `n` is set if some payload is `n` bytes long.
+ */
+#define HAMQTT_TOKEN_LENGTHS (0u HAMQTT_TOKEN_LIST(HAMQTT_TOKEN_LENGTH_BIT))
+
+/**
+ * @internal
+ * @brief One slot of the table. Empty slots have a length of 0.
+ */
+typedef struct {
+    const char *text;
+    uint8_t len;
+    uint8_t token;
+} HAMQTT_Token_Slot;
+
+/**
+ * @internal
+ * @brief The table, indexed by @ref HAMQTT_TOKEN_HASH.
+ */
+extern const HAMQTT_Token_Slot hamqtt_token_slots[HAMQTT_TOKEN_SLOTS];
+
+/**
+ * @internal
+ * @brief Decode a payload of `len` bytes, which need not be NUL terminated.
+ *
+ * @return The token, or HAMQTT_TOKEN_UNKNOWN. Matching is case sensitive.
+ */
+static inline HAMQTT_Token hamqtt_token_decode(const char *data, size_t len) {
+    if (len == 0 || len > HAMQTT_TOKEN_MAX_LEN || !(HAMQTT_TOKEN_LENGTHS & (1u << len))) return HAMQTT_TOKEN_UNKNOWN;
+
+    const HAMQTT_Token_Slot *slot = &hamqtt_token_slots[HAMQTT_TOKEN_HASH(len, data[len - 1])];
+    if (slot->len != len || memcmp(slot->text, data, len) != 0) return HAMQTT_TOKEN_UNKNOWN;
+
+    return (HAMQTT_Token)slot->token;
+}
+
+/**
+ * @internal
+ * @brief Decode a NUL terminated payload. Only the first HAMQTT_TOKEN_MAX_LEN + 1 bytes are
+ * read, so long payloads are rejected without scanning them.
+ */
+static inline HAMQTT_Token hamqtt_token_decode_str(const char *data) {
+    return hamqtt_token_decode(data, strnlen(data, HAMQTT_TOKEN_MAX_LEN + 1));
+}
+
+#ifdef __cplusplus
+}
+#endif
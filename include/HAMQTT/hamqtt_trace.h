@@ -0,0 +1,123 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_trace.h
+ * @brief Chrome trace event export of HAMQTT activity, for host builds.
+ *
+ * With `CONFIG_HAMQTT_TRACE` enabled in a host build, HAMQTT records a span for connect,
+ * discovery builds, every component update, every inbound message dispatch and handler,
+ * transport events and publishes, each tagged with the thread it ran on. Spans are written
+ * as Chrome trace event JSON, which can be opened in Perfetto (ui.perfetto.dev) or
+ * chrome://tracing. Applications can add their own spans with @ref HAMQTT_TRACE_BEGIN and
+ * @ref HAMQTT_TRACE_END.
+ *
+ * The file is a JSON array that is flushed as it grows, so a trace cut short by killing the
+ * process still opens. Without `CONFIG_HAMQTT_TRACE` the macros compile to nothing.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if HAMQTT_TRACE
+
+/**
+ * @brief A span that has begun and not yet ended.
+ *
+ * Spans are only written when they end, so a span abandoned by an early return is dropped.
+ * End spans on error paths with @ref HAMQTT_TRACE_END_ERROR instead.
+ */
+typedef struct {
+    const char *category;   ///< Category shown in the trace viewer.
+    const char *name;       ///< Name of the span.
+    const char *detail;     ///< Optional string recorded in the span's arguments. Must stay valid until the span ends.
+    int64_t start_us;       ///< Start time, or -1 if tracing was not running when the span began.
+    esp_err_t error;        ///< Error recorded in the span's arguments, or ESP_OK for none.
+} HAMQTT_Trace_Span;
+
+/**
+ * @brief Start writing a trace to `path`, replacing any existing file.
+ *
+ * @param path Path of the trace file.
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_STATE if a trace is already being written
+ * - ESP_FAIL if the file could not be opened
+ */
+esp_err_t hamqtt_trace_start(const char *path);
+
+/**
+ * @brief Finish the trace file and stop tracing. Does nothing if no trace is being written.
+ */
+void hamqtt_trace_stop(void);
+
+/**
+ * @brief Begin a span. Use @ref HAMQTT_TRACE_BEGIN instead of calling this directly.
+ */
+void hamqtt_trace_span_begin(HAMQTT_Trace_Span *span, const char *category, const char *name, const char *detail);
+
+/**
+ * @brief End a span and write it to the trace. Use @ref HAMQTT_TRACE_END instead of calling this directly.
+ */
+void hamqtt_trace_span_end(const HAMQTT_Trace_Span *span);
+
+/**
+ * @brief Declare a span named `var` and begin it.
+ *
+ * @param var Variable name for the span, passed to @ref HAMQTT_TRACE_END.
+ * @param category Category string literal, e.g. `"device"`.
+ * @param name Span name.
+ * @param detail Optional string recorded with the span, or NULL.
+ */
+#define HAMQTT_TRACE_BEGIN(var, category, name, detail) \
+    HAMQTT_Trace_Span var;                              \
+    hamqtt_trace_span_begin(&var, category, name, detail)
+
+/**
+ * @brief End a span begun with @ref HAMQTT_TRACE_BEGIN.
+ */
+#define HAMQTT_TRACE_END(var) hamqtt_trace_span_end(&var)
+
+/**
+ * @brief End a span begun with @ref HAMQTT_TRACE_BEGIN, recording `err` in its arguments
+ * unless it is ESP_OK.
+ */
+#define HAMQTT_TRACE_END_ERROR(var, err) \
+    do {                                 \
+        var.error = (err);               \
+        hamqtt_trace_span_end(&var);     \
+    } while (0)
+
+#else
+
+#define HAMQTT_TRACE_BEGIN(var, category, name, detail) do {} while (0)
+#define HAMQTT_TRACE_END(var) do {} while (0)
+#define HAMQTT_TRACE_END_ERROR(var, err) do {} while (0)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,236 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_transport.h
+ * @brief Interface definition for the MQTT transport used by a HAMQTT device.
+ *
+ * This header defines the abstract `HAMQTT_Transport` interface that sits between
+ * `HAMQTT_Device` and the underlying MQTT client and OS. Backends implement it for
+ * ESP-IDF (esp-mqtt and FreeRTOS) and for a Linux host (libmosquitto and pthreads).
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct HAMQTT_Transport
+ * @brief Base type of every MQTT transport backend.
+ */
+typedef struct HAMQTT_Transport HAMQTT_Transport;
+
+/**
+ * @brief Connection parameters passed to a transport when it is initialized.
+ */
+typedef struct {
+    const char *uri;            ///< The URI of the MQTT broker (e.g., "mqtt://broker.hivemq.com:1883").
+    const char *username;       ///< The MQTT username. @note Optional.
+    const char *password;       ///< The MQTT password. @note Optional.
+    const char *client_id;      ///< The MQTT client id. @note Optional. The backend picks one when NULL.
+    const char *will_topic;     ///< Topic of the last-will message. @note Optional.
+    const char *will_msg;       ///< Payload of the last-will message.
+    int will_qos;               ///< QoS of the last-will message.
+    bool will_retain;           ///< Whether the last-will message is retained.
+} HAMQTT_Transport_Config;
+
+/**
+ * @brief Events reported by a transport to its owner.
+ */
+typedef enum {
+    HAMQTT_TRANSPORT_EVENT_CONNECTED,       ///< The broker accepted the connection.
+    HAMQTT_TRANSPORT_EVENT_DISCONNECTED,    ///< The connection to the broker was lost.
+    HAMQTT_TRANSPORT_EVENT_DATA,            ///< A message arrived on a subscribed topic.
+    HAMQTT_TRANSPORT_EVENT_PUBLISHED,       ///< The broker acknowledged a QoS > 0 publish.
+} HAMQTT_Transport_Event_Type;
+
+/**
+ * @brief A transport event. Strings are not NUL terminated and are only valid during the callback.
+ */
+typedef struct {
+    HAMQTT_Transport_Event_Type type;   ///< The kind of event.
+    const char *topic;                  ///< Topic of a DATA event.
+    int topic_len;                      ///< Length of `topic`.
+    const char *data;                   ///< Payload of a DATA event.
+    int data_len;                       ///< Length of `data`.
+    int msg_id;                         ///< Message id of a PUBLISHED event.
+} HAMQTT_Transport_Event;
+
+/**
+ * @typedef HAMQTT_Transport_Event_Func
+ * @brief Function pointer type for receiving transport events.
+ *
+ * @param args The pointer registered with @ref hamqtt_transport_set_event_handler.
+ * @param event The event. Only valid for the duration of the call.
+ */
+typedef void (*HAMQTT_Transport_Event_Func)(void *args, const HAMQTT_Transport_Event *event);
+
+/**
+ * @brief Create the default transport for the platform being built for.
+ *
+ * This is the esp-mqtt backend on ESP-IDF, and the libmosquitto backend on a Linux host.
+ *
+ * @return Pointer to the created transport, or NULL on failure or if the platform has no default.
+ *
+ * @memberof HAMQTT_Transport
+ */
+HAMQTT_Transport *hamqtt_transport_default_create(void);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Create a transport backed by the ESP-IDF `esp-mqtt` client.
+ *
+ * @return Pointer to the created transport, or NULL on failure.
+ *
+ * @memberof HAMQTT_Transport
+ */
+HAMQTT_Transport *hamqtt_transport_esp_create(void);
+#else
+/**
+ * @brief Create a transport backed by libmosquitto, for Linux host builds.
+ *
+ * Only available when the host build found libmosquitto (`CONFIG_HAMQTT_TRANSPORT_POSIX`).
+ *
+ * @return Pointer to the created transport, or NULL on failure.
+ *
+ * @memberof HAMQTT_Transport
+ */
+HAMQTT_Transport *hamqtt_transport_posix_create(void);
+#endif
+
+/* ----- Dispatch helpers ----- */
+
+/**
+ * @brief Register the function that receives events from the transport.
+ *
+ * @param transport Pointer to the transport.
+ * @param func Function called for every event, possibly from another task or thread.
+ * @param args A pointer passed to every call of `func`.
+ *
+ * @memberof HAMQTT_Transport
+ */
+void hamqtt_transport_set_event_handler(HAMQTT_Transport *transport, HAMQTT_Transport_Event_Func func, void *args);
+
+/**
+ * @brief Prepare the transport to connect to a broker.
+ *
+ * @param transport Pointer to the transport.
+ * @param config Connection parameters. Only needs to remain valid until @ref hamqtt_transport_start returns.
+ * @return ESP_OK on success, or an appropriate error code on failure.
+ *
+ * @memberof HAMQTT_Transport
+ */
+esp_err_t hamqtt_transport_init(HAMQTT_Transport *transport, const HAMQTT_Transport_Config *config);
+
+/**
+ * @brief Start connecting to the broker in the background.
+ *
+ * @param transport Pointer to the transport.
+ * @return ESP_OK on success, or an appropriate error code on failure.
+ *
+ * @memberof HAMQTT_Transport
+ */
+esp_err_t hamqtt_transport_start(HAMQTT_Transport *transport);
+
+/**
+ * @brief Disconnect from the broker and stop the background connection.
+ *
+ * @param transport Pointer to the transport.
+ * @return ESP_OK on success, or an appropriate error code on failure.
+ *
+ * @memberof HAMQTT_Transport
+ */
+esp_err_t hamqtt_transport_stop(HAMQTT_Transport *transport);
+
+/**
+ * @brief Block until the transport is connected to the broker.
+ *
+ * @param transport Pointer to the transport.
+ * @param timeout_ms Maximum time to wait, in milliseconds.
+ * @return
+ * - ESP_OK once connected
+ * - ESP_ERR_TIMEOUT if the connection was not made within `timeout_ms`
+ *
+ * @memberof HAMQTT_Transport
+ */
+esp_err_t hamqtt_transport_wait_connected(HAMQTT_Transport *transport, uint32_t timeout_ms);
+
+/**
+ * @brief Publish a message, blocking until it has been handed to the network.
+ *
+ * @param transport Pointer to the transport.
+ * @param topic Topic to publish to.
+ * @param data Payload to publish.
+ * @param len Length of `data`, or 0 to use `strlen(data)`.
+ * @param qos QoS level of the message.
+ * @param retain Whether the broker should retain the message.
+ * @return The message id (0 for QoS 0), or -1 on failure.
+ *
+ * @memberof HAMQTT_Transport
+ */
+int hamqtt_transport_publish(HAMQTT_Transport *transport, const char *topic, const char *data, int len, int qos, int retain);
+
+/**
+ * @brief Queue a message to be published without blocking the caller.
+ *
+ * Parameters and return value are the same as @ref hamqtt_transport_publish.
+ *
+ * @memberof HAMQTT_Transport
+ */
+int hamqtt_transport_enqueue(HAMQTT_Transport *transport, const char *topic, const char *data, int len, int qos, int retain);
+
+/**
+ * @brief Subscribe to a topic. Messages are reported as @ref HAMQTT_TRANSPORT_EVENT_DATA events.
+ *
+ * @param transport Pointer to the transport.
+ * @param topic Topic filter to subscribe to.
+ * @param qos Maximum QoS of the subscription.
+ * @return The message id of the subscribe request, or -1 on failure.
+ *
+ * @memberof HAMQTT_Transport
+ */
+int hamqtt_transport_subscribe(HAMQTT_Transport *transport, const char *topic, int qos);
+
+/**
+ * @brief Get the number of bytes waiting in the transport's outbox to be sent or acknowledged.
+ *
+ * @param transport Pointer to the transport.
+ * @return The outbox size in bytes, or -1 if the backend cannot report it.
+ *
+ * @memberof HAMQTT_Transport
+ */
+int hamqtt_transport_get_outbox_size(HAMQTT_Transport *transport);
+
+/**
+ * @brief Destroy a transport and free all resources.
+ *
+ * @param transport Pointer to the transport. May be NULL.
+ *
+ * @memberof HAMQTT_Transport
+ */
+void hamqtt_transport_destroy(HAMQTT_Transport *transport);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_transport_internal.h
+ * @brief Internal declarations for the HAMQTT_Transport system.
+ *
+ * This internal header defines the `HAMQTT_Transport_VTable` structure used for
+ * polymorphic behavior and the internal fields of the `HAMQTT_Transport` base type.
+ * This header should only be included by transport backends or core library code.
+ *
+ * @note This file is not part of the public API and may change without notice.
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+#include "hamqtt_transport.h"
+
+#if HAMQTT_DIAGNOSTICS
+#include <stdatomic.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct HAMQTT_Transport_VTable HAMQTT_Transport_VTable;
+
+/* ----- V-Table (interface) ----- */
+
+/**
+ * @internal
+ * @brief Virtual function table for HAMQTT_Transport interface.
+ *
+ * Each function pointer provides a backend-specific implementation of core behavior.
+ */
+struct HAMQTT_Transport_VTable {
+    esp_err_t (*init)(HAMQTT_Transport *transport,
+                      const HAMQTT_Transport_Config *config);
+
+    esp_err_t (*start)(HAMQTT_Transport *transport);
+
+    esp_err_t (*stop)(HAMQTT_Transport *transport);
+
+    esp_err_t (*wait_connected)(HAMQTT_Transport *transport,
+                                uint32_t timeout_ms);
+
+    int (*publish)(HAMQTT_Transport *transport,
+                   const char *topic,
+                   const char *data,
+                   int len,
+                   int qos,
+                   int retain);
+
+    int (*enqueue)(HAMQTT_Transport *transport,
+                   const char *topic,
+                   const char *data,
+                   int len,
+                   int qos,
+                   int retain);
+
+    int (*subscribe)(HAMQTT_Transport *transport,
+                     const char *topic,
+                     int qos);
+
+    void (*destroy)(HAMQTT_Transport *transport);
+
+    /** Optional. Backends that cannot report their outbox leave this NULL. */
+    int (*get_outbox_size)(HAMQTT_Transport *transport);
+};
+
+/* ----- Base Object ----- */
+
+/**
+ * @brief Base struct representing a generic MQTT transport.
+ */
+struct HAMQTT_Transport {
+    const HAMQTT_Transport_VTable *v;
+
+    HAMQTT_Transport_Event_Func event_func;
+    void *event_func_args;
+
+#if HAMQTT_DIAGNOSTICS
+    atomic_uint_least32_t publish_count;        ///< Publishes and enqueues made through this transport.
+    atomic_uint_least32_t publish_failures;     ///< Publishes and enqueues the backend rejected.
+#endif
+};
+
+/**
+ * @internal
+ * @brief Forwards an event from a backend to the registered event handler.
+ *
+ * @param transport Pointer to the transport that produced the event.
+ * @param event The event to forward.
+ */
+void hamqtt_transport_dispatch_event(HAMQTT_Transport *transport, const HAMQTT_Transport_Event *event);
+
+#if HAMQTT_DIAGNOSTICS
+/**
+ * @internal
+ * @brief Get the number of publishes made through the transport, and how many of them failed.
+ */
+void hamqtt_transport_get_publish_counts(HAMQTT_Transport *transport, uint32_t *publishes, uint32_t *failures);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
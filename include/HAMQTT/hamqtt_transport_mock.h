@@ -0,0 +1,199 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_transport_mock.h
+ * @brief Deterministic in-process transport for benchmarks and host tooling.
+ *
+ * The mock transport never touches the network. Publishes are copied into buffers that
+ * are allocated once when the transport is created, events are injected synchronously on
+ * the calling thread, and time only moves when the caller advances the virtual clock. This
+ * makes runs reproducible and lets benchmarks measure only the library's own CPU and
+ * allocation cost.
+ *
+ * The virtual clock stamps recorded publishes and is what connect timeouts advance. The
+ * library's own timers, such as the diagnostics interval, read `hamqtt_port_time_us`, which
+ * only follows the virtual clock when the transport is created with `drive_port_clock`.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "common.h"
+#include "hamqtt_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Configuration parameters for a mock transport.
+ */
+typedef struct {
+    size_t max_publishes;       ///< Number of publishes that can be recorded before new ones are dropped.
+    size_t buffer_size;         ///< Bytes reserved for the topics and payloads of recorded publishes.
+    size_t max_subscriptions;   ///< Number of subscriptions that can be recorded, each up to `HAMQTT_MAX_CHAR_BUF_SIZE` bytes.
+    bool auto_connect;          ///< Report CONNECTED from `hamqtt_transport_start` instead of waiting for `hamqtt_transport_mock_connect`.
+    bool auto_ack;              ///< Report PUBLISHED right away for every QoS > 0 publish.
+    bool drive_port_clock;      ///< Make `hamqtt_port_time_us` return the virtual clock until the transport is destroyed. Host builds only, one transport at a time.
+} HAMQTT_Transport_Mock_Config;
+
+/**
+ * @brief A publish recorded by the mock transport.
+ *
+ * `topic` and `data` are NUL terminated and point into the transport's buffer.
+ */
+typedef struct {
+    const char *topic;      ///< Topic the message was published to.
+    const char *data;       ///< Payload of the message.
+    int data_len;           ///< Length of `data`.
+    int qos;                ///< QoS level of the message.
+    int retain;             ///< Whether the message was retained.
+    int msg_id;             ///< Message id returned to the publisher.
+    uint64_t time_ms;       ///< Virtual time at which the message was published.
+} HAMQTT_Transport_Mock_Publish;
+
+/**
+ * @brief Returns a default-initialized mock transport configuration.
+ *
+ * @return A default-initialized HAMQTT_Transport_Mock_Config struct.
+ *
+ * @memberof HAMQTT_Transport_Mock_Config
+ */
+HAMQTT_Transport_Mock_Config hamqtt_transport_mock_config_default(void);
+
+/**
+ * @brief Create a new mock transport. All buffers are allocated here.
+ *
+ * @param config Pointer to the configuration. Only needs to remain valid during the call.
+ * @return Pointer to the created transport, or NULL on failure.
+ *
+ * @memberof HAMQTT_Transport
+ */
+HAMQTT_Transport *hamqtt_transport_mock_create(const HAMQTT_Transport_Mock_Config *config);
+
+/**
+ * @brief Mark the transport as connected and report a CONNECTED event.
+ *
+ * @param transport Pointer to a mock transport.
+ *
+ * @memberof HAMQTT_Transport
+ */
+void hamqtt_transport_mock_connect(HAMQTT_Transport *transport);
+
+/**
+ * @brief Mark the transport as disconnected and report a DISCONNECTED event.
+ *
+ * @param transport Pointer to a mock transport.
+ *
+ * @memberof HAMQTT_Transport
+ */
+void hamqtt_transport_mock_disconnect(HAMQTT_Transport *transport);
+
+/**
+ * @brief Deliver a message as if the broker had sent it. The event handler runs before this returns.
+ *
+ * The message is delivered whether or not its topic was subscribed to.
+ *
+ * @param transport Pointer to a mock transport.
+ * @param topic Topic of the message.
+ * @param data Payload of the message.
+ * @param len Length of `data`, or 0 to use `strlen(data)`.
+ *
+ * @memberof HAMQTT_Transport
+ */
+void hamqtt_transport_mock_inject_message(HAMQTT_Transport *transport, const char *topic, const char *data, int len);
+
+/**
+ * @brief Advance the virtual clock, and `hamqtt_port_time_us` with it if the transport was
+ * created with `drive_port_clock`.
+ *
+ * @param transport Pointer to a mock transport.
+ * @param ms Number of milliseconds to advance by.
+ *
+ * @memberof HAMQTT_Transport
+ */
+void hamqtt_transport_mock_advance(HAMQTT_Transport *transport, uint32_t ms);
+
+/**
+ * @brief Get the current virtual time, in milliseconds since the transport was created.
+ *
+ * @memberof HAMQTT_Transport
+ */
+uint64_t hamqtt_transport_mock_get_time_ms(const HAMQTT_Transport *transport);
+
+/**
+ * @brief Get the number of recorded publishes.
+ *
+ * @memberof HAMQTT_Transport
+ */
+size_t hamqtt_transport_mock_get_publish_count(const HAMQTT_Transport *transport);
+
+/**
+ * @brief Get the number of publishes that did not fit in the transport's buffers.
+ *
+ * @memberof HAMQTT_Transport
+ */
+size_t hamqtt_transport_mock_get_dropped_count(const HAMQTT_Transport *transport);
+
+/**
+ * @brief Get a recorded publish.
+ *
+ * @param transport Pointer to a mock transport.
+ * @param index Index of the publish, in the order they were made.
+ * @return Pointer to the publish, or NULL if `index` is out of range.
+ *
+ * @memberof HAMQTT_Transport
+ */
+const HAMQTT_Transport_Mock_Publish *hamqtt_transport_mock_get_publish(const HAMQTT_Transport *transport, size_t index);
+
+/**
+ * @brief Find the most recent publish to a topic.
+ *
+ * @param transport Pointer to a mock transport.
+ * @param topic Topic to look for.
+ * @return Pointer to the publish, or NULL if nothing was published to `topic`.
+ *
+ * @memberof HAMQTT_Transport
+ */
+const HAMQTT_Transport_Mock_Publish *hamqtt_transport_mock_find_publish(const HAMQTT_Transport *transport, const char *topic);
+
+/**
+ * @brief Forget all recorded publishes and reuse their buffers.
+ *
+ * @memberof HAMQTT_Transport
+ */
+void hamqtt_transport_mock_clear_publishes(HAMQTT_Transport *transport);
+
+/**
+ * @brief Get the topics subscribed to on the current connection.
+ *
+ * Like a broker with clean sessions, the mock forgets subscriptions when the connection is lost.
+ *
+ * @param transport Pointer to a mock transport.
+ * @param[out] count Set to the number of topics.
+ * @return Array of topic strings.
+ *
+ * @memberof HAMQTT_Transport
+ */
+const char *const *hamqtt_transport_mock_get_subscriptions(const HAMQTT_Transport *transport, size_t *count);
+
+#ifdef __cplusplus
+}
+#endif
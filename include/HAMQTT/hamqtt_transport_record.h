@@ -0,0 +1,173 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_transport_record.h
+ * @brief Transport wrapper that records a device's MQTT traffic, and a reader for the recordings.
+ *
+ * The recording transport forwards every call to another transport and writes each broker
+ * event and each publish and subscribe made by the device to a compact binary stream, with
+ * microsecond timing. Recordings of real devices can be replayed on the host by
+ * `bench_replay` to measure performance changes on production-shaped traffic.
+ *
+ * Format (all integers are unsigned LEB128 varints unless noted):
+ *
+ *     recording := "HQRC" version:u8 record*
+ *     record    := type:u8 delta_us body
+ *     body      := (CONNECTED | DISCONNECTED)            -> nothing
+ *                | DATA                                  -> topic payload
+ *                | PUBLISHED                             -> msg_id
+ *                | PUBLISH                               -> flags:u8 topic payload msg_id+1
+ *                | SUBSCRIBE                             -> qos:u8 topic
+ *     topic     := 0 len bytes        (literal, assigned the next topic index while the table has room)
+ *                | index+1            (a topic seen before)
+ *     payload   := len bytes
+ *
+ * `delta_us` is the time since the previous record. PUBLISH flags hold the QoS in bits 0-1,
+ * retain in bit 2 and bit 3 is set for enqueued publishes. A failed publish is recorded
+ * with msg_id+1 = 0.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#pragma once
+
+#include "common.h"
+#include "hamqtt_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Version written after the magic bytes.
+ */
+#define HAMQTT_TRANSPORT_RECORD_VERSION 1
+
+/**
+ * @brief Number of distinct topics that are written once and then referred to by index.
+ */
+#define HAMQTT_TRANSPORT_RECORD_MAX_TOPICS 256
+
+/**
+ * @typedef HAMQTT_Transport_Record_Write_Func
+ * @brief Function pointer type for receiving recorded bytes.
+ *
+ * Called with the recorder's lock held, so calls are never interleaved. Write to a file,
+ * a UART or a socket; if the function blocks, the device blocks with it.
+ *
+ * @param args User-provided argument.
+ * @param data Bytes to write.
+ * @param len Number of bytes.
+ */
+typedef void (*HAMQTT_Transport_Record_Write_Func)(void *args, const void *data, size_t len);
+
+/**
+ * @brief Configuration parameters for a recording transport.
+ */
+typedef struct {
+    HAMQTT_Transport *inner;                        ///< Transport that carries the traffic. Not owned by the recorder.
+    HAMQTT_Transport_Record_Write_Func write_func;  ///< Receives the recording.
+    void *write_func_args;                          ///< Passed to `write_func`.
+} HAMQTT_Transport_Record_Config;
+
+/**
+ * @brief Kinds of records.
+ */
+typedef enum {
+    HAMQTT_TRANSPORT_RECORD_CONNECTED = 1,      ///< The broker accepted the connection.
+    HAMQTT_TRANSPORT_RECORD_DISCONNECTED,       ///< The connection to the broker was lost.
+    HAMQTT_TRANSPORT_RECORD_DATA,               ///< A message arrived from the broker.
+    HAMQTT_TRANSPORT_RECORD_PUBLISHED,          ///< The broker acknowledged a publish.
+    HAMQTT_TRANSPORT_RECORD_PUBLISH,            ///< The device published (or enqueued) a message.
+    HAMQTT_TRANSPORT_RECORD_SUBSCRIBE,          ///< The device subscribed to a topic.
+} HAMQTT_Transport_Record_Type;
+
+/**
+ * @brief A decoded record.
+ *
+ * `topic` and `data` point into the recording and are not NUL terminated.
+ */
+typedef struct {
+    HAMQTT_Transport_Record_Type type;  ///< Kind of record.
+    int64_t time_us;                    ///< Time since the recording started.
+    const char *topic;                  ///< Topic of DATA, PUBLISH and SUBSCRIBE records.
+    size_t topic_len;                   ///< Length of `topic`.
+    const char *data;                   ///< Payload of DATA and PUBLISH records.
+    size_t data_len;                    ///< Length of `data`.
+    int qos;                            ///< QoS of PUBLISH and SUBSCRIBE records.
+    bool retain;                        ///< Retain flag of PUBLISH records.
+    bool enqueued;                      ///< Whether a PUBLISH record was enqueued rather than published.
+    int msg_id;                         ///< Message id of PUBLISH and PUBLISHED records. -1 for a failed publish.
+} HAMQTT_Transport_Record;
+
+/**
+ * @brief Decoding state for a recording held in memory.
+ */
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+    size_t offset;
+    int64_t time_us;
+
+    const char *topics[HAMQTT_TRANSPORT_RECORD_MAX_TOPICS];
+    size_t topic_lens[HAMQTT_TRANSPORT_RECORD_MAX_TOPICS];
+    size_t topic_count;
+} HAMQTT_Transport_Record_Reader;
+
+/**
+ * @brief Create a transport that forwards to `config->inner` and records all traffic.
+ *
+ * Install it with `hamqtt_device_set_transport` in place of the inner transport. The
+ * recording header is written before this returns. The recorder takes over the inner
+ * transport's event handler.
+ *
+ * @param config Pointer to the configuration. Only needs to remain valid during the call.
+ * @return Pointer to the created transport, or NULL on failure.
+ *
+ * @memberof HAMQTT_Transport
+ */
+HAMQTT_Transport *hamqtt_transport_record_create(const HAMQTT_Transport_Record_Config *config);
+
+/**
+ * @brief Start reading a recording.
+ *
+ * @param reader Reader to initialize.
+ * @param buf The whole recording. Must stay valid while records are in use.
+ * @param len Length of `buf`.
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if `buf` is not a recording, or has an unsupported version
+ */
+esp_err_t hamqtt_transport_record_reader_init(HAMQTT_Transport_Record_Reader *reader, const void *buf, size_t len);
+
+/**
+ * @brief Decode the next record.
+ *
+ * @param reader Reader to advance.
+ * @param[out] record Set to the decoded record.
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_NOT_FOUND at the end of the recording
+ * - ESP_ERR_INVALID_SIZE if the recording is truncated or corrupt
+ */
+esp_err_t hamqtt_transport_record_reader_next(HAMQTT_Transport_Record_Reader *reader, HAMQTT_Transport_Record *record);
+
+#ifdef __cplusplus
+}
+#endif
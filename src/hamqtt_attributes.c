@@ -0,0 +1,452 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_attributes.c
+ * @brief Implementation of component attributes.
+ *
+ * The payload buffer holds `{` followed by one `"key":value,` fragment per slot with a value,
+ * in slot order. A rewrite parks everything from the first dirty fragment on at the end of the
+ * buffer, then walks the slots forward: clean fragments are moved back down, dirty ones are
+ * formatted in their place. The buffer is sized for every slot's largest fragment, so the
+ * fragment being written never reaches the parked ones still to be read.
+ *
+ * The rewritten payload is copied into a snapshot buffer of the same size before the lock is
+ * released, so the publish never holds up the setters. Only the device loop reads the snapshot.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <math.h>
+
+#include "HAMQTT/hamqtt_attributes_internal.h"
+#include "HAMQTT/hamqtt_port.h"
+
+#define HAMQTT_ATTRIBUTES_MAX_PRECISION 6
+#define HAMQTT_ATTRIBUTES_NUMBER_SIZE 64   // Holds any int64_t, and any float with 6 decimals
+
+static const char *TAG = "HAMQTT_Attributes";
+
+typedef struct {
+    HAMQTT_Attribute_Config config;
+    size_t key_len;
+
+    union {
+        bool b;
+        int64_t i;
+        float f;
+    } value;
+    char *string;                       // max_len + 1 bytes, for strings only
+
+    bool set;
+    bool dirty;
+    size_t len;                         // Length of the slot's fragment in the payload, 0 if none
+} HAMQTT_Attribute_Slot;
+
+struct HAMQTT_Attributes {
+    HAMQTT_Port_Mutex lock;
+    HAMQTT_Component *component;
+    char *topic;
+
+    bool dirty;                         // Some slot is dirty
+    bool resync;                        // Rewrite and publish every slot
+
+    size_t slot_count;
+    HAMQTT_Attribute_Slot *slots;
+
+    char *payload;
+    size_t payload_len;
+    size_t payload_size;
+
+    char *snapshot;                     // payload_size bytes, the payload as last closed for publishing
+};
+
+/* ----- Private HAMQTT Attributes function definitions ----- */
+
+static bool hamqtt_attributes_is_plain_key(const char *key) {
+    for (const char *c = key; *c; ++c) {
+        if (*c == '"' || *c == '\\' || (unsigned char)*c < 0x20) return false;
+    }
+
+    return true;
+}
+
+static size_t hamqtt_attributes_max_value_len(const HAMQTT_Attribute_Config *config) {
+    switch (config->type) {
+        case HAMQTT_ATTRIBUTE_BOOL:
+            return 5;                                           // false
+        case HAMQTT_ATTRIBUTE_INT:
+        case HAMQTT_ATTRIBUTE_FLOAT:
+            return HAMQTT_ATTRIBUTES_NUMBER_SIZE - 1;
+        case HAMQTT_ATTRIBUTE_STRING:
+            return 2 + (size_t)config->max_len * 6;             // Quotes, and \u00XX per byte
+    }
+
+    return 0;
+}
+
+static HAMQTT_Attribute_Slot *hamqtt_attributes_get_slot(HAMQTT_Attributes *attributes,
+                                                         size_t slot,
+                                                         HAMQTT_Attribute_Type type) {
+    if (!attributes || slot >= attributes->slot_count || attributes->slots[slot].config.type != type) return NULL;
+
+    return &attributes->slots[slot];
+}
+
+/**
+ * @brief Mark a slot dirty. Called with the lock held, after its value changed.
+ */
+static void hamqtt_attributes_mark(HAMQTT_Attributes *attributes, HAMQTT_Attribute_Slot *slot) {
+    slot->set = true;
+    slot->dirty = true;
+    attributes->dirty = true;
+}
+
+static size_t hamqtt_attributes_write_string(char *out, const char *value) {
+    static const char hex[] = "0123456789abcdef";
+
+    char *cursor = out;
+    *cursor++ = '"';
+
+    for (const char *c = value; *c; ++c) {
+        unsigned char byte = (unsigned char)*c;
+
+        if (byte == '"' || byte == '\\') {
+            *cursor++ = '\\';
+            *cursor++ = (char)byte;
+        } else if (byte < 0x20) {
+            memcpy(cursor, "\\u00", 4);
+            cursor[4] = hex[byte >> 4];
+            cursor[5] = hex[byte & 0xF];
+            cursor += 6;
+        } else {
+            *cursor++ = (char)byte;
+        }
+    }
+
+    *cursor++ = '"';
+
+    return cursor - out;
+}
+
+/**
+ * @brief Write a slot's `"key":value,` fragment at `out`, without a NUL.
+ *
+ * @return Length of the fragment, at most what `hamqtt_attributes_create` reserved for it.
+ */
+static size_t hamqtt_attributes_write_fragment(const HAMQTT_Attribute_Slot *slot, char *out) {
+    char *cursor = out;
+
+    *cursor++ = '"';
+    memcpy(cursor, slot->config.key, slot->key_len);
+    cursor += slot->key_len;
+    *cursor++ = '"';
+    *cursor++ = ':';
+
+    // Numbers go through a local buffer, snprintf would write its NUL over the parked fragments
+    char number[HAMQTT_ATTRIBUTES_NUMBER_SIZE];
+    int number_len = 0;
+
+    switch (slot->config.type) {
+        case HAMQTT_ATTRIBUTE_BOOL:
+            number_len = snprintf(number, sizeof(number), "%s", slot->value.b ? "true" : "false");
+            break;
+        case HAMQTT_ATTRIBUTE_INT:
+            number_len = snprintf(number, sizeof(number), "%lld", (long long)slot->value.i);
+            break;
+        case HAMQTT_ATTRIBUTE_FLOAT:
+            if (isfinite(slot->value.f)) {
+                number_len = snprintf(number, sizeof(number), "%.*f", slot->config.precision, (double)slot->value.f);
+            } else {
+                number_len = snprintf(number, sizeof(number), "null");
+            }
+            break;
+        case HAMQTT_ATTRIBUTE_STRING:
+            cursor += hamqtt_attributes_write_string(cursor, slot->string);
+            break;
+    }
+
+    if (number_len > 0) {
+        memcpy(cursor, number, (size_t)number_len);
+        cursor += number_len;
+    }
+
+    *cursor++ = ',';
+
+    return cursor - out;
+}
+
+/**
+ * @brief Rewrite the dirty slots in place. Called with the lock held.
+ */
+static void hamqtt_attributes_rewrite(HAMQTT_Attributes *attributes) {
+    size_t first = 0;
+    size_t write = 1;                   // After the '{'
+
+    while (first < attributes->slot_count && !attributes->slots[first].dirty) {
+        write += attributes->slots[first].len;
+        first++;
+    }
+
+    if (first == attributes->slot_count) return;
+
+    // Park the fragments from the first dirty one on at the end of the buffer
+    size_t parked_len = attributes->payload_len - write;
+    size_t read = attributes->payload_size - parked_len;
+    memmove(attributes->payload + read, attributes->payload + write, parked_len);
+
+    for (size_t i = first; i < attributes->slot_count; ++i) {
+        HAMQTT_Attribute_Slot *slot = &attributes->slots[i];
+
+        if (slot->dirty) {
+            read += slot->len;
+            slot->len = hamqtt_attributes_write_fragment(slot, attributes->payload + write);
+            slot->dirty = false;
+        } else {
+            memmove(attributes->payload + write, attributes->payload + read, slot->len);
+            read += slot->len;
+        }
+
+        write += slot->len;
+    }
+
+    attributes->payload_len = write;
+}
+
+/* ----- Public HAMQTT Attributes function definitions ----- */
+
+HAMQTT_Attributes *hamqtt_attributes_create(const HAMQTT_Attribute_Config *slots, size_t slot_count) {
+    if (!slots && slot_count > 0) {
+        ESP_LOGE(TAG, "Slots are NULL");
+        return NULL;
+    }
+
+    size_t payload_size = 2;            // '{' and '}'
+    size_t strings_size = 0;
+
+    for (size_t i = 0; i < slot_count; ++i) {
+        const HAMQTT_Attribute_Config *config = &slots[i];
+
+        if (!config->key || !hamqtt_attributes_is_plain_key(config->key)) {
+            ESP_LOGE(TAG, "Slot %u has no key or a key that needs escaping", (unsigned)i);
+            return NULL;
+        }
+
+        if (config->type == HAMQTT_ATTRIBUTE_FLOAT && config->precision > HAMQTT_ATTRIBUTES_MAX_PRECISION) {
+            ESP_LOGE(TAG, "Slot %s has a precision above %d", config->key, HAMQTT_ATTRIBUTES_MAX_PRECISION);
+            return NULL;
+        }
+
+        payload_size += strlen(config->key) + 4 /* "": and , */ + hamqtt_attributes_max_value_len(config);
+        if (config->type == HAMQTT_ATTRIBUTE_STRING) strings_size += (size_t)config->max_len + 1;
+    }
+
+    // One allocation for the set, its slots, the string values, the payload and its snapshot
+    size_t total_size = sizeof(HAMQTT_Attributes) + slot_count * sizeof(HAMQTT_Attribute_Slot) + strings_size + 2 * payload_size;
+
+    HAMQTT_Attributes *attributes = calloc(1, total_size);
+    if (!attributes) {
+        ESP_LOGE(TAG, "Unable to allocate space for attributes");
+        return NULL;
+    }
+
+    if (hamqtt_port_mutex_init(&attributes->lock) != ESP_OK) {
+        ESP_LOGE(TAG, "Unable to create attributes lock");
+        free(attributes);
+        return NULL;
+    }
+
+    attributes->slot_count = slot_count;
+    attributes->slots = (HAMQTT_Attribute_Slot *)(attributes + 1);
+
+    char *strings = (char *)(attributes->slots + slot_count);
+
+    for (size_t i = 0; i < slot_count; ++i) {
+        HAMQTT_Attribute_Slot *slot = &attributes->slots[i];
+
+        slot->config = slots[i];
+        slot->key_len = strlen(slot->config.key);
+
+        if (slot->config.type == HAMQTT_ATTRIBUTE_STRING) {
+            slot->string = strings;
+            strings += (size_t)slot->config.max_len + 1;
+        }
+    }
+
+    attributes->payload = strings;
+    attributes->payload_size = payload_size;
+    attributes->payload[0] = '{';
+    attributes->payload_len = 1;
+    attributes->snapshot = strings + payload_size;
+    attributes->resync = true;
+
+    return attributes;
+}
+
+void hamqtt_attributes_destroy(HAMQTT_Attributes *attributes) {
+    if (!attributes) return;
+
+    hamqtt_port_mutex_destroy(&attributes->lock);
+    free(attributes->topic);
+    free(attributes);
+}
+
+esp_err_t hamqtt_attributes_set_bool(HAMQTT_Attributes *attributes, size_t slot, bool value) {
+    HAMQTT_Attribute_Slot *target = hamqtt_attributes_get_slot(attributes, slot, HAMQTT_ATTRIBUTE_BOOL);
+    ESP_RETURN_ON_FALSE(target, ESP_ERR_INVALID_ARG, TAG, "Slot %u is not a bool", (unsigned)slot);
+
+    hamqtt_port_mutex_lock(&attributes->lock);
+    if (!target->set || target->value.b != value) {
+        target->value.b = value;
+        hamqtt_attributes_mark(attributes, target);
+    }
+    hamqtt_port_mutex_unlock(&attributes->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t hamqtt_attributes_set_int(HAMQTT_Attributes *attributes, size_t slot, int64_t value) {
+    HAMQTT_Attribute_Slot *target = hamqtt_attributes_get_slot(attributes, slot, HAMQTT_ATTRIBUTE_INT);
+    ESP_RETURN_ON_FALSE(target, ESP_ERR_INVALID_ARG, TAG, "Slot %u is not an int", (unsigned)slot);
+
+    hamqtt_port_mutex_lock(&attributes->lock);
+    if (!target->set || target->value.i != value) {
+        target->value.i = value;
+        hamqtt_attributes_mark(attributes, target);
+    }
+    hamqtt_port_mutex_unlock(&attributes->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t hamqtt_attributes_set_float(HAMQTT_Attributes *attributes, size_t slot, float value) {
+    HAMQTT_Attribute_Slot *target = hamqtt_attributes_get_slot(attributes, slot, HAMQTT_ATTRIBUTE_FLOAT);
+    ESP_RETURN_ON_FALSE(target, ESP_ERR_INVALID_ARG, TAG, "Slot %u is not a float", (unsigned)slot);
+
+    hamqtt_port_mutex_lock(&attributes->lock);
+    // Compare the bits, so NaN equals itself and a repeated NaN is not a change
+    if (!target->set || memcmp(&target->value.f, &value, sizeof(value)) != 0) {
+        target->value.f = value;
+        hamqtt_attributes_mark(attributes, target);
+    }
+    hamqtt_port_mutex_unlock(&attributes->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t hamqtt_attributes_set_string(HAMQTT_Attributes *attributes, size_t slot, const char *value) {
+    ESP_RETURN_ON_FALSE(value, ESP_ERR_INVALID_ARG, TAG, "Value is NULL");
+
+    HAMQTT_Attribute_Slot *target = hamqtt_attributes_get_slot(attributes, slot, HAMQTT_ATTRIBUTE_STRING);
+    ESP_RETURN_ON_FALSE(target, ESP_ERR_INVALID_ARG, TAG, "Slot %u is not a string", (unsigned)slot);
+
+    size_t len = strnlen(value, target->config.max_len);
+
+    hamqtt_port_mutex_lock(&attributes->lock);
+    if (!target->set || strncmp(target->string, value, len) != 0 || target->string[len] != '\0') {
+        memcpy(target->string, value, len);
+        target->string[len] = '\0';
+        hamqtt_attributes_mark(attributes, target);
+    }
+    hamqtt_port_mutex_unlock(&attributes->lock);
+
+    return ESP_OK;
+}
+
+void hamqtt_attributes_resync(HAMQTT_Attributes *attributes) {
+    if (!attributes) return;
+
+    hamqtt_port_mutex_lock(&attributes->lock);
+    attributes->resync = true;
+    hamqtt_port_mutex_unlock(&attributes->lock);
+}
+
+esp_err_t hamqtt_component_set_attributes(HAMQTT_Component *component, HAMQTT_Attributes *attributes) {
+    ESP_RETURN_ON_FALSE(component && attributes, ESP_ERR_INVALID_ARG, TAG, "Component or attributes are NULL");
+    ESP_RETURN_ON_FALSE(!component->attributes && !attributes->component,
+                        ESP_ERR_INVALID_STATE,
+                        TAG,
+                        "Component or attributes are already attached");
+
+    component->attributes = attributes;
+    attributes->component = component;
+
+    return ESP_OK;
+}
+
+/* ----- Internal HAMQTT Attributes function definitions ----- */
+
+esp_err_t hamqtt_attributes_build_topic(HAMQTT_Attributes *attributes, const char *device_unique_id, const char *component_unique_id) {
+    if (attributes->topic) return ESP_OK;
+
+    size_t topic_size = strlen(device_unique_id) + 1 /* / */ + strlen(component_unique_id) + 11 /* /attributes */ + 1; /* NUL */
+
+    char *topic = malloc(topic_size);
+    ESP_RETURN_ON_FALSE(topic, ESP_ERR_NO_MEM, TAG, "Unable to allocate space for attributes topic");
+
+    snprintf(topic, topic_size, "%s/%s/attributes", device_unique_id, component_unique_id);
+    attributes->topic = topic;
+
+    return ESP_OK;
+}
+
+const char *hamqtt_attributes_get_topic(const HAMQTT_Attributes *attributes) {
+    return attributes->topic;
+}
+
+void hamqtt_attributes_update(HAMQTT_Attributes *attributes, HAMQTT_Transport *transport) {
+    if (!attributes->topic) return;
+
+    hamqtt_port_mutex_lock(&attributes->lock);
+
+    if (!attributes->dirty && !attributes->resync) {
+        hamqtt_port_mutex_unlock(&attributes->lock);
+        return;
+    }
+
+    if (attributes->resync) {
+        for (size_t i = 0; i < attributes->slot_count; ++i) {
+            if (attributes->slots[i].set) attributes->slots[i].dirty = true;
+        }
+    }
+
+    hamqtt_attributes_rewrite(attributes);
+
+    // Close the object in the snapshot, over the last fragment's comma unless there are none
+    size_t len = attributes->payload_len;
+    memcpy(attributes->snapshot, attributes->payload, len);
+
+    if (len == 1) {
+        attributes->snapshot[len++] = '}';
+    } else {
+        attributes->snapshot[len - 1] = '}';
+    }
+
+    attributes->resync = false;
+    attributes->dirty = false;
+
+    hamqtt_port_mutex_unlock(&attributes->lock);
+
+    int msg_id = hamqtt_transport_publish(transport, attributes->topic, attributes->snapshot, (int)len, 1, 1);
+
+    if (msg_id < 0) {
+        // Slots are clean already, publish all of them again on the next loop
+        ESP_LOGW(TAG, "Unable to publish attributes to %s", attributes->topic);
+        hamqtt_attributes_resync(attributes);
+    }
+}
@@ -30,36 +30,18 @@
 
 #include "HAMQTT/hamqtt_binary_sensor.h"
 #include "HAMQTT/hamqtt_component_internal.h"
+#include "HAMQTT/hamqtt_discovery_internal.h"
+#include "HAMQTT/hamqtt_rules_internal.h"
 
 static const char *TAG = "HAMQTT_Binary_Sensor";
 
 HAMQTT_Binary_Sensor_Config hamqtt_binary_sensor_config_default(void) {
     HAMQTT_Binary_Sensor_Config config = {
-        .device_class = NULL,
-        .enabled_by_default = true,
-        .entity_picture = NULL,
-        .expire_after = -1,
-        .force_update = false,
-        .icon = NULL,
-        .name = "ESP32 Binary Sensor",
-        .off_delay = -1,
-        .unique_id = NULL
+        HAMQTT_BINARY_SENSOR_CONFIG_DEFAULT_FIELDS
     };
     return config;
 }
 
-struct HAMQTT_Binary_Sensor {
-    HAMQTT_Component base;
-
-    HAMQTT_Binary_Sensor_Config *component_config;
-    HAMQTT_Binary_Sensor_Get_State_Func get_state_func;
-    void *get_state_func_args;
-
-    bool has_sent_state;
-    bool previous_state;
-    char *state_topic;
-};
-
 /* ----- Private HAMQTT Binary Sensor function declarations ----- */
 
 /**
@@ -72,6 +54,22 @@ struct HAMQTT_Binary_Sensor {
  */
 static bool hamqtt_binary_sensor_is_config_valid(const HAMQTT_Binary_Sensor *sensor);
 
+/* ----- Discovery fields ----- */
+
+#if HAMQTT_RUNTIME_DISCOVERY
+static const HAMQTT_Discovery_Field binary_sensor_discovery_fields[] = {
+    HAMQTT_DISCOVERY_STRING("name", HAMQTT_Binary_Sensor_Config, name),
+    HAMQTT_DISCOVERY_STRING("unique_id", HAMQTT_Binary_Sensor_Config, unique_id),
+    HAMQTT_DISCOVERY_BOOL("enabled_by_default", HAMQTT_Binary_Sensor_Config, enabled_by_default, true),
+    HAMQTT_DISCOVERY_BOOL("force_update", HAMQTT_Binary_Sensor_Config, force_update, false),
+    HAMQTT_DISCOVERY_STRING("device_class", HAMQTT_Binary_Sensor_Config, device_class),
+    HAMQTT_DISCOVERY_STRING("entity_picture", HAMQTT_Binary_Sensor_Config, entity_picture),
+    HAMQTT_DISCOVERY_STRING("icon", HAMQTT_Binary_Sensor_Config, icon),
+    HAMQTT_DISCOVERY_INT("expire_after", HAMQTT_Binary_Sensor_Config, expire_after, -1),
+    HAMQTT_DISCOVERY_INT("off_delay", HAMQTT_Binary_Sensor_Config, off_delay, -1),
+};
+#endif
+
 /* ----- Virtual Methods ----- */
 
 static esp_err_t hamqtt_binary_sensor_get_discovery_config(HAMQTT_Component *component, 
@@ -84,35 +82,57 @@ static esp_err_t hamqtt_binary_sensor_get_discovery_config(HAMQTT_Component *com
                         TAG,
                         "Binary sensor was used despite config missing required fields");
 
-    size_t state_topic_size = strlen(device_unique_id)
-                          + strlen(sensor->component_config->unique_id)
-                          + 1 /* slash */ + 6 /* "/state" */
-                          + 1; /* NUL */
-
-    if (sensor->state_topic) free(sensor->state_topic);
-    sensor->state_topic = malloc(state_topic_size);
-    ESP_RETURN_ON_FALSE(sensor->state_topic,
-                        ESP_ERR_NO_MEM,
-                        TAG,
-                        "Unable to allocate space for HAMQTT Binary Sensor state topic");
+    // The topic only depends on the unique ids, so keep it across reconnects. The loop may be
+    // publishing to it from another task.
+    if (!sensor->state_topic) {
+        const char *topic_unique_id = sensor->component_config->unique_id;
+#if CONFIG_HAMQTT_COMPONENT_GROUP
+        // A grouped sensor reads its state from the group's combined report
+        if (sensor->group) topic_unique_id = hamqtt_component_get_unique_id(sensor->group);
+#endif
+
+        size_t state_topic_size = strlen(device_unique_id)
+                              + strlen(topic_unique_id)
+                              + 1 /* slash */ + 6 /* "/state" */
+                              + 1; /* NUL */
+
+        char *state_topic = malloc(state_topic_size);
+        ESP_RETURN_ON_FALSE(state_topic,
+                            ESP_ERR_NO_MEM,
+                            TAG,
+                            "Unable to allocate space for HAMQTT Binary Sensor state topic");
+
+        snprintf(state_topic,
+                 state_topic_size,
+                 "%s/%s/state", device_unique_id,
+                 topic_unique_id);
+
+        sensor->state_topic = state_topic;
+    }
 
-    snprintf(sensor->state_topic,
-             state_topic_size,
-             "%s/%s/state", device_unique_id,
-             sensor->component_config->unique_id);
+    // Only the topics are needed when the discovery payload was precomputed
+    if (!root) return ESP_OK;
 
+#if HAMQTT_RUNTIME_DISCOVERY
     // Build configuration on root
     cJSON_AddStringToObject(root, "p", "binary_sensor");
-    cJSON_AddStringToObject(root, "name", sensor->component_config->name);
     cJSON_AddStringToObject(root, "state_topic", sensor->state_topic);
-    cJSON_AddStringToObject(root, "unique_id", sensor->component_config->unique_id);
-    cJSON_AddBoolToObject(root, "enabled_by_default", sensor->component_config->enabled_by_default);
-    cJSON_AddBoolToObject(root, "force_update", sensor->component_config->force_update);
-    if (sensor->component_config->device_class) cJSON_AddStringToObject(root, "device_class", sensor->component_config->device_class);
-    if (sensor->component_config->entity_picture) cJSON_AddStringToObject(root, "entity_picture", sensor->component_config->entity_picture);
-    if (sensor->component_config->icon) cJSON_AddStringToObject(root, "icon", sensor->component_config->icon);
-    if (sensor->component_config->expire_after != -1) cJSON_AddNumberToObject(root, "expire_after", sensor->component_config->expire_after);
-    if (sensor->component_config->off_delay != -1) cJSON_AddNumberToObject(root, "off_delay", sensor->component_config->off_delay);
+
+#if CONFIG_HAMQTT_COMPONENT_GROUP
+    if (sensor->group) {
+        char value_template[HAMQTT_MAX_CHAR_BUF_SIZE];
+        snprintf(value_template, sizeof(value_template), "{{ value_json['%s'] }}", sensor->component_config->unique_id);
+        cJSON_AddStringToObject(root, "value_template", value_template);
+    }
+#endif
+
+    ESP_RETURN_ON_ERROR(hamqtt_discovery_add_fields(root,
+                                                    sensor->component_config,
+                                                    binary_sensor_discovery_fields,
+                                                    sizeof(binary_sensor_discovery_fields) / sizeof(binary_sensor_discovery_fields[0])),
+                        TAG,
+                        "Failed to add binary sensor discovery fields");
+#endif
 
     return ESP_OK;
 }
@@ -124,21 +144,17 @@ static void hamqtt_binary_sensor_handle_mqtt_message(HAMQTT_Component *component
 }
 
 static void hamqtt_binary_sensor_update(HAMQTT_Component *component,
-                                        esp_mqtt_client_handle_t mqtt_client) {
+                                        HAMQTT_Transport *transport) {
     HAMQTT_Binary_Sensor *sensor = (HAMQTT_Binary_Sensor *)component;
 
-    if (!sensor->get_state_func) {
-        ESP_LOGE(TAG, "Binary sensor is missing get_state_func");
-        return;
-    }
+#if CONFIG_HAMQTT_COMPONENT_GROUP
+    if (sensor->group) return; // Its group samples it and reports it with the other members
+    if (!sensor->state_topic) return; // Not announced since it left its group
+#endif
 
-    bool current_state = sensor->get_state_func(sensor->get_state_func_args);
+    if (!hamqtt_binary_sensor_poll(sensor)) return;
 
-    if (current_state == sensor->previous_state && sensor->has_sent_state) return;
-    sensor->has_sent_state = true;
-    sensor->previous_state = current_state;
-
-    esp_mqtt_client_publish(mqtt_client, sensor->state_topic, current_state ? "ON" : "OFF", 0, 1, 1);
+    hamqtt_transport_publish(transport, sensor->state_topic, sensor->previous_state ? "ON" : "OFF", 0, 1, 1);
 }
 
 static const char *hamqtt_binary_sensor_get_unique_id(HAMQTT_Component *component) {
@@ -153,7 +169,7 @@ static const char *const *hamqtt_binary_sensor_get_subscribed_topics(HAMQTT_Comp
 }
 
 /* ----- V-Table ----- */
-static const HAMQTT_Component_VTable binary_sensor_vtable = {
+const HAMQTT_Component_VTable hamqtt_binary_sensor_vtable = {
     .get_discovery_config = hamqtt_binary_sensor_get_discovery_config,
     .handle_mqtt_message = hamqtt_binary_sensor_handle_mqtt_message,
     .update = hamqtt_binary_sensor_update,
@@ -170,7 +186,28 @@ static bool hamqtt_binary_sensor_is_config_valid(const HAMQTT_Binary_Sensor *sen
     return true;
 }
 
-HAMQTT_Binary_Sensor *hamqtt_binary_sensor_create(HAMQTT_Binary_Sensor_Config *config,
+bool hamqtt_binary_sensor_poll(HAMQTT_Binary_Sensor *sensor) {
+    if (!sensor->get_state_func) {
+        ESP_LOGE(TAG, "Binary sensor is missing get_state_func");
+        return false;
+    }
+
+    bool current_state = sensor->get_state_func(sensor->get_state_func_args);
+
+    if (current_state == sensor->previous_state && sensor->has_sent_state) return false;
+
+#if HAMQTT_RULES
+    // Local rules act first, so they do not wait for the publish. The first sample is not a change.
+    if (sensor->rules && sensor->has_sent_state) hamqtt_rules_dispatch(sensor->rules, current_state);
+#endif
+
+    sensor->has_sent_state = true;
+    sensor->previous_state = current_state;
+
+    return true;
+}
+
+HAMQTT_Binary_Sensor *hamqtt_binary_sensor_create(const HAMQTT_Binary_Sensor_Config *config,
                                                   HAMQTT_Binary_Sensor_Get_State_Func get_state_func,
                                                   void *get_state_func_args) {
     HAMQTT_Binary_Sensor *sensor = calloc(1, sizeof(HAMQTT_Binary_Sensor));
@@ -179,12 +216,13 @@ HAMQTT_Binary_Sensor *hamqtt_binary_sensor_create(HAMQTT_Binary_Sensor_Config *c
         return NULL;
     }
 
-    sensor->base.v = &binary_sensor_vtable;
+    sensor->base.v = &hamqtt_binary_sensor_vtable;
     sensor->component_config = config;
     sensor->get_state_func = get_state_func;
     sensor->get_state_func_args = get_state_func_args;
     sensor->has_sent_state = false;
     sensor->previous_state = false;
+    sensor->is_static = false;
     
     if (!hamqtt_binary_sensor_is_config_valid(sensor)) {
         ESP_LOGE(TAG, "Binary Sensor config is missing required fields");
@@ -198,8 +236,9 @@ HAMQTT_Binary_Sensor *hamqtt_binary_sensor_create(HAMQTT_Binary_Sensor_Config *c
 void hamqtt_binary_sensor_destroy(HAMQTT_Binary_Sensor *sensor) {
     if (!sensor) return;
     if (sensor->state_topic) free(sensor->state_topic);
+    sensor->state_topic = NULL;
 
-    free(sensor);
+    if (!sensor->is_static) free(sensor);
 }
 
 const HAMQTT_Binary_Sensor_Config *hamqtt_binary_sensor_get_config(const HAMQTT_Binary_Sensor *sensor) {
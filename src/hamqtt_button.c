@@ -29,32 +29,18 @@
 
 #include "HAMQTT/hamqtt_button.h"
 #include "HAMQTT/hamqtt_component_internal.h"
+#include "HAMQTT/hamqtt_discovery_internal.h"
+#include "HAMQTT/hamqtt_token_internal.h"
 
 static const char* TAG = "HAMQTT_Button";
 
 HAMQTT_Button_Config hamqtt_button_config_default(void) {
     HAMQTT_Button_Config config = {
-        .device_class = NULL,
-        .enabled_by_default = true,
-        .entity_picture = NULL,
-        .icon = NULL,
-        .name = "ESP32 Button",
-        .unique_id = NULL
+        HAMQTT_BUTTON_CONFIG_DEFAULT_FIELDS
     };
     return config;
 }
 
-struct HAMQTT_Button {
-    HAMQTT_Component base;
-
-    HAMQTT_Button_Config *component_config;
-    HAMQTT_Button_On_Press_Func on_press_func;
-    void *on_press_func_args;
-
-    char *command_topic;
-    const char *subscribed_topics[1];
-};
-
 /* ----- Private HAMQTT Button function declarations ----- */
 
 /**
@@ -67,6 +53,19 @@ struct HAMQTT_Button {
  */
 static bool hamqtt_button_is_config_valid(const HAMQTT_Button *button);
 
+/* ----- Discovery fields ----- */
+
+#if HAMQTT_RUNTIME_DISCOVERY
+static const HAMQTT_Discovery_Field button_discovery_fields[] = {
+    HAMQTT_DISCOVERY_STRING("name", HAMQTT_Button_Config, name),
+    HAMQTT_DISCOVERY_STRING("unique_id", HAMQTT_Button_Config, unique_id),
+    HAMQTT_DISCOVERY_BOOL("enabled_by_default", HAMQTT_Button_Config, enabled_by_default, true),
+    HAMQTT_DISCOVERY_STRING("device_class", HAMQTT_Button_Config, device_class),
+    HAMQTT_DISCOVERY_STRING("entity_picture", HAMQTT_Button_Config, entity_picture),
+    HAMQTT_DISCOVERY_STRING("icon", HAMQTT_Button_Config, icon),
+};
+#endif
+
 /* ----- Virtual Methods ----- */
 
 static esp_err_t hamqtt_button_get_discovery_config(HAMQTT_Component *component, 
@@ -79,33 +78,43 @@ static esp_err_t hamqtt_button_get_discovery_config(HAMQTT_Component *component,
                         TAG,
                         "Button was used despite config missing required fields");
                                                     
-    size_t command_topic_size = strlen(device_unique_id)
-                          + strlen(button->component_config->unique_id)
-                          + 1 /* slash */ + 6 /* "/press" */
-                          + 1; /* NUL */
-    
-    if (button->command_topic) free(button->command_topic);
-    button->command_topic = malloc(command_topic_size);
-    ESP_RETURN_ON_FALSE(button->command_topic,
-                        ESP_ERR_NO_MEM,
-                        TAG, 
-                        "Unable to allocate space for HAMQTT Button command topic");
-
-    snprintf(button->command_topic, command_topic_size,
-             "%s/%s/press", device_unique_id,
-             button->component_config->unique_id);
+    // The topic only depends on the unique ids, so keep it across reconnects. Messages may be
+    // matched against it on the transport's task.
+    if (!button->command_topic) {
+        size_t command_topic_size = strlen(device_unique_id)
+                              + strlen(button->component_config->unique_id)
+                              + 1 /* slash */ + 6 /* "/press" */
+                              + 1; /* NUL */
+
+        char *command_topic = malloc(command_topic_size);
+        ESP_RETURN_ON_FALSE(command_topic,
+                            ESP_ERR_NO_MEM,
+                            TAG, 
+                            "Unable to allocate space for HAMQTT Button command topic");
+
+        snprintf(command_topic, command_topic_size,
+                 "%s/%s/press", device_unique_id,
+                 button->component_config->unique_id);
+
+        button->command_topic = command_topic;
+        button->subscribed_topics[0] = command_topic;
+    }
 
-    button->subscribed_topics[0] = button->command_topic;
+    // Only the topics are needed when the discovery payload was precomputed
+    if (!root) return ESP_OK;
 
+#if HAMQTT_RUNTIME_DISCOVERY
     // Build configuration on root
     cJSON_AddStringToObject(root, "p", "button");
-    cJSON_AddStringToObject(root, "name", button->component_config->name);
     cJSON_AddStringToObject(root, "command_topic", button->command_topic);
-    cJSON_AddStringToObject(root, "unique_id", button->component_config->unique_id);
-    cJSON_AddBoolToObject(root, "enabled_by_default", button->component_config->enabled_by_default);
-    if (button->component_config->device_class) cJSON_AddStringToObject(root, "device_class", button->component_config->device_class);
-    if (button->component_config->entity_picture) cJSON_AddStringToObject(root, "entity_picture", button->component_config->entity_picture);
-    if (button->component_config->icon) cJSON_AddStringToObject(root, "icon", button->component_config->icon);
+
+    ESP_RETURN_ON_ERROR(hamqtt_discovery_add_fields(root,
+                                                    button->component_config,
+                                                    button_discovery_fields,
+                                                    sizeof(button_discovery_fields) / sizeof(button_discovery_fields[0])),
+                        TAG,
+                        "Failed to add button discovery fields");
+#endif
 
     return ESP_OK;
 }
@@ -118,7 +127,7 @@ static void hamqtt_button_handle_mqtt_message(HAMQTT_Component *component,
     if (!button->command_topic) return;
 
     if (strcmp(topic, button->command_topic) != 0) return; // Sanity check
-    if (strcmp(data, "PRESS") != 0) return;
+    if (hamqtt_token_decode_str(data) != HAMQTT_TOKEN_PRESS) return;
 
     if (!button->on_press_func) {
         ESP_LOGE(TAG, "Button is missing on_press_func");
@@ -129,7 +138,7 @@ static void hamqtt_button_handle_mqtt_message(HAMQTT_Component *component,
 }
 
 static void hamqtt_button_update(HAMQTT_Component *component,
-                                 esp_mqtt_client_handle_t mqtt_client) {
+                                 HAMQTT_Transport *transport) {
     // DO NOTHING
 }
 
@@ -148,7 +157,7 @@ static const char *const *hamqtt_button_get_subscribed_topics(HAMQTT_Component *
 }
 
 /* ----- V-Table ----- */
-static const HAMQTT_Component_VTable button_vtable = {
+const HAMQTT_Component_VTable hamqtt_button_vtable = {
     .get_discovery_config = hamqtt_button_get_discovery_config,
     .handle_mqtt_message = hamqtt_button_handle_mqtt_message,
     .update = hamqtt_button_update,
@@ -165,7 +174,7 @@ static bool hamqtt_button_is_config_valid(const HAMQTT_Button *button) {
     return true;
 }
 
-HAMQTT_Button *hamqtt_button_create(HAMQTT_Button_Config *config,
+HAMQTT_Button *hamqtt_button_create(const HAMQTT_Button_Config *config,
                                     HAMQTT_Button_On_Press_Func on_press_func,
                                     void *on_press_func_args) {
     HAMQTT_Button *button = calloc(1, sizeof(HAMQTT_Button));
@@ -174,10 +183,11 @@ HAMQTT_Button *hamqtt_button_create(HAMQTT_Button_Config *config,
         return NULL;
     }
 
-    button->base.v = &button_vtable;
+    button->base.v = &hamqtt_button_vtable;
     button->component_config = config;
     button->on_press_func = on_press_func;
     button->on_press_func_args = on_press_func_args;
+    button->is_static = false;
 
     if (!hamqtt_button_is_config_valid(button)) {
         ESP_LOGE(TAG, "Button config is missing required fields");
@@ -191,8 +201,10 @@ HAMQTT_Button *hamqtt_button_create(HAMQTT_Button_Config *config,
 void hamqtt_button_destroy(HAMQTT_Button *button) {
     if (!button) return;
     if (button->command_topic) free(button->command_topic);
+    button->command_topic = NULL;
+    button->subscribed_topics[0] = NULL;
 
-    free(button);
+    if (!button->is_static) free(button);
 }
 
 const HAMQTT_Button_Config *hamqtt_button_get_config(const HAMQTT_Button *button) {
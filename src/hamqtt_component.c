@@ -18,7 +18,8 @@
  * @file hamqtt_component.c
  * @brief Integration for Home Assistant MQTT components.
  *
- * This file implements the dispatch helpers for `HAMQTT_Component`.
+ * This file implements the dispatch helpers for `HAMQTT_Component`, and the unique id check
+ * shared by devices and components.
  *
  * @author Ethan Barnes
  * @date 2025
@@ -42,9 +43,9 @@ void hamqtt_component_handle_mqtt_message(
 }
 
 void hamqtt_component_update(
-        HAMQTT_Component *c, esp_mqtt_client_handle_t client)
+        HAMQTT_Component *c, HAMQTT_Transport *transport)
 {
-    c->v->update(c, client);
+    c->v->update(c, transport);
 }
 
 const char *hamqtt_component_get_unique_id(
@@ -57,4 +58,14 @@ const char * const *hamqtt_component_get_subscribed_topics(
         HAMQTT_Component *c, size_t *count)
 {
     return c->v->get_subscribed_topics(c, count);
-}
\ No newline at end of file
+}
+
+/* ----- Unique ids ----- */
+
+bool hamqtt_component_is_plain_id(const char *id) {
+    for (const char *c = id; *c; ++c) {
+        if (*c == '"' || *c == '\\' || *c == '+' || *c == '#' || *c == '/' || (unsigned char)*c < 0x20) return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,498 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_console.c
+ * @brief The `hamqtt` console command and the entity counters it prints.
+ *
+ * Publishes are counted from the task running `hamqtt_device_loop` and inbound messages
+ * from the transport's event task, each into its own fields, so neither side takes a lock.
+ * The command runs on the console task and reads everything without locking, so a value
+ * printed while it is being updated may be torn.
+ *
+ * Devices add themselves to a small registry when they are created. Slots are claimed and
+ * released with compare-and-swap, so devices can come and go from any task, but not while
+ * the command is printing them.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <stdatomic.h>
+
+#include "HAMQTT/hamqtt_console_internal.h"
+#include "HAMQTT/hamqtt_device.h"
+#include "HAMQTT/hamqtt_transport_internal.h"
+
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+#include "HAMQTT/hamqtt_binary_sensor.h"
+#endif
+#if CONFIG_HAMQTT_COMPONENT_BUTTON
+#include "HAMQTT/hamqtt_button.h"
+#endif
+#if CONFIG_HAMQTT_COMPONENT_GROUP
+#include "HAMQTT/hamqtt_group.h"
+#endif
+
+#ifdef ESP_PLATFORM
+#include "esp_console.h"
+#endif
+
+#define HAMQTT_CONSOLE_MAX_DEVICES 8
+
+static const char *TAG = "HAMQTT_Console";
+
+typedef struct {
+    HAMQTT_Transport base;
+    HAMQTT_Transport *inner;
+    HAMQTT_Console_Stats *stats;
+} HAMQTT_Console_Transport;
+
+struct HAMQTT_Console_Stats {
+    size_t entity_count;
+    HAMQTT_Entity_Stats *entities;
+
+    HAMQTT_Console_Transport transport;
+    size_t publisher;
+};
+
+static HAMQTT_Device *_Atomic console_devices[HAMQTT_CONSOLE_MAX_DEVICES];
+
+/* ----- Wrapped transport ----- */
+
+static void hamqtt_console_stats_record_publish(HAMQTT_Console_Stats *stats, const char *data, int len, int msg_id) {
+    if (stats->publisher >= stats->entity_count) return;
+
+    HAMQTT_Entity_Stats *entity = &stats->entities[stats->publisher];
+
+    if (msg_id < 0) {
+        entity->publish_failures++;
+        return;
+    }
+
+    if (len <= 0) len = (int)strlen(data);
+    size_t copy = (size_t)len < sizeof(entity->last_value) - 1 ? (size_t)len : sizeof(entity->last_value) - 1;
+
+    memcpy(entity->last_value, data, copy);
+    entity->last_value[copy] = '\0';
+    entity->last_publish_us = hamqtt_port_time_us();
+    entity->publishes++;
+}
+
+static esp_err_t hamqtt_console_transport_init(HAMQTT_Transport *self, const HAMQTT_Transport_Config *config) {
+    return hamqtt_transport_init(((HAMQTT_Console_Transport *)self)->inner, config);
+}
+
+static esp_err_t hamqtt_console_transport_start(HAMQTT_Transport *self) {
+    return hamqtt_transport_start(((HAMQTT_Console_Transport *)self)->inner);
+}
+
+static esp_err_t hamqtt_console_transport_stop(HAMQTT_Transport *self) {
+    return hamqtt_transport_stop(((HAMQTT_Console_Transport *)self)->inner);
+}
+
+static esp_err_t hamqtt_console_transport_wait_connected(HAMQTT_Transport *self, uint32_t timeout_ms) {
+    return hamqtt_transport_wait_connected(((HAMQTT_Console_Transport *)self)->inner, timeout_ms);
+}
+
+static int hamqtt_console_transport_publish(HAMQTT_Transport *self,
+                                            const char *topic,
+                                            const char *data,
+                                            int len,
+                                            int qos,
+                                            int retain) {
+    HAMQTT_Console_Transport *transport = (HAMQTT_Console_Transport *)self;
+
+    int msg_id = hamqtt_transport_publish(transport->inner, topic, data, len, qos, retain);
+    hamqtt_console_stats_record_publish(transport->stats, data, len, msg_id);
+
+    return msg_id;
+}
+
+static int hamqtt_console_transport_enqueue(HAMQTT_Transport *self,
+                                            const char *topic,
+                                            const char *data,
+                                            int len,
+                                            int qos,
+                                            int retain) {
+    HAMQTT_Console_Transport *transport = (HAMQTT_Console_Transport *)self;
+
+    int msg_id = hamqtt_transport_enqueue(transport->inner, topic, data, len, qos, retain);
+    hamqtt_console_stats_record_publish(transport->stats, data, len, msg_id);
+
+    return msg_id;
+}
+
+static int hamqtt_console_transport_subscribe(HAMQTT_Transport *self, const char *topic, int qos) {
+    return hamqtt_transport_subscribe(((HAMQTT_Console_Transport *)self)->inner, topic, qos);
+}
+
+static int hamqtt_console_transport_get_outbox_size(HAMQTT_Transport *self) {
+    return hamqtt_transport_get_outbox_size(((HAMQTT_Console_Transport *)self)->inner);
+}
+
+static void hamqtt_console_transport_destroy(HAMQTT_Transport *self) {
+    // Owned by the stats
+}
+
+static const HAMQTT_Transport_VTable hamqtt_console_transport_vtable = {
+    .init = hamqtt_console_transport_init,
+    .start = hamqtt_console_transport_start,
+    .stop = hamqtt_console_transport_stop,
+    .wait_connected = hamqtt_console_transport_wait_connected,
+    .publish = hamqtt_console_transport_publish,
+    .enqueue = hamqtt_console_transport_enqueue,
+    .subscribe = hamqtt_console_transport_subscribe,
+    .destroy = hamqtt_console_transport_destroy,
+    .get_outbox_size = hamqtt_console_transport_get_outbox_size,
+};
+
+/* ----- Entity counters ----- */
+
+HAMQTT_Console_Stats *hamqtt_console_stats_create(size_t entity_count) {
+    HAMQTT_Console_Stats *stats = calloc(1, sizeof(HAMQTT_Console_Stats));
+    if (!stats) {
+        ESP_LOGE(TAG, "Unable to allocate space for entity stats");
+        return NULL;
+    }
+
+    stats->entity_count = entity_count;
+    stats->entities = calloc(entity_count, sizeof(HAMQTT_Entity_Stats));
+    if (entity_count && !stats->entities) {
+        ESP_LOGE(TAG, "Unable to allocate space for entity stats");
+        free(stats);
+        return NULL;
+    }
+
+    stats->transport.base.v = &hamqtt_console_transport_vtable;
+    stats->transport.stats = stats;
+
+    return stats;
+}
+
+void hamqtt_console_stats_destroy(HAMQTT_Console_Stats *stats) {
+    if (!stats) return;
+
+    free(stats->entities);
+    free(stats);
+}
+
+void hamqtt_console_stats_reset(HAMQTT_Console_Stats *stats) {
+    memset(stats->entities, 0, stats->entity_count * sizeof(HAMQTT_Entity_Stats));
+}
+
+HAMQTT_Transport *hamqtt_console_stats_wrap_transport(HAMQTT_Console_Stats *stats, HAMQTT_Transport *inner) {
+    stats->transport.inner = inner;
+    return &stats->transport.base;
+}
+
+void hamqtt_console_stats_set_publisher(HAMQTT_Console_Stats *stats, size_t entity) {
+    stats->publisher = entity;
+}
+
+void hamqtt_console_stats_record_message(HAMQTT_Console_Stats *stats, size_t entity, int64_t arrival_us) {
+    if (entity >= stats->entity_count) return;
+
+    stats->entities[entity].messages++;
+    stats->entities[entity].last_message_us = arrival_us;
+}
+
+esp_err_t hamqtt_console_stats_get(const HAMQTT_Console_Stats *stats, size_t entity, HAMQTT_Entity_Stats *out) {
+    ESP_RETURN_ON_FALSE(entity < stats->entity_count, ESP_ERR_INVALID_ARG, TAG, "No stats for entity %d", (int)entity);
+
+    *out = stats->entities[entity];
+
+    return ESP_OK;
+}
+
+/* ----- Device registry ----- */
+
+esp_err_t hamqtt_console_add_device(HAMQTT_Device *device) {
+    for (size_t i = 0; i < HAMQTT_CONSOLE_MAX_DEVICES; ++i) {
+        HAMQTT_Device *expected = NULL;
+        if (atomic_compare_exchange_strong(&console_devices[i], &expected, device)) return ESP_OK;
+    }
+
+    ESP_LOGW(TAG, "More than %d devices, the hamqtt command will not list them all", HAMQTT_CONSOLE_MAX_DEVICES);
+    return ESP_ERR_NO_MEM;
+}
+
+void hamqtt_console_remove_device(HAMQTT_Device *device) {
+    for (size_t i = 0; i < HAMQTT_CONSOLE_MAX_DEVICES; ++i) {
+        HAMQTT_Device *expected = device;
+        if (atomic_compare_exchange_strong(&console_devices[i], &expected, NULL)) return;
+    }
+}
+
+/* ----- Command ----- */
+
+static const char *hamqtt_console_component_type(const HAMQTT_Component *component) {
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+    if (component->v == &hamqtt_binary_sensor_vtable) return "binary_sensor";
+#endif
+#if CONFIG_HAMQTT_COMPONENT_BUTTON
+    if (component->v == &hamqtt_button_vtable) return "button";
+#endif
+#if CONFIG_HAMQTT_COMPONENT_GROUP
+    if (component->v == &hamqtt_group_vtable) return "group";
+#endif
+    return "custom";
+}
+
+/**
+ * @brief Seconds since `us`, or -1 if it never happened.
+ */
+static double hamqtt_console_age_s(int64_t now_us, int64_t us) {
+    return us ? (double)(now_us - us) / 1e6 : -1.0;
+}
+
+static void hamqtt_console_print_status(HAMQTT_Device *device) {
+    const HAMQTT_Device_Config *config = hamqtt_device_get_config(device);
+    HAMQTT_Transport *transport = hamqtt_device_get_transport(device);
+
+    bool connected = transport && hamqtt_transport_wait_connected(transport, 0) == ESP_OK;
+    int outbox = transport ? hamqtt_transport_get_outbox_size(transport) : -1;
+
+    printf("  mqtt: %s  uri: %s\n", connected ? "connected" : "disconnected", config->mqtt_uri ? config->mqtt_uri : "-");
+    printf("  components: %d/%d\n", (int)hamqtt_device_get_component_count(device), HAMQTT_DEVICE_MAX_COMPONENTS);
+    if (outbox >= 0) {
+        printf("  outbox: %d bytes\n", outbox);
+    } else {
+        printf("  outbox: unknown\n");
+    }
+
+#if HAMQTT_DIAGNOSTICS
+    HAMQTT_Device_Stats stats;
+    hamqtt_device_get_stats(device, &stats);
+
+    printf("  uptime: %llu s  connects: %u  reconnects: %u  disconnects: %u\n",
+           (unsigned long long)(stats.uptime_ms / 1000),
+           (unsigned)stats.connects,
+           (unsigned)stats.reconnects,
+           (unsigned)stats.disconnects);
+    printf("  publishes: %u  failed: %u  diagnostics: %u  received: %u\n",
+           (unsigned)stats.publishes,
+           (unsigned)stats.publish_failures,
+           (unsigned)stats.diagnostics_publishes,
+           (unsigned)stats.messages_received);
+    printf("  loops: %u  p99 <= %u us  max: %u us\n",
+           (unsigned)stats.loops,
+           (unsigned)stats.loop_p99_us,
+           (unsigned)stats.loop_max_us);
+#endif
+
+#if HAMQTT_PIPELINE
+    HAMQTT_Pipeline_Stats pipeline;
+    hamqtt_device_get_pipeline_stats(device, &pipeline);
+
+    printf("  pipeline: %s  routing core: %d  execution core: %d\n",
+           pipeline.running ? "running" : "stopped",
+           pipeline.routing_core,
+           pipeline.execution_core);
+    printf("  commands: %u  dropped: %u  ring: %u/%u high water  loops: %u\n",
+           (unsigned)pipeline.commands,
+           (unsigned)pipeline.commands_dropped,
+           (unsigned)pipeline.ring_high_water,
+           (unsigned)pipeline.ring_slots,
+           (unsigned)pipeline.loops);
+
+    // Utilization covers the time since the previous status
+    for (size_t core = 0; core < pipeline.core_count; ++core) {
+        const HAMQTT_Core_Utilization *utilization = &pipeline.cores[core];
+        if (utilization->load_pct >= 0) {
+            printf("  core %d: routing %.1f%%  execution %.1f%%  load %.1f%%\n",
+                   (int)core,
+                   utilization->routing_pct,
+                   utilization->execution_pct,
+                   utilization->load_pct);
+        } else {
+            printf("  core %d: routing %.1f%%  execution %.1f%%\n",
+                   (int)core,
+                   utilization->routing_pct,
+                   utilization->execution_pct);
+        }
+    }
+#endif
+}
+
+static void hamqtt_console_print_components(HAMQTT_Device *device) {
+    int64_t now_us = hamqtt_port_time_us();
+
+    printf("  %3s  %-24s %-14s %8s %6s %8s %9s %9s  %s\n",
+           "#", "unique_id", "type", "pubs", "failed", "msgs", "pub_age_s", "msg_age_s", "last_value");
+
+    for (size_t i = 0; i < hamqtt_device_get_component_count(device); ++i) {
+        HAMQTT_Component *component = hamqtt_device_get_component(device, i);
+
+        HAMQTT_Entity_Stats stats = {0};
+        hamqtt_device_get_entity_stats(device, i, &stats);
+
+        printf("  %3d  %-24s %-14s %8u %6u %8u %9.1f %9.1f  %s\n",
+               (int)i,
+               hamqtt_component_get_unique_id(component),
+               hamqtt_console_component_type(component),
+               (unsigned)stats.publishes,
+               (unsigned)stats.publish_failures,
+               (unsigned)stats.messages,
+               hamqtt_console_age_s(now_us, stats.last_publish_us),
+               hamqtt_console_age_s(now_us, stats.last_message_us),
+               stats.publishes ? stats.last_value : "-");
+    }
+}
+
+static void hamqtt_console_print_routes(HAMQTT_Device *device) {
+    size_t route_count = 0;
+
+    for (size_t i = 0; i < hamqtt_device_get_component_count(device); ++i) {
+        HAMQTT_Component *component = hamqtt_device_get_component(device, i);
+
+        size_t topic_count = 0;
+        const char *const *topics = hamqtt_component_get_subscribed_topics(component, &topic_count);
+
+        for (size_t j = 0; j < topic_count; ++j) {
+            printf("  %-48s -> %3d %s\n", topics[j] ? topics[j] : "(not built)", (int)i, hamqtt_component_get_unique_id(component));
+            route_count++;
+        }
+    }
+
+    printf("  %d routes\n", (int)route_count);
+}
+
+#if HAMQTT_LATENCY
+static void hamqtt_console_print_histogram(const char *entity, HAMQTT_Latency_Stage stage, const HAMQTT_Latency_Histogram *histogram) {
+    printf("  %-24s %-12s %8u %8u %8u %8u %10.1f\n",
+           entity,
+           hamqtt_latency_stage_name(stage),
+           (unsigned)histogram->count,
+           (unsigned)hamqtt_latency_histogram_percentile(histogram, 50),
+           (unsigned)hamqtt_latency_histogram_percentile(histogram, 99),
+           (unsigned)histogram->max_us,
+           (double)histogram->total_us / (double)histogram->count);
+}
+#endif
+
+static void hamqtt_console_print_latency(HAMQTT_Device *device) {
+#if HAMQTT_LATENCY
+    HAMQTT_Latency_Histogram histogram;
+
+    printf("  %-24s %-12s %8s %8s %8s %8s %10s\n", "entity", "stage", "count", "p50_us", "p99_us", "max_us", "mean_us");
+
+    for (size_t i = 0; i < hamqtt_device_get_component_count(device); ++i) {
+        const char *unique_id = hamqtt_component_get_unique_id(hamqtt_device_get_component(device, i));
+
+        for (int stage = 0; stage < HAMQTT_LATENCY_STAGE_PROBE_RTT; ++stage) {
+            if (hamqtt_device_get_latency(device, i, stage, &histogram) != ESP_OK || histogram.count == 0) continue;
+            hamqtt_console_print_histogram(unique_id, stage, &histogram);
+        }
+    }
+
+    if (hamqtt_device_get_latency(device, 0, HAMQTT_LATENCY_STAGE_PROBE_RTT, &histogram) == ESP_OK && histogram.count > 0) {
+        hamqtt_console_print_histogram("broker", HAMQTT_LATENCY_STAGE_PROBE_RTT, &histogram);
+    }
+#else
+    printf("  latency instrumentation is disabled, enable CONFIG_HAMQTT_LATENCY\n");
+#endif
+}
+
+static void hamqtt_console_print_memory(void) {
+    printf("heap free: %u bytes  minimum free: %u bytes\n",
+           (unsigned)hamqtt_port_heap_free(),
+           (unsigned)hamqtt_port_heap_min_free());
+}
+
+static void hamqtt_console_reset(HAMQTT_Device *device) {
+    hamqtt_device_reset_entity_stats(device);
+#if HAMQTT_LATENCY
+    hamqtt_device_reset_latency(device);
+#endif
+    printf("  counters reset\n");
+}
+
+static void hamqtt_console_print_usage(void) {
+    printf("usage: hamqtt [status|components|routes|memory|latency|reset|help] [<device unique_id or index>]\n"
+           "  status      connection, outbox, device counters and per-core utilization (default)\n"
+           "  components  component table with per-entity publishes, messages and last value\n"
+           "  routes      subscribed topics and the component each is routed to\n"
+           "  memory      free and minimum free heap\n"
+           "  latency     latency histograms (CONFIG_HAMQTT_LATENCY)\n"
+           "  reset       clear per-entity counters and latency histograms\n");
+}
+
+static bool hamqtt_console_device_matches(HAMQTT_Device *device, size_t index, const char *selector) {
+    if (!selector) return true;
+
+    char *end = NULL;
+    unsigned long selected = strtoul(selector, &end, 10);
+    if (end != selector && *end == '\0') return selected == index;
+
+    return strcmp(hamqtt_device_get_config(device)->unique_id, selector) == 0;
+}
+
+int hamqtt_console_run(int argc, char **argv) {
+    const char *command = argc > 1 ? argv[1] : "status";
+    const char *selector = argc > 2 ? argv[2] : NULL;
+
+    void (*print)(HAMQTT_Device *device) = NULL;
+
+    if (strcmp(command, "status") == 0) {
+        print = hamqtt_console_print_status;
+    } else if (strcmp(command, "components") == 0) {
+        print = hamqtt_console_print_components;
+    } else if (strcmp(command, "routes") == 0) {
+        print = hamqtt_console_print_routes;
+    } else if (strcmp(command, "latency") == 0) {
+        print = hamqtt_console_print_latency;
+    } else if (strcmp(command, "reset") == 0) {
+        print = hamqtt_console_reset;
+    } else if (strcmp(command, "memory") == 0) {
+        hamqtt_console_print_memory();
+        return 0;
+    } else {
+        hamqtt_console_print_usage();
+        return strcmp(command, "help") == 0 ? 0 : 1;
+    }
+
+    bool found = false;
+    for (size_t i = 0; i < HAMQTT_CONSOLE_MAX_DEVICES; ++i) {
+        HAMQTT_Device *device = atomic_load(&console_devices[i]);
+        if (!device || !hamqtt_console_device_matches(device, i, selector)) continue;
+
+        printf("[%d] %s\n", (int)i, hamqtt_device_get_config(device)->unique_id);
+        print(device);
+        found = true;
+    }
+
+    if (!found) {
+        printf(selector ? "no device matches %s\n" : "no devices%s\n", selector ? selector : "");
+        return 1;
+    }
+
+    return 0;
+}
+
+#ifdef ESP_PLATFORM
+esp_err_t hamqtt_console_register(void) {
+    const esp_console_cmd_t command = {
+        .command = "hamqtt",
+        .help = "Inspect HAMQTT devices: status, components, routes, memory, latency, reset",
+        .hint = "[status|components|routes|memory|latency|reset|help] [<device>]",
+        .func = hamqtt_console_run,
+    };
+
+    return esp_console_cmd_register(&command);
+}
+#endif
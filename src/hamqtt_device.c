@@ -31,8 +31,21 @@
  */
 
 #include "HAMQTT/hamqtt_device.h"
-
-#define MQTT_CONNECTED_BIT BIT0
+#include "HAMQTT/hamqtt_attributes_internal.h"
+#include "HAMQTT/hamqtt_component_internal.h"
+#include "HAMQTT/hamqtt_console_internal.h"
+#include "HAMQTT/hamqtt_diagnostics_internal.h"
+#include "HAMQTT/hamqtt_discovery_internal.h"
+#include "HAMQTT/hamqtt_latency_internal.h"
+#include "HAMQTT/hamqtt_pipeline_internal.h"
+#include "HAMQTT/hamqtt_routes_internal.h"
+#include "HAMQTT/hamqtt_rules_internal.h"
+#include "HAMQTT/hamqtt_scene_internal.h"
+#include "HAMQTT/hamqtt_trace.h"
+
+#if CONFIG_HAMQTT_COMPONENT_GROUP && CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+#include "HAMQTT/hamqtt_binary_sensor.h"
+#endif
 
 static const char *TAG = "HAMQTT_Device";
 
@@ -60,11 +73,74 @@ struct HAMQTT_Device {
     HAMQTT_Component *components[HAMQTT_DEVICE_MAX_COMPONENTS];
     int component_count;
 
+    // Snapshot of the components and their topics, read by the loop and the transport's task
+    HAMQTT_Routes *routes;
+    bool routes_published;
+
     char *availability_topic;
 
-    esp_mqtt_client_handle_t mqtt_client;
-    EventGroupHandle_t mqtt_event_group;
+    const HAMQTT_Discovery_Template *discovery_template;
+
+    HAMQTT_Transport *transport;
+    bool owns_transport;
+
+#if HAMQTT_LATENCY
+    HAMQTT_Latency *latency;
+    char *latency_probe_topic;
+#endif
+
+#if HAMQTT_DIAGNOSTICS
+    HAMQTT_Diagnostics *diagnostics;
+#endif
+
+#if HAMQTT_CONSOLE
+    HAMQTT_Console_Stats *console_stats;
+#endif
+
+#if HAMQTT_PIPELINE
+    HAMQTT_Pipeline *pipeline;
+#endif
+
+#if HAMQTT_RULES
+    HAMQTT_Rules *rules;
+#endif
+
+#if HAMQTT_SCENE
+    HAMQTT_Scene *scene;
+#endif
+};
+
+// An inbound message on its way to the components it matches
+typedef struct {
+    const HAMQTT_Device *device;
+    const char *topic;
+    size_t topic_size;                  // Including the NUL
+    const char *data;
+    size_t data_size;                   // Including the NUL
+#if HAMQTT_LATENCY || HAMQTT_CONSOLE || HAMQTT_PIPELINE
+    int64_t arrival_us;
+#endif
+} HAMQTT_Device_Message;
+
+/* ----- Discovery fields ----- */
+
+#if HAMQTT_RUNTIME_DISCOVERY
+static const HAMQTT_Discovery_Field device_discovery_fields[] = {
+    HAMQTT_DISCOVERY_STRING("ids", HAMQTT_Device_Config, unique_id),
+    HAMQTT_DISCOVERY_STRING("name", HAMQTT_Device_Config, name),
+    HAMQTT_DISCOVERY_STRING("mf", HAMQTT_Device_Config, manufacturer),
+    HAMQTT_DISCOVERY_STRING("mdl", HAMQTT_Device_Config, model),
+    HAMQTT_DISCOVERY_STRING("sw", HAMQTT_Device_Config, sw_version),
+    HAMQTT_DISCOVERY_STRING("hw", HAMQTT_Device_Config, hw_version),
+    HAMQTT_DISCOVERY_STRING("sn", HAMQTT_Device_Config, serial_number),
+};
+
+static const HAMQTT_Discovery_Field origin_discovery_fields[] = {
+    HAMQTT_DISCOVERY_STRING("name", HAMQTT_Device_Config, name),
+    HAMQTT_DISCOVERY_STRING("sw", HAMQTT_Device_Config, sw_version),
+    HAMQTT_DISCOVERY_STRING("url", HAMQTT_Device_Config, origin_url),
 };
+#endif
 
 /* ----- Private HAMQTT Device function declarations ----- */
 
@@ -78,6 +154,27 @@ struct HAMQTT_Device {
  */
 static bool hamqtt_device_is_config_valid(const HAMQTT_Device *device);
 
+#if CONFIG_HAMQTT_COMPONENT_GROUP && CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+/**
+ * @brief Checks that the group of every grouped binary sensor was added to the device too.
+ *
+ * A grouped binary sensor only reports through its group, so it would go silent otherwise.
+ *
+ * @param device The device to check.
+ * @return ESP_OK if every group is registered, ESP_ERR_INVALID_STATE otherwise.
+ */
+static esp_err_t hamqtt_device_check_groups(const HAMQTT_Device *device);
+#endif
+
+/**
+ * @brief Builds the device level topics, such as the availability topic.
+ *
+ * @param[in] device The device whose topics to build.
+ * @return ESP_OK on success, or appropriate error on failure.
+ */
+static esp_err_t hamqtt_device_build_topics(HAMQTT_Device *device);
+
+#if HAMQTT_RUNTIME_DISCOVERY
 /**
  * @brief Builds the full Home Assistant discovery config JSON for the device and its components.
  *
@@ -86,6 +183,26 @@ static bool hamqtt_device_is_config_valid(const HAMQTT_Device *device);
  * @return ESP_OK on success, or appropriate error on failure.
  */
 static esp_err_t hamqtt_device_build_config(HAMQTT_Device *device, cJSON* root);
+#endif
+
+/**
+ * @brief Renders the device's precomputed discovery template into a newly allocated string.
+ *
+ * Components are still asked to prepare their runtime topics, but no cJSON objects are built.
+ *
+ * @param[in] device The device whose template to render.
+ * @param[out] out Set to the rendered payload. Must be freed by the caller.
+ * @return ESP_OK on success, or appropriate error on failure.
+ */
+static esp_err_t hamqtt_device_render_discovery_template(HAMQTT_Device *device, char **out);
+
+/**
+ * @brief Publishes a discovery payload to the device's Home Assistant config topic.
+ *
+ * @param[in] device The device whose config topic to publish to.
+ * @param[in] payload The discovery payload.
+ */
+static void hamqtt_device_publish_discovery(const HAMQTT_Device *device, const char *payload);
 
 /**
  * @brief Subscribes to all topics requested by each registered component.
@@ -94,15 +211,22 @@ static esp_err_t hamqtt_device_build_config(HAMQTT_Device *device, cJSON* root);
  */
 static void hamqtt_device_subscribe(const HAMQTT_Device *device);
 
+#if HAMQTT_ATTRIBUTES
 /**
- * @brief Callback handler for all MQTT client events.
+ * @brief Has every component's attributes published in full on the next loop.
+ *
+ * @param[in] device The device whose components should resync.
+ */
+static void hamqtt_device_resync_attributes(const HAMQTT_Device *device);
+#endif
+
+/**
+ * @brief Callback handler for all transport events.
  *
  * @param handler_args Pointer to the HAMQTT_Device.
- * @param base Event base.
- * @param event_id Event ID.
- * @param event_data Pointer to the event data.
+ * @param event The transport event.
  */
-static void hamqtt_device_mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
+static void hamqtt_device_transport_event_handler(void *handler_args, const HAMQTT_Transport_Event *event);
 
 /**
  * @brief Determines if any component is subscribed to a given topic and dispatches the message to it.
@@ -115,6 +239,45 @@ static void hamqtt_device_mqtt_event_handler(void *handler_args, esp_event_base_
  */
 void hamqtt_device_handle_mqtt_message(const HAMQTT_Device *device, const char *topic, int topic_len, const char *data, int data_len);
 
+/**
+ * @brief Runs the handler of a component a message was routed to, or hands it to the
+ * execution task. Called by @ref hamqtt_routes_match.
+ *
+ * @param route The matching route.
+ * @param context Pointer to the HAMQTT_Device_Message.
+ */
+static void hamqtt_device_dispatch_route(const HAMQTT_Route *route, void *context);
+
+#if HAMQTT_SCENE
+/**
+ * @brief Applies a scene received on the scene topic, or hands it to the execution task.
+ *
+ * Scenes are larger than other commands, so they skip the clamped copies.
+ *
+ * @param[in] device The device instance.
+ * @param[in] data Payload data.
+ * @param[in] data_len Length of the payload.
+ */
+static void hamqtt_device_handle_scene_message(const HAMQTT_Device *device, const char *data, int data_len);
+#endif
+
+#if HAMQTT_PIPELINE
+/**
+ * @brief Runs a command routed by @ref hamqtt_device_handle_mqtt_message on the execution task.
+ *
+ * @param context Pointer to the HAMQTT_Device.
+ * @param command The command, valid until this returns.
+ */
+static void hamqtt_device_execute_command(void *context, const HAMQTT_Pipeline_Command *command);
+
+/**
+ * @brief Calls @ref hamqtt_device_loop from the execution task.
+ *
+ * @param context Pointer to the HAMQTT_Device.
+ */
+static void hamqtt_device_pipeline_loop(void *context);
+#endif
+
 /* ----- HAMQTT Device function definitions ----- */
 
 HAMQTT_Device *hamqtt_device_create(HAMQTT_Device_Config *config){
@@ -126,19 +289,89 @@ HAMQTT_Device *hamqtt_device_create(HAMQTT_Device_Config *config){
 
     device->device_config = config;
     device->component_count = 0;
-    device->mqtt_client = NULL;
+    device->transport = NULL;
+
+    // Destroying a partly created device frees whatever was allocated
+    device->routes = hamqtt_routes_create();
+    if (!device->routes) goto fail;
+
+#if HAMQTT_LATENCY
+    device->latency = hamqtt_latency_create(HAMQTT_DEVICE_MAX_COMPONENTS);
+    if (!device->latency) goto fail;
+#endif
+
+#if HAMQTT_DIAGNOSTICS
+    device->diagnostics = hamqtt_diagnostics_create();
+    if (!device->diagnostics) goto fail;
+#endif
+
+#if HAMQTT_CONSOLE
+    device->console_stats = hamqtt_console_stats_create(HAMQTT_DEVICE_MAX_COMPONENTS);
+    if (!device->console_stats) goto fail;
+
+    hamqtt_console_add_device(device);
+#endif
+
+#if HAMQTT_PIPELINE
+    const HAMQTT_Pipeline_Callbacks pipeline_callbacks = {
+        .execute = hamqtt_device_execute_command,
+        .loop = hamqtt_device_pipeline_loop,
+        .context = device,
+    };
+    device->pipeline = hamqtt_pipeline_create(&pipeline_callbacks);
+    if (!device->pipeline) goto fail;
+#endif
+
+#if HAMQTT_SCENE
+    device->scene = hamqtt_scene_create();
+    if (!device->scene) goto fail;
+#endif
 
     if (!hamqtt_device_is_config_valid(device)) {
         ESP_LOGW(TAG, "Device config is missing required fields");
     }
 
     return device;
+
+fail:
+    hamqtt_device_destroy(device);
+    return NULL;
 }
 
 void hamqtt_device_destroy(HAMQTT_Device *device) {
     if (!device) return;
+
+#if HAMQTT_PIPELINE
+    // Stop the execution task before anything it uses is freed
+    hamqtt_pipeline_destroy(device->pipeline);
+#endif
+
+#if HAMQTT_CONSOLE
+    hamqtt_console_remove_device(device);
+    hamqtt_console_stats_destroy(device->console_stats);
+#endif
     
     if (device->availability_topic) free(device->availability_topic);
+    if (device->owns_transport) hamqtt_transport_destroy(device->transport);
+
+#if HAMQTT_LATENCY
+    free(device->latency_probe_topic);
+    hamqtt_latency_destroy(device->latency);
+#endif
+
+#if HAMQTT_DIAGNOSTICS
+    hamqtt_diagnostics_destroy(device->diagnostics);
+#endif
+
+#if HAMQTT_RULES
+    hamqtt_rules_destroy(device->rules);
+#endif
+
+#if HAMQTT_SCENE
+    hamqtt_scene_destroy(device->scene);
+#endif
+
+    hamqtt_routes_destroy(device->routes);
 
     free(device);
 }
@@ -155,97 +388,397 @@ esp_err_t hamqtt_device_add_component(HAMQTT_Device *device, HAMQTT_Component *c
                         "Component buffer is full! No more than %d components can be added",
                         HAMQTT_DEVICE_MAX_COMPONENTS);
 
+    // Topics are built, subscribed and announced on connect, a later component would get none of them
+    ESP_RETURN_ON_FALSE(!device->routes_published,
+                        ESP_ERR_INVALID_STATE,
+                        TAG,
+                        "Components must be added before the device connects");
+
+#if HAMQTT_SCENE
+    // Its topics would be the scene's, "<device>/scene/set" and "<device>/scene/state"
+    const char *unique_id = hamqtt_component_get_unique_id(component);
+    ESP_RETURN_ON_FALSE(!unique_id || strcmp(unique_id, "scene") != 0,
+                        ESP_ERR_INVALID_ARG,
+                        TAG,
+                        "The unique id \"scene\" is reserved for the device's scene topics");
+#endif
+
     device->components[device->component_count] = component;
     device->component_count++;
 
     return ESP_OK;
 }
 
+#if HAMQTT_RULES
+esp_err_t hamqtt_device_set_rules(HAMQTT_Device *device, const HAMQTT_Rule *rules, size_t rule_count) {
+    ESP_RETURN_ON_FALSE(!device->rules,
+                        ESP_ERR_INVALID_STATE,
+                        TAG,
+                        "Rules were already set");
+
+    // Once connected the loop may be sampling the sensors the rules attach to
+    ESP_RETURN_ON_FALSE(!device->routes_published,
+                        ESP_ERR_INVALID_STATE,
+                        TAG,
+                        "Rules must be set before the device connects");
+
+    return hamqtt_rules_compile(rules, rule_count, device->components, device->component_count, &device->rules);
+}
+#endif
+
+#if HAMQTT_SCENE
+esp_err_t hamqtt_device_apply_scene(HAMQTT_Device *device, const char *json, size_t len) {
+    HAMQTT_Transport *transport = device->transport;
+#if HAMQTT_PIPELINE
+    if (transport && hamqtt_pipeline_is_execution_task(device->pipeline)) {
+        transport = hamqtt_pipeline_wrap_transport(device->pipeline, transport);
+    }
+#endif
+
+    // Any application task may get here, so the scene's own reader is used, which it lets one task hold
+    return hamqtt_scene_apply(device->scene, device->routes, HAMQTT_ROUTES_READER_SCENE, transport, json, len);
+}
+#endif
+
+esp_err_t hamqtt_device_set_discovery_template(HAMQTT_Device *device, const HAMQTT_Discovery_Template *discovery) {
+    ESP_RETURN_ON_FALSE(discovery && discovery->fragments && discovery->fragment_count > 0,
+                        ESP_ERR_INVALID_ARG,
+                        TAG,
+                        "Discovery template is empty");
+
+    device->discovery_template = discovery;
+
+    return ESP_OK;
+}
+
+esp_err_t hamqtt_device_set_transport(HAMQTT_Device *device, HAMQTT_Transport *transport) {
+    ESP_RETURN_ON_FALSE(transport, ESP_ERR_INVALID_ARG, TAG, "Transport is NULL");
+
+    if (device->owns_transport) hamqtt_transport_destroy(device->transport);
+
+    device->transport = transport;
+    device->owns_transport = false;
+
+    return ESP_OK;
+}
+
+esp_err_t hamqtt_device_build_discovery_payload(HAMQTT_Device *device, char **payload) {
+    ESP_RETURN_ON_FALSE(hamqtt_device_is_config_valid(device), ESP_ERR_INVALID_STATE, TAG, "Some required fields are missing");
+    ESP_RETURN_ON_ERROR(hamqtt_device_build_topics(device), TAG, "Failed to build device topics");
+
+    if (device->discovery_template) {
+        return hamqtt_device_render_discovery_template(device, payload);
+    }
+
+#if HAMQTT_RUNTIME_DISCOVERY
+    cJSON *ha_dev_config_json = cJSON_CreateObject();
+    ESP_RETURN_ON_FALSE(ha_dev_config_json, ESP_ERR_NO_MEM, TAG, "Unable to allocate HomeAssistant configuration");
+
+    esp_err_t ret = hamqtt_device_build_config(device, ha_dev_config_json);
+    if (ret == ESP_OK) {
+        *payload = cJSON_Print(ha_dev_config_json);
+        if (!*payload) ret = ESP_ERR_NO_MEM;
+    }
+
+    cJSON_Delete(ha_dev_config_json);
+
+    return ret;
+#else
+    ESP_LOGE(TAG, "No discovery template was set and runtime discovery is disabled");
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void hamqtt_device_free_discovery_payload(const HAMQTT_Device *device, char *payload) {
+    if (!payload) return;
+
+#if HAMQTT_RUNTIME_DISCOVERY
+    // Payloads printed by cJSON come from its allocation hooks
+    if (!device->discovery_template) {
+        cJSON_free(payload);
+        return;
+    }
+#endif
+
+    free(payload);
+}
+
 esp_err_t hamqtt_device_connect(HAMQTT_Device *device) {
-    // Get HomeAssistant configuration
-    cJSON* ha_dev_config_json = cJSON_CreateObject();
-    ESP_RETURN_ON_ERROR(hamqtt_device_build_config(device, ha_dev_config_json), TAG, "Failed to build HomeAssistant configuration");
+    esp_err_t ret = ESP_OK;
 
-    char *ha_dev_config_str;
-    ha_dev_config_str = cJSON_Print(ha_dev_config_json);
+#if CONFIG_HAMQTT_COMPONENT_GROUP && CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+    ESP_RETURN_ON_ERROR(hamqtt_device_check_groups(device), TAG, "A binary sensor cannot report its state");
+#endif
 
-    // Create MQTT config
-    esp_mqtt_client_config_t mqtt_config = {};
-    mqtt_config.broker.address.uri = device->device_config->mqtt_uri;
+    HAMQTT_TRACE_BEGIN(connect_span, "device", "connect", device->device_config->unique_id);
 
-    if (device->device_config->mqtt_username) mqtt_config.credentials.username = device->device_config->mqtt_username;
-    if (device->device_config->mqtt_password) mqtt_config.credentials.authentication.password = device->device_config->mqtt_password;
+    // Get HomeAssistant configuration
+    char *ha_dev_config_str = NULL;
+    HAMQTT_TRACE_BEGIN(build_span, "discovery", "build", NULL);
+    ret = hamqtt_device_build_discovery_payload(device, &ha_dev_config_str);
+    HAMQTT_TRACE_END_ERROR(build_span, ret);
+    ESP_GOTO_ON_ERROR(ret, cleanup, TAG, "Failed to build HomeAssistant configuration");
+
+    // Topics are built now, publish them before the transport can deliver anything
+    ESP_GOTO_ON_ERROR(hamqtt_routes_publish(device->routes, device->components, device->component_count),
+                      cleanup,
+                      TAG,
+                      "Failed to publish route table");
+    device->routes_published = true;
+
+    // Create the platform transport unless the application provided one
+    if (!device->transport) {
+        device->transport = hamqtt_transport_default_create();
+        ESP_GOTO_ON_FALSE(device->transport, ESP_FAIL, cleanup, TAG, "Unable to create MQTT transport");
+        device->owns_transport = true;
+    }
 
-    mqtt_config.session.last_will.topic = device->availability_topic;
-    mqtt_config.session.last_will.msg = "offline";
-    mqtt_config.session.last_will.qos = 1;
-    mqtt_config.session.last_will.retain = 1;
+    // Create MQTT config
+    HAMQTT_Transport_Config transport_config = {
+        .uri = device->device_config->mqtt_uri,
+        .username = device->device_config->mqtt_username,
+        .password = device->device_config->mqtt_password,
+        .will_topic = device->availability_topic,
+        .will_msg = "offline",
+        .will_qos = 1,
+        .will_retain = true,
+    };
 
     // Connect to the mqtt broker
-    device->mqtt_event_group = xEventGroupCreate();
-
-    device->mqtt_client = esp_mqtt_client_init(&mqtt_config);
-    esp_mqtt_client_register_event(device->mqtt_client, ESP_EVENT_ANY_ID, hamqtt_device_mqtt_event_handler, device);
+    hamqtt_transport_set_event_handler(device->transport, hamqtt_device_transport_event_handler, device);
 
-    ESP_RETURN_ON_ERROR(esp_mqtt_client_start(device->mqtt_client), TAG, "Failed ot start MQTT Client");
+    ESP_GOTO_ON_ERROR(hamqtt_transport_init(device->transport, &transport_config), cleanup, TAG, "Failed to initialize MQTT transport");
+    ESP_GOTO_ON_ERROR(hamqtt_transport_start(device->transport), cleanup, TAG, "Failed to start MQTT transport");
 
     // Wait for connection
-    EventBits_t bits = xEventGroupWaitBits(
-        device->mqtt_event_group,
-        MQTT_CONNECTED_BIT,
-        pdFALSE,
-        pdFALSE,
-        pdMS_TO_TICKS(HAMQTT_MQTT_CONNECT_TIMEOUT_MS)
-    );
-
-    ESP_RETURN_ON_FALSE(bits & MQTT_CONNECTED_BIT, ESP_FAIL, TAG, "MQTT Failed to connect within timeout");
+    HAMQTT_TRACE_BEGIN(wait_span, "mqtt", "wait_connected", NULL);
+    ret = hamqtt_transport_wait_connected(device->transport, HAMQTT_MQTT_CONNECT_TIMEOUT_MS);
+    HAMQTT_TRACE_END_ERROR(wait_span, ret);
+    ESP_GOTO_ON_ERROR(ret, cleanup, TAG, "MQTT Failed to connect within timeout");
 
     // Publish the config to MQTT Broker
     ESP_LOGI(TAG, "Publishing Configuration");
+    HAMQTT_TRACE_BEGIN(publish_span, "discovery", "publish", NULL);
+    hamqtt_device_publish_discovery(device, ha_dev_config_str);
+    HAMQTT_TRACE_END(publish_span);
 
-    size_t config_topic_size = strlen(device->device_config->mqtt_config_topic_prefix)
-                            + strlen(device->device_config->mqtt_config_topic_prefix)
-                            + 8 /* /device/ */ + 7 /* /config */ + 1; /* NUL */
-    
-    int clamped_config_topic_size = config_topic_size < HAMQTT_MAX_CHAR_BUF_SIZE ? config_topic_size : HAMQTT_MAX_CHAR_BUF_SIZE;
+cleanup:
+    hamqtt_device_free_discovery_payload(device, ha_dev_config_str);
+    HAMQTT_TRACE_END_ERROR(connect_span, ret);
 
-    char config_topic[clamped_config_topic_size];
-    snprintf(config_topic,
-             clamped_config_topic_size,
-             "%s/device/%s/config",
-             device->device_config->mqtt_config_topic_prefix,
-             device->device_config->unique_id);
-    
-    esp_mqtt_client_publish(device->mqtt_client, config_topic, ha_dev_config_str, strlen(ha_dev_config_str), 1, 1);
+    return ret;
+}
 
-    cJSON_Delete(ha_dev_config_json);
+esp_err_t hamqtt_device_disconnect(HAMQTT_Device *device) {
+    ESP_RETURN_ON_FALSE(device->transport, ESP_ERR_INVALID_STATE, TAG, "Tried to disconnect before MQTT connection was created");
 
-    return ESP_OK;
+    // The broker only sends the last will when the connection drops unexpectedly
+    hamqtt_device_publish_availability(device, false);
+
+#if HAMQTT_DIAGNOSTICS
+    hamqtt_diagnostics_handle_stop(device->diagnostics);
+#endif
+
+    return hamqtt_transport_stop(device->transport);
 }
 
 esp_err_t hamqtt_device_publish_availability(const HAMQTT_Device *device, bool availability) {
-    ESP_RETURN_ON_FALSE(device->mqtt_client, ESP_ERR_INVALID_STATE, TAG, "Tried to publish availability before MQTT connection was created");
+    ESP_RETURN_ON_FALSE(device->transport, ESP_ERR_INVALID_STATE, TAG, "Tried to publish availability before MQTT connection was created");
 
     if (availability) {
-        esp_mqtt_client_publish(device->mqtt_client, device->availability_topic, "online", 0, 1, 1);
+        hamqtt_transport_publish(device->transport, device->availability_topic, "online", 0, 1, 1);
     } else {
-        esp_mqtt_client_publish(device->mqtt_client, device->availability_topic, "offline", 0, 1, 1);
+        hamqtt_transport_publish(device->transport, device->availability_topic, "offline", 0, 1, 1);
     }
 
     return ESP_OK;
 }
 
 void hamqtt_device_loop(const HAMQTT_Device *device) {
-    for (int i = 0; i < device->component_count; ++i) {
-        HAMQTT_Component *component = device->components[i];
-        hamqtt_component_update(component, device->mqtt_client);
+    HAMQTT_TRACE_BEGIN(loop_span, "device", "loop", NULL);
+
+#if HAMQTT_DIAGNOSTICS
+    int64_t loop_start_us = hamqtt_port_time_us();
+#endif
+
+    HAMQTT_Transport *transport = device->transport;
+
+#if HAMQTT_PIPELINE
+    // On the execution task, publishes are left to the MQTT task to write out
+    if (hamqtt_pipeline_is_execution_task(device->pipeline)) {
+        transport = hamqtt_pipeline_wrap_transport(device->pipeline, transport);
+    }
+#endif
+
+#if HAMQTT_LATENCY
+    // Components publish through a wrapper that remembers when, so the PUBACK can be timed
+    transport = hamqtt_latency_wrap_transport(device->latency, transport);
+
+#if CONFIG_HAMQTT_LATENCY_PROBE_INTERVAL_MS > 0
+    if (hamqtt_latency_probe_due(device->latency, CONFIG_HAMQTT_LATENCY_PROBE_INTERVAL_MS)) {
+        hamqtt_device_send_latency_probe(device);
+    }
+#endif
+#endif
+
+#if HAMQTT_CONSOLE
+    // Counts each publish against the component whose update made it
+    transport = hamqtt_console_stats_wrap_transport(device->console_stats, transport);
+#endif
+
+    const HAMQTT_Route_Table *table = hamqtt_routes_enter(device->routes, HAMQTT_ROUTES_READER_LOOP);
+
+    for (size_t i = 0; i < table->component_count; ++i) {
+        HAMQTT_Component *component = table->components[i];
+#if HAMQTT_LATENCY
+        hamqtt_latency_set_publisher(device->latency, i);
+#endif
+#if HAMQTT_CONSOLE
+        hamqtt_console_stats_set_publisher(device->console_stats, i);
+#endif
+        HAMQTT_TRACE_BEGIN(update_span, "component", "update", hamqtt_component_get_unique_id(component));
+        hamqtt_component_update(component, transport);
+#if HAMQTT_ATTRIBUTES
+        if (component->attributes) hamqtt_attributes_update(component->attributes, transport);
+#endif
+        HAMQTT_TRACE_END(update_span);
+    }
+
+    hamqtt_routes_exit(device->routes, HAMQTT_ROUTES_READER_LOOP);
+
+#if HAMQTT_DIAGNOSTICS
+    // Reports go out after the loop is timed, so they are not part of the loop p99
+    if (device->transport) {
+        hamqtt_diagnostics_update(device->diagnostics, device->transport, hamqtt_port_time_us() - loop_start_us);
     }
+#endif
+
+    HAMQTT_TRACE_END(loop_span);
 }
 
 const HAMQTT_Device_Config *hamqtt_device_get_config(const HAMQTT_Device *device) {
     return device->device_config;
 }
 
+size_t hamqtt_device_get_component_count(const HAMQTT_Device *device) {
+    return device->component_count;
+}
+
+HAMQTT_Component *hamqtt_device_get_component(const HAMQTT_Device *device, size_t index) {
+    return index < device->component_count ? device->components[index] : NULL;
+}
+
+HAMQTT_Transport *hamqtt_device_get_transport(const HAMQTT_Device *device) {
+    return device->transport;
+}
+
+#if HAMQTT_LATENCY
+esp_err_t hamqtt_device_get_latency(const HAMQTT_Device *device,
+                                    size_t component_index,
+                                    HAMQTT_Latency_Stage stage,
+                                    HAMQTT_Latency_Histogram *histogram) {
+    ESP_RETURN_ON_FALSE(stage == HAMQTT_LATENCY_STAGE_PROBE_RTT || component_index < device->component_count,
+                        ESP_ERR_INVALID_ARG,
+                        TAG,
+                        "Component index %d is out of range",
+                        (int)component_index);
+
+    return hamqtt_latency_get(device->latency, component_index, stage, histogram);
+}
+
+void hamqtt_device_reset_latency(HAMQTT_Device *device) {
+    hamqtt_latency_reset(device->latency);
+}
+
+esp_err_t hamqtt_device_send_latency_probe(const HAMQTT_Device *device) {
+    ESP_RETURN_ON_FALSE(device->transport && device->latency_probe_topic,
+                        ESP_ERR_INVALID_STATE,
+                        TAG,
+                        "Tried to send a latency probe before MQTT connection was created");
+
+    char payload[24];
+    snprintf(payload, sizeof(payload), "%lld", (long long)hamqtt_port_time_us());
+
+    ESP_RETURN_ON_FALSE(hamqtt_transport_publish(device->transport, device->latency_probe_topic, payload, 0, 0, 0) >= 0,
+                        ESP_FAIL,
+                        TAG,
+                        "Failed to publish latency probe");
+
+    return ESP_OK;
+}
+
+void hamqtt_device_log_latency(const HAMQTT_Device *device) {
+    HAMQTT_Latency_Histogram histogram;
+
+    for (int i = 0; i < device->component_count; ++i) {
+        const char *unique_id = hamqtt_component_get_unique_id(device->components[i]);
+
+        for (int stage = 0; stage < HAMQTT_LATENCY_STAGE_PROBE_RTT; ++stage) {
+            if (hamqtt_latency_get(device->latency, i, stage, &histogram) != ESP_OK || histogram.count == 0) continue;
+
+            ESP_LOGI(TAG, "%s %s: n=%u p50<=%uus p99<=%uus max=%uus",
+                     unique_id,
+                     hamqtt_latency_stage_name(stage),
+                     (unsigned)histogram.count,
+                     (unsigned)hamqtt_latency_histogram_percentile(&histogram, 50),
+                     (unsigned)hamqtt_latency_histogram_percentile(&histogram, 99),
+                     (unsigned)histogram.max_us);
+        }
+    }
+
+    if (hamqtt_latency_get(device->latency, 0, HAMQTT_LATENCY_STAGE_PROBE_RTT, &histogram) == ESP_OK && histogram.count > 0) {
+        ESP_LOGI(TAG, "broker %s: n=%u p50<=%uus p99<=%uus max=%uus",
+                 hamqtt_latency_stage_name(HAMQTT_LATENCY_STAGE_PROBE_RTT),
+                 (unsigned)histogram.count,
+                 (unsigned)hamqtt_latency_histogram_percentile(&histogram, 50),
+                 (unsigned)hamqtt_latency_histogram_percentile(&histogram, 99),
+                 (unsigned)histogram.max_us);
+    }
+}
+#endif
+
+#if HAMQTT_DIAGNOSTICS
+void hamqtt_device_set_diagnostics_config(HAMQTT_Device *device, const HAMQTT_Diagnostics_Config *config) {
+    hamqtt_diagnostics_set_config(device->diagnostics, config);
+}
+
+void hamqtt_device_get_stats(const HAMQTT_Device *device, HAMQTT_Device_Stats *stats) {
+    hamqtt_diagnostics_get_stats(device->diagnostics, device->transport, stats);
+}
+#endif
+
+#if HAMQTT_CONSOLE
+esp_err_t hamqtt_device_get_entity_stats(const HAMQTT_Device *device, size_t component_index, HAMQTT_Entity_Stats *stats) {
+    ESP_RETURN_ON_FALSE(component_index < device->component_count,
+                        ESP_ERR_INVALID_ARG,
+                        TAG,
+                        "Component index %d is out of range",
+                        (int)component_index);
+
+    return hamqtt_console_stats_get(device->console_stats, component_index, stats);
+}
+
+void hamqtt_device_reset_entity_stats(HAMQTT_Device *device) {
+    hamqtt_console_stats_reset(device->console_stats);
+}
+#endif
+
+#if HAMQTT_PIPELINE
+esp_err_t hamqtt_device_start_pipeline(HAMQTT_Device *device, const HAMQTT_Pipeline_Config *config) {
+    ESP_RETURN_ON_FALSE(device->transport, ESP_ERR_INVALID_STATE, TAG, "Device must be connected before its pipeline starts");
+
+    return hamqtt_pipeline_start(device->pipeline, config);
+}
+
+void hamqtt_device_stop_pipeline(HAMQTT_Device *device) {
+    hamqtt_pipeline_stop(device->pipeline);
+}
+
+void hamqtt_device_get_pipeline_stats(HAMQTT_Device *device, HAMQTT_Pipeline_Stats *stats) {
+    hamqtt_pipeline_get_stats(device->pipeline, stats);
+}
+#endif
+
 bool hamqtt_device_is_config_valid(const HAMQTT_Device *device) {
     if (!device->device_config->mqtt_config_topic_prefix) return false;
     if (!device->device_config->mqtt_uri) return false;
@@ -255,14 +788,39 @@ bool hamqtt_device_is_config_valid(const HAMQTT_Device *device) {
     return true;
 }
 
-esp_err_t hamqtt_device_build_config(HAMQTT_Device *device, cJSON* root) {
-    ESP_RETURN_ON_FALSE(hamqtt_device_is_config_valid(device), ESP_ERR_INVALID_STATE, TAG, "Some required fields are missing");
+#if CONFIG_HAMQTT_COMPONENT_GROUP && CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+esp_err_t hamqtt_device_check_groups(const HAMQTT_Device *device) {
+    for (size_t i = 0; i < device->component_count; ++i) {
+        if (device->components[i]->v != &hamqtt_binary_sensor_vtable) continue;
+
+        const HAMQTT_Binary_Sensor *sensor = (const HAMQTT_Binary_Sensor *)device->components[i];
+        if (!sensor->group) continue;
+
+        bool registered = false;
+        for (size_t j = 0; j < device->component_count && !registered; ++j) {
+            registered = device->components[j] == sensor->group;
+        }
+
+        ESP_RETURN_ON_FALSE(registered,
+                            ESP_ERR_INVALID_STATE,
+                            TAG,
+                            "Binary sensor %s is in group %s, which was not added to the device",
+                            sensor->component_config->unique_id,
+                            hamqtt_component_get_unique_id(sensor->group));
+    }
+
+    return ESP_OK;
+}
+#endif
+
+esp_err_t hamqtt_device_build_topics(HAMQTT_Device *device) {
+    // Topics only depend on the unique id, keep them across reconnects instead of churning the heap
+    if (device->availability_topic) return ESP_OK;
 
     // Set availability topic
     size_t availability_topic_size = strlen(device->device_config->unique_id)
                                     + 13 /* /availability */ + 1; /* NUL */
 
-    if (device->availability_topic) free(device->availability_topic);
     device->availability_topic = malloc(availability_topic_size);
     ESP_RETURN_ON_FALSE(device->availability_topic,
                         ESP_ERR_NO_MEM,
@@ -272,6 +830,51 @@ esp_err_t hamqtt_device_build_config(HAMQTT_Device *device, cJSON* root) {
     snprintf(device->availability_topic, availability_topic_size,
              "%s/availability", device->device_config->unique_id);
 
+#if HAMQTT_LATENCY
+    size_t latency_probe_topic_size = strlen(device->device_config->unique_id)
+                                    + 14 /* /latency_probe */ + 1; /* NUL */
+
+    device->latency_probe_topic = malloc(latency_probe_topic_size);
+    if (!device->latency_probe_topic) {
+        free(device->availability_topic);
+        device->availability_topic = NULL;
+        ESP_LOGE(TAG, "Unable to allocate space for HAMQTT Device latency probe topic");
+        return ESP_ERR_NO_MEM;
+    }
+
+    snprintf(device->latency_probe_topic, latency_probe_topic_size,
+             "%s/latency_probe", device->device_config->unique_id);
+#endif
+
+#if HAMQTT_DIAGNOSTICS
+    if (hamqtt_diagnostics_build_topics(device->diagnostics, device->device_config->unique_id) != ESP_OK) {
+#if HAMQTT_LATENCY
+        free(device->latency_probe_topic);
+        device->latency_probe_topic = NULL;
+#endif
+        free(device->availability_topic);
+        device->availability_topic = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+
+#if HAMQTT_SCENE
+    if (hamqtt_scene_build_topics(device->scene, device->device_config->unique_id) != ESP_OK) {
+#if HAMQTT_LATENCY
+        free(device->latency_probe_topic);
+        device->latency_probe_topic = NULL;
+#endif
+        free(device->availability_topic);
+        device->availability_topic = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+
+    return ESP_OK;
+}
+
+#if HAMQTT_RUNTIME_DISCOVERY
+esp_err_t hamqtt_device_build_config(HAMQTT_Device *device, cJSON* root) {
     // Build HomeAssistant config
     ESP_LOGI(TAG, "Building Configuration");
 
@@ -279,21 +882,23 @@ esp_err_t hamqtt_device_build_config(HAMQTT_Device *device, cJSON* root) {
     cJSON *device_json = cJSON_CreateObject();
     cJSON_AddItemToObject(root, "device", device_json);
 
-    cJSON_AddStringToObject(device_json, "ids", device->device_config->unique_id);
-    cJSON_AddStringToObject(device_json, "name", device->device_config->name);
-    if (device->device_config->manufacturer) cJSON_AddStringToObject(device_json, "mf", device->device_config->manufacturer);
-    if (device->device_config->model) cJSON_AddStringToObject(device_json, "mdl", device->device_config->model);
-    if (device->device_config->sw_version) cJSON_AddStringToObject(device_json, "sw", device->device_config->sw_version);
-    if (device->device_config->hw_version) cJSON_AddStringToObject(device_json, "hw", device->device_config->hw_version);
-    if (device->device_config->serial_number) cJSON_AddStringToObject(device_json, "sn", device->device_config->serial_number);
+    ESP_RETURN_ON_ERROR(hamqtt_discovery_add_fields(device_json,
+                                                    device->device_config,
+                                                    device_discovery_fields,
+                                                    sizeof(device_discovery_fields) / sizeof(device_discovery_fields[0])),
+                        TAG,
+                        "Failed to add device discovery fields");
 
     // Origin Config
     cJSON *origin_json = cJSON_CreateObject();
     cJSON_AddItemToObject(root, "origin", origin_json);
 
-    cJSON_AddStringToObject(origin_json, "name", device->device_config->name);
-    if (device->device_config->sw_version) cJSON_AddStringToObject(origin_json, "sw", device->device_config->sw_version);
-    if (device->device_config->origin_url) cJSON_AddStringToObject(origin_json, "url", device->device_config->origin_url);
+    ESP_RETURN_ON_ERROR(hamqtt_discovery_add_fields(origin_json,
+                                                    device->device_config,
+                                                    origin_discovery_fields,
+                                                    sizeof(origin_discovery_fields) / sizeof(origin_discovery_fields[0])),
+                        TAG,
+                        "Failed to add origin discovery fields");
 
     // Component Config
     cJSON *components_json = cJSON_CreateObject();
@@ -309,9 +914,24 @@ esp_err_t hamqtt_device_build_config(HAMQTT_Device *device, cJSON* root) {
 
         const char *unique_id = hamqtt_component_get_unique_id(component);
 
+#if HAMQTT_ATTRIBUTES
+        if (component->attributes) {
+            ESP_RETURN_ON_ERROR(hamqtt_attributes_build_topic(component->attributes, device->device_config->unique_id, unique_id),
+                                TAG,
+                                "Failed to build attributes topic");
+            cJSON_AddStringToObject(component_json, "json_attributes_topic", hamqtt_attributes_get_topic(component->attributes));
+        }
+#endif
+
         cJSON_AddItemToObject(components_json, unique_id, component_json);
     }
 
+#if HAMQTT_DIAGNOSTICS
+    ESP_RETURN_ON_ERROR(hamqtt_diagnostics_add_discovery(device->diagnostics, components_json, device->device_config->unique_id),
+                        TAG,
+                        "Failed to add diagnostic sensors");
+#endif
+
     // Availability Config
     cJSON_AddStringToObject(root, "availability_topic", device->availability_topic);
 
@@ -319,35 +939,120 @@ esp_err_t hamqtt_device_build_config(HAMQTT_Device *device, cJSON* root) {
 
     return ESP_OK;
 }
+#endif
 
-void hamqtt_device_subscribe(const HAMQTT_Device *device) {
+void hamqtt_device_publish_discovery(const HAMQTT_Device *device, const char *payload) {
+    size_t config_topic_size = strlen(device->device_config->mqtt_config_topic_prefix)
+                            + strlen(device->device_config->unique_id)
+                            + 8 /* /device/ */ + 7 /* /config */ + 1; /* NUL */
+    
+    int clamped_config_topic_size = config_topic_size < HAMQTT_MAX_CHAR_BUF_SIZE ? config_topic_size : HAMQTT_MAX_CHAR_BUF_SIZE;
+
+    char config_topic[clamped_config_topic_size];
+    snprintf(config_topic,
+             clamped_config_topic_size,
+             "%s/device/%s/config",
+             device->device_config->mqtt_config_topic_prefix,
+             device->device_config->unique_id);
+    
+    hamqtt_transport_publish(device->transport, config_topic, payload, strlen(payload), 1, 1);
+}
+
+esp_err_t hamqtt_device_render_discovery_template(HAMQTT_Device *device, char **out) {
+    const HAMQTT_Discovery_Template *discovery = device->discovery_template;
+    const char *unique_id = device->device_config->unique_id;
+
+    // Fragments are spliced around the unique id without escaping it
+    ESP_RETURN_ON_FALSE(hamqtt_component_is_plain_id(unique_id),
+                        ESP_ERR_INVALID_ARG,
+                        TAG,
+                        "Unique id %s needs JSON escaping or holds an MQTT wildcard or '/'",
+                        unique_id);
+
+    ESP_RETURN_ON_FALSE(discovery->component_count == device->component_count,
+                        ESP_ERR_INVALID_STATE,
+                        TAG,
+                        "Discovery template describes %d components but %d were added",
+                        (int)discovery->component_count,
+                        device->component_count);
+
+    // Components still own their runtime topics, so let them build those without any JSON
     for (size_t i = 0; i < device->component_count; ++i) {
-        HAMQTT_Component *component = device->components[i];
+        ESP_RETURN_ON_ERROR(hamqtt_component_get_discovery_config(device->components[i], NULL, unique_id),
+                            TAG,
+                            "Failed to prepare topics of a component");
+
+#if HAMQTT_ATTRIBUTES
+        // The template itself must carry the json_attributes_topic this builds
+        HAMQTT_Attributes *attributes = device->components[i]->attributes;
+        if (attributes) {
+            ESP_RETURN_ON_ERROR(hamqtt_attributes_build_topic(attributes, unique_id, hamqtt_component_get_unique_id(device->components[i])),
+                                TAG,
+                                "Failed to build attributes topic");
+        }
+#endif
+    }
+
+    size_t unique_id_len = strlen(unique_id);
+    size_t payload_size = (discovery->fragment_count - 1) * unique_id_len + 1; /* NUL */
+    for (size_t i = 0; i < discovery->fragment_count; ++i) {
+        payload_size += strlen(discovery->fragments[i]);
+    }
 
-        size_t topic_count = 0;
-        const char *const *topics = hamqtt_component_get_subscribed_topics(component, &topic_count);
+    char *payload = malloc(payload_size);
+    ESP_RETURN_ON_FALSE(payload,
+                        ESP_ERR_NO_MEM,
+                        TAG,
+                        "Unable to allocate space for HAMQTT Device discovery payload");
 
-        for (size_t j = 0; j < topic_count; ++j) {
-            ESP_LOGI(TAG, "Subscribing to Topic %s", topics[j]);
-            esp_mqtt_client_subscribe_single(device->mqtt_client, topics[j], 1);
+    char *cursor = payload;
+    for (size_t i = 0; i < discovery->fragment_count; ++i) {
+        if (i > 0) {
+            memcpy(cursor, unique_id, unique_id_len);
+            cursor += unique_id_len;
         }
+
+        size_t fragment_len = strlen(discovery->fragments[i]);
+        memcpy(cursor, discovery->fragments[i], fragment_len);
+        cursor += fragment_len;
     }
+    *cursor = '\0';
+
+    *out = payload;
+
+    return ESP_OK;
 }
 
-void hamqtt_device_mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data) {
-    HAMQTT_Device *device = (HAMQTT_Device *)handler_args;
+void hamqtt_device_subscribe(const HAMQTT_Device *device) {
+    const HAMQTT_Route_Table *table = hamqtt_routes_enter(device->routes, HAMQTT_ROUTES_READER_TRANSPORT);
+
+    for (size_t i = 0; i < table->route_count; ++i) {
+        ESP_LOGI(TAG, "Subscribing to Topic %s", table->routes[i].topic);
+        hamqtt_transport_subscribe(device->transport, table->routes[i].topic, 1);
+    }
+
+    hamqtt_routes_exit(device->routes, HAMQTT_ROUTES_READER_TRANSPORT);
+}
 
-    esp_mqtt_event_handle_t event = (esp_mqtt_event_handle_t)event_data;
+#if HAMQTT_ATTRIBUTES
+void hamqtt_device_resync_attributes(const HAMQTT_Device *device) {
+    const HAMQTT_Route_Table *table = hamqtt_routes_enter(device->routes, HAMQTT_ROUTES_READER_TRANSPORT);
 
-    switch (event_id)
+    for (size_t i = 0; i < table->component_count; ++i) {
+        if (table->components[i]->attributes) hamqtt_attributes_resync(table->components[i]->attributes);
+    }
+
+    hamqtt_routes_exit(device->routes, HAMQTT_ROUTES_READER_TRANSPORT);
+}
+#endif
+
+void hamqtt_device_transport_event_handler(void *handler_args, const HAMQTT_Transport_Event *event) {
+    HAMQTT_Device *device = (HAMQTT_Device *)handler_args;
+
+    switch (event->type)
     {
-    case MQTT_EVENT_BEFORE_CONNECT:
-        ESP_LOGI(TAG, "MQTT Connecting");
-        break;
-    
-    case MQTT_EVENT_CONNECTED:
+    case HAMQTT_TRANSPORT_EVENT_CONNECTED:
         ESP_LOGI(TAG, "MQTT Connected");
-        xEventGroupSetBits(device->mqtt_event_group, MQTT_CONNECTED_BIT);
 
         ESP_LOGI(TAG, "Publishing As Available");
         hamqtt_device_publish_availability(device, true);
@@ -355,23 +1060,116 @@ void hamqtt_device_mqtt_event_handler(void *handler_args, esp_event_base_t base,
         ESP_LOGI(TAG, "Subscribing to Component Topics");
         hamqtt_device_subscribe(device);
 
+#if HAMQTT_LATENCY
+        hamqtt_transport_subscribe(device->transport, device->latency_probe_topic, 0);
+#endif
+
+#if HAMQTT_SCENE
+        hamqtt_transport_subscribe(device->transport, hamqtt_scene_get_topic(device->scene), 1);
+#endif
+
+#if HAMQTT_DIAGNOSTICS
+        hamqtt_diagnostics_handle_connected(device->diagnostics);
+#endif
+
+#if HAMQTT_ATTRIBUTES
+        // Retained attributes may have been cleared while offline, publish them all again
+        hamqtt_device_resync_attributes(device);
+#endif
+
         break; 
 
-    case MQTT_EVENT_DISCONNECTED:
+    case HAMQTT_TRANSPORT_EVENT_DISCONNECTED:
         ESP_LOGW(TAG, "MQTT Lost Connection");
-        xEventGroupClearBits(device->mqtt_event_group, MQTT_CONNECTED_BIT);
+#if HAMQTT_DIAGNOSTICS
+        hamqtt_diagnostics_handle_disconnected(device->diagnostics);
+#endif
         break;
 
-    case MQTT_EVENT_DATA:
+    case HAMQTT_TRANSPORT_EVENT_DATA:
+#if HAMQTT_DIAGNOSTICS
+        hamqtt_diagnostics_handle_message(device->diagnostics);
+#endif
         hamqtt_device_handle_mqtt_message(device, event->topic, event->topic_len, event->data, event->data_len);
         break;
 
+#if HAMQTT_LATENCY
+    case HAMQTT_TRANSPORT_EVENT_PUBLISHED:
+        hamqtt_latency_handle_ack(device->latency, event->msg_id);
+        break;
+#endif
+
     default:
         break;
     }
 }
 
+void hamqtt_device_dispatch_route(const HAMQTT_Route *route, void *context) {
+    const HAMQTT_Device_Message *message = (const HAMQTT_Device_Message *)context;
+#if HAMQTT_LATENCY || HAMQTT_CONSOLE || HAMQTT_PIPELINE
+    const HAMQTT_Device *device = message->device;
+#endif
+
+    HAMQTT_Component *component = route->component;
+#if HAMQTT_CONSOLE
+    hamqtt_console_stats_record_message(device->console_stats, route->index, message->arrival_us);
+#endif
+
+#if HAMQTT_PIPELINE
+    // While the pipeline runs, callbacks belong to the execution task
+    HAMQTT_Pipeline_Command *command = NULL;
+    esp_err_t submitted = hamqtt_pipeline_begin_submit(device->pipeline, &command);
+
+    if (submitted == ESP_OK) {
+        command->component = component;
+        command->index = route->index;
+        command->arrival_us = message->arrival_us;
+        memcpy(command->topic, message->topic, message->topic_size);
+        memcpy(command->data, message->data, message->data_size);
+        command->routed_us = hamqtt_port_time_us();
+
+        hamqtt_pipeline_end_submit(device->pipeline);
+#if HAMQTT_LATENCY
+        hamqtt_latency_record(device->latency, route->index, HAMQTT_LATENCY_STAGE_ROUTE, command->routed_us - message->arrival_us);
+#endif
+        return;
+    }
+
+    if (submitted == ESP_ERR_NO_MEM) {
+        ESP_LOGW(TAG, "Command ring is full, dropping message for %s", hamqtt_component_get_unique_id(component));
+        return;
+    }
+#endif
+    HAMQTT_TRACE_BEGIN(handle_span, "component", "handle", hamqtt_component_get_unique_id(component));
+#if HAMQTT_LATENCY
+    // Without the pipeline, handlers run inline on the transport's task, so nothing waits in a queue
+    int64_t routed_us = hamqtt_port_time_us();
+    int64_t callback_start_us = routed_us;
+    hamqtt_component_handle_mqtt_message(component, message->topic, message->data);
+    int64_t callback_end_us = hamqtt_port_time_us();
+
+    hamqtt_latency_record(device->latency, route->index, HAMQTT_LATENCY_STAGE_ROUTE, routed_us - message->arrival_us);
+    hamqtt_latency_record(device->latency, route->index, HAMQTT_LATENCY_STAGE_QUEUE_WAIT, callback_start_us - routed_us);
+    hamqtt_latency_record(device->latency, route->index, HAMQTT_LATENCY_STAGE_CALLBACK, callback_end_us - callback_start_us);
+    hamqtt_latency_record(device->latency, route->index, HAMQTT_LATENCY_STAGE_COMMAND, callback_end_us - message->arrival_us);
+#else
+    hamqtt_component_handle_mqtt_message(component, message->topic, message->data);
+#endif
+    HAMQTT_TRACE_END(handle_span);
+}
+
 void hamqtt_device_handle_mqtt_message(const HAMQTT_Device *device, const char *topic, int topic_len, const char *data, int data_len) {
+#if HAMQTT_LATENCY || HAMQTT_CONSOLE || HAMQTT_PIPELINE
+    int64_t arrival_us = hamqtt_port_time_us();
+#endif
+
+#if HAMQTT_SCENE
+    if (hamqtt_scene_is_topic(device->scene, topic, topic_len)) {
+        hamqtt_device_handle_scene_message(device, data, data_len);
+        return;
+    }
+#endif
+
     // Clamp lengths to ensure we don't exceed HAMQTT_MAX_CHAR_BUF_SIZE
     int clamped_topic_len = topic_len < (HAMQTT_MAX_CHAR_BUF_SIZE - 1) ? topic_len : (HAMQTT_MAX_CHAR_BUF_SIZE - 1);
     int clamped_data_len  = data_len  < (HAMQTT_MAX_CHAR_BUF_SIZE - 1) ? data_len  : (HAMQTT_MAX_CHAR_BUF_SIZE - 1);
@@ -386,21 +1184,113 @@ void hamqtt_device_handle_mqtt_message(const HAMQTT_Device *device, const char *
 
     memcpy(topic_str, topic, clamped_topic_len);
     memcpy(data_str, data, clamped_data_len);
+
+#if HAMQTT_LATENCY
+    // Loopback probes carry the time they were sent
+    if (device->latency_probe_topic && strcmp(topic_str, device->latency_probe_topic) == 0) {
+        hamqtt_latency_record(device->latency, 0, HAMQTT_LATENCY_STAGE_PROBE_RTT, arrival_us - strtoll(data_str, NULL, 10));
+        return;
+    }
+#endif
     
+    HAMQTT_TRACE_BEGIN(dispatch_span, "mqtt", "dispatch", topic_str);
+
     ESP_LOGI(TAG, "MQTT Event Data Received");
     ESP_LOGI(TAG, "Topic: %s", topic_str);
     ESP_LOGI(TAG, "Data: %s", data_str);
 
-    for (size_t i = 0; i < device->component_count; ++i) {
-        HAMQTT_Component *component = device->components[i];
+    HAMQTT_Device_Message message = {
+        .device = device,
+        .topic = topic_str,
+        .topic_size = sizeof(topic_str),
+        .data = data_str,
+        .data_size = sizeof(data_str),
+#if HAMQTT_LATENCY || HAMQTT_CONSOLE || HAMQTT_PIPELINE
+        .arrival_us = arrival_us,
+#endif
+    };
+
+    const HAMQTT_Route_Table *table = hamqtt_routes_enter(device->routes, HAMQTT_ROUTES_READER_TRANSPORT);
 
-        size_t topic_count = 0;
-        const char *const *topics = hamqtt_component_get_subscribed_topics(component, &topic_count);
+    hamqtt_routes_match(table, topic_str, clamped_topic_len, hamqtt_device_dispatch_route, &message);
 
-        for (size_t j = 0; j < topic_count; ++j) {
-            if (strcmp(topics[j], topic_str) == 0) {
-                hamqtt_component_handle_mqtt_message(component, topic_str, data_str);
-            }
+    hamqtt_routes_exit(device->routes, HAMQTT_ROUTES_READER_TRANSPORT);
+
+#if HAMQTT_PIPELINE
+    hamqtt_pipeline_record_routing(device->pipeline, hamqtt_port_time_us() - arrival_us);
+#endif
+
+    HAMQTT_TRACE_END(dispatch_span);
+}
+
+#if HAMQTT_SCENE
+void hamqtt_device_handle_scene_message(const HAMQTT_Device *device, const char *data, int data_len) {
+    ESP_LOGI(TAG, "MQTT Scene Received");
+
+#if HAMQTT_PIPELINE
+    HAMQTT_Pipeline_Command *command = NULL;
+    esp_err_t submitted = hamqtt_pipeline_begin_submit(device->pipeline, &command);
+
+    if (submitted == ESP_OK) {
+        // Only one scene waits at a time. A slot that is not ended is reused by the next message.
+        if (hamqtt_scene_defer(device->scene, data, data_len) != ESP_OK) {
+            ESP_LOGW(TAG, "Dropping scene");
+            return;
         }
+
+        // The slot only marks the scene's place among the commands
+        command->component = NULL;
+        command->index = 0;
+        command->arrival_us = hamqtt_port_time_us();
+        command->routed_us = command->arrival_us;
+
+        hamqtt_pipeline_end_submit(device->pipeline);
+        return;
+    }
+
+    if (submitted == ESP_ERR_NO_MEM) {
+        ESP_LOGW(TAG, "Command ring is full, dropping scene");
+        return;
     }
-}
\ No newline at end of file
+#endif
+
+    hamqtt_scene_apply(device->scene, device->routes, HAMQTT_ROUTES_READER_TRANSPORT, device->transport, data, data_len);
+}
+#endif
+
+#if HAMQTT_PIPELINE
+void hamqtt_device_execute_command(void *context, const HAMQTT_Pipeline_Command *command) {
+    HAMQTT_Device *device = (HAMQTT_Device *)context;
+
+#if HAMQTT_SCENE
+    // Scenes wait in the device, the command only says when to apply them
+    if (!command->component) {
+        HAMQTT_Transport *transport = hamqtt_pipeline_wrap_transport(device->pipeline, device->transport);
+
+        const HAMQTT_Route_Table *table = hamqtt_routes_enter(device->routes, HAMQTT_ROUTES_READER_LOOP);
+        hamqtt_scene_apply_deferred(device->scene, table, transport);
+        hamqtt_routes_exit(device->routes, HAMQTT_ROUTES_READER_LOOP);
+        return;
+    }
+#endif
+
+    HAMQTT_TRACE_BEGIN(handle_span, "component", "handle", hamqtt_component_get_unique_id(command->component));
+#if HAMQTT_LATENCY
+    int64_t callback_start_us = hamqtt_port_time_us();
+    hamqtt_component_handle_mqtt_message(command->component, command->topic, command->data);
+    int64_t callback_end_us = hamqtt_port_time_us();
+
+    hamqtt_latency_record(device->latency, command->index, HAMQTT_LATENCY_STAGE_QUEUE_WAIT, callback_start_us - command->routed_us);
+    hamqtt_latency_record(device->latency, command->index, HAMQTT_LATENCY_STAGE_CALLBACK, callback_end_us - callback_start_us);
+    hamqtt_latency_record(device->latency, command->index, HAMQTT_LATENCY_STAGE_COMMAND, callback_end_us - command->arrival_us);
+#else
+    (void)device;
+    hamqtt_component_handle_mqtt_message(command->component, command->topic, command->data);
+#endif
+    HAMQTT_TRACE_END(handle_span);
+}
+
+void hamqtt_device_pipeline_loop(void *context) {
+    hamqtt_device_loop((const HAMQTT_Device *)context);
+}
+#endif
\ No newline at end of file
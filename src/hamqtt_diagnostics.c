@@ -0,0 +1,377 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_diagnostics.c
+ * @brief Counters, loop timing and the report schedule of the diagnostic sensors.
+ *
+ * Connection and message counters are updated from the transport's event task, and the loop
+ * histogram and schedule from the task running `hamqtt_device_loop`, which is also the only
+ * task that publishes reports. Counters are atomic; the loop histogram is not, so stats read
+ * from another task may see a loop half recorded.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <stdatomic.h>
+
+#include "HAMQTT/hamqtt_diagnostics_internal.h"
+#include "HAMQTT/hamqtt_discovery_internal.h"
+#include "HAMQTT/hamqtt_transport_internal.h"
+
+/**
+ * Bucket 0 counts loops under 1 µs, bucket `i` loops in `[2^(i-1), 2^i)` µs, and the last
+ * bucket everything above it.
+ */
+#define HAMQTT_DIAGNOSTICS_LOOP_BUCKETS 20
+
+static const char *TAG = "HAMQTT_Diagnostics";
+
+HAMQTT_Diagnostics_Config hamqtt_diagnostics_config_default(void) {
+    HAMQTT_Diagnostics_Config config = {
+        .interval_ms = 60 * 1000,
+        .jitter_pct = 20,
+        .heartbeat_ms = 10 * 60 * 1000,
+        .heap_deadband_bytes = 1024,
+        .outbox_deadband_bytes = 1024,
+        .loop_deadband_us = 1000,
+        .enabled_by_default = true,
+    };
+    return config;
+}
+
+/**
+ * @brief A diagnostic sensor, read from one key of the shared state payload.
+ */
+typedef struct {
+    const char *key;
+    const char *name;
+    const char *device_class;
+    const char *state_class;
+    const char *unit_of_measurement;
+    const char *icon;
+} HAMQTT_Diagnostics_Entity;
+
+static const HAMQTT_Diagnostics_Entity diagnostics_entities[] = {
+    { "uptime", "Uptime", "duration", "total_increasing", "s", NULL },
+    { "heap_free", "Free Heap", "data_size", "measurement", "B", "mdi:memory" },
+    { "heap_min_free", "Minimum Free Heap", "data_size", "measurement", "B", "mdi:memory" },
+    { "reconnects", "MQTT Reconnects", NULL, "total_increasing", NULL, "mdi:lan-disconnect" },
+    { "publishes", "MQTT Publishes", NULL, "total_increasing", NULL, "mdi:upload-network" },
+    { "publish_failures", "MQTT Publish Failures", NULL, "total_increasing", NULL, "mdi:alert-circle" },
+    { "loop_p99", "Loop p99", "duration", "measurement", "ms", "mdi:timer-outline" },
+    { "outbox", "MQTT Outbox", "data_size", "measurement", "B", "mdi:tray-full" },
+};
+
+#if HAMQTT_RUNTIME_DISCOVERY
+static const HAMQTT_Discovery_Field diagnostics_entity_discovery_fields[] = {
+    HAMQTT_DISCOVERY_STRING("name", HAMQTT_Diagnostics_Entity, name),
+    HAMQTT_DISCOVERY_STRING("device_class", HAMQTT_Diagnostics_Entity, device_class),
+    HAMQTT_DISCOVERY_STRING("state_class", HAMQTT_Diagnostics_Entity, state_class),
+    HAMQTT_DISCOVERY_STRING("unit_of_measurement", HAMQTT_Diagnostics_Entity, unit_of_measurement),
+    HAMQTT_DISCOVERY_STRING("icon", HAMQTT_Diagnostics_Entity, icon),
+};
+#endif
+
+struct HAMQTT_Diagnostics {
+    HAMQTT_Diagnostics_Config config;
+    char *state_topic;
+    int64_t created_us;
+
+    atomic_uint_least32_t connects;
+    atomic_uint_least32_t reconnects;
+    atomic_uint_least32_t disconnects;
+    atomic_uint_least32_t messages_received;
+    atomic_bool connection_lost;
+    atomic_bool stopping;
+    atomic_bool report_pending;
+
+    uint32_t loop_buckets[HAMQTT_DIAGNOSTICS_LOOP_BUCKETS];
+    uint32_t loop_count;
+    uint32_t loop_max_us;
+
+    uint32_t diagnostics_publishes;
+    bool reported;
+    int64_t next_check_us;
+    int64_t last_report_us;
+    HAMQTT_Device_Stats last_report;
+};
+
+/* ----- Private HAMQTT Diagnostics function definitions ----- */
+
+static void hamqtt_diagnostics_record_loop(HAMQTT_Diagnostics *diagnostics, int64_t us) {
+    uint32_t value = us < 0 ? 0 : (us > UINT32_MAX ? UINT32_MAX : (uint32_t)us);
+
+    size_t bucket = 0;
+    while (bucket < HAMQTT_DIAGNOSTICS_LOOP_BUCKETS - 1 && value >= (1U << bucket)) bucket++;
+
+    diagnostics->loop_buckets[bucket]++;
+    diagnostics->loop_count++;
+    if (value > diagnostics->loop_max_us) diagnostics->loop_max_us = value;
+}
+
+static uint32_t hamqtt_diagnostics_loop_p99(const HAMQTT_Diagnostics *diagnostics) {
+    if (diagnostics->loop_count == 0) return 0;
+
+    uint64_t rank = ((uint64_t)diagnostics->loop_count * 99 + 99) / 100;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HAMQTT_DIAGNOSTICS_LOOP_BUCKETS - 1; ++i) {
+        seen += diagnostics->loop_buckets[i];
+        if (seen >= rank) {
+            uint32_t upper = 1U << i;
+            return upper < diagnostics->loop_max_us ? upper : diagnostics->loop_max_us;
+        }
+    }
+
+    return diagnostics->loop_max_us;
+}
+
+/**
+ * @brief The interval until the next check, lengthened or shortened by a random jitter.
+ */
+static int64_t hamqtt_diagnostics_jittered_interval_us(const HAMQTT_Diagnostics *diagnostics) {
+    int64_t interval_us = (int64_t)diagnostics->config.interval_ms * 1000;
+    int64_t jitter_pct = diagnostics->config.jitter_pct > 100 ? 100 : diagnostics->config.jitter_pct;
+
+    if (jitter_pct == 0) return interval_us;
+
+    // Spread over [-jitter, +jitter] in steps of 0.01 %
+    int64_t span = 2 * jitter_pct * 100 + 1;
+    int64_t offset = (int64_t)(hamqtt_port_random() % (uint32_t)span) - jitter_pct * 100;
+
+    return interval_us + interval_us * offset / 10000;
+}
+
+static bool hamqtt_diagnostics_moved(uint64_t last, uint64_t current, uint32_t deadband) {
+    uint64_t delta = current > last ? current - last : last - current;
+    return delta >= (deadband ? deadband : 1);
+}
+
+/**
+ * @brief Whether any value moved past its deadband since the last report.
+ *
+ * Counters that only ever grow, such as publishes and uptime, are left to the heartbeat.
+ */
+static bool hamqtt_diagnostics_changed(const HAMQTT_Diagnostics *diagnostics, const HAMQTT_Device_Stats *stats) {
+    const HAMQTT_Device_Stats *last = &diagnostics->last_report;
+    const HAMQTT_Diagnostics_Config *config = &diagnostics->config;
+
+    if (stats->reconnects != last->reconnects) return true;
+    if (stats->publish_failures != last->publish_failures) return true;
+    if (hamqtt_diagnostics_moved(last->heap_free, stats->heap_free, config->heap_deadband_bytes)) return true;
+    if (hamqtt_diagnostics_moved(last->heap_min_free, stats->heap_min_free, config->heap_deadband_bytes)) return true;
+    if (hamqtt_diagnostics_moved(last->loop_p99_us, stats->loop_p99_us, config->loop_deadband_us)) return true;
+
+    if ((stats->outbox_bytes < 0) != (last->outbox_bytes < 0)) return true;
+    if (stats->outbox_bytes >= 0 &&
+        hamqtt_diagnostics_moved(last->outbox_bytes, stats->outbox_bytes, config->outbox_deadband_bytes)) return true;
+
+    return false;
+}
+
+static int hamqtt_diagnostics_format(const HAMQTT_Device_Stats *stats, char *out, size_t out_size) {
+    char outbox[16];
+    if (stats->outbox_bytes >= 0) {
+        snprintf(outbox, sizeof(outbox), "%d", stats->outbox_bytes);
+    } else {
+        // Renders as None in the value template, which Home Assistant shows as unknown
+        snprintf(outbox, sizeof(outbox), "null");
+    }
+
+    return snprintf(out, out_size,
+                    "{\"uptime\":%llu,\"heap_free\":%zu,\"heap_min_free\":%zu,\"reconnects\":%u,"
+                    "\"publishes\":%u,\"publish_failures\":%u,\"loop_p99\":%u.%03u,\"outbox\":%s}",
+                    (unsigned long long)(stats->uptime_ms / 1000),
+                    stats->heap_free,
+                    stats->heap_min_free,
+                    (unsigned)stats->reconnects,
+                    (unsigned)stats->publishes,
+                    (unsigned)stats->publish_failures,
+                    (unsigned)(stats->loop_p99_us / 1000),
+                    (unsigned)(stats->loop_p99_us % 1000),
+                    outbox);
+}
+
+/* ----- HAMQTT Diagnostics function definitions ----- */
+
+HAMQTT_Diagnostics *hamqtt_diagnostics_create(void) {
+    HAMQTT_Diagnostics *diagnostics = calloc(1, sizeof(HAMQTT_Diagnostics));
+    if (!diagnostics) {
+        ESP_LOGE(TAG, "Unable to allocate space for diagnostics");
+        return NULL;
+    }
+
+    diagnostics->config = hamqtt_diagnostics_config_default();
+    diagnostics->created_us = hamqtt_port_time_us();
+
+    return diagnostics;
+}
+
+void hamqtt_diagnostics_destroy(HAMQTT_Diagnostics *diagnostics) {
+    if (!diagnostics) return;
+
+    free(diagnostics->state_topic);
+    free(diagnostics);
+}
+
+void hamqtt_diagnostics_set_config(HAMQTT_Diagnostics *diagnostics, const HAMQTT_Diagnostics_Config *config) {
+    diagnostics->config = *config;
+    diagnostics->next_check_us = 0;
+}
+
+esp_err_t hamqtt_diagnostics_build_topics(HAMQTT_Diagnostics *diagnostics, const char *device_unique_id) {
+    if (diagnostics->state_topic) return ESP_OK;
+
+    size_t state_topic_size = strlen(device_unique_id)
+                            + 18 /* /diagnostics/state */ + 1; /* NUL */
+
+    diagnostics->state_topic = malloc(state_topic_size);
+    ESP_RETURN_ON_FALSE(diagnostics->state_topic,
+                        ESP_ERR_NO_MEM,
+                        TAG,
+                        "Unable to allocate space for diagnostics state topic");
+
+    snprintf(diagnostics->state_topic, state_topic_size, "%s/diagnostics/state", device_unique_id);
+
+    return ESP_OK;
+}
+
+#if HAMQTT_RUNTIME_DISCOVERY
+esp_err_t hamqtt_diagnostics_add_discovery(const HAMQTT_Diagnostics *diagnostics, cJSON *components, const char *device_unique_id) {
+    if (diagnostics->config.interval_ms == 0) return ESP_OK;
+
+    char unique_id[HAMQTT_MAX_CHAR_BUF_SIZE];
+    char value_template[64];
+
+    for (size_t i = 0; i < sizeof(diagnostics_entities) / sizeof(diagnostics_entities[0]); ++i) {
+        const HAMQTT_Diagnostics_Entity *entity = &diagnostics_entities[i];
+
+        cJSON *entity_json = cJSON_CreateObject();
+        ESP_RETURN_ON_FALSE(entity_json, ESP_ERR_NO_MEM, TAG, "Unable to allocate diagnostic sensor configuration");
+
+        snprintf(unique_id, sizeof(unique_id), "%s_diag_%s", device_unique_id, entity->key);
+        snprintf(value_template, sizeof(value_template), "{{ value_json.%s }}", entity->key);
+
+        cJSON_AddStringToObject(entity_json, "p", "sensor");
+        cJSON_AddStringToObject(entity_json, "unique_id", unique_id);
+        cJSON_AddStringToObject(entity_json, "state_topic", diagnostics->state_topic);
+        cJSON_AddStringToObject(entity_json, "value_template", value_template);
+        cJSON_AddStringToObject(entity_json, "entity_category", "diagnostic");
+        if (!diagnostics->config.enabled_by_default) cJSON_AddBoolToObject(entity_json, "enabled_by_default", false);
+
+        cJSON_AddItemToObject(components, unique_id, entity_json);
+
+        ESP_RETURN_ON_ERROR(hamqtt_discovery_add_fields(entity_json,
+                                                        entity,
+                                                        diagnostics_entity_discovery_fields,
+                                                        sizeof(diagnostics_entity_discovery_fields) / sizeof(diagnostics_entity_discovery_fields[0])),
+                            TAG,
+                            "Failed to add diagnostic sensor discovery fields");
+    }
+
+    return ESP_OK;
+}
+#endif
+
+void hamqtt_diagnostics_handle_connected(HAMQTT_Diagnostics *diagnostics) {
+    atomic_fetch_add_explicit(&diagnostics->connects, 1, memory_order_relaxed);
+    if (atomic_exchange(&diagnostics->connection_lost, false)) {
+        atomic_fetch_add_explicit(&diagnostics->reconnects, 1, memory_order_relaxed);
+    }
+
+    atomic_store(&diagnostics->stopping, false);
+    atomic_store(&diagnostics->report_pending, true);
+}
+
+void hamqtt_diagnostics_handle_disconnected(HAMQTT_Diagnostics *diagnostics) {
+    if (atomic_exchange(&diagnostics->stopping, false)) return;
+
+    if (!atomic_exchange(&diagnostics->connection_lost, true)) {
+        atomic_fetch_add_explicit(&diagnostics->disconnects, 1, memory_order_relaxed);
+    }
+}
+
+void hamqtt_diagnostics_handle_stop(HAMQTT_Diagnostics *diagnostics) {
+    atomic_store(&diagnostics->stopping, true);
+    atomic_store(&diagnostics->connection_lost, false);
+}
+
+void hamqtt_diagnostics_handle_message(HAMQTT_Diagnostics *diagnostics) {
+    atomic_fetch_add_explicit(&diagnostics->messages_received, 1, memory_order_relaxed);
+}
+
+void hamqtt_diagnostics_update(HAMQTT_Diagnostics *diagnostics, HAMQTT_Transport *transport, int64_t loop_us) {
+    hamqtt_diagnostics_record_loop(diagnostics, loop_us);
+
+    if (diagnostics->config.interval_ms == 0 || !diagnostics->state_topic) return;
+
+    int64_t now_us = hamqtt_port_time_us();
+
+    // A new connection is reported on the next loop, so the retained state is current
+    bool connected = atomic_exchange(&diagnostics->report_pending, false);
+    if (!connected && now_us < diagnostics->next_check_us) return;
+
+    diagnostics->next_check_us = now_us + hamqtt_diagnostics_jittered_interval_us(diagnostics);
+
+    HAMQTT_Device_Stats stats;
+    hamqtt_diagnostics_get_stats(diagnostics, transport, &stats);
+
+    bool heartbeat = now_us - diagnostics->last_report_us >= (int64_t)diagnostics->config.heartbeat_ms * 1000;
+    if (diagnostics->reported && !connected && !heartbeat && !hamqtt_diagnostics_changed(diagnostics, &stats)) return;
+
+    char payload[256];
+    int len = hamqtt_diagnostics_format(&stats, payload, sizeof(payload));
+
+    if (hamqtt_transport_publish(transport, diagnostics->state_topic, payload, len, 0, 1) < 0) {
+        ESP_LOGW(TAG, "Failed to publish diagnostics");
+        return;
+    }
+
+    diagnostics->diagnostics_publishes++;
+    diagnostics->reported = true;
+    diagnostics->last_report_us = now_us;
+    diagnostics->last_report = stats;
+
+    // Start a new loop window
+    memset(diagnostics->loop_buckets, 0, sizeof(diagnostics->loop_buckets));
+    diagnostics->loop_count = 0;
+    diagnostics->loop_max_us = 0;
+}
+
+void hamqtt_diagnostics_get_stats(const HAMQTT_Diagnostics *diagnostics, HAMQTT_Transport *transport, HAMQTT_Device_Stats *stats) {
+    *stats = (HAMQTT_Device_Stats){
+        .uptime_ms = (uint64_t)(hamqtt_port_time_us() - diagnostics->created_us) / 1000,
+        .connects = atomic_load_explicit(&diagnostics->connects, memory_order_relaxed),
+        .reconnects = atomic_load_explicit(&diagnostics->reconnects, memory_order_relaxed),
+        .disconnects = atomic_load_explicit(&diagnostics->disconnects, memory_order_relaxed),
+        .messages_received = atomic_load_explicit(&diagnostics->messages_received, memory_order_relaxed),
+        .diagnostics_publishes = diagnostics->diagnostics_publishes,
+        .loops = diagnostics->loop_count,
+        .loop_p99_us = hamqtt_diagnostics_loop_p99(diagnostics),
+        .loop_max_us = diagnostics->loop_max_us,
+        .heap_free = hamqtt_port_heap_free(),
+        .heap_min_free = hamqtt_port_heap_min_free(),
+        .outbox_bytes = -1,
+    };
+
+    if (transport) {
+        hamqtt_transport_get_publish_counts(transport, &stats->publishes, &stats->publish_failures);
+        stats->outbox_bytes = hamqtt_transport_get_outbox_size(transport);
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_discovery.c
+ * @brief Generic emitter for table-driven discovery fields.
+ *
+ * Implements the interface declared in @ref hamqtt_discovery_internal.h.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include "HAMQTT/hamqtt_discovery_internal.h"
+
+static const char *TAG = "HAMQTT_Discovery";
+
+esp_err_t hamqtt_discovery_add_fields(cJSON *root,
+                                      const void *config,
+                                      const HAMQTT_Discovery_Field *fields,
+                                      size_t field_count) {
+    const char *base = (const char *)config;
+
+    for (size_t i = 0; i < field_count; ++i) {
+        const HAMQTT_Discovery_Field *field = &fields[i];
+        const void *value = base + field->offset;
+        cJSON *item = NULL;
+
+        switch (field->type) {
+        case HAMQTT_DISCOVERY_FIELD_STRING: {
+            const char *str = *(const char *const *)value;
+            if (!str) continue;
+            item = cJSON_AddStringToObject(root, field->key, str);
+            break;
+        }
+
+        case HAMQTT_DISCOVERY_FIELD_BOOL: {
+            bool b = *(const bool *)value;
+            if ((int)b == field->omit_value) continue;
+            item = cJSON_AddBoolToObject(root, field->key, b);
+            break;
+        }
+
+        case HAMQTT_DISCOVERY_FIELD_INT: {
+            int n = *(const int *)value;
+            if (n == field->omit_value) continue;
+            item = cJSON_AddNumberToObject(root, field->key, n);
+            break;
+        }
+
+        default:
+            continue;
+        }
+
+        ESP_RETURN_ON_FALSE(item,
+                            ESP_ERR_NO_MEM,
+                            TAG,
+                            "Unable to add discovery field %s",
+                            field->key);
+    }
+
+    return ESP_OK;
+}
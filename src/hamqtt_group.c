@@ -0,0 +1,367 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_group.c
+ * @brief Implementation of the HAMQTT_Group component.
+ *
+ * Contains the command fan-out to members and the combined state report of the member
+ * binary sensors.
+ *
+ * Implements the interface defined in @ref hamqtt_group.h.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include "HAMQTT/hamqtt_group.h"
+#include "HAMQTT/hamqtt_component_internal.h"
+#include "HAMQTT/hamqtt_discovery_internal.h"
+
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+#include "HAMQTT/hamqtt_binary_sensor.h"
+#endif
+
+static const char *TAG = "HAMQTT_Group";
+
+struct HAMQTT_Group {
+    HAMQTT_Component base;
+
+    const HAMQTT_Group_Config *component_config;
+
+    HAMQTT_Component **members;
+    size_t member_count;
+
+    char *command_topic;
+    char *state_topic;
+    const char *subscribed_topics[1];
+
+    // Combined report of the member binary sensors, sized for all of them when created
+    char *state_payload;
+    size_t state_payload_size;
+    bool has_state_members;
+};
+
+HAMQTT_Group_Config hamqtt_group_config_default(void) {
+    HAMQTT_Group_Config config = {
+        .enabled_by_default = true,
+        .entity_picture = NULL,
+        .icon = NULL,
+        .name = "ESP32 Group",
+        .unique_id = NULL,
+    };
+    return config;
+}
+
+/* ----- Private HAMQTT Group function declarations ----- */
+
+/**
+ * @brief Validates that the minimum required fields are populated in the configuration.
+ *
+ * Required fields: `name` and `unique_id`.
+ *
+ * @param group The group to validate.
+ * @return true if valid, false otherwise.
+ */
+static bool hamqtt_group_is_config_valid(const HAMQTT_Group *group);
+
+/**
+ * @brief Build a "<device>/<group>/<suffix>" topic.
+ */
+static char *hamqtt_group_build_topic(const HAMQTT_Group *group, const char *device_unique_id, const char *suffix);
+
+/* ----- Discovery fields ----- */
+
+#if HAMQTT_RUNTIME_DISCOVERY
+static const HAMQTT_Discovery_Field group_discovery_fields[] = {
+    HAMQTT_DISCOVERY_STRING("name", HAMQTT_Group_Config, name),
+    HAMQTT_DISCOVERY_STRING("unique_id", HAMQTT_Group_Config, unique_id),
+    HAMQTT_DISCOVERY_BOOL("enabled_by_default", HAMQTT_Group_Config, enabled_by_default, true),
+    HAMQTT_DISCOVERY_STRING("entity_picture", HAMQTT_Group_Config, entity_picture),
+    HAMQTT_DISCOVERY_STRING("icon", HAMQTT_Group_Config, icon),
+};
+#endif
+
+/* ----- Virtual Methods ----- */
+
+static esp_err_t hamqtt_group_get_discovery_config(HAMQTT_Component *component,
+                                                   cJSON *root,
+                                                   const char *device_unique_id) {
+    HAMQTT_Group *group = (HAMQTT_Group *)component;
+
+    ESP_RETURN_ON_FALSE(hamqtt_group_is_config_valid(group),
+                        ESP_ERR_INVALID_STATE,
+                        TAG,
+                        "Group was used despite config missing required fields");
+
+    // The topics only depend on the unique ids, so keep them across reconnects. Messages may be
+    // matched against the command topic on the transport's task.
+    if (!group->command_topic) {
+        char *command_topic = hamqtt_group_build_topic(group, device_unique_id, "set");
+        ESP_RETURN_ON_FALSE(command_topic,
+                            ESP_ERR_NO_MEM,
+                            TAG,
+                            "Unable to allocate space for HAMQTT Group command topic");
+
+        group->command_topic = command_topic;
+        group->subscribed_topics[0] = command_topic;
+    }
+
+    if (!group->state_topic && group->has_state_members) {
+        group->state_topic = hamqtt_group_build_topic(group, device_unique_id, "state");
+        ESP_RETURN_ON_FALSE(group->state_topic,
+                            ESP_ERR_NO_MEM,
+                            TAG,
+                            "Unable to allocate space for HAMQTT Group state topic");
+    }
+
+    // Only the topics are needed when the discovery payload was precomputed
+    if (!root) return ESP_OK;
+
+#if HAMQTT_RUNTIME_DISCOVERY
+    // Build configuration on root. Home Assistant sees the group as a button.
+    cJSON_AddStringToObject(root, "p", "button");
+    cJSON_AddStringToObject(root, "command_topic", group->command_topic);
+
+    ESP_RETURN_ON_ERROR(hamqtt_discovery_add_fields(root,
+                                                    group->component_config,
+                                                    group_discovery_fields,
+                                                    sizeof(group_discovery_fields) / sizeof(group_discovery_fields[0])),
+                        TAG,
+                        "Failed to add group discovery fields");
+#endif
+
+    return ESP_OK;
+}
+
+static void hamqtt_group_handle_mqtt_message(HAMQTT_Component *component,
+                                             const char *topic,
+                                             const char *data) {
+    HAMQTT_Group *group = (HAMQTT_Group *)component;
+
+    if (!group->command_topic) return;
+
+    if (strcmp(topic, group->command_topic) != 0) return; // Sanity check
+
+    // One pass over the members, each handed the command as if it arrived on its own topic
+    for (size_t i = 0; i < group->member_count; ++i) {
+        HAMQTT_Component *member = group->members[i];
+
+        size_t topic_count = 0;
+        const char *const *topics = hamqtt_component_get_subscribed_topics(member, &topic_count);
+        if (topic_count == 0 || !topics[0]) continue;
+
+        hamqtt_component_handle_mqtt_message(member, topics[0], data);
+    }
+}
+
+static void hamqtt_group_update(HAMQTT_Component *component,
+                                HAMQTT_Transport *transport) {
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+    HAMQTT_Group *group = (HAMQTT_Group *)component;
+
+    if (!group->has_state_members || !group->state_topic) return;
+
+    // Sample every member, so each one's rules still run, and report them all if any changed
+    bool changed = false;
+    for (size_t i = 0; i < group->member_count; ++i) {
+        if (group->members[i]->v != &hamqtt_binary_sensor_vtable) continue;
+        if (hamqtt_binary_sensor_poll((HAMQTT_Binary_Sensor *)group->members[i])) changed = true;
+    }
+
+    if (!changed) return;
+
+    char *cursor = group->state_payload;
+    char *end = group->state_payload + group->state_payload_size;
+    *cursor++ = '{';
+
+    for (size_t i = 0; i < group->member_count; ++i) {
+        if (group->members[i]->v != &hamqtt_binary_sensor_vtable) continue;
+        HAMQTT_Binary_Sensor *sensor = (HAMQTT_Binary_Sensor *)group->members[i];
+
+        cursor += snprintf(cursor, end - cursor, "%s\"%s\":\"%s\"",
+                           cursor == group->state_payload + 1 ? "" : ",",
+                           sensor->component_config->unique_id,
+                           sensor->previous_state ? "ON" : "OFF");
+    }
+
+    snprintf(cursor, end - cursor, "}");
+
+    hamqtt_transport_publish(transport, group->state_topic, group->state_payload, 0, 1, 1);
+#endif
+}
+
+static const char *hamqtt_group_get_unique_id(HAMQTT_Component *component) {
+    HAMQTT_Group *group = (HAMQTT_Group *)component;
+
+    return group->component_config->unique_id;
+}
+
+static const char *const *hamqtt_group_get_subscribed_topics(HAMQTT_Component *component, size_t *count) {
+    HAMQTT_Group *group = (HAMQTT_Group *)component;
+
+    *count = 1;
+
+    return group->subscribed_topics;
+}
+
+/* ----- V-Table ----- */
+const HAMQTT_Component_VTable hamqtt_group_vtable = {
+    .get_discovery_config = hamqtt_group_get_discovery_config,
+    .handle_mqtt_message = hamqtt_group_handle_mqtt_message,
+    .update = hamqtt_group_update,
+    .get_unique_id = hamqtt_group_get_unique_id,
+    .get_subscribed_topics = hamqtt_group_get_subscribed_topics
+};
+
+/* ----- HAMQTT Group function definitions ----- */
+
+static bool hamqtt_group_is_config_valid(const HAMQTT_Group *group) {
+    if (!group->component_config->name) return false;
+    if (!group->component_config->unique_id) return false;
+
+    return true;
+}
+
+static char *hamqtt_group_build_topic(const HAMQTT_Group *group, const char *device_unique_id, const char *suffix) {
+    size_t topic_size = strlen(device_unique_id)
+                      + strlen(group->component_config->unique_id)
+                      + strlen(suffix)
+                      + 2 /* slashes */
+                      + 1; /* NUL */
+
+    char *topic = malloc(topic_size);
+    if (!topic) return NULL;
+
+    snprintf(topic, topic_size, "%s/%s/%s", device_unique_id, group->component_config->unique_id, suffix);
+
+    return topic;
+}
+
+HAMQTT_Group *hamqtt_group_create(const HAMQTT_Group_Config *config, HAMQTT_Component *const *members, size_t member_count) {
+    HAMQTT_Group *group = calloc(1, sizeof(HAMQTT_Group));
+    if (!group) {
+        ESP_LOGE(TAG, "Unable to allocate space for HAMQTT Group");
+        return NULL;
+    }
+
+    group->base.v = &hamqtt_group_vtable;
+    group->component_config = config;
+
+    if (!hamqtt_group_is_config_valid(group)) {
+        ESP_LOGE(TAG, "Group config is missing required fields");
+        free(group);
+        return NULL;
+    }
+
+    if (member_count == 0) {
+        ESP_LOGE(TAG, "Group %s has no members", config->unique_id);
+        free(group);
+        return NULL;
+    }
+
+    group->members = malloc(member_count * sizeof *group->members);
+    if (!group->members) {
+        ESP_LOGE(TAG, "Unable to allocate space for HAMQTT Group members");
+        free(group);
+        return NULL;
+    }
+
+    size_t state_payload_size = 2 /* braces */ + 1; /* NUL */
+
+    for (size_t i = 0; i < member_count; ++i) {
+        if (!members[i]) {
+            ESP_LOGE(TAG, "Group member %d was not initialized", (int)i);
+            hamqtt_group_destroy(group);
+            return NULL;
+        }
+
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+        if (members[i]->v == &hamqtt_binary_sensor_vtable) {
+            HAMQTT_Binary_Sensor *sensor = (HAMQTT_Binary_Sensor *)members[i];
+
+            if (sensor->group) {
+                ESP_LOGE(TAG, "Binary sensor %s is already in a group", sensor->component_config->unique_id);
+                hamqtt_group_destroy(group);
+                return NULL;
+            }
+
+            // Its own state topic was already announced, and its device would keep publishing there
+            if (sensor->state_topic) {
+                ESP_LOGE(TAG, "Binary sensor %s must be grouped before its device connects",
+                         sensor->component_config->unique_id);
+                hamqtt_group_destroy(group);
+                return NULL;
+            }
+
+            // The id is written into the report and the single quoted value template unescaped
+            if (!hamqtt_component_is_plain_id(sensor->component_config->unique_id)
+                || strchr(sensor->component_config->unique_id, '\'')) {
+                ESP_LOGE(TAG, "Binary sensor %s cannot be reported by a group, its unique id needs escaping",
+                         sensor->component_config->unique_id);
+                hamqtt_group_destroy(group);
+                return NULL;
+            }
+
+            sensor->group = &group->base;
+            group->has_state_members = true;
+            state_payload_size += strlen(sensor->component_config->unique_id)
+                                + 9; /* "":"OFF", */
+        }
+#endif
+
+        group->members[group->member_count++] = members[i];
+    }
+
+    if (group->has_state_members) {
+        group->state_payload = malloc(state_payload_size);
+        group->state_payload_size = state_payload_size;
+        if (!group->state_payload) {
+            ESP_LOGE(TAG, "Unable to allocate space for HAMQTT Group state");
+            hamqtt_group_destroy(group);
+            return NULL;
+        }
+    }
+
+    return group;
+}
+
+void hamqtt_group_destroy(HAMQTT_Group *group) {
+    if (!group) return;
+
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+    for (size_t i = 0; i < group->member_count; ++i) {
+        if (group->members[i]->v != &hamqtt_binary_sensor_vtable) continue;
+        HAMQTT_Binary_Sensor *sensor = (HAMQTT_Binary_Sensor *)group->members[i];
+
+        // Drop the group's state topic so the next connect announces the sensor's own
+        sensor->group = NULL;
+        free(sensor->state_topic);
+        sensor->state_topic = NULL;
+    }
+#endif
+
+    free(group->members);
+    free(group->command_topic);
+    free(group->state_topic);
+    free(group->state_payload);
+    free(group);
+}
+
+const HAMQTT_Group_Config *hamqtt_group_get_config(const HAMQTT_Group *group) {
+    return group->component_config;
+}
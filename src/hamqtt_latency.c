@@ -0,0 +1,299 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_latency.c
+ * @brief Latency histograms and the publish/PUBACK matching used by HAMQTT_Device.
+ *
+ * Inbound stages and PUBACKs are recorded from the transport's event task, and publishes
+ * from the task running `hamqtt_device_loop`. Publishes are matched to their PUBACK through
+ * a small table of atomic slots indexed by message id, so neither side takes a lock. A
+ * PUBACK can arrive before the publish call has returned its message id, so whichever side
+ * gets there second records the sample. Readers may see a sample half applied.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <stdatomic.h>
+
+#include "HAMQTT/hamqtt_latency_internal.h"
+#include "HAMQTT/hamqtt_transport_internal.h"
+
+#define HAMQTT_LATENCY_PENDING_SLOTS 32
+
+static const char *TAG = "HAMQTT_Latency";
+
+static const char *const stage_names[HAMQTT_LATENCY_STAGE_COUNT] = {
+    [HAMQTT_LATENCY_STAGE_ROUTE] = "route",
+    [HAMQTT_LATENCY_STAGE_QUEUE_WAIT] = "queue_wait",
+    [HAMQTT_LATENCY_STAGE_CALLBACK] = "callback",
+    [HAMQTT_LATENCY_STAGE_COMMAND] = "command",
+    [HAMQTT_LATENCY_STAGE_PUBLISH_ACK] = "publish_ack",
+    [HAMQTT_LATENCY_STAGE_PROBE_RTT] = "probe_rtt",
+};
+
+/**
+ * @brief A publish waiting for its PUBACK, or a PUBACK waiting for its publish.
+ *
+ * `msg_id` is set once the publish is known and `acked_id` once the PUBACK is, each after the
+ * fields it guards. The side that swaps `msg_id` back to 0 records the sample.
+ */
+typedef struct {
+    atomic_int msg_id;
+    size_t entity;
+    int64_t published_us;
+
+    atomic_int acked_id;
+    int64_t acked_us;
+} HAMQTT_Latency_Pending;
+
+typedef struct {
+    HAMQTT_Transport base;
+    HAMQTT_Transport *inner;
+    HAMQTT_Latency *latency;
+} HAMQTT_Latency_Transport;
+
+struct HAMQTT_Latency {
+    size_t entity_count;
+    HAMQTT_Latency_Histogram *histograms;   // entity_count rows of HAMQTT_LATENCY_STAGE_COUNT
+    HAMQTT_Latency_Histogram probe;
+
+    HAMQTT_Latency_Transport transport;
+    size_t publisher;
+    HAMQTT_Latency_Pending pending[HAMQTT_LATENCY_PENDING_SLOTS];
+
+    int64_t last_probe_us;
+};
+
+/* ----- Histograms ----- */
+
+void hamqtt_latency_histogram_add(HAMQTT_Latency_Histogram *histogram, int64_t us) {
+    uint32_t value = us < 0 ? 0 : (us > UINT32_MAX ? UINT32_MAX : (uint32_t)us);
+
+    size_t bucket = 0;
+    while (bucket < HAMQTT_LATENCY_BUCKETS - 1 && value >= (1U << bucket)) bucket++;
+
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->total_us += value;
+    if (value > histogram->max_us) histogram->max_us = value;
+}
+
+uint32_t hamqtt_latency_histogram_percentile(const HAMQTT_Latency_Histogram *histogram, double p) {
+    if (histogram->count == 0) return 0;
+
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)histogram->count + 0.5);
+    if (rank < 1) rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HAMQTT_LATENCY_BUCKETS - 1; ++i) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            uint32_t upper = 1U << i;
+            return upper < histogram->max_us ? upper : histogram->max_us;
+        }
+    }
+
+    return histogram->max_us;
+}
+
+const char *hamqtt_latency_stage_name(HAMQTT_Latency_Stage stage) {
+    return stage < HAMQTT_LATENCY_STAGE_COUNT ? stage_names[stage] : "unknown";
+}
+
+/* ----- Wrapped transport ----- */
+
+static void hamqtt_latency_track_publish(HAMQTT_Latency *latency, int msg_id, int64_t published_us) {
+    if (msg_id <= 0) return;
+
+    HAMQTT_Latency_Pending *slot = &latency->pending[msg_id % HAMQTT_LATENCY_PENDING_SLOTS];
+
+    // An older publish still in the slot has waited too long to be worth measuring
+    slot->entity = latency->publisher;
+    slot->published_us = published_us;
+    atomic_store(&slot->msg_id, msg_id);
+
+    if (atomic_load(&slot->acked_id) != msg_id) return;
+
+    int expected = msg_id;
+    if (!atomic_compare_exchange_strong(&slot->msg_id, &expected, 0)) return;
+
+    hamqtt_latency_record(latency, slot->entity, HAMQTT_LATENCY_STAGE_PUBLISH_ACK, slot->acked_us - published_us);
+}
+
+static esp_err_t hamqtt_latency_transport_init(HAMQTT_Transport *self, const HAMQTT_Transport_Config *config) {
+    return hamqtt_transport_init(((HAMQTT_Latency_Transport *)self)->inner, config);
+}
+
+static esp_err_t hamqtt_latency_transport_start(HAMQTT_Transport *self) {
+    return hamqtt_transport_start(((HAMQTT_Latency_Transport *)self)->inner);
+}
+
+static esp_err_t hamqtt_latency_transport_stop(HAMQTT_Transport *self) {
+    return hamqtt_transport_stop(((HAMQTT_Latency_Transport *)self)->inner);
+}
+
+static esp_err_t hamqtt_latency_transport_wait_connected(HAMQTT_Transport *self, uint32_t timeout_ms) {
+    return hamqtt_transport_wait_connected(((HAMQTT_Latency_Transport *)self)->inner, timeout_ms);
+}
+
+static int hamqtt_latency_transport_publish(HAMQTT_Transport *self,
+                                            const char *topic,
+                                            const char *data,
+                                            int len,
+                                            int qos,
+                                            int retain) {
+    HAMQTT_Latency_Transport *transport = (HAMQTT_Latency_Transport *)self;
+
+    int64_t published_us = hamqtt_port_time_us();
+    int msg_id = hamqtt_transport_publish(transport->inner, topic, data, len, qos, retain);
+    if (qos > 0) hamqtt_latency_track_publish(transport->latency, msg_id, published_us);
+
+    return msg_id;
+}
+
+static int hamqtt_latency_transport_enqueue(HAMQTT_Transport *self,
+                                            const char *topic,
+                                            const char *data,
+                                            int len,
+                                            int qos,
+                                            int retain) {
+    HAMQTT_Latency_Transport *transport = (HAMQTT_Latency_Transport *)self;
+
+    int64_t published_us = hamqtt_port_time_us();
+    int msg_id = hamqtt_transport_enqueue(transport->inner, topic, data, len, qos, retain);
+    if (qos > 0) hamqtt_latency_track_publish(transport->latency, msg_id, published_us);
+
+    return msg_id;
+}
+
+static int hamqtt_latency_transport_subscribe(HAMQTT_Transport *self, const char *topic, int qos) {
+    return hamqtt_transport_subscribe(((HAMQTT_Latency_Transport *)self)->inner, topic, qos);
+}
+
+static int hamqtt_latency_transport_get_outbox_size(HAMQTT_Transport *self) {
+    return hamqtt_transport_get_outbox_size(((HAMQTT_Latency_Transport *)self)->inner);
+}
+
+static void hamqtt_latency_transport_destroy(HAMQTT_Transport *self) {
+    // Owned by the recorder
+}
+
+static const HAMQTT_Transport_VTable hamqtt_latency_transport_vtable = {
+    .init = hamqtt_latency_transport_init,
+    .start = hamqtt_latency_transport_start,
+    .stop = hamqtt_latency_transport_stop,
+    .wait_connected = hamqtt_latency_transport_wait_connected,
+    .publish = hamqtt_latency_transport_publish,
+    .enqueue = hamqtt_latency_transport_enqueue,
+    .subscribe = hamqtt_latency_transport_subscribe,
+    .destroy = hamqtt_latency_transport_destroy,
+    .get_outbox_size = hamqtt_latency_transport_get_outbox_size,
+};
+
+/* ----- Recorder ----- */
+
+HAMQTT_Latency *hamqtt_latency_create(size_t entity_count) {
+    HAMQTT_Latency *latency = calloc(1, sizeof(HAMQTT_Latency));
+    if (!latency) {
+        ESP_LOGE(TAG, "Unable to allocate space for latency recorder");
+        return NULL;
+    }
+
+    latency->entity_count = entity_count;
+    latency->histograms = calloc(entity_count * HAMQTT_LATENCY_STAGE_COUNT, sizeof(HAMQTT_Latency_Histogram));
+    if (entity_count && !latency->histograms) {
+        ESP_LOGE(TAG, "Unable to allocate space for latency histograms");
+        free(latency);
+        return NULL;
+    }
+
+    latency->transport.base.v = &hamqtt_latency_transport_vtable;
+    latency->transport.latency = latency;
+
+    return latency;
+}
+
+void hamqtt_latency_destroy(HAMQTT_Latency *latency) {
+    if (!latency) return;
+
+    free(latency->histograms);
+    free(latency);
+}
+
+void hamqtt_latency_reset(HAMQTT_Latency *latency) {
+    memset(latency->histograms, 0, latency->entity_count * HAMQTT_LATENCY_STAGE_COUNT * sizeof(HAMQTT_Latency_Histogram));
+    memset(&latency->probe, 0, sizeof(latency->probe));
+}
+
+static HAMQTT_Latency_Histogram *hamqtt_latency_find(const HAMQTT_Latency *latency, size_t entity, HAMQTT_Latency_Stage stage) {
+    if (stage == HAMQTT_LATENCY_STAGE_PROBE_RTT) return (HAMQTT_Latency_Histogram *)&latency->probe;
+    if (stage >= HAMQTT_LATENCY_STAGE_COUNT || entity >= latency->entity_count) return NULL;
+
+    return &latency->histograms[entity * HAMQTT_LATENCY_STAGE_COUNT + stage];
+}
+
+void hamqtt_latency_record(HAMQTT_Latency *latency, size_t entity, HAMQTT_Latency_Stage stage, int64_t us) {
+    HAMQTT_Latency_Histogram *histogram = hamqtt_latency_find(latency, entity, stage);
+    if (histogram) hamqtt_latency_histogram_add(histogram, us);
+}
+
+esp_err_t hamqtt_latency_get(const HAMQTT_Latency *latency, size_t entity, HAMQTT_Latency_Stage stage, HAMQTT_Latency_Histogram *histogram) {
+    const HAMQTT_Latency_Histogram *source = hamqtt_latency_find(latency, entity, stage);
+    ESP_RETURN_ON_FALSE(source, ESP_ERR_INVALID_ARG, TAG, "No histogram for entity %d, stage %d", (int)entity, (int)stage);
+
+    *histogram = *source;
+    return ESP_OK;
+}
+
+HAMQTT_Transport *hamqtt_latency_wrap_transport(HAMQTT_Latency *latency, HAMQTT_Transport *inner) {
+    latency->transport.inner = inner;
+    return &latency->transport.base;
+}
+
+void hamqtt_latency_set_publisher(HAMQTT_Latency *latency, size_t entity) {
+    latency->publisher = entity;
+}
+
+void hamqtt_latency_handle_ack(HAMQTT_Latency *latency, int msg_id) {
+    if (msg_id <= 0) return;
+
+    HAMQTT_Latency_Pending *slot = &latency->pending[msg_id % HAMQTT_LATENCY_PENDING_SLOTS];
+
+    int64_t acked_us = hamqtt_port_time_us();
+    slot->acked_us = acked_us;
+    atomic_store(&slot->acked_id, msg_id);
+
+    if (atomic_load(&slot->msg_id) != msg_id) return;
+
+    size_t entity = slot->entity;
+    int64_t published_us = slot->published_us;
+
+    int expected = msg_id;
+    if (!atomic_compare_exchange_strong(&slot->msg_id, &expected, 0)) return;
+
+    hamqtt_latency_record(latency, entity, HAMQTT_LATENCY_STAGE_PUBLISH_ACK, acked_us - published_us);
+}
+
+bool hamqtt_latency_probe_due(HAMQTT_Latency *latency, uint32_t interval_ms) {
+    int64_t now_us = hamqtt_port_time_us();
+    if (latency->last_probe_us && now_us - latency->last_probe_us < (int64_t)interval_ms * 1000) return false;
+
+    latency->last_probe_us = now_us;
+    return true;
+}
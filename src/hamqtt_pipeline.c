@@ -0,0 +1,579 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_pipeline.c
+ * @brief Command ring between the MQTT task and a pinned execution task.
+ *
+ * The ring has one producer, the task that routes inbound messages, and one consumer, the
+ * execution task, so it needs no lock: the producer fills the slot at `head` and then
+ * publishes it by advancing `head`, and the consumer runs the slot at `tail` in place before
+ * advancing `tail`. The two indices sit on separate cache lines and each side keeps a copy of
+ * the other's index, so a busy ring does not bounce lines between cores.
+ *
+ * The execution task only sleeps when the ring is empty. It announces that through
+ * `sleeping`, so the producer only pays for a wakeup when one is needed.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#ifndef ESP_PLATFORM
+#define _GNU_SOURCE
+#endif
+
+#include <stdatomic.h>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+#include "HAMQTT/hamqtt_pipeline_internal.h"
+#include "HAMQTT/hamqtt_transport_internal.h"
+
+#define HAMQTT_PIPELINE_CACHE_LINE 64
+
+// The MQTT task's core, from esp-mqtt's own configuration. -1 when it is not pinned.
+#if defined(ESP_PLATFORM) && defined(CONFIG_MQTT_TASK_CORE_SELECTION_ENABLED) && defined(CONFIG_MQTT_USE_CORE_1)
+#define HAMQTT_PIPELINE_MQTT_CORE 1
+#elif defined(ESP_PLATFORM) && defined(CONFIG_MQTT_TASK_CORE_SELECTION_ENABLED)
+#define HAMQTT_PIPELINE_MQTT_CORE 0
+#else
+#define HAMQTT_PIPELINE_MQTT_CORE -1
+#endif
+
+static const char *TAG = "HAMQTT_Pipeline";
+
+// The pipeline whose execution task is the caller, if any
+static __thread HAMQTT_Pipeline *hamqtt_pipeline_current;
+
+typedef struct {
+    HAMQTT_Transport base;
+    HAMQTT_Transport *inner;
+} HAMQTT_Pipeline_Transport;
+
+typedef struct {
+    atomic_uint_least64_t routing_us;
+    atomic_uint_least64_t execution_us;
+} HAMQTT_Pipeline_Core_Time;
+
+struct HAMQTT_Pipeline {
+    HAMQTT_Pipeline_Callbacks callbacks;
+    HAMQTT_Pipeline_Config config;
+
+    HAMQTT_Pipeline_Command *slots;
+    size_t slot_count;                          // Power of two
+
+    // Producer side
+    atomic_size_t head;
+    size_t producer_tail;                       // Last tail the producer read
+    char head_pad[HAMQTT_PIPELINE_CACHE_LINE];
+
+    // Consumer side
+    atomic_size_t tail;
+    char tail_pad[HAMQTT_PIPELINE_CACHE_LINE];
+
+    atomic_bool running;
+    atomic_bool sleeping;
+
+#ifdef ESP_PLATFORM
+    TaskHandle_t task;
+    SemaphoreHandle_t exited;
+#else
+    pthread_t thread;
+    pthread_mutex_t wake_lock;
+    pthread_cond_t wake_cond;
+    bool wake_pending;
+#endif
+    atomic_bool task_started;
+
+    atomic_int routing_core;
+    atomic_int execution_core;
+    atomic_uint_least32_t commands;
+    atomic_uint_least32_t commands_dropped;
+    atomic_uint_least32_t high_water;
+    atomic_uint_least32_t loops;
+    HAMQTT_Pipeline_Core_Time core_time[HAMQTT_PIPELINE_MAX_CORES];
+
+    // Start of the current stats window, guarded by stats_lock
+    HAMQTT_Port_Mutex stats_lock;
+    int64_t window_start_us;
+    uint64_t window_routing_us[HAMQTT_PIPELINE_MAX_CORES];
+    uint64_t window_execution_us[HAMQTT_PIPELINE_MAX_CORES];
+    uint32_t window_idle_us[HAMQTT_PIPELINE_MAX_CORES];
+    bool window_idle_valid[HAMQTT_PIPELINE_MAX_CORES];
+
+    HAMQTT_Pipeline_Transport transport;
+};
+
+HAMQTT_Pipeline_Config hamqtt_pipeline_config_default(void) {
+    HAMQTT_Pipeline_Config config = {
+        .execution_core = CONFIG_HAMQTT_PIPELINE_EXECUTION_CORE,
+        .loop_interval_ms = 500,
+        .stack_size = 4096,
+        .priority = 5,
+    };
+    return config;
+}
+
+/* ----- Private HAMQTT Pipeline function definitions ----- */
+
+static void hamqtt_pipeline_add_time(HAMQTT_Pipeline *pipeline, bool routing, int64_t busy_us) {
+    if (busy_us <= 0) return;
+
+    int core = hamqtt_port_core_id();
+    HAMQTT_Pipeline_Core_Time *time = &pipeline->core_time[core];
+
+    atomic_fetch_add_explicit(routing ? &time->routing_us : &time->execution_us, (uint64_t)busy_us, memory_order_relaxed);
+    atomic_store_explicit(routing ? &pipeline->routing_core : &pipeline->execution_core, core, memory_order_relaxed);
+}
+
+/**
+ * @brief Run every command in the ring, in place, on the calling task.
+ */
+static void hamqtt_pipeline_drain(HAMQTT_Pipeline *pipeline) {
+    size_t tail = atomic_load_explicit(&pipeline->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&pipeline->head, memory_order_acquire);
+
+    while (tail != head) {
+        const HAMQTT_Pipeline_Command *command = &pipeline->slots[tail & (pipeline->slot_count - 1)];
+
+        int64_t start_us = hamqtt_port_time_us();
+        pipeline->callbacks.execute(pipeline->callbacks.context, command);
+        hamqtt_pipeline_add_time(pipeline, false, hamqtt_port_time_us() - start_us);
+
+        // The slot may be refilled as soon as the producer sees this
+        atomic_store_explicit(&pipeline->tail, ++tail, memory_order_release);
+
+        if (tail == head) head = atomic_load_explicit(&pipeline->head, memory_order_acquire);
+    }
+}
+
+static bool hamqtt_pipeline_is_empty(HAMQTT_Pipeline *pipeline) {
+    return atomic_load(&pipeline->head) == atomic_load_explicit(&pipeline->tail, memory_order_relaxed);
+}
+
+static void hamqtt_pipeline_wake(HAMQTT_Pipeline *pipeline) {
+#ifdef ESP_PLATFORM
+    xTaskNotifyGive(pipeline->task);
+#else
+    pthread_mutex_lock(&pipeline->wake_lock);
+    pipeline->wake_pending = true;
+    pthread_cond_signal(&pipeline->wake_cond);
+    pthread_mutex_unlock(&pipeline->wake_lock);
+#endif
+}
+
+/**
+ * @brief Sleep until a command is submitted, the pipeline stops, or `timeout_us` passes.
+ */
+static void hamqtt_pipeline_wait(HAMQTT_Pipeline *pipeline, int64_t timeout_us) {
+    atomic_store(&pipeline->sleeping, true);
+
+    // A command submitted before `sleeping` was visible did not wake us, so check again
+    if (!hamqtt_pipeline_is_empty(pipeline) || !atomic_load(&pipeline->running)) {
+        atomic_store(&pipeline->sleeping, false);
+        return;
+    }
+
+#ifdef ESP_PLATFORM
+    TickType_t ticks = pdMS_TO_TICKS((timeout_us + 999) / 1000);
+    ulTaskNotifyTake(pdTRUE, ticks ? ticks : 1);
+#else
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_us / 1000000;
+    deadline.tv_nsec += (timeout_us % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&pipeline->wake_lock);
+    while (!pipeline->wake_pending) {
+        if (pthread_cond_timedwait(&pipeline->wake_cond, &pipeline->wake_lock, &deadline) != 0) break;
+    }
+    pipeline->wake_pending = false;
+    pthread_mutex_unlock(&pipeline->wake_lock);
+#endif
+
+    atomic_store(&pipeline->sleeping, false);
+}
+
+/**
+ * @brief Body of the execution task.
+ */
+static void hamqtt_pipeline_run(HAMQTT_Pipeline *pipeline) {
+    hamqtt_pipeline_current = pipeline;
+
+    int64_t interval_us = (int64_t)pipeline->config.loop_interval_ms * 1000;
+    int64_t next_loop_us = hamqtt_port_time_us();
+
+    while (atomic_load(&pipeline->running)) {
+        hamqtt_pipeline_drain(pipeline);
+
+        int64_t now_us = hamqtt_port_time_us();
+        if (now_us >= next_loop_us) {
+            pipeline->callbacks.loop(pipeline->callbacks.context);
+
+            int64_t end_us = hamqtt_port_time_us();
+            hamqtt_pipeline_add_time(pipeline, false, end_us - now_us);
+            atomic_fetch_add_explicit(&pipeline->loops, 1, memory_order_relaxed);
+
+            // After a stall, carry on from now rather than catching up with a burst of loops
+            next_loop_us += interval_us;
+            if (next_loop_us <= end_us) next_loop_us = end_us + interval_us;
+            continue;
+        }
+
+        hamqtt_pipeline_wait(pipeline, next_loop_us - now_us);
+    }
+
+    hamqtt_pipeline_drain(pipeline);
+}
+
+#ifdef ESP_PLATFORM
+static void hamqtt_pipeline_task(void *arg) {
+    HAMQTT_Pipeline *pipeline = (HAMQTT_Pipeline *)arg;
+
+    hamqtt_pipeline_run(pipeline);
+
+    xSemaphoreGive(pipeline->exited);
+    vTaskDelete(NULL);
+}
+#else
+static void *hamqtt_pipeline_thread(void *arg) {
+    hamqtt_pipeline_run((HAMQTT_Pipeline *)arg);
+    return NULL;
+}
+#endif
+
+static esp_err_t hamqtt_pipeline_start_task(HAMQTT_Pipeline *pipeline) {
+    int core = pipeline->config.execution_core;
+
+#ifdef ESP_PLATFORM
+    BaseType_t created = xTaskCreatePinnedToCore(hamqtt_pipeline_task,
+                                                 "hamqtt_exec",
+                                                 pipeline->config.stack_size,
+                                                 pipeline,
+                                                 pipeline->config.priority,
+                                                 &pipeline->task,
+                                                 core < 0 ? tskNO_AFFINITY : core);
+    ESP_RETURN_ON_FALSE(created == pdPASS, ESP_ERR_NO_MEM, TAG, "Unable to create the execution task");
+#else
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+
+    if (core >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(core, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+
+    int rc = pthread_create(&pipeline->thread, &attr, hamqtt_pipeline_thread, pipeline);
+    pthread_attr_destroy(&attr);
+    ESP_RETURN_ON_FALSE(rc == 0, ESP_ERR_NO_MEM, TAG, "Unable to create the execution thread");
+#endif
+
+    atomic_store(&pipeline->task_started, true);
+
+    return ESP_OK;
+}
+
+static void hamqtt_pipeline_join_task(HAMQTT_Pipeline *pipeline) {
+#ifdef ESP_PLATFORM
+    xSemaphoreTake(pipeline->exited, portMAX_DELAY);
+#else
+    pthread_join(pipeline->thread, NULL);
+#endif
+
+    atomic_store(&pipeline->task_started, false);
+}
+
+/* ----- Transport ----- */
+
+static esp_err_t hamqtt_pipeline_transport_init(HAMQTT_Transport *self, const HAMQTT_Transport_Config *config) {
+    return hamqtt_transport_init(((HAMQTT_Pipeline_Transport *)self)->inner, config);
+}
+
+static esp_err_t hamqtt_pipeline_transport_start(HAMQTT_Transport *self) {
+    return hamqtt_transport_start(((HAMQTT_Pipeline_Transport *)self)->inner);
+}
+
+static esp_err_t hamqtt_pipeline_transport_stop(HAMQTT_Transport *self) {
+    return hamqtt_transport_stop(((HAMQTT_Pipeline_Transport *)self)->inner);
+}
+
+static esp_err_t hamqtt_pipeline_transport_wait_connected(HAMQTT_Transport *self, uint32_t timeout_ms) {
+    return hamqtt_transport_wait_connected(((HAMQTT_Pipeline_Transport *)self)->inner, timeout_ms);
+}
+
+static int hamqtt_pipeline_transport_enqueue(HAMQTT_Transport *self,
+                                             const char *topic,
+                                             const char *data,
+                                             int len,
+                                             int qos,
+                                             int retain) {
+    return hamqtt_transport_enqueue(((HAMQTT_Pipeline_Transport *)self)->inner, topic, data, len, qos, retain);
+}
+
+static int hamqtt_pipeline_transport_subscribe(HAMQTT_Transport *self, const char *topic, int qos) {
+    return hamqtt_transport_subscribe(((HAMQTT_Pipeline_Transport *)self)->inner, topic, qos);
+}
+
+static int hamqtt_pipeline_transport_get_outbox_size(HAMQTT_Transport *self) {
+    return hamqtt_transport_get_outbox_size(((HAMQTT_Pipeline_Transport *)self)->inner);
+}
+
+static void hamqtt_pipeline_transport_destroy(HAMQTT_Transport *self) {
+    // Owned by the pipeline
+}
+
+static const HAMQTT_Transport_VTable hamqtt_pipeline_transport_vtable = {
+    .init = hamqtt_pipeline_transport_init,
+    .start = hamqtt_pipeline_transport_start,
+    .stop = hamqtt_pipeline_transport_stop,
+    .wait_connected = hamqtt_pipeline_transport_wait_connected,
+    .publish = hamqtt_pipeline_transport_enqueue,     // The MQTT task does the socket write
+    .enqueue = hamqtt_pipeline_transport_enqueue,
+    .subscribe = hamqtt_pipeline_transport_subscribe,
+    .destroy = hamqtt_pipeline_transport_destroy,
+    .get_outbox_size = hamqtt_pipeline_transport_get_outbox_size,
+};
+
+/* ----- HAMQTT Pipeline function definitions ----- */
+
+HAMQTT_Pipeline *hamqtt_pipeline_create(const HAMQTT_Pipeline_Callbacks *callbacks) {
+    HAMQTT_Pipeline *pipeline = calloc(1, sizeof(HAMQTT_Pipeline));
+    if (!pipeline) {
+        ESP_LOGE(TAG, "Unable to allocate space for pipeline");
+        return NULL;
+    }
+
+    pipeline->callbacks = *callbacks;
+    pipeline->transport.base.v = &hamqtt_pipeline_transport_vtable;
+    atomic_init(&pipeline->routing_core, -1);
+    atomic_init(&pipeline->execution_core, -1);
+
+    if (hamqtt_port_mutex_init(&pipeline->stats_lock) != ESP_OK) {
+        ESP_LOGE(TAG, "Unable to create pipeline stats lock");
+        free(pipeline);
+        return NULL;
+    }
+
+#ifdef ESP_PLATFORM
+    pipeline->exited = xSemaphoreCreateBinary();
+    if (!pipeline->exited) {
+        ESP_LOGE(TAG, "Unable to create pipeline semaphore");
+        hamqtt_port_mutex_destroy(&pipeline->stats_lock);
+        free(pipeline);
+        return NULL;
+    }
+#else
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&pipeline->wake_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    pthread_mutex_init(&pipeline->wake_lock, NULL);
+#endif
+
+    return pipeline;
+}
+
+void hamqtt_pipeline_destroy(HAMQTT_Pipeline *pipeline) {
+    if (!pipeline) return;
+
+    hamqtt_pipeline_stop(pipeline);
+
+#ifdef ESP_PLATFORM
+    vSemaphoreDelete(pipeline->exited);
+#else
+    pthread_cond_destroy(&pipeline->wake_cond);
+    pthread_mutex_destroy(&pipeline->wake_lock);
+#endif
+    hamqtt_port_mutex_destroy(&pipeline->stats_lock);
+
+    free(pipeline->slots);
+    free(pipeline);
+}
+
+esp_err_t hamqtt_pipeline_start(HAMQTT_Pipeline *pipeline, const HAMQTT_Pipeline_Config *config) {
+    ESP_RETURN_ON_FALSE(!atomic_load(&pipeline->task_started), ESP_ERR_INVALID_STATE, TAG, "Pipeline is already running");
+    ESP_RETURN_ON_FALSE(config->loop_interval_ms > 0, ESP_ERR_INVALID_ARG, TAG, "Loop interval must be positive");
+    ESP_RETURN_ON_FALSE(config->execution_core < hamqtt_port_core_count(),
+                        ESP_ERR_INVALID_ARG,
+                        TAG,
+                        "Core %d does not exist",
+                        config->execution_core);
+
+    if (HAMQTT_PIPELINE_MQTT_CORE < 0) {
+        ESP_LOGW(TAG, "The MQTT task is not pinned, so it may share a core with the execution task");
+    } else if (HAMQTT_PIPELINE_MQTT_CORE == config->execution_core) {
+        ESP_LOGW(TAG, "The MQTT task and the execution task are both pinned to core %d", config->execution_core);
+    }
+
+    // Kept across restarts, since the producer may still be looking at it
+    if (!pipeline->slots) {
+        size_t slot_count = 1;
+        while (slot_count < CONFIG_HAMQTT_PIPELINE_RING_SIZE) slot_count <<= 1;
+
+        pipeline->slots = calloc(slot_count, sizeof(HAMQTT_Pipeline_Command));
+        ESP_RETURN_ON_FALSE(pipeline->slots, ESP_ERR_NO_MEM, TAG, "Unable to allocate space for the command ring");
+        pipeline->slot_count = slot_count;
+    }
+
+    pipeline->config = *config;
+
+    hamqtt_port_mutex_lock(&pipeline->stats_lock);
+    pipeline->window_start_us = hamqtt_port_time_us();
+    for (int core = 0; core < HAMQTT_PIPELINE_MAX_CORES; ++core) {
+        pipeline->window_routing_us[core] = atomic_load(&pipeline->core_time[core].routing_us);
+        pipeline->window_execution_us[core] = atomic_load(&pipeline->core_time[core].execution_us);
+        pipeline->window_idle_valid[core] = core < hamqtt_port_core_count()
+                                         && hamqtt_port_core_idle_us(core, &pipeline->window_idle_us[core]);
+    }
+    hamqtt_port_mutex_unlock(&pipeline->stats_lock);
+
+    atomic_store(&pipeline->running, true);
+
+    esp_err_t err = hamqtt_pipeline_start_task(pipeline);
+    if (err != ESP_OK) atomic_store(&pipeline->running, false);
+
+    return err;
+}
+
+void hamqtt_pipeline_stop(HAMQTT_Pipeline *pipeline) {
+    if (!atomic_load(&pipeline->task_started)) return;
+
+    atomic_store(&pipeline->running, false);
+    hamqtt_pipeline_wake(pipeline);
+    hamqtt_pipeline_join_task(pipeline);
+
+    // A command submitted while the task was leaving is still owed its callback
+    hamqtt_pipeline_drain(pipeline);
+}
+
+esp_err_t hamqtt_pipeline_begin_submit(HAMQTT_Pipeline *pipeline, HAMQTT_Pipeline_Command **command) {
+    if (!atomic_load_explicit(&pipeline->running, memory_order_acquire)) return ESP_ERR_INVALID_STATE;
+
+    size_t head = atomic_load_explicit(&pipeline->head, memory_order_relaxed);
+
+    if (head - pipeline->producer_tail >= pipeline->slot_count) {
+        pipeline->producer_tail = atomic_load_explicit(&pipeline->tail, memory_order_acquire);
+
+        if (head - pipeline->producer_tail >= pipeline->slot_count) {
+            atomic_fetch_add_explicit(&pipeline->commands_dropped, 1, memory_order_relaxed);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    *command = &pipeline->slots[head & (pipeline->slot_count - 1)];
+
+    return ESP_OK;
+}
+
+void hamqtt_pipeline_end_submit(HAMQTT_Pipeline *pipeline) {
+    size_t head = atomic_load_explicit(&pipeline->head, memory_order_relaxed) + 1;
+
+    // Sequentially consistent, so either the consumer sees the command or we see it sleeping
+    atomic_store(&pipeline->head, head);
+
+    atomic_fetch_add_explicit(&pipeline->commands, 1, memory_order_relaxed);
+
+    // The cached tail may be old, so only read the real one when it could be a new high
+    uint32_t high_water = atomic_load_explicit(&pipeline->high_water, memory_order_relaxed);
+    if ((uint32_t)(head - pipeline->producer_tail) > high_water) {
+        pipeline->producer_tail = atomic_load_explicit(&pipeline->tail, memory_order_acquire);
+
+        uint32_t waiting = (uint32_t)(head - pipeline->producer_tail);
+        if (waiting > high_water) atomic_store_explicit(&pipeline->high_water, waiting, memory_order_relaxed);
+    }
+
+    // Only write the flag when the consumer is asleep, so a busy ring leaves its line alone
+    if (atomic_load(&pipeline->sleeping) && atomic_exchange(&pipeline->sleeping, false)) hamqtt_pipeline_wake(pipeline);
+}
+
+void hamqtt_pipeline_record_routing(HAMQTT_Pipeline *pipeline, int64_t busy_us) {
+    if (!atomic_load_explicit(&pipeline->running, memory_order_relaxed)) return;
+
+    hamqtt_pipeline_add_time(pipeline, true, busy_us);
+}
+
+bool hamqtt_pipeline_is_execution_task(const HAMQTT_Pipeline *pipeline) {
+    return hamqtt_pipeline_current == pipeline;
+}
+
+HAMQTT_Transport *hamqtt_pipeline_wrap_transport(HAMQTT_Pipeline *pipeline, HAMQTT_Transport *inner) {
+    pipeline->transport.inner = inner;
+    return &pipeline->transport.base;
+}
+
+void hamqtt_pipeline_get_stats(HAMQTT_Pipeline *pipeline, HAMQTT_Pipeline_Stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+
+    stats->running = atomic_load(&pipeline->task_started);
+    stats->routing_core = atomic_load_explicit(&pipeline->routing_core, memory_order_relaxed);
+    stats->execution_core = atomic_load_explicit(&pipeline->execution_core, memory_order_relaxed);
+    stats->commands = atomic_load_explicit(&pipeline->commands, memory_order_relaxed);
+    stats->commands_dropped = atomic_load_explicit(&pipeline->commands_dropped, memory_order_relaxed);
+    stats->ring_slots = (uint32_t)pipeline->slot_count;
+    stats->ring_high_water = atomic_load_explicit(&pipeline->high_water, memory_order_relaxed);
+    stats->loops = atomic_load_explicit(&pipeline->loops, memory_order_relaxed);
+    stats->core_count = (size_t)hamqtt_port_core_count();
+
+    hamqtt_port_mutex_lock(&pipeline->stats_lock);
+
+    int64_t now_us = hamqtt_port_time_us();
+    stats->window_us = pipeline->window_start_us ? (uint64_t)(now_us - pipeline->window_start_us) : 0;
+    pipeline->window_start_us = now_us;
+
+    for (size_t core = 0; core < HAMQTT_PIPELINE_MAX_CORES; ++core) {
+        uint64_t routing_us = atomic_load(&pipeline->core_time[core].routing_us);
+        uint64_t execution_us = atomic_load(&pipeline->core_time[core].execution_us);
+        uint32_t idle_us = 0;
+        bool idle_valid = core < stats->core_count && hamqtt_port_core_idle_us((int)core, &idle_us);
+
+        if (core < stats->core_count) {
+            HAMQTT_Core_Utilization *utilization = &stats->cores[core];
+            double window_us = stats->window_us ? (double)stats->window_us : 1.0;
+
+            utilization->routing_pct = (float)(100.0 * (double)(routing_us - pipeline->window_routing_us[core]) / window_us);
+            utilization->execution_pct = (float)(100.0 * (double)(execution_us - pipeline->window_execution_us[core]) / window_us);
+            utilization->load_pct = -1.0f;
+
+            if (idle_valid && pipeline->window_idle_valid[core] && stats->window_us) {
+                double idle_pct = 100.0 * (double)(uint32_t)(idle_us - pipeline->window_idle_us[core]) / window_us;
+                utilization->load_pct = (float)(idle_pct >= 100.0 ? 0.0 : 100.0 - idle_pct);
+            }
+        }
+
+        pipeline->window_routing_us[core] = routing_us;
+        pipeline->window_execution_us[core] = execution_us;
+        pipeline->window_idle_us[core] = idle_us;
+        pipeline->window_idle_valid[core] = idle_valid;
+    }
+
+    hamqtt_port_mutex_unlock(&pipeline->stats_lock);
+}
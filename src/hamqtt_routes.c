@@ -0,0 +1,582 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_routes.c
+ * @brief Read-copy-update of the component and route table.
+ *
+ * Each snapshot is one allocation holding the table, the component pointers, the routes and
+ * copies of their topics, so a reader never follows a pointer into memory a component may
+ * free. The current snapshot is swapped with a single atomic store.
+ *
+ * Each reader has one atomic word: the low bits count the read-side sections it is in, and
+ * the high bits count the times that dropped back to zero, its quiescent states. When a
+ * snapshot is retired, the writer records which readers were inside a section and their
+ * quiescent count. A reader that was outside can only see the new snapshot; one that was
+ * inside has left once its quiescent count moves. Retired snapshots are freed by the next
+ * publish once every reader has passed one of these tests, or when the routes are destroyed.
+ *
+ * Topics are indexed in the same allocation. Exact topics go in an open addressed hash table
+ * of whole topics. Filters with `+` or `#` levels go in a trie: each node keeps its `+` child
+ * and the routes ending at it or in a `#` below it, and the literal children of every node
+ * share one hash table keyed by parent and level, so each level is one probe however wide the
+ * trie is. Routes sharing a topic or a node are chained in table order.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <stdatomic.h>
+
+#include "HAMQTT/hamqtt_routes_internal.h"
+
+#define HAMQTT_ROUTES_NESTING_BITS 8
+#define HAMQTT_ROUTES_NESTING_MASK ((1U << HAMQTT_ROUTES_NESTING_BITS) - 1)
+
+#define HAMQTT_ROUTES_NONE SIZE_MAX
+#define HAMQTT_ROUTES_HASH_SEED 0x811C9DC5U
+
+static const char *TAG = "HAMQTT_Routes";
+
+typedef struct {
+    size_t next;                // Next route with the same topic, or ending at the same node
+    uint32_t hash;              // Hash of the whole topic, for exact routes
+} HAMQTT_Route_Link;
+
+typedef struct {
+    size_t routes;              // First route whose filter ends at this node
+    size_t multi_routes;        // First route whose filter ends in a '#' level below this node
+    size_t plus;                // Child for a '+' level
+} HAMQTT_Route_Node;
+
+typedef struct {
+    uint32_t hash;
+    size_t parent;
+    size_t child;               // HAMQTT_ROUTES_NONE if the slot is free
+    const char *level;
+    size_t level_len;
+} HAMQTT_Route_Edge;
+
+typedef struct HAMQTT_Route_Snapshot HAMQTT_Route_Snapshot;
+
+struct HAMQTT_Route_Snapshot {
+    HAMQTT_Route_Table table;
+
+    HAMQTT_Route_Link *links;
+    size_t *exact_slots;        // Index of the first route with a topic, a power of two of them
+    size_t exact_slot_count;
+    HAMQTT_Route_Node *nodes;   // The root is node 0, absent without filters
+    size_t node_count;
+    HAMQTT_Route_Edge *edges;
+    size_t edge_slot_count;
+
+    HAMQTT_Route_Snapshot *next_retired;
+    bool reader_active[HAMQTT_ROUTES_READER_COUNT];     // Reader was inside a section when retired
+    uint32_t reader_quiescent[HAMQTT_ROUTES_READER_COUNT];
+
+    // Followed by the component pointers, the routes, the index and the topic copies
+};
+
+struct HAMQTT_Routes {
+    _Atomic(HAMQTT_Route_Snapshot *) current;
+    atomic_uint_least32_t readers[HAMQTT_ROUTES_READER_COUNT];
+
+    HAMQTT_Route_Snapshot *retired;
+};
+
+/**
+ * The table before anything was published. Never retired.
+ */
+static HAMQTT_Route_Snapshot empty_snapshot;
+
+/* ----- Private HAMQTT Routes function definitions ----- */
+
+/**
+ * @brief Whether `table` already holds exactly `components` and their current topics.
+ */
+static bool hamqtt_routes_matches(const HAMQTT_Route_Table *table, HAMQTT_Component *const *components, size_t component_count) {
+    if (table->component_count != component_count) return false;
+
+    size_t route = 0;
+    for (size_t i = 0; i < component_count; ++i) {
+        if (table->components[i] != components[i]) return false;
+
+        size_t topic_count = 0;
+        const char *const *topics = hamqtt_component_get_subscribed_topics(components[i], &topic_count);
+
+        for (size_t j = 0; j < topic_count; ++j) {
+            if (!topics[j]) continue;
+            if (route >= table->route_count || strcmp(table->routes[route].topic, topics[j]) != 0) return false;
+            route++;
+        }
+    }
+
+    return route == table->route_count;
+}
+
+/**
+ * @brief Hash four bytes at a time, as topics are mostly long and the device's cores are 32-bit.
+ */
+static uint32_t hamqtt_routes_hash(uint32_t hash, const char *data, size_t len) {
+    hash ^= (uint32_t)len;
+
+    while (len >= 4) {
+        uint32_t word;
+        memcpy(&word, data, 4);
+
+        hash = (hash ^ word) * 0x9E3779B1U;
+        hash ^= hash >> 15;
+
+        data += 4;
+        len -= 4;
+    }
+
+    if (len > 0) {
+        uint32_t word = 0;
+        memcpy(&word, data, len);
+
+        hash = (hash ^ word) * 0x9E3779B1U;
+        hash ^= hash >> 15;
+    }
+
+    return hash;
+}
+
+static uint32_t hamqtt_routes_edge_hash(size_t parent, const char *level, size_t level_len) {
+    return hamqtt_routes_hash(HAMQTT_ROUTES_HASH_SEED ^ ((uint32_t)parent * 0x9E3779B1U), level, level_len);
+}
+
+static size_t hamqtt_routes_slot_count(size_t entries) {
+    if (entries == 0) return 0;
+
+    // At most half full, so probes stay short
+    size_t slots = 1;
+    while (slots < entries * 2) slots <<= 1;
+
+    return slots;
+}
+
+/**
+ * @brief Whether a topic has a whole `+` level, or a whole `#` as its last level.
+ *
+ * Anything else is matched literally. Counts the levels into `levels`.
+ */
+static bool hamqtt_routes_is_filter(const char *topic, size_t *levels) {
+    bool filter = false;
+    *levels = 0;
+
+    const char *level = topic;
+    while (true) {
+        const char *slash = strchr(level, '/');
+        size_t level_len = slash ? (size_t)(slash - level) : strlen(level);
+
+        (*levels)++;
+        if (level_len == 1 && (level[0] == '+' || (level[0] == '#' && !slash))) filter = true;
+
+        if (!slash) return filter;
+        level = slash + 1;
+    }
+}
+
+static void hamqtt_routes_append(HAMQTT_Route_Link *links, size_t *head, size_t route) {
+    while (*head != HAMQTT_ROUTES_NONE) head = &links[*head].next;
+    *head = route;
+}
+
+static size_t hamqtt_routes_find_edge(const HAMQTT_Route_Snapshot *snapshot, size_t parent, const char *level, size_t level_len, uint32_t hash) {
+    size_t mask = snapshot->edge_slot_count - 1;
+
+    for (size_t i = hash & mask; snapshot->edges[i].child != HAMQTT_ROUTES_NONE; i = (i + 1) & mask) {
+        const HAMQTT_Route_Edge *edge = &snapshot->edges[i];
+
+        if (edge->hash == hash && edge->parent == parent && edge->level_len == level_len
+            && memcmp(edge->level, level, level_len) == 0) {
+            return i;
+        }
+    }
+
+    return HAMQTT_ROUTES_NONE;
+}
+
+static size_t hamqtt_routes_add_node(HAMQTT_Route_Snapshot *snapshot) {
+    snapshot->nodes[snapshot->node_count] = (HAMQTT_Route_Node){
+        .routes = HAMQTT_ROUTES_NONE,
+        .multi_routes = HAMQTT_ROUTES_NONE,
+        .plus = HAMQTT_ROUTES_NONE,
+    };
+
+    return snapshot->node_count++;
+}
+
+static void hamqtt_routes_index_exact(HAMQTT_Route_Snapshot *snapshot, size_t route) {
+    const char *topic = snapshot->table.routes[route].topic;
+    uint32_t hash = hamqtt_routes_hash(HAMQTT_ROUTES_HASH_SEED, topic, strlen(topic));
+    size_t mask = snapshot->exact_slot_count - 1;
+
+    snapshot->links[route].hash = hash;
+
+    size_t i = hash & mask;
+    for (; snapshot->exact_slots[i] != HAMQTT_ROUTES_NONE; i = (i + 1) & mask) {
+        size_t first = snapshot->exact_slots[i];
+
+        if (snapshot->links[first].hash == hash && strcmp(snapshot->table.routes[first].topic, topic) == 0) {
+            hamqtt_routes_append(snapshot->links, &snapshot->exact_slots[i], route);
+            return;
+        }
+    }
+
+    snapshot->exact_slots[i] = route;
+}
+
+static void hamqtt_routes_index_filter(HAMQTT_Route_Snapshot *snapshot, size_t route) {
+    if (snapshot->node_count == 0) hamqtt_routes_add_node(snapshot);
+
+    size_t node = 0;
+    const char *level = snapshot->table.routes[route].topic;
+
+    while (true) {
+        const char *slash = strchr(level, '/');
+        size_t level_len = slash ? (size_t)(slash - level) : strlen(level);
+
+        if (level_len == 1 && level[0] == '#' && !slash) {
+            hamqtt_routes_append(snapshot->links, &snapshot->nodes[node].multi_routes, route);
+            return;
+        }
+
+        if (level_len == 1 && level[0] == '+') {
+            if (snapshot->nodes[node].plus == HAMQTT_ROUTES_NONE) {
+                size_t child = hamqtt_routes_add_node(snapshot);
+                snapshot->nodes[node].plus = child;
+            }
+            node = snapshot->nodes[node].plus;
+        } else {
+            uint32_t hash = hamqtt_routes_edge_hash(node, level, level_len);
+            size_t edge = hamqtt_routes_find_edge(snapshot, node, level, level_len, hash);
+
+            if (edge == HAMQTT_ROUTES_NONE) {
+                size_t mask = snapshot->edge_slot_count - 1;
+                edge = hash & mask;
+                while (snapshot->edges[edge].child != HAMQTT_ROUTES_NONE) edge = (edge + 1) & mask;
+
+                snapshot->edges[edge] = (HAMQTT_Route_Edge){
+                    .hash = hash,
+                    .parent = node,
+                    .child = hamqtt_routes_add_node(snapshot),
+                    .level = level,
+                    .level_len = level_len,
+                };
+            }
+            node = snapshot->edges[edge].child;
+        }
+
+        if (!slash) break;
+        level = slash + 1;
+    }
+
+    hamqtt_routes_append(snapshot->links, &snapshot->nodes[node].routes, route);
+}
+
+static size_t hamqtt_routes_visit(const HAMQTT_Route_Snapshot *snapshot, size_t route, HAMQTT_Route_Visitor visit, void *context) {
+    size_t count = 0;
+
+    for (; route != HAMQTT_ROUTES_NONE; route = snapshot->links[route].next) {
+        visit(&snapshot->table.routes[route], context);
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Match the levels from `level` on against the filters below `node`.
+ *
+ * @param level Start of the next level, or NULL once every level was matched.
+ */
+static size_t hamqtt_routes_walk(const HAMQTT_Route_Snapshot *snapshot,
+                                 size_t node,
+                                 const char *level,
+                                 const char *end,
+                                 bool wildcards,
+                                 HAMQTT_Route_Visitor visit,
+                                 void *context) {
+    const HAMQTT_Route_Node *trie_node = &snapshot->nodes[node];
+
+    // A '#' level matches any number of levels, including none
+    size_t count = wildcards ? hamqtt_routes_visit(snapshot, trie_node->multi_routes, visit, context) : 0;
+
+    if (!level) return count + hamqtt_routes_visit(snapshot, trie_node->routes, visit, context);
+
+    const char *slash = memchr(level, '/', end - level);
+    size_t level_len = slash ? (size_t)(slash - level) : (size_t)(end - level);
+    const char *next = slash ? slash + 1 : NULL;
+
+    if (snapshot->edge_slot_count > 0) {
+        size_t edge = hamqtt_routes_find_edge(snapshot, node, level, level_len, hamqtt_routes_edge_hash(node, level, level_len));
+        if (edge != HAMQTT_ROUTES_NONE) {
+            count += hamqtt_routes_walk(snapshot, snapshot->edges[edge].child, next, end, true, visit, context);
+        }
+    }
+
+    if (wildcards && trie_node->plus != HAMQTT_ROUTES_NONE) {
+        count += hamqtt_routes_walk(snapshot, trie_node->plus, next, end, true, visit, context);
+    }
+
+    return count;
+}
+
+static bool hamqtt_routes_is_quiescent(const HAMQTT_Routes *routes, const HAMQTT_Route_Snapshot *snapshot) {
+    for (size_t i = 0; i < HAMQTT_ROUTES_READER_COUNT; ++i) {
+        if (!snapshot->reader_active[i]) continue;
+
+        uint32_t state = atomic_load(&routes->readers[i]);
+        if ((state >> HAMQTT_ROUTES_NESTING_BITS) == snapshot->reader_quiescent[i]) return false;
+    }
+
+    return true;
+}
+
+static void hamqtt_routes_retire(HAMQTT_Routes *routes, HAMQTT_Route_Snapshot *snapshot) {
+    if (snapshot == &empty_snapshot) return;
+
+    // The new snapshot is already visible, so any reader outside a section now cannot get this one
+    for (size_t i = 0; i < HAMQTT_ROUTES_READER_COUNT; ++i) {
+        uint32_t state = atomic_load(&routes->readers[i]);
+        snapshot->reader_active[i] = (state & HAMQTT_ROUTES_NESTING_MASK) != 0;
+        snapshot->reader_quiescent[i] = state >> HAMQTT_ROUTES_NESTING_BITS;
+    }
+
+    snapshot->next_retired = routes->retired;
+    routes->retired = snapshot;
+}
+
+static void hamqtt_routes_reclaim(HAMQTT_Routes *routes) {
+    HAMQTT_Route_Snapshot **link = &routes->retired;
+
+    while (*link) {
+        HAMQTT_Route_Snapshot *snapshot = *link;
+
+        if (hamqtt_routes_is_quiescent(routes, snapshot)) {
+            *link = snapshot->next_retired;
+            free(snapshot);
+        } else {
+            link = &snapshot->next_retired;
+        }
+    }
+}
+
+/* ----- HAMQTT Routes function definitions ----- */
+
+HAMQTT_Routes *hamqtt_routes_create(void) {
+    HAMQTT_Routes *routes = calloc(1, sizeof(HAMQTT_Routes));
+    if (!routes) {
+        ESP_LOGE(TAG, "Unable to allocate space for routes");
+        return NULL;
+    }
+
+    atomic_init(&routes->current, &empty_snapshot);
+
+    return routes;
+}
+
+void hamqtt_routes_destroy(HAMQTT_Routes *routes) {
+    if (!routes) return;
+
+    HAMQTT_Route_Snapshot *current = atomic_load(&routes->current);
+    if (current != &empty_snapshot) free(current);
+
+    while (routes->retired) {
+        HAMQTT_Route_Snapshot *snapshot = routes->retired;
+        routes->retired = snapshot->next_retired;
+        free(snapshot);
+    }
+
+    free(routes);
+}
+
+esp_err_t hamqtt_routes_publish(HAMQTT_Routes *routes, HAMQTT_Component *const *components, size_t component_count) {
+    HAMQTT_Route_Snapshot *current = atomic_load(&routes->current);
+
+    // Reconnects usually change nothing, so do not churn the heap for them
+    if (hamqtt_routes_matches(&current->table, components, component_count)) {
+        hamqtt_routes_reclaim(routes);
+        return ESP_OK;
+    }
+
+    size_t route_count = 0;
+    size_t exact_count = 0;
+    size_t filter_levels = 0;
+    size_t topic_bytes = 0;
+    for (size_t i = 0; i < component_count; ++i) {
+        size_t topic_count = 0;
+        const char *const *topics = hamqtt_component_get_subscribed_topics(components[i], &topic_count);
+
+        for (size_t j = 0; j < topic_count; ++j) {
+            if (!topics[j]) continue;
+            route_count++;
+            topic_bytes += strlen(topics[j]) + 1; /* NUL */
+
+            size_t levels = 0;
+            if (hamqtt_routes_is_filter(topics[j], &levels)) {
+                filter_levels += levels;
+            } else {
+                exact_count++;
+            }
+        }
+    }
+
+    // Every filter level adds at most one node and one edge, plus the root
+    size_t exact_slot_count = hamqtt_routes_slot_count(exact_count);
+    size_t node_limit = filter_levels > 0 ? filter_levels + 1 : 0;
+    size_t edge_slot_count = hamqtt_routes_slot_count(filter_levels);
+
+    HAMQTT_Route_Snapshot *snapshot = malloc(sizeof(HAMQTT_Route_Snapshot)
+                                             + component_count * sizeof(HAMQTT_Component *)
+                                             + route_count * sizeof(HAMQTT_Route)
+                                             + route_count * sizeof(HAMQTT_Route_Link)
+                                             + exact_slot_count * sizeof(size_t)
+                                             + node_limit * sizeof(HAMQTT_Route_Node)
+                                             + edge_slot_count * sizeof(HAMQTT_Route_Edge)
+                                             + topic_bytes);
+    ESP_RETURN_ON_FALSE(snapshot, ESP_ERR_NO_MEM, TAG, "Unable to allocate space for route table");
+
+    HAMQTT_Component **snapshot_components = (HAMQTT_Component **)(snapshot + 1);
+    HAMQTT_Route *snapshot_routes = (HAMQTT_Route *)(snapshot_components + component_count);
+    HAMQTT_Route_Link *links = (HAMQTT_Route_Link *)(snapshot_routes + route_count);
+    size_t *exact_slots = (size_t *)(links + route_count);
+    HAMQTT_Route_Node *nodes = (HAMQTT_Route_Node *)(exact_slots + exact_slot_count);
+    HAMQTT_Route_Edge *edges = (HAMQTT_Route_Edge *)(nodes + node_limit);
+    char *cursor = (char *)(edges + edge_slot_count);
+
+    size_t route = 0;
+    for (size_t i = 0; i < component_count; ++i) {
+        snapshot_components[i] = components[i];
+
+        size_t topic_count = 0;
+        const char *const *topics = hamqtt_component_get_subscribed_topics(components[i], &topic_count);
+
+        for (size_t j = 0; j < topic_count; ++j) {
+            if (!topics[j]) continue;
+
+            size_t topic_size = strlen(topics[j]) + 1;
+            memcpy(cursor, topics[j], topic_size);
+
+            snapshot_routes[route++] = (HAMQTT_Route){
+                .topic = cursor,
+                .component = components[i],
+                .index = i,
+            };
+            cursor += topic_size;
+        }
+    }
+
+    *snapshot = (HAMQTT_Route_Snapshot){
+        .table = {
+            .component_count = component_count,
+            .components = snapshot_components,
+            .route_count = route_count,
+            .routes = snapshot_routes,
+        },
+        .links = links,
+        .exact_slots = exact_slots,
+        .exact_slot_count = exact_slot_count,
+        .nodes = nodes,
+        .node_count = 0,
+        .edges = edges,
+        .edge_slot_count = edge_slot_count,
+    };
+
+    for (size_t i = 0; i < exact_slot_count; ++i) exact_slots[i] = HAMQTT_ROUTES_NONE;
+    for (size_t i = 0; i < edge_slot_count; ++i) edges[i].child = HAMQTT_ROUTES_NONE;
+
+    for (size_t i = 0; i < route_count; ++i) {
+        links[i].next = HAMQTT_ROUTES_NONE;
+
+        size_t levels = 0;
+        if (hamqtt_routes_is_filter(snapshot_routes[i].topic, &levels)) {
+            hamqtt_routes_index_filter(snapshot, i);
+        } else {
+            hamqtt_routes_index_exact(snapshot, i);
+        }
+    }
+
+    atomic_store(&routes->current, snapshot);
+
+    hamqtt_routes_retire(routes, current);
+    hamqtt_routes_reclaim(routes);
+
+    return ESP_OK;
+}
+
+const HAMQTT_Route_Table *hamqtt_routes_enter(HAMQTT_Routes *routes, HAMQTT_Routes_Reader reader) {
+    atomic_fetch_add(&routes->readers[reader], 1);
+
+    return &atomic_load(&routes->current)->table;
+}
+
+size_t hamqtt_routes_match(const HAMQTT_Route_Table *table,
+                           const char *topic,
+                           size_t topic_len,
+                           HAMQTT_Route_Visitor visit,
+                           void *context) {
+    // The table is the first member of its snapshot
+    const HAMQTT_Route_Snapshot *snapshot = (const HAMQTT_Route_Snapshot *)table;
+    size_t count = 0;
+
+    if (snapshot->exact_slot_count > 0) {
+        uint32_t hash = hamqtt_routes_hash(HAMQTT_ROUTES_HASH_SEED, topic, topic_len);
+        size_t mask = snapshot->exact_slot_count - 1;
+
+        for (size_t i = hash & mask; snapshot->exact_slots[i] != HAMQTT_ROUTES_NONE; i = (i + 1) & mask) {
+            size_t first = snapshot->exact_slots[i];
+            const char *route_topic = snapshot->table.routes[first].topic;
+
+            if (snapshot->links[first].hash == hash
+                && strnlen(route_topic, topic_len + 1) == topic_len && memcmp(route_topic, topic, topic_len) == 0) {
+                count += hamqtt_routes_visit(snapshot, first, visit, context);
+                break;
+            }
+        }
+    }
+
+    // Without filters, the exact match is all there is
+    if (snapshot->node_count > 0) {
+        bool wildcards = topic_len == 0 || topic[0] != '$';
+        count += hamqtt_routes_walk(snapshot, 0, topic, topic + topic_len, wildcards, visit, context);
+    }
+
+    return count;
+}
+
+void hamqtt_routes_exit(HAMQTT_Routes *routes, HAMQTT_Routes_Reader reader) {
+    atomic_uint_least32_t *state = &routes->readers[reader];
+    uint32_t expected = atomic_load(state);
+    uint32_t desired;
+
+    // Leaving the outermost section is a quiescent state, counted in the same step
+    do {
+        desired = (expected & HAMQTT_ROUTES_NESTING_MASK) == 1
+                ? expected - 1 + (1U << HAMQTT_ROUTES_NESTING_BITS)
+                : expected - 1;
+    } while (!atomic_compare_exchange_weak(state, &expected, desired));
+}
+
+size_t hamqtt_routes_retired_count(const HAMQTT_Routes *routes) {
+    size_t count = 0;
+    for (const HAMQTT_Route_Snapshot *snapshot = routes->retired; snapshot; snapshot = snapshot->next_retired) count++;
+
+    return count;
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_rules.c
+ * @brief Compilation of local automation rules into a dispatch table.
+ *
+ * Unique ids are only looked up here, once. The table is one allocation holding the trigger
+ * sensors, their slices and the resolved actions, grouped by sensor and then by state.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include "HAMQTT/hamqtt_rules_internal.h"
+#include "HAMQTT/hamqtt_binary_sensor.h"
+#include "HAMQTT/hamqtt_button.h"
+
+static const char *TAG = "HAMQTT_Rules";
+
+struct HAMQTT_Rules {
+    size_t sensor_count;
+    HAMQTT_Binary_Sensor **sensors;
+    HAMQTT_Rule_Slice *slices;
+
+    // Followed by the sensors, the slices and the entries
+};
+
+/* ----- Private HAMQTT Rules function definitions ----- */
+
+#if CONFIG_HAMQTT_COMPONENT_BUTTON
+static void hamqtt_rules_press(bool state, void *args) {
+    HAMQTT_Button *button = (HAMQTT_Button *)args;
+
+    if (!button->on_press_func) {
+        ESP_LOGE(TAG, "Button is missing on_press_func");
+        return;
+    }
+
+    button->on_press_func(button->on_press_func_args);
+}
+#endif
+
+static HAMQTT_Component *hamqtt_rules_find(HAMQTT_Component *const *components, size_t component_count, const char *unique_id) {
+    if (!unique_id) return NULL;
+
+    for (size_t i = 0; i < component_count; ++i) {
+        if (strcmp(hamqtt_component_get_unique_id(components[i]), unique_id) == 0) return components[i];
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Resolve the trigger and action of one rule.
+ */
+static esp_err_t hamqtt_rules_resolve(const HAMQTT_Rule *rule,
+                                      HAMQTT_Component *const *components,
+                                      size_t component_count,
+                                      HAMQTT_Binary_Sensor **trigger,
+                                      HAMQTT_Rule_Entry *entry) {
+    ESP_RETURN_ON_FALSE(rule->when & HAMQTT_RULE_WHEN_CHANGED,
+                        ESP_ERR_INVALID_ARG,
+                        TAG,
+                        "Rule on %s never runs", rule->trigger ? rule->trigger : "(null)");
+
+    HAMQTT_Component *component = hamqtt_rules_find(components, component_count, rule->trigger);
+    ESP_RETURN_ON_FALSE(component,
+                        ESP_ERR_NOT_FOUND,
+                        TAG,
+                        "Rule trigger %s is not a component of the device", rule->trigger ? rule->trigger : "(null)");
+    ESP_RETURN_ON_FALSE(component->v == &hamqtt_binary_sensor_vtable,
+                        ESP_ERR_INVALID_ARG,
+                        TAG,
+                        "Rule trigger %s is not a binary sensor", rule->trigger);
+
+    *trigger = (HAMQTT_Binary_Sensor *)component;
+
+    switch (rule->action) {
+#if CONFIG_HAMQTT_COMPONENT_BUTTON
+        case HAMQTT_RULE_ACTION_PRESS:
+            component = hamqtt_rules_find(components, component_count, rule->target);
+            ESP_RETURN_ON_FALSE(component,
+                                ESP_ERR_NOT_FOUND,
+                                TAG,
+                                "Rule target %s is not a component of the device", rule->target ? rule->target : "(null)");
+            ESP_RETURN_ON_FALSE(component->v == &hamqtt_button_vtable,
+                                ESP_ERR_INVALID_ARG,
+                                TAG,
+                                "Rule target %s is not a button", rule->target);
+
+            *entry = (HAMQTT_Rule_Entry){ .func = hamqtt_rules_press, .args = component };
+            return ESP_OK;
+#endif
+
+        case HAMQTT_RULE_ACTION_CALL:
+            ESP_RETURN_ON_FALSE(rule->func,
+                                ESP_ERR_INVALID_ARG,
+                                TAG,
+                                "Rule on %s has no function to call", rule->trigger);
+
+            *entry = (HAMQTT_Rule_Entry){ .func = rule->func, .args = rule->func_args };
+            return ESP_OK;
+
+        default:
+            ESP_LOGE(TAG, "Rule on %s has an unsupported action %d", rule->trigger, (int)rule->action);
+            return ESP_ERR_INVALID_ARG;
+    }
+}
+
+/* ----- HAMQTT Rules function definitions ----- */
+
+esp_err_t hamqtt_rules_compile(const HAMQTT_Rule *rules,
+                               size_t rule_count,
+                               HAMQTT_Component *const *components,
+                               size_t component_count,
+                               HAMQTT_Rules **compiled) {
+    esp_err_t ret = ESP_OK;
+    HAMQTT_Rules *table = NULL;
+
+    HAMQTT_Binary_Sensor **triggers = malloc(rule_count * sizeof(HAMQTT_Binary_Sensor *) + 1);
+    HAMQTT_Rule_Entry *resolved = malloc(rule_count * sizeof(HAMQTT_Rule_Entry) + 1);
+    ESP_GOTO_ON_FALSE(triggers && resolved, ESP_ERR_NO_MEM, cleanup, TAG, "Unable to allocate space for rules");
+
+    size_t sensor_count = 0;
+    size_t entry_count = 0;
+    for (size_t i = 0; i < rule_count; ++i) {
+        ESP_GOTO_ON_ERROR(hamqtt_rules_resolve(&rules[i], components, component_count, &triggers[i], &resolved[i]),
+                          cleanup,
+                          TAG,
+                          "Failed to compile rule %d", (int)i);
+
+        // Rules are few and only compiled once, so a quadratic search for the first use is fine
+        size_t first = 0;
+        while (triggers[first] != triggers[i]) first++;
+
+        if (first == i) {
+            ESP_GOTO_ON_FALSE(!triggers[i]->rules,
+                              ESP_ERR_INVALID_STATE,
+                              cleanup,
+                              TAG,
+                              "Binary sensor %s already triggers rules of another device", rules[i].trigger);
+            sensor_count++;
+        }
+
+        entry_count += (rules[i].when & HAMQTT_RULE_WHEN_ON ? 1 : 0) + (rules[i].when & HAMQTT_RULE_WHEN_OFF ? 1 : 0);
+    }
+
+    table = malloc(sizeof(HAMQTT_Rules)
+                   + sensor_count * sizeof(HAMQTT_Binary_Sensor *)
+                   + sensor_count * sizeof(HAMQTT_Rule_Slice)
+                   + entry_count * sizeof(HAMQTT_Rule_Entry));
+    ESP_GOTO_ON_FALSE(table, ESP_ERR_NO_MEM, cleanup, TAG, "Unable to allocate space for rule table");
+
+    table->sensor_count = 0;
+    table->sensors = (HAMQTT_Binary_Sensor **)(table + 1);
+    table->slices = (HAMQTT_Rule_Slice *)(table->sensors + sensor_count);
+    HAMQTT_Rule_Entry *cursor = (HAMQTT_Rule_Entry *)(table->slices + sensor_count);
+
+    for (size_t i = 0; i < rule_count; ++i) {
+        size_t first = 0;
+        while (triggers[first] != triggers[i]) first++;
+        if (first != i) continue;
+
+        HAMQTT_Rule_Slice *slice = &table->slices[table->sensor_count];
+        table->sensors[table->sensor_count++] = triggers[i];
+
+        // Index 0 holds the actions for turning OFF, index 1 those for turning ON
+        for (int state = 0; state < 2; ++state) {
+            HAMQTT_Rule_When edge = state ? HAMQTT_RULE_WHEN_ON : HAMQTT_RULE_WHEN_OFF;
+
+            slice->entries[state] = cursor;
+            slice->count[state] = 0;
+
+            for (size_t j = i; j < rule_count; ++j) {
+                if (triggers[j] != triggers[i] || !(rules[j].when & edge)) continue;
+
+                *cursor++ = resolved[j];
+                slice->count[state]++;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < table->sensor_count; ++i) {
+        table->sensors[i]->rules = &table->slices[i];
+    }
+
+    ESP_LOGI(TAG, "Compiled %d rules into %d actions on %d sensors", (int)rule_count, (int)entry_count, (int)sensor_count);
+
+    *compiled = table;
+
+cleanup:
+    free(triggers);
+    free(resolved);
+
+    return ret;
+}
+
+void hamqtt_rules_destroy(HAMQTT_Rules *rules) {
+    if (!rules) return;
+
+    for (size_t i = 0; i < rules->sensor_count; ++i) {
+        rules->sensors[i]->rules = NULL;
+    }
+
+    free(rules);
+}
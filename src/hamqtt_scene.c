@@ -0,0 +1,334 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_scene.c
+ * @brief Parsing and applying scenes.
+ *
+ * The parser walks the payload once, without cJSON or the heap. Unescaped unique ids and
+ * values are written back to back, NUL terminated, into a buffer as large as the largest
+ * payload, which always fits them: every key loses two quotes and every value at least its
+ * separator. Components are resolved during the parse, so applying is a loop of callbacks.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <ctype.h>
+#include <stdatomic.h>
+
+#include "HAMQTT/hamqtt_scene_internal.h"
+
+#define HAMQTT_SCENE_MAX_PAYLOAD CONFIG_HAMQTT_SCENE_MAX_PAYLOAD
+#define HAMQTT_SCENE_MAX_ENTITIES CONFIG_HAMQTT_SCENE_MAX_ENTITIES
+
+static const char *TAG = "HAMQTT_Scene";
+
+typedef struct {
+    HAMQTT_Component *component;
+    const char *topic;                  // The component's first subscribed topic
+    const char *value;
+} HAMQTT_Scene_Entry;
+
+struct HAMQTT_Scene {
+    char *topic;
+    char *state_topic;
+
+    atomic_bool busy;                   // A scene is being applied or waits in `payload`
+    size_t payload_len;
+    char payload[HAMQTT_SCENE_MAX_PAYLOAD];
+
+    // Unescaped unique ids and values of the scene being applied
+    char text[HAMQTT_SCENE_MAX_PAYLOAD];
+    size_t entry_count;
+    HAMQTT_Scene_Entry entries[HAMQTT_SCENE_MAX_ENTITIES];
+};
+
+typedef struct {
+    const char *cursor;
+    const char *end;
+    char *text;                         // Next free byte of the scene's text buffer
+    char *text_end;
+} HAMQTT_Scene_Parser;
+
+/* ----- Private HAMQTT Scene function definitions ----- */
+
+static void hamqtt_scene_skip_space(HAMQTT_Scene_Parser *parser) {
+    while (parser->cursor < parser->end
+           && (*parser->cursor == ' ' || *parser->cursor == '\t' || *parser->cursor == '\n' || *parser->cursor == '\r')) {
+        parser->cursor++;
+    }
+}
+
+static bool hamqtt_scene_consume(HAMQTT_Scene_Parser *parser, char expected) {
+    hamqtt_scene_skip_space(parser);
+
+    if (parser->cursor >= parser->end || *parser->cursor != expected) return false;
+
+    parser->cursor++;
+    return true;
+}
+
+static bool hamqtt_scene_is_literal(char c) {
+    return isalnum((unsigned char)c) || c == '-' || c == '+' || c == '.';
+}
+
+/**
+ * @brief Read a string, or a number or literal if `allow_literal`, into the text buffer.
+ *
+ * Strings are unescaped. `\u` escapes are rejected, unique ids and commands do not need them.
+ */
+static esp_err_t hamqtt_scene_read_token(HAMQTT_Scene_Parser *parser, bool allow_literal, const char **token) {
+    hamqtt_scene_skip_space(parser);
+
+    char *out = parser->text;
+
+    if (parser->cursor < parser->end && *parser->cursor == '"') {
+        parser->cursor++;
+
+        while (true) {
+            if (parser->cursor >= parser->end) return ESP_ERR_INVALID_ARG;
+
+            char c = *parser->cursor++;
+            if (c == '"') break;
+            if ((unsigned char)c < 0x20) return ESP_ERR_INVALID_ARG;
+
+            if (c == '\\') {
+                if (parser->cursor >= parser->end) return ESP_ERR_INVALID_ARG;
+
+                switch (*parser->cursor++) {
+                    case '"':  c = '"';  break;
+                    case '\\': c = '\\'; break;
+                    case '/':  c = '/';  break;
+                    case 'b':  c = '\b'; break;
+                    case 'f':  c = '\f'; break;
+                    case 'n':  c = '\n'; break;
+                    case 'r':  c = '\r'; break;
+                    case 't':  c = '\t'; break;
+                    default:   return ESP_ERR_INVALID_ARG;
+                }
+            }
+
+            if (out >= parser->text_end - 1) return ESP_ERR_INVALID_SIZE;
+            *out++ = c;
+        }
+    } else if (allow_literal) {
+        while (parser->cursor < parser->end && hamqtt_scene_is_literal(*parser->cursor)) {
+            if (out >= parser->text_end - 1) return ESP_ERR_INVALID_SIZE;
+            *out++ = *parser->cursor++;
+        }
+
+        if (out == parser->text) return ESP_ERR_INVALID_ARG;
+    } else {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *out++ = '\0';
+    *token = parser->text;
+    parser->text = out;
+
+    return ESP_OK;
+}
+
+static HAMQTT_Component *hamqtt_scene_find(const HAMQTT_Route_Table *table, const char *unique_id) {
+    for (size_t i = 0; i < table->component_count; ++i) {
+        if (strcmp(hamqtt_component_get_unique_id(table->components[i]), unique_id) == 0) return table->components[i];
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Parse the whole scene and resolve every component, without running anything.
+ */
+static esp_err_t hamqtt_scene_parse(HAMQTT_Scene *scene, const HAMQTT_Route_Table *table, const char *payload, size_t payload_len) {
+    HAMQTT_Scene_Parser parser = {
+        .cursor = payload,
+        .end = payload + payload_len,
+        .text = scene->text,
+        .text_end = scene->text + sizeof(scene->text),
+    };
+
+    scene->entry_count = 0;
+
+    ESP_RETURN_ON_FALSE(hamqtt_scene_consume(&parser, '{'), ESP_ERR_INVALID_ARG, TAG, "Scene is not a JSON object");
+
+    if (!hamqtt_scene_consume(&parser, '}')) {
+        do {
+            const char *unique_id = NULL;
+            const char *value = NULL;
+
+            ESP_RETURN_ON_ERROR(hamqtt_scene_read_token(&parser, false, &unique_id), TAG, "Scene has an invalid unique id");
+            ESP_RETURN_ON_FALSE(hamqtt_scene_consume(&parser, ':'), ESP_ERR_INVALID_ARG, TAG, "Scene is missing a ':' after %s", unique_id);
+            ESP_RETURN_ON_ERROR(hamqtt_scene_read_token(&parser, true, &value), TAG, "Scene has an invalid value for %s", unique_id);
+
+            ESP_RETURN_ON_FALSE(scene->entry_count < HAMQTT_SCENE_MAX_ENTITIES,
+                                ESP_ERR_INVALID_SIZE,
+                                TAG,
+                                "Scene has more than %d entities", HAMQTT_SCENE_MAX_ENTITIES);
+
+            HAMQTT_Component *component = hamqtt_scene_find(table, unique_id);
+            ESP_RETURN_ON_FALSE(component, ESP_ERR_NOT_FOUND, TAG, "Scene entity %s is not a component of the device", unique_id);
+
+            size_t topic_count = 0;
+            const char *const *topics = hamqtt_component_get_subscribed_topics(component, &topic_count);
+            ESP_RETURN_ON_FALSE(topic_count > 0 && topics[0], ESP_ERR_NOT_FOUND, TAG, "Scene entity %s does not take commands", unique_id);
+
+            scene->entries[scene->entry_count++] = (HAMQTT_Scene_Entry){
+                .component = component,
+                .topic = topics[0],
+                .value = value,
+            };
+        } while (hamqtt_scene_consume(&parser, ','));
+
+        ESP_RETURN_ON_FALSE(hamqtt_scene_consume(&parser, '}'), ESP_ERR_INVALID_ARG, TAG, "Scene object is not closed");
+    }
+
+    hamqtt_scene_skip_space(&parser);
+    ESP_RETURN_ON_FALSE(parser.cursor == parser.end, ESP_ERR_INVALID_ARG, TAG, "Scene has data after the object");
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Parse, apply and report a scene. The caller holds `busy`.
+ */
+static esp_err_t hamqtt_scene_run(HAMQTT_Scene *scene,
+                                  const HAMQTT_Route_Table *table,
+                                  HAMQTT_Transport *transport,
+                                  const char *payload,
+                                  size_t payload_len) {
+    ESP_RETURN_ON_FALSE(payload_len <= HAMQTT_SCENE_MAX_PAYLOAD,
+                        ESP_ERR_INVALID_SIZE,
+                        TAG,
+                        "Scene of %d bytes is larger than %d", (int)payload_len, HAMQTT_SCENE_MAX_PAYLOAD);
+
+    ESP_RETURN_ON_ERROR(hamqtt_scene_parse(scene, table, payload, payload_len), TAG, "Scene was not applied");
+
+    // Everything is resolved, so the outputs change as close together as their callbacks allow
+    for (size_t i = 0; i < scene->entry_count; ++i) {
+        const HAMQTT_Scene_Entry *entry = &scene->entries[i];
+        hamqtt_component_handle_mqtt_message(entry->component, entry->topic, entry->value);
+    }
+
+    if (transport && scene->state_topic) {
+        hamqtt_transport_publish(transport, scene->state_topic, payload, (int)payload_len, 1, 1);
+    }
+
+    return ESP_OK;
+}
+
+/* ----- HAMQTT Scene function definitions ----- */
+
+HAMQTT_Scene *hamqtt_scene_create(void) {
+    HAMQTT_Scene *scene = calloc(1, sizeof(HAMQTT_Scene));
+    if (!scene) {
+        ESP_LOGE(TAG, "Unable to allocate space for scene");
+        return NULL;
+    }
+
+    atomic_init(&scene->busy, false);
+
+    return scene;
+}
+
+void hamqtt_scene_destroy(HAMQTT_Scene *scene) {
+    if (!scene) return;
+
+    free(scene->topic);
+    free(scene->state_topic);
+    free(scene);
+}
+
+esp_err_t hamqtt_scene_build_topics(HAMQTT_Scene *scene, const char *device_unique_id) {
+    if (scene->topic) return ESP_OK;
+
+    size_t topic_size = strlen(device_unique_id) + 10 /* /scene/set */ + 1; /* NUL */
+    size_t state_topic_size = strlen(device_unique_id) + 12 /* /scene/state */ + 1; /* NUL */
+
+    char *topic = malloc(topic_size);
+    char *state_topic = malloc(state_topic_size);
+    if (!topic || !state_topic) {
+        free(topic);
+        free(state_topic);
+        ESP_LOGE(TAG, "Unable to allocate space for scene topics");
+        return ESP_ERR_NO_MEM;
+    }
+
+    snprintf(topic, topic_size, "%s/scene/set", device_unique_id);
+    snprintf(state_topic, state_topic_size, "%s/scene/state", device_unique_id);
+
+    scene->topic = topic;
+    scene->state_topic = state_topic;
+
+    return ESP_OK;
+}
+
+const char *hamqtt_scene_get_topic(const HAMQTT_Scene *scene) {
+    return scene->topic;
+}
+
+bool hamqtt_scene_is_topic(const HAMQTT_Scene *scene, const char *topic, int topic_len) {
+    if (!scene->topic) return false;
+
+    return strncmp(scene->topic, topic, topic_len) == 0 && scene->topic[topic_len] == '\0';
+}
+
+esp_err_t hamqtt_scene_apply(HAMQTT_Scene *scene,
+                             HAMQTT_Routes *routes,
+                             HAMQTT_Routes_Reader reader,
+                             HAMQTT_Transport *transport,
+                             const char *payload,
+                             size_t payload_len) {
+    ESP_RETURN_ON_FALSE(!atomic_exchange(&scene->busy, true),
+                        ESP_ERR_INVALID_STATE,
+                        TAG,
+                        "Another scene is being applied");
+
+    const HAMQTT_Route_Table *table = hamqtt_routes_enter(routes, reader);
+    esp_err_t ret = hamqtt_scene_run(scene, table, transport, payload, payload_len);
+    hamqtt_routes_exit(routes, reader);
+
+    atomic_store(&scene->busy, false);
+
+    return ret;
+}
+
+esp_err_t hamqtt_scene_defer(HAMQTT_Scene *scene, const char *payload, size_t payload_len) {
+    ESP_RETURN_ON_FALSE(payload_len <= HAMQTT_SCENE_MAX_PAYLOAD,
+                        ESP_ERR_INVALID_SIZE,
+                        TAG,
+                        "Scene of %d bytes is larger than %d", (int)payload_len, HAMQTT_SCENE_MAX_PAYLOAD);
+
+    ESP_RETURN_ON_FALSE(!atomic_exchange(&scene->busy, true),
+                        ESP_ERR_INVALID_STATE,
+                        TAG,
+                        "Another scene is waiting to be applied");
+
+    memcpy(scene->payload, payload, payload_len);
+    scene->payload_len = payload_len;
+
+    return ESP_OK;
+}
+
+esp_err_t hamqtt_scene_apply_deferred(HAMQTT_Scene *scene, const HAMQTT_Route_Table *table, HAMQTT_Transport *transport) {
+    esp_err_t ret = hamqtt_scene_run(scene, table, transport, scene->payload, scene->payload_len);
+
+    atomic_store(&scene->busy, false);
+
+    return ret;
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_token.c
+ * @brief The payload table used by @ref hamqtt_token_decode, laid out at compile time.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include "HAMQTT/hamqtt_token_internal.h"
+
+_Static_assert(HAMQTT_TOKEN_MAX_LEN < 32, "Payload lengths must fit in the length mask");
+_Static_assert((HAMQTT_TOKEN_LENGTHS >> (HAMQTT_TOKEN_MAX_LEN + 1)) == 0, "A payload is longer than HAMQTT_TOKEN_MAX_LEN");
+_Static_assert(HAMQTT_TOKEN_COUNT <= UINT8_MAX, "Tokens must fit in a slot");
+
+#define HAMQTT_TOKEN_SLOT(name, text, last) \
+    [HAMQTT_TOKEN_HASH(sizeof(text) - 1, last)] = { text, sizeof(text) - 1, HAMQTT_TOKEN_##name },
+
+// The bits of distinct slots add up to their union, while two payloads in one slot carry into
+// another bit. A hash that stops being perfect fails the build rather than shadowing a payload.
+#define HAMQTT_TOKEN_SLOT_BIT(name, text, last) (1ull << HAMQTT_TOKEN_HASH(sizeof(text) - 1, last))
+#define HAMQTT_TOKEN_SLOT_SUM(name, text, last) + HAMQTT_TOKEN_SLOT_BIT(name, text, last)
+#define HAMQTT_TOKEN_SLOT_UNION(name, text, last) | HAMQTT_TOKEN_SLOT_BIT(name, text, last)
+
+_Static_assert(HAMQTT_TOKEN_SLOTS <= 64, "Slots must fit in the collision check");
+_Static_assert((0ull HAMQTT_TOKEN_LIST(HAMQTT_TOKEN_SLOT_SUM)) == (0ull HAMQTT_TOKEN_LIST(HAMQTT_TOKEN_SLOT_UNION)),
+               "Two payloads hash to the same slot, change HAMQTT_TOKEN_HASH");
+
+const HAMQTT_Token_Slot hamqtt_token_slots[HAMQTT_TOKEN_SLOTS] = {
+    HAMQTT_TOKEN_LIST(HAMQTT_TOKEN_SLOT)
+};
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_trace.c
+ * @brief Chrome trace event writer for host builds.
+ *
+ * Spans are written as complete ("X") events when they end. Events are formatted into a
+ * buffer and only whole events are written to the file, so a trace cut short by killing
+ * the process is still a readable (unterminated) JSON array. Each thread is named in the
+ * trace the first time it records a span.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "HAMQTT/hamqtt_trace.h"
+
+#define HAMQTT_TRACE_BUFFER_SIZE (64 * 1024)
+#define HAMQTT_TRACE_EVENT_SIZE 1024
+#define HAMQTT_TRACE_FLUSH_INTERVAL_US 1000000
+
+static const char *TAG = "HAMQTT_Trace";
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_bool trace_running;
+static int trace_fd = -1;
+static int trace_pid;
+static int64_t trace_start_us;
+static int64_t trace_last_flush_us;
+static unsigned trace_session;
+static bool trace_first_event;
+
+static char trace_buffer[HAMQTT_TRACE_BUFFER_SIZE];
+static size_t trace_buffer_len;
+
+static __thread int trace_tid;
+static __thread unsigned trace_named_session;
+
+/**
+ * @brief Write the buffered events to the file. Called with `trace_lock` held.
+ */
+static void hamqtt_trace_flush(void) {
+    size_t written = 0;
+
+    while (written < trace_buffer_len) {
+        ssize_t n = write(trace_fd, trace_buffer + written, trace_buffer_len - written);
+        if (n <= 0) break;
+        written += n;
+    }
+
+    trace_buffer_len = 0;
+    trace_last_flush_us = hamqtt_port_time_us();
+}
+
+/**
+ * @brief Append one formatted event to the buffer. Called with `trace_lock` held.
+ */
+static void hamqtt_trace_append(const char *event, size_t len) {
+    if (trace_buffer_len + len + 2 > sizeof(trace_buffer)) hamqtt_trace_flush();
+
+    if (!trace_first_event) trace_buffer[trace_buffer_len++] = ',';
+    trace_first_event = false;
+
+    memcpy(trace_buffer + trace_buffer_len, event, len);
+    trace_buffer_len += len;
+    trace_buffer[trace_buffer_len++] = '\n';
+}
+
+/**
+ * @brief Copy `str` into `out` as the contents of a JSON string, truncating to fit.
+ *
+ * @return Number of characters written, excluding the NUL terminator.
+ */
+static size_t hamqtt_trace_escape(char *out, size_t size, const char *str) {
+    size_t len = 0;
+
+    for (; *str && len + 7 < size; ++str) {
+        unsigned char c = (unsigned char)*str;
+
+        if (c == '"' || c == '\\') {
+            out[len++] = '\\';
+            out[len++] = c;
+        } else if (c < 0x20) {
+            len += snprintf(out + len, size - len, "\\u%04x", c);
+        } else {
+            out[len++] = c;
+        }
+    }
+
+    out[len] = '\0';
+    return len;
+}
+
+/**
+ * @brief Name the calling thread in the trace. Called with `trace_lock` held.
+ */
+static void hamqtt_trace_name_thread(void) {
+    char thread_name[32] = "thread";
+    pthread_getname_np(pthread_self(), thread_name, sizeof(thread_name));
+
+    char escaped[64];
+    hamqtt_trace_escape(escaped, sizeof(escaped), thread_name);
+
+    char event[HAMQTT_TRACE_EVENT_SIZE];
+    int len = snprintf(event, sizeof(event),
+                       "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s (%d)\"}}",
+                       trace_pid, trace_tid, escaped, trace_tid);
+    hamqtt_trace_append(event, len);
+
+    trace_named_session = trace_session;
+}
+
+esp_err_t hamqtt_trace_start(const char *path) {
+    pthread_mutex_lock(&trace_lock);
+
+    esp_err_t ret = ESP_OK;
+    ESP_GOTO_ON_FALSE(trace_fd < 0, ESP_ERR_INVALID_STATE, cleanup, TAG, "A trace is already being written");
+
+    trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    ESP_GOTO_ON_FALSE(trace_fd >= 0, ESP_FAIL, cleanup, TAG, "Unable to open trace file %s", path);
+
+    trace_pid = getpid();
+    trace_start_us = hamqtt_port_time_us();
+    trace_last_flush_us = trace_start_us;
+    trace_session++;
+    trace_buffer_len = 0;
+
+    trace_buffer[trace_buffer_len++] = '[';
+    trace_buffer[trace_buffer_len++] = '\n';
+    trace_first_event = true;
+
+    char event[HAMQTT_TRACE_EVENT_SIZE];
+    int len = snprintf(event, sizeof(event),
+                       "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":\"HAMQTT\"}}",
+                       trace_pid);
+    hamqtt_trace_append(event, len);
+
+    atomic_store(&trace_running, true);
+
+cleanup:
+    pthread_mutex_unlock(&trace_lock);
+    return ret;
+}
+
+void hamqtt_trace_stop(void) {
+    pthread_mutex_lock(&trace_lock);
+
+    if (trace_fd >= 0) {
+        atomic_store(&trace_running, false);
+
+        if (trace_buffer_len + 3 > sizeof(trace_buffer)) hamqtt_trace_flush();
+        memcpy(trace_buffer + trace_buffer_len, "]\n", 2);
+        trace_buffer_len += 2;
+
+        hamqtt_trace_flush();
+        close(trace_fd);
+        trace_fd = -1;
+    }
+
+    pthread_mutex_unlock(&trace_lock);
+}
+
+void hamqtt_trace_span_begin(HAMQTT_Trace_Span *span, const char *category, const char *name, const char *detail) {
+    span->category = category;
+    span->name = name;
+    span->detail = detail;
+    span->error = ESP_OK;
+    span->start_us = atomic_load_explicit(&trace_running, memory_order_relaxed) ? hamqtt_port_time_us() : -1;
+}
+
+void hamqtt_trace_span_end(const HAMQTT_Trace_Span *span) {
+    if (span->start_us < 0 || !atomic_load_explicit(&trace_running, memory_order_relaxed)) return;
+
+    int64_t end_us = hamqtt_port_time_us();
+    if (!trace_tid) trace_tid = (int)syscall(SYS_gettid);
+
+    char name[128];
+    char detail[HAMQTT_TRACE_EVENT_SIZE / 2];
+    hamqtt_trace_escape(name, sizeof(name), span->name);
+
+    char event[HAMQTT_TRACE_EVENT_SIZE];
+    int len = snprintf(event, sizeof(event),
+                       "{\"ph\":\"X\",\"cat\":\"%s\",\"name\":\"%s\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%d",
+                       span->category, name,
+                       (long long)(span->start_us - trace_start_us), (long long)(end_us - span->start_us),
+                       trace_pid, trace_tid);
+
+    if (span->detail || span->error != ESP_OK) {
+        len += snprintf(event + len, sizeof(event) - len, ",\"args\":{");
+        if (span->detail) {
+            hamqtt_trace_escape(detail, sizeof(detail), span->detail);
+            len += snprintf(event + len, sizeof(event) - len, "\"detail\":\"%s\"%s", detail, span->error != ESP_OK ? "," : "");
+        }
+        if (span->error != ESP_OK) {
+            len += snprintf(event + len, sizeof(event) - len, "\"error\":\"0x%x\"", (unsigned)span->error);
+        }
+        len += snprintf(event + len, sizeof(event) - len, "}");
+    }
+    len += snprintf(event + len, sizeof(event) - len, "}");
+
+    pthread_mutex_lock(&trace_lock);
+
+    // The trace may have been stopped, or restarted, since the check above
+    if (trace_fd >= 0 && span->start_us >= trace_start_us) {
+        if (trace_named_session != trace_session) hamqtt_trace_name_thread();
+        hamqtt_trace_append(event, len);
+        if (end_us - trace_last_flush_us > HAMQTT_TRACE_FLUSH_INTERVAL_US) hamqtt_trace_flush();
+    }
+
+    pthread_mutex_unlock(&trace_lock);
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_transport.c
+ * @brief Integration for HAMQTT MQTT transports.
+ *
+ * This file implements the dispatch helpers for `HAMQTT_Transport`.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include "HAMQTT/hamqtt_transport_internal.h"
+#include "HAMQTT/hamqtt_trace.h"
+
+HAMQTT_Transport *hamqtt_transport_default_create(void) {
+#if defined(ESP_PLATFORM)
+    return hamqtt_transport_esp_create();
+#elif defined(CONFIG_HAMQTT_TRANSPORT_POSIX)
+    return hamqtt_transport_posix_create();
+#else
+    static const char *TAG = "HAMQTT_Transport";
+    ESP_LOGE(TAG, "No default transport on this platform, set one with hamqtt_device_set_transport");
+    return NULL;
+#endif
+}
+
+/* ----- Dispatch helpers ----- */
+
+#if HAMQTT_DIAGNOSTICS
+static inline void hamqtt_transport_count_publish(HAMQTT_Transport *t, int msg_id) {
+    atomic_fetch_add_explicit(&t->publish_count, 1, memory_order_relaxed);
+    if (msg_id < 0) atomic_fetch_add_explicit(&t->publish_failures, 1, memory_order_relaxed);
+}
+
+void hamqtt_transport_get_publish_counts(
+        HAMQTT_Transport *t, uint32_t *publishes, uint32_t *failures)
+{
+    *publishes = atomic_load_explicit(&t->publish_count, memory_order_relaxed);
+    *failures = atomic_load_explicit(&t->publish_failures, memory_order_relaxed);
+}
+#endif
+
+#if HAMQTT_TRACE
+static const char *const event_names[] = {
+    [HAMQTT_TRANSPORT_EVENT_CONNECTED] = "connected",
+    [HAMQTT_TRANSPORT_EVENT_DISCONNECTED] = "disconnected",
+    [HAMQTT_TRANSPORT_EVENT_DATA] = "data",
+    [HAMQTT_TRANSPORT_EVENT_PUBLISHED] = "published",
+};
+#endif
+
+void hamqtt_transport_set_event_handler(
+        HAMQTT_Transport *t, HAMQTT_Transport_Event_Func func, void *args)
+{
+    t->event_func = func;
+    t->event_func_args = args;
+}
+
+void hamqtt_transport_dispatch_event(
+        HAMQTT_Transport *t, const HAMQTT_Transport_Event *event)
+{
+    HAMQTT_TRACE_BEGIN(event_span, "mqtt", event_names[event->type], NULL);
+    if (t->event_func) t->event_func(t->event_func_args, event);
+    HAMQTT_TRACE_END(event_span);
+}
+
+esp_err_t hamqtt_transport_init(
+        HAMQTT_Transport *t, const HAMQTT_Transport_Config *config)
+{
+    return t->v->init(t, config);
+}
+
+esp_err_t hamqtt_transport_start(
+        HAMQTT_Transport *t)
+{
+    return t->v->start(t);
+}
+
+esp_err_t hamqtt_transport_stop(
+        HAMQTT_Transport *t)
+{
+    return t->v->stop(t);
+}
+
+esp_err_t hamqtt_transport_wait_connected(
+        HAMQTT_Transport *t, uint32_t timeout_ms)
+{
+    return t->v->wait_connected(t, timeout_ms);
+}
+
+int hamqtt_transport_publish(
+        HAMQTT_Transport *t, const char *topic, const char *data, int len, int qos, int retain)
+{
+    HAMQTT_TRACE_BEGIN(publish_span, "mqtt", "publish", topic);
+    int msg_id = t->v->publish(t, topic, data, len, qos, retain);
+    HAMQTT_TRACE_END(publish_span);
+
+#if HAMQTT_DIAGNOSTICS
+    hamqtt_transport_count_publish(t, msg_id);
+#endif
+
+    return msg_id;
+}
+
+int hamqtt_transport_enqueue(
+        HAMQTT_Transport *t, const char *topic, const char *data, int len, int qos, int retain)
+{
+    HAMQTT_TRACE_BEGIN(enqueue_span, "mqtt", "enqueue", topic);
+    int msg_id = t->v->enqueue(t, topic, data, len, qos, retain);
+    HAMQTT_TRACE_END(enqueue_span);
+
+#if HAMQTT_DIAGNOSTICS
+    hamqtt_transport_count_publish(t, msg_id);
+#endif
+
+    return msg_id;
+}
+
+int hamqtt_transport_subscribe(
+        HAMQTT_Transport *t, const char *topic, int qos)
+{
+    return t->v->subscribe(t, topic, qos);
+}
+
+int hamqtt_transport_get_outbox_size(
+        HAMQTT_Transport *t)
+{
+    return t->v->get_outbox_size ? t->v->get_outbox_size(t) : -1;
+}
+
+void hamqtt_transport_destroy(
+        HAMQTT_Transport *t)
+{
+    if (!t) return;
+    t->v->destroy(t);
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_port_linux.c
+ * @brief Linux host implementation of the HAMQTT platform layer.
+ *
+ * Implements the interface declared in @ref hamqtt_port.h for host builds.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#define _GNU_SOURCE
+
+#include <malloc.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "HAMQTT/hamqtt_port.h"
+
+HAMQTT_Port_Log_Level hamqtt_port_log_level = HAMQTT_PORT_LOG_INFO;
+
+void hamqtt_port_log(HAMQTT_Port_Log_Level level, const char *tag, const char *format, ...) {
+    static const char level_chars[] = "-EWIDV";
+
+    if (level > hamqtt_port_log_level) return;
+
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%c (%s) ", level_chars[level], tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+static int64_t (*port_clock)(void *args);
+static void *port_clock_args;
+
+int64_t hamqtt_port_time_us(void) {
+    if (port_clock) return port_clock(port_clock_args);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void hamqtt_port_set_clock(int64_t (*clock)(void *args), void *args) {
+    port_clock = clock;
+    port_clock_args = args;
+}
+
+static atomic_size_t heap_min_free = SIZE_MAX;
+
+size_t hamqtt_port_heap_free(void) {
+    // Free chunks inside the arenas, the host heap grows on demand so the system's free RAM says nothing about it
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+    size_t free_bytes = mallinfo2().fordblks;
+#else
+    size_t free_bytes = (size_t)(unsigned int)mallinfo().fordblks;
+#endif
+
+    size_t min_free = atomic_load_explicit(&heap_min_free, memory_order_relaxed);
+    while (free_bytes < min_free &&
+           !atomic_compare_exchange_weak_explicit(&heap_min_free, &min_free, free_bytes, memory_order_relaxed, memory_order_relaxed)) {
+    }
+
+    return free_bytes;
+}
+
+size_t hamqtt_port_heap_min_free(void) {
+    size_t min_free = atomic_load_explicit(&heap_min_free, memory_order_relaxed);
+    return min_free == SIZE_MAX ? hamqtt_port_heap_free() : min_free;
+}
+
+uint32_t hamqtt_port_random(void) {
+    static __thread unsigned int seed;
+    if (!seed) seed = (unsigned int)hamqtt_port_time_us() ^ (unsigned int)getpid();
+
+    return ((uint32_t)rand_r(&seed) << 16) ^ (uint32_t)rand_r(&seed);
+}
+
+int hamqtt_port_core_id(void) {
+    int cpu = sched_getcpu();
+    if (cpu < 0) return 0;
+
+    return cpu < HAMQTT_PORT_MAX_CORES ? cpu : HAMQTT_PORT_MAX_CORES - 1;
+}
+
+int hamqtt_port_core_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1) return 1;
+
+    return count < HAMQTT_PORT_MAX_CORES ? (int)count : HAMQTT_PORT_MAX_CORES;
+}
+
+bool hamqtt_port_core_idle_us(int core, uint32_t *idle_us) {
+    FILE *stat = fopen("/proc/stat", "r");
+    if (!stat) return false;
+
+    char label[16];
+    snprintf(label, sizeof(label), "cpu%d", core);
+
+    char line[256];
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), stat)) {
+        unsigned long long user, nice, system, idle, iowait;
+        char name[16];
+
+        // Fields after the label are user, nice, system, idle and iowait, in clock ticks
+        if (sscanf(line, "%15s %llu %llu %llu %llu %llu", name, &user, &nice, &system, &idle, &iowait) != 6) continue;
+        if (strcmp(name, label) != 0) continue;
+
+        long ticks_per_s = sysconf(_SC_CLK_TCK);
+        *idle_us = (uint32_t)((idle + iowait) * (1000000ULL / (unsigned long long)(ticks_per_s > 0 ? ticks_per_s : 100)));
+        found = true;
+    }
+
+    fclose(stat);
+    return found;
+}
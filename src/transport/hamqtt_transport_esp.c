@@ -0,0 +1,228 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_transport_esp.c
+ * @brief ESP-IDF transport backend built on esp-mqtt and FreeRTOS event groups.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "mqtt_client.h"
+
+#include "HAMQTT/hamqtt_transport_internal.h"
+
+#define MQTT_CONNECTED_BIT BIT0
+
+static const char *TAG = "HAMQTT_Transport_ESP";
+
+typedef struct {
+    HAMQTT_Transport base;
+
+    esp_mqtt_client_handle_t mqtt_client;
+    EventGroupHandle_t mqtt_event_group;
+} HAMQTT_Transport_ESP;
+
+/**
+ * @brief Callback handler for all esp-mqtt client events, translated into transport events.
+ */
+static void hamqtt_transport_esp_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data) {
+    HAMQTT_Transport_ESP *transport = (HAMQTT_Transport_ESP *)handler_args;
+
+    esp_mqtt_event_handle_t mqtt_event = (esp_mqtt_event_handle_t)event_data;
+    HAMQTT_Transport_Event event = {};
+
+    switch (event_id)
+    {
+    case MQTT_EVENT_BEFORE_CONNECT:
+        ESP_LOGI(TAG, "MQTT Connecting");
+        return;
+
+    case MQTT_EVENT_CONNECTED:
+        xEventGroupSetBits(transport->mqtt_event_group, MQTT_CONNECTED_BIT);
+        event.type = HAMQTT_TRANSPORT_EVENT_CONNECTED;
+        break;
+
+    case MQTT_EVENT_DISCONNECTED:
+        xEventGroupClearBits(transport->mqtt_event_group, MQTT_CONNECTED_BIT);
+        event.type = HAMQTT_TRANSPORT_EVENT_DISCONNECTED;
+        break;
+
+    case MQTT_EVENT_DATA:
+        event.type = HAMQTT_TRANSPORT_EVENT_DATA;
+        event.topic = mqtt_event->topic;
+        event.topic_len = mqtt_event->topic_len;
+        event.data = mqtt_event->data;
+        event.data_len = mqtt_event->data_len;
+        break;
+
+    case MQTT_EVENT_PUBLISHED:
+        event.type = HAMQTT_TRANSPORT_EVENT_PUBLISHED;
+        event.msg_id = mqtt_event->msg_id;
+        break;
+
+    default:
+        return;
+    }
+
+    hamqtt_transport_dispatch_event(&transport->base, &event);
+}
+
+/* ----- Implementation of HAMQTT_Transport interface ----- */
+
+static esp_err_t hamqtt_transport_esp_init(HAMQTT_Transport *self,
+                                           const HAMQTT_Transport_Config *config) {
+    HAMQTT_Transport_ESP *transport = (HAMQTT_Transport_ESP *)self;
+
+    esp_mqtt_client_config_t mqtt_config = {};
+    mqtt_config.broker.address.uri = config->uri;
+
+    if (config->username) mqtt_config.credentials.username = config->username;
+    if (config->password) mqtt_config.credentials.authentication.password = config->password;
+    if (config->client_id) mqtt_config.credentials.client_id = config->client_id;
+
+    if (config->will_topic) {
+        mqtt_config.session.last_will.topic = config->will_topic;
+        mqtt_config.session.last_will.msg = config->will_msg;
+        mqtt_config.session.last_will.qos = config->will_qos;
+        mqtt_config.session.last_will.retain = config->will_retain;
+    }
+
+    // Reuse the client across reconnects rather than freeing and allocating it again
+    if (transport->mqtt_client) {
+        return esp_mqtt_set_config(transport->mqtt_client, &mqtt_config);
+    }
+
+    transport->mqtt_client = esp_mqtt_client_init(&mqtt_config);
+    ESP_RETURN_ON_FALSE(transport->mqtt_client, ESP_FAIL, TAG, "Unable to create MQTT client");
+
+    ESP_RETURN_ON_ERROR(esp_mqtt_client_register_event(transport->mqtt_client, ESP_EVENT_ANY_ID, hamqtt_transport_esp_event_handler, transport),
+                        TAG,
+                        "Failed to register MQTT event handler");
+
+    return ESP_OK;
+}
+
+static esp_err_t hamqtt_transport_esp_start(HAMQTT_Transport *self) {
+    HAMQTT_Transport_ESP *transport = (HAMQTT_Transport_ESP *)self;
+
+    ESP_RETURN_ON_FALSE(transport->mqtt_client, ESP_ERR_INVALID_STATE, TAG, "Transport was started before it was initialized");
+
+    return esp_mqtt_client_start(transport->mqtt_client);
+}
+
+static esp_err_t hamqtt_transport_esp_stop(HAMQTT_Transport *self) {
+    HAMQTT_Transport_ESP *transport = (HAMQTT_Transport_ESP *)self;
+
+    ESP_RETURN_ON_FALSE(transport->mqtt_client, ESP_ERR_INVALID_STATE, TAG, "Transport was stopped before it was initialized");
+
+    xEventGroupClearBits(transport->mqtt_event_group, MQTT_CONNECTED_BIT);
+
+    return esp_mqtt_client_stop(transport->mqtt_client);
+}
+
+static esp_err_t hamqtt_transport_esp_wait_connected(HAMQTT_Transport *self,
+                                                     uint32_t timeout_ms) {
+    HAMQTT_Transport_ESP *transport = (HAMQTT_Transport_ESP *)self;
+
+    EventBits_t bits = xEventGroupWaitBits(
+        transport->mqtt_event_group,
+        MQTT_CONNECTED_BIT,
+        pdFALSE,
+        pdFALSE,
+        pdMS_TO_TICKS(timeout_ms)
+    );
+
+    return (bits & MQTT_CONNECTED_BIT) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+static int hamqtt_transport_esp_publish(HAMQTT_Transport *self,
+                                        const char *topic,
+                                        const char *data,
+                                        int len,
+                                        int qos,
+                                        int retain) {
+    HAMQTT_Transport_ESP *transport = (HAMQTT_Transport_ESP *)self;
+    return esp_mqtt_client_publish(transport->mqtt_client, topic, data, len, qos, retain);
+}
+
+static int hamqtt_transport_esp_enqueue(HAMQTT_Transport *self,
+                                        const char *topic,
+                                        const char *data,
+                                        int len,
+                                        int qos,
+                                        int retain) {
+    HAMQTT_Transport_ESP *transport = (HAMQTT_Transport_ESP *)self;
+    return esp_mqtt_client_enqueue(transport->mqtt_client, topic, data, len, qos, retain, true);
+}
+
+static int hamqtt_transport_esp_subscribe(HAMQTT_Transport *self,
+                                          const char *topic,
+                                          int qos) {
+    HAMQTT_Transport_ESP *transport = (HAMQTT_Transport_ESP *)self;
+    return esp_mqtt_client_subscribe_single(transport->mqtt_client, topic, qos);
+}
+
+static int hamqtt_transport_esp_get_outbox_size(HAMQTT_Transport *self) {
+    HAMQTT_Transport_ESP *transport = (HAMQTT_Transport_ESP *)self;
+    return transport->mqtt_client ? esp_mqtt_client_get_outbox_size(transport->mqtt_client) : 0;
+}
+
+static void hamqtt_transport_esp_destroy(HAMQTT_Transport *self) {
+    HAMQTT_Transport_ESP *transport = (HAMQTT_Transport_ESP *)self;
+
+    if (transport->mqtt_client) esp_mqtt_client_destroy(transport->mqtt_client);
+    if (transport->mqtt_event_group) vEventGroupDelete(transport->mqtt_event_group);
+
+    free(transport);
+}
+
+static const HAMQTT_Transport_VTable hamqtt_transport_esp_vtable = {
+    .init = hamqtt_transport_esp_init,
+    .start = hamqtt_transport_esp_start,
+    .stop = hamqtt_transport_esp_stop,
+    .wait_connected = hamqtt_transport_esp_wait_connected,
+    .publish = hamqtt_transport_esp_publish,
+    .enqueue = hamqtt_transport_esp_enqueue,
+    .subscribe = hamqtt_transport_esp_subscribe,
+    .destroy = hamqtt_transport_esp_destroy,
+    .get_outbox_size = hamqtt_transport_esp_get_outbox_size,
+};
+
+/* ----- Public HAMQTT Transport ESP function definitions ----- */
+
+HAMQTT_Transport *hamqtt_transport_esp_create(void) {
+    HAMQTT_Transport_ESP *transport = calloc(1, sizeof(HAMQTT_Transport_ESP));
+    if (!transport) {
+        ESP_LOGE(TAG, "Unable to allocate space for HAMQTT Transport");
+        return NULL;
+    }
+
+    transport->base.v = &hamqtt_transport_esp_vtable;
+
+    transport->mqtt_event_group = xEventGroupCreate();
+    if (!transport->mqtt_event_group) {
+        ESP_LOGE(TAG, "Unable to create MQTT event group");
+        free(transport);
+        return NULL;
+    }
+
+    return &transport->base;
+}
@@ -0,0 +1,355 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_transport_mock.c
+ * @brief Deterministic in-process transport backend.
+ *
+ * Publishes and subscriptions are copied into buffers allocated at creation time, so
+ * recording them does not add heap traffic to the measurements of the code under test.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include "HAMQTT/hamqtt_transport_mock.h"
+#include "HAMQTT/hamqtt_transport_internal.h"
+
+static const char *TAG = "HAMQTT_Transport_Mock";
+
+typedef struct {
+    HAMQTT_Transport base;
+
+    HAMQTT_Transport_Mock_Config config;
+
+    bool started;
+    bool connected;
+    uint64_t time_ms;
+    int next_msg_id;
+
+    HAMQTT_Transport_Mock_Publish *publishes;
+    size_t publish_count;
+    size_t dropped_count;
+
+    char *buffer;
+    size_t buffer_used;
+
+    char **subscriptions;               // max_subscriptions pointers into subscription_topics
+    char *subscription_topics;          // max_subscriptions slots of HAMQTT_MAX_CHAR_BUF_SIZE bytes
+    size_t subscription_count;
+} HAMQTT_Transport_Mock;
+
+HAMQTT_Transport_Mock_Config hamqtt_transport_mock_config_default(void) {
+    HAMQTT_Transport_Mock_Config config = {
+        .max_publishes = 1024,
+        .buffer_size = 64 * 1024,
+        .max_subscriptions = 2 * HAMQTT_DEVICE_MAX_COMPONENTS,
+        .auto_connect = true,
+        .auto_ack = false,
+        .drive_port_clock = false,
+    };
+    return config;
+}
+
+/* ----- Private HAMQTT Transport Mock function definitions ----- */
+
+/**
+ * @brief Copies `len` bytes into the record buffer and NUL terminates them.
+ *
+ * @return Pointer to the copy, or NULL if the buffer is full.
+ */
+static char *hamqtt_transport_mock_store(HAMQTT_Transport_Mock *transport, const char *str, size_t len) {
+    if (transport->buffer_used + len + 1 > transport->config.buffer_size) return NULL;
+
+    char *copy = transport->buffer + transport->buffer_used;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    transport->buffer_used += len + 1;
+
+    return copy;
+}
+
+#ifndef ESP_PLATFORM
+static int64_t hamqtt_transport_mock_clock(void *args) {
+    return (int64_t)((HAMQTT_Transport_Mock *)args)->time_ms * 1000;
+}
+#endif
+
+static void hamqtt_transport_mock_set_connected(HAMQTT_Transport_Mock *transport, bool connected) {
+    transport->connected = connected;
+
+    if (!connected) transport->subscription_count = 0;
+
+    HAMQTT_Transport_Event event = {
+        .type = connected ? HAMQTT_TRANSPORT_EVENT_CONNECTED : HAMQTT_TRANSPORT_EVENT_DISCONNECTED,
+    };
+    hamqtt_transport_dispatch_event(&transport->base, &event);
+}
+
+/* ----- Implementation of HAMQTT_Transport interface ----- */
+
+static esp_err_t hamqtt_transport_mock_init(HAMQTT_Transport *self,
+                                            const HAMQTT_Transport_Config *config) {
+    HAMQTT_Transport_Mock *transport = (HAMQTT_Transport_Mock *)self;
+
+    ESP_RETURN_ON_FALSE(!transport->started, ESP_ERR_INVALID_STATE, TAG, "Transport must be stopped before it is initialized again");
+
+    return ESP_OK;
+}
+
+static esp_err_t hamqtt_transport_mock_start(HAMQTT_Transport *self) {
+    HAMQTT_Transport_Mock *transport = (HAMQTT_Transport_Mock *)self;
+
+    transport->started = true;
+    if (transport->config.auto_connect) hamqtt_transport_mock_set_connected(transport, true);
+
+    return ESP_OK;
+}
+
+static esp_err_t hamqtt_transport_mock_stop(HAMQTT_Transport *self) {
+    HAMQTT_Transport_Mock *transport = (HAMQTT_Transport_Mock *)self;
+
+    ESP_RETURN_ON_FALSE(transport->started, ESP_ERR_INVALID_STATE, TAG, "Transport was stopped before it was started");
+
+    transport->started = false;
+    if (transport->connected) hamqtt_transport_mock_set_connected(transport, false);
+
+    return ESP_OK;
+}
+
+static esp_err_t hamqtt_transport_mock_wait_connected(HAMQTT_Transport *self,
+                                                      uint32_t timeout_ms) {
+    HAMQTT_Transport_Mock *transport = (HAMQTT_Transport_Mock *)self;
+
+    // Nothing can connect the transport while the caller is blocked, so time out right away
+    if (transport->connected) return ESP_OK;
+
+    transport->time_ms += timeout_ms;
+    return ESP_ERR_TIMEOUT;
+}
+
+static int hamqtt_transport_mock_publish(HAMQTT_Transport *self,
+                                         const char *topic,
+                                         const char *data,
+                                         int len,
+                                         int qos,
+                                         int retain) {
+    HAMQTT_Transport_Mock *transport = (HAMQTT_Transport_Mock *)self;
+
+    if (!transport->connected) return -1;
+    if (len <= 0) len = (int)strlen(data);
+
+    int msg_id = qos > 0 ? ++transport->next_msg_id : 0;
+
+    size_t buffer_used = transport->buffer_used;
+    const char *topic_copy = NULL;
+    const char *data_copy = NULL;
+
+    if (transport->publish_count < transport->config.max_publishes) {
+        topic_copy = hamqtt_transport_mock_store(transport, topic, strlen(topic));
+        data_copy = topic_copy ? hamqtt_transport_mock_store(transport, data, len) : NULL;
+    }
+
+    if (data_copy) {
+        transport->publishes[transport->publish_count++] = (HAMQTT_Transport_Mock_Publish){
+            .topic = topic_copy,
+            .data = data_copy,
+            .data_len = len,
+            .qos = qos,
+            .retain = retain,
+            .msg_id = msg_id,
+            .time_ms = transport->time_ms,
+        };
+    } else {
+        transport->buffer_used = buffer_used;
+        transport->dropped_count++;
+    }
+
+    if (msg_id > 0 && transport->config.auto_ack) {
+        HAMQTT_Transport_Event event = {
+            .type = HAMQTT_TRANSPORT_EVENT_PUBLISHED,
+            .msg_id = msg_id,
+        };
+        hamqtt_transport_dispatch_event(&transport->base, &event);
+    }
+
+    return msg_id;
+}
+
+static int hamqtt_transport_mock_subscribe(HAMQTT_Transport *self,
+                                           const char *topic,
+                                           int qos) {
+    HAMQTT_Transport_Mock *transport = (HAMQTT_Transport_Mock *)self;
+
+    if (!transport->connected) return -1;
+
+    ESP_RETURN_ON_FALSE(transport->subscription_count < transport->config.max_subscriptions,
+                        -1,
+                        TAG,
+                        "Subscription buffer is full! No more than %d subscriptions can be recorded",
+                        (int)transport->config.max_subscriptions);
+
+    size_t topic_size = strlen(topic) + 1;
+    ESP_RETURN_ON_FALSE(topic_size <= HAMQTT_MAX_CHAR_BUF_SIZE,
+                        -1,
+                        TAG,
+                        "Subscription topic %s is longer than %d bytes",
+                        topic,
+                        HAMQTT_MAX_CHAR_BUF_SIZE - 1);
+
+    memcpy(transport->subscriptions[transport->subscription_count++], topic, topic_size);
+
+    return ++transport->next_msg_id;
+}
+
+static void hamqtt_transport_mock_destroy(HAMQTT_Transport *self) {
+    HAMQTT_Transport_Mock *transport = (HAMQTT_Transport_Mock *)self;
+
+#ifndef ESP_PLATFORM
+    if (transport->config.drive_port_clock) hamqtt_port_set_clock(NULL, NULL);
+#endif
+
+    free(transport->subscriptions);
+    free(transport->subscription_topics);
+    free(transport->publishes);
+    free(transport->buffer);
+    free(transport);
+}
+
+static const HAMQTT_Transport_VTable hamqtt_transport_mock_vtable = {
+    .init = hamqtt_transport_mock_init,
+    .start = hamqtt_transport_mock_start,
+    .stop = hamqtt_transport_mock_stop,
+    .wait_connected = hamqtt_transport_mock_wait_connected,
+    .publish = hamqtt_transport_mock_publish,
+    .enqueue = hamqtt_transport_mock_publish,
+    .subscribe = hamqtt_transport_mock_subscribe,
+    .destroy = hamqtt_transport_mock_destroy,
+};
+
+/* ----- Public HAMQTT Transport Mock function definitions ----- */
+
+HAMQTT_Transport *hamqtt_transport_mock_create(const HAMQTT_Transport_Mock_Config *config) {
+    HAMQTT_Transport_Mock *transport = calloc(1, sizeof(HAMQTT_Transport_Mock));
+    if (!transport) {
+        ESP_LOGE(TAG, "Unable to allocate space for HAMQTT Transport");
+        return NULL;
+    }
+
+    transport->base.v = &hamqtt_transport_mock_vtable;
+    transport->config = *config;
+
+    transport->publishes = calloc(config->max_publishes, sizeof(HAMQTT_Transport_Mock_Publish));
+    transport->buffer = malloc(config->buffer_size);
+    transport->subscriptions = calloc(config->max_subscriptions, sizeof(char *));
+    transport->subscription_topics = malloc(config->max_subscriptions * HAMQTT_MAX_CHAR_BUF_SIZE);
+
+    // Not installed yet, so destroy must not uninstall it
+    transport->config.drive_port_clock = false;
+
+    if ((config->max_publishes && !transport->publishes) ||
+        (config->buffer_size && !transport->buffer) ||
+        (config->max_subscriptions && (!transport->subscriptions || !transport->subscription_topics))) {
+        ESP_LOGE(TAG, "Unable to allocate space for HAMQTT Transport buffers");
+        hamqtt_transport_mock_destroy(&transport->base);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < config->max_subscriptions; ++i) {
+        transport->subscriptions[i] = transport->subscription_topics + i * HAMQTT_MAX_CHAR_BUF_SIZE;
+    }
+
+    if (config->drive_port_clock) {
+#ifndef ESP_PLATFORM
+        hamqtt_port_set_clock(hamqtt_transport_mock_clock, transport);
+        transport->config.drive_port_clock = true;
+#else
+        ESP_LOGE(TAG, "drive_port_clock is only supported on host builds");
+        hamqtt_transport_mock_destroy(&transport->base);
+        return NULL;
+#endif
+    }
+
+    return &transport->base;
+}
+
+void hamqtt_transport_mock_connect(HAMQTT_Transport *self) {
+    hamqtt_transport_mock_set_connected((HAMQTT_Transport_Mock *)self, true);
+}
+
+void hamqtt_transport_mock_disconnect(HAMQTT_Transport *self) {
+    hamqtt_transport_mock_set_connected((HAMQTT_Transport_Mock *)self, false);
+}
+
+void hamqtt_transport_mock_inject_message(HAMQTT_Transport *self, const char *topic, const char *data, int len) {
+    HAMQTT_Transport_Event event = {
+        .type = HAMQTT_TRANSPORT_EVENT_DATA,
+        .topic = topic,
+        .topic_len = (int)strlen(topic),
+        .data = data,
+        .data_len = len > 0 ? len : (int)strlen(data),
+    };
+    hamqtt_transport_dispatch_event(self, &event);
+}
+
+void hamqtt_transport_mock_advance(HAMQTT_Transport *self, uint32_t ms) {
+    ((HAMQTT_Transport_Mock *)self)->time_ms += ms;
+}
+
+uint64_t hamqtt_transport_mock_get_time_ms(const HAMQTT_Transport *self) {
+    return ((const HAMQTT_Transport_Mock *)self)->time_ms;
+}
+
+size_t hamqtt_transport_mock_get_publish_count(const HAMQTT_Transport *self) {
+    return ((const HAMQTT_Transport_Mock *)self)->publish_count;
+}
+
+size_t hamqtt_transport_mock_get_dropped_count(const HAMQTT_Transport *self) {
+    return ((const HAMQTT_Transport_Mock *)self)->dropped_count;
+}
+
+const HAMQTT_Transport_Mock_Publish *hamqtt_transport_mock_get_publish(const HAMQTT_Transport *self, size_t index) {
+    const HAMQTT_Transport_Mock *transport = (const HAMQTT_Transport_Mock *)self;
+
+    if (index >= transport->publish_count) return NULL;
+    return &transport->publishes[index];
+}
+
+const HAMQTT_Transport_Mock_Publish *hamqtt_transport_mock_find_publish(const HAMQTT_Transport *self, const char *topic) {
+    const HAMQTT_Transport_Mock *transport = (const HAMQTT_Transport_Mock *)self;
+
+    for (size_t i = transport->publish_count; i > 0; --i) {
+        if (strcmp(transport->publishes[i - 1].topic, topic) == 0) return &transport->publishes[i - 1];
+    }
+
+    return NULL;
+}
+
+void hamqtt_transport_mock_clear_publishes(HAMQTT_Transport *self) {
+    HAMQTT_Transport_Mock *transport = (HAMQTT_Transport_Mock *)self;
+
+    transport->publish_count = 0;
+    transport->dropped_count = 0;
+    transport->buffer_used = 0;
+}
+
+const char *const *hamqtt_transport_mock_get_subscriptions(const HAMQTT_Transport *self, size_t *count) {
+    const HAMQTT_Transport_Mock *transport = (const HAMQTT_Transport_Mock *)self;
+
+    *count = transport->subscription_count;
+    return (const char *const *)transport->subscriptions;
+}
@@ -0,0 +1,341 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_transport_posix.c
+ * @brief Linux host transport backend built on libmosquitto and pthreads.
+ *
+ * libmosquitto runs its network loop on its own thread, so events are delivered from
+ * that thread just like esp-mqtt delivers them from its task on ESP-IDF.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <mosquitto.h>
+
+#include "HAMQTT/hamqtt_transport_internal.h"
+
+#define MQTT_DEFAULT_PORT 1883
+#define MQTT_KEEPALIVE_S 60
+
+static const char *TAG = "HAMQTT_Transport_POSIX";
+
+typedef struct {
+    HAMQTT_Transport base;
+
+    struct mosquitto *mosq;
+    char host[HAMQTT_MAX_CHAR_BUF_SIZE];
+    int port;
+
+    bool loop_running;
+    bool connected;
+    pthread_mutex_t lock;
+    pthread_cond_t connected_cond;
+} HAMQTT_Transport_POSIX;
+
+static pthread_once_t mosquitto_lib_once = PTHREAD_ONCE_INIT;
+
+static void hamqtt_transport_posix_lib_init(void) {
+    mosquitto_lib_init();
+}
+
+/**
+ * @brief Splits an `mqtt://host[:port]` URI into its host and port.
+ */
+static esp_err_t hamqtt_transport_posix_parse_uri(HAMQTT_Transport_POSIX *transport, const char *uri) {
+    const char *host = strstr(uri, "://");
+    if (host) {
+        ESP_RETURN_ON_FALSE(strncmp(uri, "mqtt://", 7) == 0 || strncmp(uri, "tcp://", 6) == 0,
+                            ESP_ERR_NOT_SUPPORTED,
+                            TAG,
+                            "Unsupported MQTT URI scheme: %s",
+                            uri);
+        host += 3;
+    } else {
+        host = uri;
+    }
+
+    const char *port = strrchr(host, ':');
+    size_t host_len = port ? (size_t)(port - host) : strlen(host);
+
+    ESP_RETURN_ON_FALSE(host_len > 0 && host_len < sizeof(transport->host),
+                        ESP_ERR_INVALID_ARG,
+                        TAG,
+                        "Invalid MQTT broker host in URI: %s",
+                        uri);
+
+    memcpy(transport->host, host, host_len);
+    transport->host[host_len] = '\0';
+    transport->port = port ? atoi(port + 1) : MQTT_DEFAULT_PORT;
+
+    ESP_RETURN_ON_FALSE(transport->port > 0 && transport->port < 65536,
+                        ESP_ERR_INVALID_ARG,
+                        TAG,
+                        "Invalid MQTT broker port in URI: %s",
+                        uri);
+
+    return ESP_OK;
+}
+
+static void hamqtt_transport_posix_set_connected(HAMQTT_Transport_POSIX *transport, bool connected) {
+    pthread_mutex_lock(&transport->lock);
+    transport->connected = connected;
+    pthread_cond_broadcast(&transport->connected_cond);
+    pthread_mutex_unlock(&transport->lock);
+}
+
+/* ----- libmosquitto callbacks ----- */
+
+static void hamqtt_transport_posix_on_connect(struct mosquitto *mosq, void *obj, int rc) {
+    HAMQTT_Transport_POSIX *transport = (HAMQTT_Transport_POSIX *)obj;
+
+    if (rc != 0) {
+        ESP_LOGW(TAG, "Broker refused connection: %s", mosquitto_connack_string(rc));
+        return;
+    }
+
+    hamqtt_transport_posix_set_connected(transport, true);
+
+    HAMQTT_Transport_Event event = { .type = HAMQTT_TRANSPORT_EVENT_CONNECTED };
+    hamqtt_transport_dispatch_event(&transport->base, &event);
+}
+
+static void hamqtt_transport_posix_on_disconnect(struct mosquitto *mosq, void *obj, int rc) {
+    HAMQTT_Transport_POSIX *transport = (HAMQTT_Transport_POSIX *)obj;
+
+    hamqtt_transport_posix_set_connected(transport, false);
+
+    HAMQTT_Transport_Event event = { .type = HAMQTT_TRANSPORT_EVENT_DISCONNECTED };
+    hamqtt_transport_dispatch_event(&transport->base, &event);
+}
+
+static void hamqtt_transport_posix_on_message(struct mosquitto *mosq, void *obj, const struct mosquitto_message *message) {
+    HAMQTT_Transport_POSIX *transport = (HAMQTT_Transport_POSIX *)obj;
+
+    HAMQTT_Transport_Event event = {
+        .type = HAMQTT_TRANSPORT_EVENT_DATA,
+        .topic = message->topic,
+        .topic_len = (int)strlen(message->topic),
+        .data = (const char *)message->payload,
+        .data_len = message->payloadlen,
+    };
+    hamqtt_transport_dispatch_event(&transport->base, &event);
+}
+
+static void hamqtt_transport_posix_on_publish(struct mosquitto *mosq, void *obj, int mid) {
+    HAMQTT_Transport_POSIX *transport = (HAMQTT_Transport_POSIX *)obj;
+
+    HAMQTT_Transport_Event event = {
+        .type = HAMQTT_TRANSPORT_EVENT_PUBLISHED,
+        .msg_id = mid,
+    };
+    hamqtt_transport_dispatch_event(&transport->base, &event);
+}
+
+/* ----- Implementation of HAMQTT_Transport interface ----- */
+
+static esp_err_t hamqtt_transport_posix_init(HAMQTT_Transport *self,
+                                             const HAMQTT_Transport_Config *config) {
+    HAMQTT_Transport_POSIX *transport = (HAMQTT_Transport_POSIX *)self;
+
+    ESP_RETURN_ON_FALSE(!transport->loop_running, ESP_ERR_INVALID_STATE, TAG, "Transport must be stopped before it is initialized again");
+    ESP_RETURN_ON_ERROR(hamqtt_transport_posix_parse_uri(transport, config->uri), TAG, "Failed to parse MQTT URI");
+
+    // Reuse the client across reconnects rather than freeing and allocating it again
+    if (transport->mosq) {
+        ESP_RETURN_ON_FALSE(mosquitto_reinitialise(transport->mosq, config->client_id, true, transport) == MOSQ_ERR_SUCCESS,
+                            ESP_ERR_NO_MEM,
+                            TAG,
+                            "Unable to reinitialize MQTT client");
+    } else {
+        transport->mosq = mosquitto_new(config->client_id, true, transport);
+        ESP_RETURN_ON_FALSE(transport->mosq, ESP_ERR_NO_MEM, TAG, "Unable to create MQTT client");
+    }
+
+    mosquitto_connect_callback_set(transport->mosq, hamqtt_transport_posix_on_connect);
+    mosquitto_disconnect_callback_set(transport->mosq, hamqtt_transport_posix_on_disconnect);
+    mosquitto_message_callback_set(transport->mosq, hamqtt_transport_posix_on_message);
+    mosquitto_publish_callback_set(transport->mosq, hamqtt_transport_posix_on_publish);
+
+    if (config->username) {
+        ESP_RETURN_ON_FALSE(mosquitto_username_pw_set(transport->mosq, config->username, config->password) == MOSQ_ERR_SUCCESS,
+                            ESP_FAIL,
+                            TAG,
+                            "Failed to set MQTT credentials");
+    }
+
+    if (config->will_topic) {
+        ESP_RETURN_ON_FALSE(mosquitto_will_set(transport->mosq,
+                                               config->will_topic,
+                                               (int)strlen(config->will_msg),
+                                               config->will_msg,
+                                               config->will_qos,
+                                               config->will_retain) == MOSQ_ERR_SUCCESS,
+                            ESP_FAIL,
+                            TAG,
+                            "Failed to set MQTT last will");
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t hamqtt_transport_posix_start(HAMQTT_Transport *self) {
+    HAMQTT_Transport_POSIX *transport = (HAMQTT_Transport_POSIX *)self;
+
+    ESP_RETURN_ON_FALSE(transport->mosq, ESP_ERR_INVALID_STATE, TAG, "Transport was started before it was initialized");
+
+    int rc = mosquitto_connect_async(transport->mosq, transport->host, transport->port, MQTT_KEEPALIVE_S);
+    ESP_RETURN_ON_FALSE(rc == MOSQ_ERR_SUCCESS, ESP_FAIL, TAG, "Failed to connect to %s:%d: %s",
+                        transport->host, transport->port, mosquitto_strerror(rc));
+
+    rc = mosquitto_loop_start(transport->mosq);
+    ESP_RETURN_ON_FALSE(rc == MOSQ_ERR_SUCCESS, ESP_FAIL, TAG, "Failed to start MQTT network thread: %s", mosquitto_strerror(rc));
+
+    transport->loop_running = true;
+
+    return ESP_OK;
+}
+
+static esp_err_t hamqtt_transport_posix_stop(HAMQTT_Transport *self) {
+    HAMQTT_Transport_POSIX *transport = (HAMQTT_Transport_POSIX *)self;
+
+    ESP_RETURN_ON_FALSE(transport->loop_running, ESP_ERR_INVALID_STATE, TAG, "Transport was stopped before it was started");
+
+    mosquitto_disconnect(transport->mosq);
+    mosquitto_loop_stop(transport->mosq, false);
+
+    transport->loop_running = false;
+    hamqtt_transport_posix_set_connected(transport, false);
+
+    return ESP_OK;
+}
+
+static esp_err_t hamqtt_transport_posix_wait_connected(HAMQTT_Transport *self,
+                                                       uint32_t timeout_ms) {
+    HAMQTT_Transport_POSIX *transport = (HAMQTT_Transport_POSIX *)self;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&transport->lock);
+    int rc = 0;
+    while (!transport->connected && rc != ETIMEDOUT) {
+        rc = pthread_cond_timedwait(&transport->connected_cond, &transport->lock, &deadline);
+    }
+    bool connected = transport->connected;
+    pthread_mutex_unlock(&transport->lock);
+
+    return connected ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+static int hamqtt_transport_posix_publish(HAMQTT_Transport *self,
+                                          const char *topic,
+                                          const char *data,
+                                          int len,
+                                          int qos,
+                                          int retain) {
+    HAMQTT_Transport_POSIX *transport = (HAMQTT_Transport_POSIX *)self;
+
+    if (len <= 0) len = (int)strlen(data);
+
+    int msg_id = 0;
+    int rc = mosquitto_publish(transport->mosq, &msg_id, topic, len, data, qos, retain);
+    if (rc != MOSQ_ERR_SUCCESS) {
+        ESP_LOGW(TAG, "Failed to publish to %s: %s", topic, mosquitto_strerror(rc));
+        return -1;
+    }
+
+    return qos > 0 ? msg_id : 0;
+}
+
+static int hamqtt_transport_posix_enqueue(HAMQTT_Transport *self,
+                                          const char *topic,
+                                          const char *data,
+                                          int len,
+                                          int qos,
+                                          int retain) {
+    // libmosquitto publishes are already queued for the network thread
+    return hamqtt_transport_posix_publish(self, topic, data, len, qos, retain);
+}
+
+static int hamqtt_transport_posix_subscribe(HAMQTT_Transport *self,
+                                            const char *topic,
+                                            int qos) {
+    HAMQTT_Transport_POSIX *transport = (HAMQTT_Transport_POSIX *)self;
+
+    int msg_id = 0;
+    int rc = mosquitto_subscribe(transport->mosq, &msg_id, topic, qos);
+    if (rc != MOSQ_ERR_SUCCESS) {
+        ESP_LOGW(TAG, "Failed to subscribe to %s: %s", topic, mosquitto_strerror(rc));
+        return -1;
+    }
+
+    return msg_id;
+}
+
+static void hamqtt_transport_posix_destroy(HAMQTT_Transport *self) {
+    HAMQTT_Transport_POSIX *transport = (HAMQTT_Transport_POSIX *)self;
+
+    if (transport->loop_running) hamqtt_transport_posix_stop(self);
+    if (transport->mosq) mosquitto_destroy(transport->mosq);
+
+    pthread_cond_destroy(&transport->connected_cond);
+    pthread_mutex_destroy(&transport->lock);
+
+    free(transport);
+}
+
+static const HAMQTT_Transport_VTable hamqtt_transport_posix_vtable = {
+    .init = hamqtt_transport_posix_init,
+    .start = hamqtt_transport_posix_start,
+    .stop = hamqtt_transport_posix_stop,
+    .wait_connected = hamqtt_transport_posix_wait_connected,
+    .publish = hamqtt_transport_posix_publish,
+    .enqueue = hamqtt_transport_posix_enqueue,
+    .subscribe = hamqtt_transport_posix_subscribe,
+    .destroy = hamqtt_transport_posix_destroy,
+};
+
+/* ----- Public HAMQTT Transport POSIX function definitions ----- */
+
+HAMQTT_Transport *hamqtt_transport_posix_create(void) {
+    pthread_once(&mosquitto_lib_once, hamqtt_transport_posix_lib_init);
+
+    HAMQTT_Transport_POSIX *transport = calloc(1, sizeof(HAMQTT_Transport_POSIX));
+    if (!transport) {
+        ESP_LOGE(TAG, "Unable to allocate space for HAMQTT Transport");
+        return NULL;
+    }
+
+    transport->base.v = &hamqtt_transport_posix_vtable;
+
+    pthread_mutex_init(&transport->lock, NULL);
+    pthread_cond_init(&transport->connected_cond, NULL);
+
+    return &transport->base;
+}
@@ -0,0 +1,455 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file hamqtt_transport_record.c
+ * @brief Recording transport wrapper and recording reader.
+ *
+ * Events are recorded from the inner transport's event task and publishes from whichever
+ * task publishes, so records are encoded under a mutex. Publishes are recorded after the
+ * inner transport returns their message id, which means a PUBLISHED record can precede the
+ * PUBLISH it acknowledges when the inner transport acks synchronously.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include "HAMQTT/hamqtt_transport_record.h"
+#include "HAMQTT/hamqtt_transport_internal.h"
+
+/**
+ * @brief Longest prefix of a record before its topic and payload bytes: type, delta, flags, topic ref and length.
+ */
+#define HAMQTT_TRANSPORT_RECORD_HEADER_SIZE 48
+
+static const char *TAG = "HAMQTT_Transport_Record";
+
+static const uint8_t record_magic[4] = { 'H', 'Q', 'R', 'C' };
+
+typedef struct {
+    HAMQTT_Transport base;
+
+    HAMQTT_Transport *inner;
+    HAMQTT_Transport_Record_Write_Func write_func;
+    void *write_func_args;
+
+    HAMQTT_Port_Mutex lock;
+    int64_t last_us;
+
+    char *topics[HAMQTT_TRANSPORT_RECORD_MAX_TOPICS];
+    uint32_t topic_hashes[HAMQTT_TRANSPORT_RECORD_MAX_TOPICS];
+    size_t topic_count;
+} HAMQTT_Transport_Recorder;
+
+/* ----- Encoding ----- */
+
+static size_t hamqtt_transport_record_put_varint(uint8_t *out, uint64_t value) {
+    size_t len = 0;
+
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        out[len++] = byte | (value ? 0x80 : 0);
+    } while (value);
+
+    return len;
+}
+
+static uint32_t hamqtt_transport_record_hash(const char *topic, size_t len) {
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < len; ++i) {
+        hash = (hash ^ (uint8_t)topic[i]) * 16777619U;
+    }
+    return hash;
+}
+
+/**
+ * @brief Start a record. Called with the lock held.
+ *
+ * @return Number of bytes written to `out`.
+ */
+static size_t hamqtt_transport_record_begin(HAMQTT_Transport_Recorder *recorder, uint8_t *out, HAMQTT_Transport_Record_Type type) {
+    int64_t now_us = hamqtt_port_time_us();
+    int64_t delta_us = now_us > recorder->last_us ? now_us - recorder->last_us : 0;
+    recorder->last_us = now_us;
+
+    out[0] = (uint8_t)type;
+    return 1 + hamqtt_transport_record_put_varint(out + 1, (uint64_t)delta_us);
+}
+
+/**
+ * @brief Append a topic reference to `out`, flushing `out` and writing the topic itself
+ * if it has not been seen before. Called with the lock held.
+ *
+ * @return Number of bytes of `out` that still have to be written.
+ */
+static size_t hamqtt_transport_record_put_topic(HAMQTT_Transport_Recorder *recorder, uint8_t *out, size_t used, const char *topic) {
+    size_t len = strlen(topic);
+    uint32_t hash = hamqtt_transport_record_hash(topic, len);
+
+    for (size_t i = 0; i < recorder->topic_count; ++i) {
+        if (recorder->topic_hashes[i] == hash && recorder->topics[i] && strcmp(recorder->topics[i], topic) == 0) {
+            return used + hamqtt_transport_record_put_varint(out + used, i + 1);
+        }
+    }
+
+    // Both sides assign indices to literals only while the table has room
+    if (recorder->topic_count < HAMQTT_TRANSPORT_RECORD_MAX_TOPICS) {
+        // Readers assign the index regardless, so a failed copy just leaves the slot unmatched
+        recorder->topics[recorder->topic_count] = strdup(topic);
+        recorder->topic_hashes[recorder->topic_count] = hash;
+        recorder->topic_count++;
+    }
+
+    used += hamqtt_transport_record_put_varint(out + used, 0);
+    used += hamqtt_transport_record_put_varint(out + used, len);
+    recorder->write_func(recorder->write_func_args, out, used);
+    recorder->write_func(recorder->write_func_args, topic, len);
+
+    return 0;
+}
+
+static void hamqtt_transport_record_put_payload(HAMQTT_Transport_Recorder *recorder, uint8_t *out, size_t used, const char *data, size_t len) {
+    used += hamqtt_transport_record_put_varint(out + used, len);
+    recorder->write_func(recorder->write_func_args, out, used);
+    if (len) recorder->write_func(recorder->write_func_args, data, len);
+}
+
+static void hamqtt_transport_record_write_publish(HAMQTT_Transport_Recorder *recorder,
+                                                  const char *topic,
+                                                  const char *data,
+                                                  int len,
+                                                  int qos,
+                                                  int retain,
+                                                  bool enqueued,
+                                                  int msg_id) {
+    uint8_t out[HAMQTT_TRANSPORT_RECORD_HEADER_SIZE];
+    size_t data_len = len > 0 ? (size_t)len : (data ? strlen(data) : 0);
+
+    hamqtt_port_mutex_lock(&recorder->lock);
+
+    size_t used = hamqtt_transport_record_begin(recorder, out, HAMQTT_TRANSPORT_RECORD_PUBLISH);
+    out[used++] = (uint8_t)((qos & 0x3) | (retain ? 0x4 : 0) | (enqueued ? 0x8 : 0));
+    used = hamqtt_transport_record_put_topic(recorder, out, used, topic);
+    hamqtt_transport_record_put_payload(recorder, out, used, data, data_len);
+
+    used = hamqtt_transport_record_put_varint(out, msg_id < 0 ? 0 : (uint64_t)msg_id + 1);
+    recorder->write_func(recorder->write_func_args, out, used);
+
+    hamqtt_port_mutex_unlock(&recorder->lock);
+}
+
+/* ----- Wrapped transport ----- */
+
+static void hamqtt_transport_record_event_handler(void *handler_args, const HAMQTT_Transport_Event *event) {
+    HAMQTT_Transport_Recorder *recorder = (HAMQTT_Transport_Recorder *)handler_args;
+    uint8_t out[HAMQTT_TRANSPORT_RECORD_HEADER_SIZE];
+    size_t used = 0;
+
+    hamqtt_port_mutex_lock(&recorder->lock);
+
+    switch (event->type) {
+    case HAMQTT_TRANSPORT_EVENT_CONNECTED:
+        used = hamqtt_transport_record_begin(recorder, out, HAMQTT_TRANSPORT_RECORD_CONNECTED);
+        recorder->write_func(recorder->write_func_args, out, used);
+        break;
+
+    case HAMQTT_TRANSPORT_EVENT_DISCONNECTED:
+        used = hamqtt_transport_record_begin(recorder, out, HAMQTT_TRANSPORT_RECORD_DISCONNECTED);
+        recorder->write_func(recorder->write_func_args, out, used);
+        break;
+
+    case HAMQTT_TRANSPORT_EVENT_DATA: {
+        // Event topics are not NUL terminated
+        char topic[HAMQTT_MAX_CHAR_BUF_SIZE];
+        int topic_len = event->topic_len < (int)sizeof(topic) - 1 ? event->topic_len : (int)sizeof(topic) - 1;
+        memcpy(topic, event->topic, topic_len);
+        topic[topic_len] = '\0';
+
+        used = hamqtt_transport_record_begin(recorder, out, HAMQTT_TRANSPORT_RECORD_DATA);
+        used = hamqtt_transport_record_put_topic(recorder, out, used, topic);
+        hamqtt_transport_record_put_payload(recorder, out, used, event->data, event->data_len);
+        break;
+    }
+
+    case HAMQTT_TRANSPORT_EVENT_PUBLISHED:
+        used = hamqtt_transport_record_begin(recorder, out, HAMQTT_TRANSPORT_RECORD_PUBLISHED);
+        used += hamqtt_transport_record_put_varint(out + used, event->msg_id < 0 ? 0 : (uint64_t)event->msg_id);
+        recorder->write_func(recorder->write_func_args, out, used);
+        break;
+    }
+
+    hamqtt_port_mutex_unlock(&recorder->lock);
+
+    hamqtt_transport_dispatch_event(&recorder->base, event);
+}
+
+static esp_err_t hamqtt_transport_record_init(HAMQTT_Transport *self, const HAMQTT_Transport_Config *config) {
+    return hamqtt_transport_init(((HAMQTT_Transport_Recorder *)self)->inner, config);
+}
+
+static esp_err_t hamqtt_transport_record_start(HAMQTT_Transport *self) {
+    return hamqtt_transport_start(((HAMQTT_Transport_Recorder *)self)->inner);
+}
+
+static esp_err_t hamqtt_transport_record_stop(HAMQTT_Transport *self) {
+    return hamqtt_transport_stop(((HAMQTT_Transport_Recorder *)self)->inner);
+}
+
+static esp_err_t hamqtt_transport_record_wait_connected(HAMQTT_Transport *self, uint32_t timeout_ms) {
+    return hamqtt_transport_wait_connected(((HAMQTT_Transport_Recorder *)self)->inner, timeout_ms);
+}
+
+static int hamqtt_transport_record_publish(HAMQTT_Transport *self,
+                                           const char *topic,
+                                           const char *data,
+                                           int len,
+                                           int qos,
+                                           int retain) {
+    HAMQTT_Transport_Recorder *recorder = (HAMQTT_Transport_Recorder *)self;
+
+    int msg_id = hamqtt_transport_publish(recorder->inner, topic, data, len, qos, retain);
+    hamqtt_transport_record_write_publish(recorder, topic, data, len, qos, retain, false, msg_id);
+
+    return msg_id;
+}
+
+static int hamqtt_transport_record_enqueue(HAMQTT_Transport *self,
+                                           const char *topic,
+                                           const char *data,
+                                           int len,
+                                           int qos,
+                                           int retain) {
+    HAMQTT_Transport_Recorder *recorder = (HAMQTT_Transport_Recorder *)self;
+
+    int msg_id = hamqtt_transport_enqueue(recorder->inner, topic, data, len, qos, retain);
+    hamqtt_transport_record_write_publish(recorder, topic, data, len, qos, retain, true, msg_id);
+
+    return msg_id;
+}
+
+static int hamqtt_transport_record_subscribe(HAMQTT_Transport *self, const char *topic, int qos) {
+    HAMQTT_Transport_Recorder *recorder = (HAMQTT_Transport_Recorder *)self;
+    uint8_t out[HAMQTT_TRANSPORT_RECORD_HEADER_SIZE];
+
+    int msg_id = hamqtt_transport_subscribe(recorder->inner, topic, qos);
+
+    hamqtt_port_mutex_lock(&recorder->lock);
+
+    size_t used = hamqtt_transport_record_begin(recorder, out, HAMQTT_TRANSPORT_RECORD_SUBSCRIBE);
+    out[used++] = (uint8_t)qos;
+    used = hamqtt_transport_record_put_topic(recorder, out, used, topic);
+    if (used) recorder->write_func(recorder->write_func_args, out, used);
+
+    hamqtt_port_mutex_unlock(&recorder->lock);
+
+    return msg_id;
+}
+
+static int hamqtt_transport_record_get_outbox_size(HAMQTT_Transport *self) {
+    return hamqtt_transport_get_outbox_size(((HAMQTT_Transport_Recorder *)self)->inner);
+}
+
+static void hamqtt_transport_record_destroy(HAMQTT_Transport *self) {
+    HAMQTT_Transport_Recorder *recorder = (HAMQTT_Transport_Recorder *)self;
+
+    // Stop events reaching a freed recorder; the inner transport is not owned
+    hamqtt_transport_set_event_handler(recorder->inner, NULL, NULL);
+
+    for (size_t i = 0; i < recorder->topic_count; ++i) {
+        free(recorder->topics[i]);
+    }
+
+    hamqtt_port_mutex_destroy(&recorder->lock);
+    free(recorder);
+}
+
+static const HAMQTT_Transport_VTable hamqtt_transport_record_vtable = {
+    .init = hamqtt_transport_record_init,
+    .start = hamqtt_transport_record_start,
+    .stop = hamqtt_transport_record_stop,
+    .wait_connected = hamqtt_transport_record_wait_connected,
+    .publish = hamqtt_transport_record_publish,
+    .enqueue = hamqtt_transport_record_enqueue,
+    .subscribe = hamqtt_transport_record_subscribe,
+    .destroy = hamqtt_transport_record_destroy,
+    .get_outbox_size = hamqtt_transport_record_get_outbox_size,
+};
+
+HAMQTT_Transport *hamqtt_transport_record_create(const HAMQTT_Transport_Record_Config *config) {
+    ESP_RETURN_ON_FALSE(config->inner && config->write_func, NULL, TAG, "A recording transport needs an inner transport and a write function");
+
+    HAMQTT_Transport_Recorder *recorder = calloc(1, sizeof(HAMQTT_Transport_Recorder));
+    if (!recorder) {
+        ESP_LOGE(TAG, "Unable to allocate space for HAMQTT Transport");
+        return NULL;
+    }
+
+    if (hamqtt_port_mutex_init(&recorder->lock) != ESP_OK) {
+        ESP_LOGE(TAG, "Unable to create recorder lock");
+        free(recorder);
+        return NULL;
+    }
+
+    recorder->base.v = &hamqtt_transport_record_vtable;
+    recorder->inner = config->inner;
+    recorder->write_func = config->write_func;
+    recorder->write_func_args = config->write_func_args;
+    recorder->last_us = hamqtt_port_time_us();
+
+    uint8_t version = HAMQTT_TRANSPORT_RECORD_VERSION;
+    recorder->write_func(recorder->write_func_args, record_magic, sizeof(record_magic));
+    recorder->write_func(recorder->write_func_args, &version, 1);
+
+    hamqtt_transport_set_event_handler(recorder->inner, hamqtt_transport_record_event_handler, recorder);
+
+    return &recorder->base;
+}
+
+/* ----- Reader ----- */
+
+static bool hamqtt_transport_record_get_varint(HAMQTT_Transport_Record_Reader *reader, uint64_t *value) {
+    *value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (reader->offset >= reader->len) return false;
+
+        uint8_t byte = reader->buf[reader->offset++];
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+
+    return false;
+}
+
+static bool hamqtt_transport_record_get_bytes(HAMQTT_Transport_Record_Reader *reader, const char **bytes, size_t *len) {
+    uint64_t value;
+    if (!hamqtt_transport_record_get_varint(reader, &value) || value > reader->len - reader->offset) return false;
+
+    *bytes = (const char *)reader->buf + reader->offset;
+    *len = (size_t)value;
+    reader->offset += (size_t)value;
+
+    return true;
+}
+
+static bool hamqtt_transport_record_get_topic(HAMQTT_Transport_Record_Reader *reader, HAMQTT_Transport_Record *record) {
+    uint64_t ref;
+    if (!hamqtt_transport_record_get_varint(reader, &ref)) return false;
+
+    if (ref > 0) {
+        if (ref > reader->topic_count) return false;
+
+        record->topic = reader->topics[ref - 1];
+        record->topic_len = reader->topic_lens[ref - 1];
+        return true;
+    }
+
+    if (!hamqtt_transport_record_get_bytes(reader, &record->topic, &record->topic_len)) return false;
+
+    if (reader->topic_count < HAMQTT_TRANSPORT_RECORD_MAX_TOPICS) {
+        reader->topics[reader->topic_count] = record->topic;
+        reader->topic_lens[reader->topic_count] = record->topic_len;
+        reader->topic_count++;
+    }
+
+    return true;
+}
+
+esp_err_t hamqtt_transport_record_reader_init(HAMQTT_Transport_Record_Reader *reader, const void *buf, size_t len) {
+    memset(reader, 0, sizeof(*reader));
+
+    ESP_RETURN_ON_FALSE(len >= sizeof(record_magic) + 1 && memcmp(buf, record_magic, sizeof(record_magic)) == 0,
+                        ESP_ERR_INVALID_ARG,
+                        TAG,
+                        "Not a HAMQTT recording");
+
+    const uint8_t *bytes = buf;
+    ESP_RETURN_ON_FALSE(bytes[sizeof(record_magic)] == HAMQTT_TRANSPORT_RECORD_VERSION,
+                        ESP_ERR_INVALID_ARG,
+                        TAG,
+                        "Unsupported recording version %d",
+                        bytes[sizeof(record_magic)]);
+
+    reader->buf = bytes;
+    reader->len = len;
+    reader->offset = sizeof(record_magic) + 1;
+
+    return ESP_OK;
+}
+
+esp_err_t hamqtt_transport_record_reader_next(HAMQTT_Transport_Record_Reader *reader, HAMQTT_Transport_Record *record) {
+    if (reader->offset >= reader->len) return ESP_ERR_NOT_FOUND;
+
+    memset(record, 0, sizeof(*record));
+    record->type = reader->buf[reader->offset++];
+
+    uint64_t value;
+    ESP_RETURN_ON_FALSE(hamqtt_transport_record_get_varint(reader, &value), ESP_ERR_INVALID_SIZE, TAG, "Truncated record");
+    reader->time_us += (int64_t)value;
+    record->time_us = reader->time_us;
+
+    bool ok = true;
+
+    switch (record->type) {
+    case HAMQTT_TRANSPORT_RECORD_CONNECTED:
+    case HAMQTT_TRANSPORT_RECORD_DISCONNECTED:
+        break;
+
+    case HAMQTT_TRANSPORT_RECORD_DATA:
+        ok = hamqtt_transport_record_get_topic(reader, record)
+          && hamqtt_transport_record_get_bytes(reader, &record->data, &record->data_len);
+        break;
+
+    case HAMQTT_TRANSPORT_RECORD_PUBLISHED:
+        ok = hamqtt_transport_record_get_varint(reader, &value);
+        record->msg_id = (int)value;
+        break;
+
+    case HAMQTT_TRANSPORT_RECORD_PUBLISH: {
+        ok = reader->offset < reader->len;
+        if (!ok) break;
+
+        uint8_t flags = reader->buf[reader->offset++];
+        record->qos = flags & 0x3;
+        record->retain = flags & 0x4;
+        record->enqueued = flags & 0x8;
+
+        ok = hamqtt_transport_record_get_topic(reader, record)
+          && hamqtt_transport_record_get_bytes(reader, &record->data, &record->data_len)
+          && hamqtt_transport_record_get_varint(reader, &value);
+        record->msg_id = (int)value - 1;
+        break;
+    }
+
+    case HAMQTT_TRANSPORT_RECORD_SUBSCRIBE:
+        ok = reader->offset < reader->len;
+        if (!ok) break;
+
+        record->qos = reader->buf[reader->offset++];
+        ok = hamqtt_transport_record_get_topic(reader, record);
+        break;
+
+    default:
+        ESP_LOGE(TAG, "Unknown record type %d at offset %d", record->type, (int)reader->offset - 1);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    ESP_RETURN_ON_FALSE(ok, ESP_ERR_INVALID_SIZE, TAG, "Truncated record");
+
+    return ESP_OK;
+}
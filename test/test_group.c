@@ -0,0 +1,142 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file test_group.c
+ * @brief Checks that a group refuses member ids it cannot report, that a device will not
+ * connect with a grouped binary sensor whose group it does not have, and that nothing can be
+ * added once it has connected.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "HAMQTT.h"
+#include "HAMQTT/hamqtt_transport_mock.h"
+
+#define CHECK(cond)                                                                      \
+    do {                                                                                 \
+        if (!(cond)) {                                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);     \
+            return 1;                                                                    \
+        }                                                                                \
+    } while (0)
+
+static bool door_open;
+
+static bool test_get_state(void *args) {
+    return door_open;
+}
+
+static int test_member_ids(void) {
+    HAMQTT_Binary_Sensor_Config quoted_config = hamqtt_binary_sensor_config_default();
+    quoted_config.unique_id = "door\"1";
+
+    HAMQTT_Binary_Sensor_Config apostrophe_config = hamqtt_binary_sensor_config_default();
+    apostrophe_config.unique_id = "door's";
+
+    HAMQTT_Binary_Sensor *quoted = hamqtt_binary_sensor_create(&quoted_config, test_get_state, NULL);
+    HAMQTT_Binary_Sensor *apostrophe = hamqtt_binary_sensor_create(&apostrophe_config, test_get_state, NULL);
+    CHECK(quoted && apostrophe);
+
+    HAMQTT_Group_Config group_config = hamqtt_group_config_default();
+    group_config.unique_id = "doors";
+
+    HAMQTT_Component *quoted_members[] = {(HAMQTT_Component *)quoted};
+    HAMQTT_Component *apostrophe_members[] = {(HAMQTT_Component *)apostrophe};
+    CHECK(!hamqtt_group_create(&group_config, quoted_members, 1));
+    CHECK(!hamqtt_group_create(&group_config, apostrophe_members, 1));
+    CHECK(!hamqtt_group_create(&group_config, quoted_members, 0));
+
+    hamqtt_binary_sensor_destroy(quoted);
+    hamqtt_binary_sensor_destroy(apostrophe);
+    return 0;
+}
+
+static int test_group_registered(void) {
+    HAMQTT_Device_Config device_config = hamqtt_device_config_default();
+    device_config.mqtt_uri = "mock://test";
+    device_config.unique_id = "group_test";
+
+    HAMQTT_Binary_Sensor_Config sensor_config = hamqtt_binary_sensor_config_default();
+    sensor_config.unique_id = "door";
+
+    HAMQTT_Binary_Sensor_Config late_config = hamqtt_binary_sensor_config_default();
+    late_config.unique_id = "window";
+
+    HAMQTT_Group_Config group_config = hamqtt_group_config_default();
+    group_config.unique_id = "doors";
+
+    HAMQTT_Transport_Mock_Config mock_config = hamqtt_transport_mock_config_default();
+    mock_config.auto_ack = true;
+
+    HAMQTT_Transport *mock = hamqtt_transport_mock_create(&mock_config);
+    HAMQTT_Device *device = hamqtt_device_create(&device_config);
+    HAMQTT_Binary_Sensor *sensor = hamqtt_binary_sensor_create(&sensor_config, test_get_state, NULL);
+    HAMQTT_Binary_Sensor *late = hamqtt_binary_sensor_create(&late_config, test_get_state, NULL);
+    CHECK(mock && device && sensor && late);
+
+    HAMQTT_Component *members[] = {(HAMQTT_Component *)sensor};
+    HAMQTT_Group *group = hamqtt_group_create(&group_config, members, 1);
+    CHECK(group);
+
+    CHECK(hamqtt_device_add_component(device, (HAMQTT_Component *)sensor) == ESP_OK);
+    CHECK(hamqtt_device_add_component(device, (HAMQTT_Component *)late) == ESP_OK);
+    CHECK(hamqtt_device_set_transport(device, mock) == ESP_OK);
+
+    // The sensor would never report without its group
+    CHECK(hamqtt_device_connect(device) == ESP_ERR_INVALID_STATE);
+    CHECK(hamqtt_transport_mock_get_publish_count(mock) == 0);
+
+    CHECK(hamqtt_device_add_component(device, (HAMQTT_Component *)group) == ESP_OK);
+
+#if HAMQTT_RUNTIME_DISCOVERY
+    // Grouped sensors are only described by runtime discovery
+    CHECK(hamqtt_device_connect(device) == ESP_OK);
+
+    door_open = true;
+    hamqtt_device_loop(device);
+
+    const HAMQTT_Transport_Mock_Publish *publish = hamqtt_transport_mock_find_publish(mock, "group_test/doors/state");
+    CHECK(publish);
+    CHECK(strstr(publish->data, "\"door\":\"ON\""));
+
+    // Nothing added now would be subscribed or announced
+    CHECK(hamqtt_device_add_component(device, (HAMQTT_Component *)group) == ESP_ERR_INVALID_STATE);
+
+    // Its own state topic is already announced
+    HAMQTT_Component *late_members[] = {(HAMQTT_Component *)late};
+    CHECK(!hamqtt_group_create(&group_config, late_members, 1));
+#endif
+
+    hamqtt_device_destroy(device);
+    hamqtt_group_destroy(group);
+    hamqtt_binary_sensor_destroy(sensor);
+    hamqtt_binary_sensor_destroy(late);
+    hamqtt_transport_destroy(mock);
+    return 0;
+}
+
+int main(void) {
+    if (test_member_ids() != 0) return 1;
+    if (test_group_registered() != 0) return 1;
+
+    return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file test_manifest.c
+ * @brief Checks the discovery payload rendered from a device manifest.
+ *
+ * The payload must carry the device's serial number and point `json_attributes_topic` at
+ * the topic the attributes are published to, and a device whose unique id would need JSON
+ * escaping must refuse to render it.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "HAMQTT.h"
+#include "HAMQTT/hamqtt_transport_mock.h"
+#include "test_manifest_hamqtt.h"
+
+bool test_get_state(void *args) {
+    return false;
+}
+
+static bool test_published(const HAMQTT_Transport *mock, const char *topic, const char *needle) {
+    const HAMQTT_Transport_Mock_Publish *publish = hamqtt_transport_mock_find_publish(mock, topic);
+    if (!publish) {
+        fprintf(stderr, "Nothing was published to %s\n", topic);
+        return false;
+    }
+
+    if (!strstr(publish->data, needle)) {
+        fprintf(stderr, "%s does not contain %s:\n%.*s\n", topic, needle, (int)publish->data_len, publish->data);
+        return false;
+    }
+
+    return true;
+}
+
+int main(void) {
+    HAMQTT_Device_Config device_config = hamqtt_device_config_default();
+    device_config.mqtt_uri = "mock://test";
+    device_config.unique_id = "unit_1";
+
+    HAMQTT_Transport_Mock_Config mock_config = hamqtt_transport_mock_config_default();
+    mock_config.auto_ack = true;
+    HAMQTT_Transport *mock = hamqtt_transport_mock_create(&mock_config);
+
+    HAMQTT_Device *device = hamqtt_device_create(&device_config);
+
+    if (!mock || !device ||
+        manifest_test_hamqtt_register(device) != ESP_OK ||
+        hamqtt_device_set_transport(device, mock) != ESP_OK ||
+        hamqtt_device_connect(device) != ESP_OK) {
+        fprintf(stderr, "Unable to set up the device\n");
+        return 1;
+    }
+
+    hamqtt_attributes_set_int(manifest_test_door_attributes, MANIFEST_TEST_DOOR_ATTR_RSSI, -61);
+    hamqtt_device_loop(device);
+
+    int rc = 0;
+    if (!test_published(mock, "homeassistant/device/unit_1/config", "\"sn\":\"SN-0001\"") ||
+        !test_published(mock, "homeassistant/device/unit_1/config", "\"json_attributes_topic\":\"unit_1/door/attributes\"") ||
+        !test_published(mock, "unit_1/door/attributes", "\"rssi\":-61")) {
+        rc = 1;
+    }
+
+    // The unique id is spliced into the template and its topics as is. Rendering fails before a
+    // transport is needed
+    static char *const unsafe_ids[] = {"unit\"2", "unit/2"};
+    for (size_t i = 0; i < sizeof(unsafe_ids) / sizeof(unsafe_ids[0]); ++i) {
+        HAMQTT_Device_Config unsafe_config = device_config;
+        unsafe_config.unique_id = unsafe_ids[i];
+        HAMQTT_Device *unsafe_device = hamqtt_device_create(&unsafe_config);
+
+        if (!unsafe_device ||
+            hamqtt_device_set_discovery_template(unsafe_device, &manifest_test_hamqtt_discovery) != ESP_OK ||
+            hamqtt_device_connect(unsafe_device) != ESP_ERR_INVALID_ARG) {
+            fprintf(stderr, "Unique id %s was rendered into the template\n", unsafe_ids[i]);
+            rc = 1;
+        }
+
+        hamqtt_device_destroy(unsafe_device);
+    }
+
+    hamqtt_device_destroy(device);
+    hamqtt_attributes_destroy(manifest_test_door_attributes);
+    hamqtt_transport_destroy(mock);
+
+    return rc;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file test_replay_record.c
+ * @brief Records a session for `bench_replay` to replay.
+ *
+ * The device connects, reports a state change, handles a press, loses its connection to the
+ * broker and gets it back, then is disconnected by the application. `bench_replay` must
+ * reproduce every publish, including the `offline` of the clean disconnect, to pass.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <stdio.h>
+
+#include "HAMQTT.h"
+#include "HAMQTT/hamqtt_transport_mock.h"
+#include "HAMQTT/hamqtt_transport_record.h"
+
+static bool door_open;
+
+static bool test_get_state(void *args) {
+    return door_open;
+}
+
+static void test_on_press(void *args) {}
+
+static void test_record_write(void *args, const void *data, size_t len) {
+    fwrite(data, 1, len, (FILE *)args);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <recording>\n", argv[0]);
+        return 2;
+    }
+
+    FILE *file = fopen(argv[1], "wb");
+    if (!file) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    HAMQTT_Device_Config device_config = hamqtt_device_config_default();
+    device_config.mqtt_uri = "mock://test";
+    device_config.unique_id = "replay_test";
+    device_config.name = "Replay Test";
+
+    HAMQTT_Binary_Sensor_Config sensor_config = hamqtt_binary_sensor_config_default();
+    sensor_config.unique_id = "door";
+    sensor_config.name = "Door";
+
+    HAMQTT_Button_Config button_config = hamqtt_button_config_default();
+    button_config.unique_id = "bell";
+    button_config.name = "Bell";
+
+    HAMQTT_Transport_Mock_Config mock_config = hamqtt_transport_mock_config_default();
+    mock_config.auto_ack = true;
+    HAMQTT_Transport *mock = hamqtt_transport_mock_create(&mock_config);
+
+    HAMQTT_Transport_Record_Config record_config = {
+        .inner = mock,
+        .write_func = test_record_write,
+        .write_func_args = file,
+    };
+    HAMQTT_Transport *recorder = mock ? hamqtt_transport_record_create(&record_config) : NULL;
+
+    HAMQTT_Device *device = hamqtt_device_create(&device_config);
+    HAMQTT_Binary_Sensor *sensor = hamqtt_binary_sensor_create(&sensor_config, test_get_state, NULL);
+    HAMQTT_Button *button = hamqtt_button_create(&button_config, test_on_press, NULL);
+
+    if (!recorder || !device || !sensor || !button ||
+        hamqtt_device_add_component(device, (HAMQTT_Component *)sensor) != ESP_OK ||
+        hamqtt_device_add_component(device, (HAMQTT_Component *)button) != ESP_OK ||
+        hamqtt_device_set_transport(device, recorder) != ESP_OK ||
+        hamqtt_device_connect(device) != ESP_OK) {
+        fprintf(stderr, "Unable to set up the device\n");
+        return 1;
+    }
+
+    hamqtt_device_loop(device);
+
+    door_open = true;
+    hamqtt_device_loop(device);
+
+    hamqtt_transport_mock_inject_message(mock, "replay_test/bell/press", "PRESS", 5);
+    hamqtt_device_loop(device);
+
+    // A dropped connection is replayed as one, and does not publish `offline`
+    hamqtt_transport_mock_disconnect(mock);
+    hamqtt_transport_mock_connect(mock);
+
+    door_open = false;
+    hamqtt_device_loop(device);
+
+    int rc = hamqtt_device_disconnect(device) == ESP_OK ? 0 : 1;
+
+    hamqtt_device_destroy(device);
+    hamqtt_binary_sensor_destroy(sensor);
+    hamqtt_button_destroy(button);
+    hamqtt_transport_destroy(recorder);
+    hamqtt_transport_destroy(mock);
+    fclose(file);
+
+    return rc;
+}
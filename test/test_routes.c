@@ -0,0 +1,304 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file test_routes.c
+ * @brief Checks the route table directly: exact topics and `+`/`#` filters match as in MQTT,
+ * with exact routes first, and retired snapshots are freed while readers on other tasks keep
+ * entering it.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "HAMQTT/hamqtt_component_internal.h"
+#include "HAMQTT/hamqtt_routes_internal.h"
+
+#define CHECK(cond)                                                                      \
+    do {                                                                                 \
+        if (!(cond)) {                                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);     \
+            return 1;                                                                    \
+        }                                                                                \
+    } while (0)
+
+/**
+ * @brief A component that only subscribes to the topics it is given.
+ */
+typedef struct {
+    HAMQTT_Component base;
+    const char *unique_id;
+    const char *topics[2];
+    size_t topic_count;
+} Test_Component;
+
+static const char *test_component_get_unique_id(HAMQTT_Component *component) {
+    return ((Test_Component *)component)->unique_id;
+}
+
+static const char *const *test_component_get_subscribed_topics(HAMQTT_Component *component, size_t *count) {
+    Test_Component *test = (Test_Component *)component;
+
+    *count = test->topic_count;
+    return test->topics;
+}
+
+static const HAMQTT_Component_VTable test_component_vtable = {
+    .get_unique_id = test_component_get_unique_id,
+    .get_subscribed_topics = test_component_get_subscribed_topics,
+};
+
+/* ----- Matching ----- */
+
+#define TEST_MAX_MATCHES 8
+
+typedef struct {
+    size_t indices[TEST_MAX_MATCHES];
+    size_t count;
+} Test_Matches;
+
+static void test_record_route(const HAMQTT_Route *route, void *context) {
+    Test_Matches *matches = context;
+    if (matches->count < TEST_MAX_MATCHES) matches->indices[matches->count] = route->index;
+    matches->count++;
+}
+
+/**
+ * @brief Whether `topic` matches exactly the components in `expected`. The first
+ * `exact_count` must come first and in that order, the filters after them in any order.
+ */
+static bool test_matches(const HAMQTT_Route_Table *table, const char *topic,
+                         const size_t *expected, size_t expected_count, size_t exact_count) {
+    Test_Matches matches = { .count = 0 };
+    size_t visited = hamqtt_routes_match(table, topic, strlen(topic), test_record_route, &matches);
+
+    bool ok = visited == expected_count && matches.count == expected_count;
+    for (size_t i = 0; ok && i < exact_count; ++i) ok = matches.indices[i] == expected[i];
+
+    for (size_t i = exact_count; ok && i < expected_count; ++i) {
+        bool found = false;
+        for (size_t j = exact_count; j < matches.count && !found; ++j) found = matches.indices[j] == expected[i];
+        ok = found;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "%s matched %d routes:", topic, (int)matches.count);
+        for (size_t i = 0; i < matches.count && i < TEST_MAX_MATCHES; ++i) fprintf(stderr, " %d", (int)matches.indices[i]);
+        fprintf(stderr, "\n");
+    }
+
+    return ok;
+}
+
+#define EXPECT(table, topic, exact_count, ...)                                           \
+    do {                                                                                 \
+        const size_t expected[] = {__VA_ARGS__};                                         \
+        CHECK(test_matches(table, topic, expected,                                       \
+                           sizeof(expected) / sizeof(expected[0]), exact_count));        \
+    } while (0)
+
+#define EXPECT_NONE(table, topic) \
+    CHECK(hamqtt_routes_match(table, topic, strlen(topic), test_record_route, &(Test_Matches){ .count = 0 }) == 0)
+
+static int test_wildcards(void) {
+    HAMQTT_Routes *routes = hamqtt_routes_create();
+    CHECK(routes);
+
+    Test_Component components[] = {
+        { .unique_id = "exact",       .topics = {"dev/a/set"} },
+        { .unique_id = "plus",        .topics = {"dev/+/set"} },
+        { .unique_id = "multi",       .topics = {"dev/#"} },
+        { .unique_id = "exact_again", .topics = {"dev/a/set"} },
+        { .unique_id = "two_plus",    .topics = {"+/+/state"} },
+        { .unique_id = "everything",  .topics = {"#"} },
+        { .unique_id = "other",       .topics = {"other/x", "other/+/y"} },
+    };
+    HAMQTT_Component *all[7];
+    for (size_t i = 0; i < 7; ++i) {
+        components[i].base.v = &test_component_vtable;
+        components[i].topic_count = components[i].topics[1] ? 2 : 1;
+        all[i] = &components[i].base;
+    }
+
+    CHECK(hamqtt_routes_publish(routes, all, 7) == ESP_OK);
+    const HAMQTT_Route_Table *table = hamqtt_routes_enter(routes, HAMQTT_ROUTES_READER_LOOP);
+
+    // Routes with the exact topic come first, in table order
+    EXPECT(table, "dev/a/set", 2, 0, 3, 1, 2, 5);
+    EXPECT(table, "other/x", 1, 6, 5);
+
+    // '+' is one whole level, '#' any number of them including none
+    EXPECT(table, "dev/b/set", 0, 1, 2, 5);
+    EXPECT(table, "dev/a/state", 0, 2, 4, 5);
+    EXPECT(table, "dev", 0, 2, 5);
+    EXPECT(table, "dev/a/set/extra", 0, 2, 5);
+    EXPECT(table, "other/z/y", 0, 6, 5);
+    EXPECT(table, "other/y", 0, 5);
+
+    // Filters starting with a wildcard do not match topics starting with '$'
+    EXPECT_NONE(table, "$SYS/a/state");
+    EXPECT(table, "dev/$x/set", 0, 1, 2, 5);
+
+    hamqtt_routes_exit(routes, HAMQTT_ROUTES_READER_LOOP);
+
+    // Without a '#' that catches everything, topics that match nothing visit nothing
+    CHECK(hamqtt_routes_publish(routes, (HAMQTT_Component *[]){all[0], all[1], all[4], all[6]}, 4) == ESP_OK);
+    table = hamqtt_routes_enter(routes, HAMQTT_ROUTES_READER_LOOP);
+
+    EXPECT(table, "dev/a/set", 1, 0, 1);
+    EXPECT_NONE(table, "dev/a/se");
+    EXPECT_NONE(table, "dev/a");
+    EXPECT_NONE(table, "dev/a/set/extra");
+    EXPECT_NONE(table, "other");
+    EXPECT_NONE(table, "");
+
+    hamqtt_routes_exit(routes, HAMQTT_ROUTES_READER_LOOP);
+
+    // With exact topics only there is no trie to walk
+    CHECK(hamqtt_routes_publish(routes, all, 1) == ESP_OK);
+    table = hamqtt_routes_enter(routes, HAMQTT_ROUTES_READER_LOOP);
+
+    EXPECT(table, "dev/a/set", 1, 0);
+    EXPECT_NONE(table, "dev/b/set");
+
+    hamqtt_routes_exit(routes, HAMQTT_ROUTES_READER_LOOP);
+
+    hamqtt_routes_destroy(routes);
+    return 0;
+}
+
+/* ----- Reclaiming ----- */
+
+/**
+ * @brief Two readers passing a turn back and forth. Only the one holding the turn leaves and
+ * enters again, and only while the other is inside, so at any time one of them is inside.
+ */
+typedef struct {
+    HAMQTT_Routes *routes;
+    HAMQTT_Routes_Reader readers[2];
+    atomic_bool inside[2];
+    atomic_int turn;
+    atomic_bool stop;
+    atomic_size_t sections[2];
+} Test_Overlap;
+
+typedef struct {
+    Test_Overlap *overlap;
+    int index;
+} Test_Reader;
+
+static void test_count_route(const HAMQTT_Route *route, void *context) {
+    ++*(size_t *)context;
+}
+
+static void *test_reader_run(void *args) {
+    Test_Overlap *overlap = ((Test_Reader *)args)->overlap;
+    int me = ((Test_Reader *)args)->index;
+    HAMQTT_Routes_Reader reader = overlap->readers[me];
+
+    hamqtt_routes_enter(overlap->routes, reader);
+    atomic_store(&overlap->inside[me], true);
+
+    while (!atomic_load(&overlap->stop)) {
+        if (atomic_load(&overlap->turn) != me || !atomic_load(&overlap->inside[!me])) {
+            sched_yield();
+            continue;
+        }
+
+        hamqtt_routes_exit(overlap->routes, reader);
+
+        size_t matched = 0;
+        const HAMQTT_Route_Table *table = hamqtt_routes_enter(overlap->routes, reader);
+        hamqtt_routes_match(table, "dev/a/set", 9, test_count_route, &matched);
+        atomic_fetch_add(&overlap->sections[me], 1);
+
+        atomic_store(&overlap->turn, !me);
+    }
+
+    hamqtt_routes_exit(overlap->routes, reader);
+    return NULL;
+}
+
+static int64_t test_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int test_reclaim_with_concurrent_readers(void) {
+    HAMQTT_Routes *routes = hamqtt_routes_create();
+    CHECK(routes);
+
+    Test_Component a = { .base.v = &test_component_vtable, .unique_id = "a", .topics = {"dev/a/set"}, .topic_count = 1 };
+    Test_Component b = { .base.v = &test_component_vtable, .unique_id = "b", .topics = {"dev/b/set"}, .topic_count = 1 };
+    HAMQTT_Component *both[] = {&a.base, &b.base};
+
+    // The loop and a task applying a scene, each on its own reader. Sharing one, their sections
+    // would overlap forever and nothing retired could be freed.
+    Test_Overlap overlap = {
+        .routes = routes,
+        .readers = {HAMQTT_ROUTES_READER_LOOP, HAMQTT_ROUTES_READER_SCENE},
+    };
+    atomic_init(&overlap.inside[0], false);
+    atomic_init(&overlap.inside[1], false);
+    atomic_init(&overlap.turn, 0);
+    atomic_init(&overlap.stop, false);
+    atomic_init(&overlap.sections[0], 0);
+    atomic_init(&overlap.sections[1], 0);
+
+    Test_Reader readers[] = {{ .overlap = &overlap, .index = 0 }, { .overlap = &overlap, .index = 1 }};
+    pthread_t threads[2];
+    for (size_t i = 0; i < 2; ++i) CHECK(pthread_create(&threads[i], NULL, test_reader_run, &readers[i]) == 0);
+
+    // Publish only once the readers are passing the turn
+    while (atomic_load(&overlap.sections[0]) == 0 || atomic_load(&overlap.sections[1]) == 0) sched_yield();
+
+    // Every publish retires the previous snapshot
+    for (size_t i = 0; i < 1000; ++i) {
+        CHECK(hamqtt_routes_publish(routes, both, 1 + i % 2) == ESP_OK);
+    }
+
+    // Both readers keep entering, but each leaves between sections, so everything retired is freed
+    int64_t deadline_ms = test_now_ms() + 5000;
+    while (hamqtt_routes_retired_count(routes) > 0 && test_now_ms() < deadline_ms) {
+        CHECK(hamqtt_routes_publish(routes, both, 2) == ESP_OK);
+    }
+
+    size_t retired = hamqtt_routes_retired_count(routes);
+
+    atomic_store(&overlap.stop, true);
+    for (size_t i = 0; i < 2; ++i) pthread_join(threads[i], NULL);
+
+    CHECK(retired == 0);
+
+    hamqtt_routes_destroy(routes);
+    return 0;
+}
+
+int main(void) {
+    if (test_wildcards() != 0) return 1;
+    if (test_reclaim_with_concurrent_readers() != 0) return 1;
+
+    return 0;
+}
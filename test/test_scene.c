@@ -0,0 +1,62 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file test_scene.c
+ * @brief Checks that a component cannot take the unique id whose topics are the scene's.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <stdio.h>
+
+#include "HAMQTT.h"
+
+static void test_on_press(void *args) {}
+
+int main(void) {
+    HAMQTT_Device_Config device_config = hamqtt_device_config_default();
+    device_config.mqtt_uri = "mock://test";
+    device_config.unique_id = "scene_test";
+
+    HAMQTT_Button_Config scene_config = hamqtt_button_config_default();
+    scene_config.unique_id = "scene";
+
+    HAMQTT_Button_Config bell_config = hamqtt_button_config_default();
+    bell_config.unique_id = "bell";
+
+    HAMQTT_Device *device = hamqtt_device_create(&device_config);
+    HAMQTT_Button *scene = hamqtt_button_create(&scene_config, test_on_press, NULL);
+    HAMQTT_Button *bell = hamqtt_button_create(&bell_config, test_on_press, NULL);
+
+    int rc = 0;
+    if (!device || !scene || !bell) {
+        fprintf(stderr, "Unable to set up the device\n");
+        rc = 1;
+    } else if (hamqtt_device_add_component(device, (HAMQTT_Component *)scene) != ESP_ERR_INVALID_ARG ||
+               hamqtt_device_add_component(device, (HAMQTT_Component *)bell) != ESP_OK) {
+        fprintf(stderr, "A button took the scene's topics\n");
+        rc = 1;
+    }
+
+    hamqtt_device_destroy(device);
+    hamqtt_button_destroy(scene);
+    hamqtt_button_destroy(bell);
+
+    return rc;
+}
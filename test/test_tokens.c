@@ -0,0 +1,72 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file test_tokens.c
+ * @brief Checks that every payload in HAMQTT_TOKEN_LIST decodes to its own token.
+ *
+ * The slot of a payload is hashed from the last character written next to it in the list,
+ * while lookups hash the payload's real last character, so a typo there makes the payload
+ * undecodable.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <stdio.h>
+
+#include "HAMQTT/hamqtt_token_internal.h"
+
+static int failures;
+
+static void test_token(const char *name, const char *text, char last, HAMQTT_Token expected) {
+    size_t len = strlen(text);
+
+    if (text[len - 1] != last) {
+        fprintf(stderr, "%s ends in '%c', but is listed with '%c'\n", name, text[len - 1], last);
+        failures++;
+    }
+
+    HAMQTT_Token token = hamqtt_token_decode_str(text);
+    if (token != expected) {
+        fprintf(stderr, "%s decodes to %d instead of %d\n", name, (int)token, (int)expected);
+        failures++;
+    }
+}
+
+static void test_unknown(const char *payload) {
+    HAMQTT_Token token = hamqtt_token_decode_str(payload);
+    if (token != HAMQTT_TOKEN_UNKNOWN) {
+        fprintf(stderr, "\"%s\" decodes to %d instead of unknown\n", payload, (int)token);
+        failures++;
+    }
+}
+
+int main(void) {
+#define TEST_TOKEN(name, text, last) test_token(#name, text, last, HAMQTT_TOKEN_##name);
+    HAMQTT_TOKEN_LIST(TEST_TOKEN)
+#undef TEST_TOKEN
+
+    test_unknown("");
+    test_unknown("press");
+    test_unknown("PRESX");
+    test_unknown("PRES");
+    test_unknown("PRESSS");
+    test_unknown("ARM_CUSTOM_BYPASSX");
+
+    return failures ? 1 : 0;
+}
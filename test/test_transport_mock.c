@@ -0,0 +1,101 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file test_transport_mock.c
+ * @brief Checks the mock transport's subscription table and its control of the port clock.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <stdio.h>
+
+#include "HAMQTT/hamqtt_transport_mock.h"
+
+#define CHECK(cond)                                                                      \
+    do {                                                                                 \
+        if (!(cond)) {                                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);     \
+            return 1;                                                                    \
+        }                                                                                \
+    } while (0)
+
+static int test_subscriptions(void) {
+    HAMQTT_Transport_Mock_Config config = hamqtt_transport_mock_config_default();
+    config.max_subscriptions = 2;
+
+    HAMQTT_Transport *mock = hamqtt_transport_mock_create(&config);
+    CHECK(mock);
+    CHECK(hamqtt_transport_start(mock) == ESP_OK);
+
+    char long_topic[HAMQTT_MAX_CHAR_BUF_SIZE + 1];
+    memset(long_topic, 'a', sizeof(long_topic) - 1);
+    long_topic[sizeof(long_topic) - 1] = '\0';
+
+    CHECK(hamqtt_transport_subscribe(mock, "dev/a/press", 1) > 0);
+    CHECK(hamqtt_transport_subscribe(mock, long_topic, 1) < 0);
+    CHECK(hamqtt_transport_subscribe(mock, "dev/b/press", 1) > 0);
+    CHECK(hamqtt_transport_subscribe(mock, "dev/c/press", 1) < 0);
+
+    size_t count;
+    const char *const *topics = hamqtt_transport_mock_get_subscriptions(mock, &count);
+    CHECK(count == 2);
+    CHECK(strcmp(topics[0], "dev/a/press") == 0);
+    CHECK(strcmp(topics[1], "dev/b/press") == 0);
+
+    // Slots are reused after the connection drops
+    hamqtt_transport_mock_disconnect(mock);
+    hamqtt_transport_mock_get_subscriptions(mock, &count);
+    CHECK(count == 0);
+
+    hamqtt_transport_mock_connect(mock);
+    CHECK(hamqtt_transport_subscribe(mock, "dev/c/press", 1) > 0);
+    topics = hamqtt_transport_mock_get_subscriptions(mock, &count);
+    CHECK(count == 1);
+    CHECK(strcmp(topics[0], "dev/c/press") == 0);
+
+    hamqtt_transport_destroy(mock);
+    return 0;
+}
+
+static int test_port_clock(void) {
+    HAMQTT_Transport_Mock_Config config = hamqtt_transport_mock_config_default();
+    config.drive_port_clock = true;
+
+    HAMQTT_Transport *mock = hamqtt_transport_mock_create(&config);
+    CHECK(mock);
+    CHECK(hamqtt_port_time_us() == 0);
+
+    hamqtt_transport_mock_advance(mock, 1500);
+    CHECK(hamqtt_port_time_us() == 1500 * 1000);
+
+    hamqtt_transport_destroy(mock);
+
+    // The monotonic clock is back, and it does not stand still
+    int64_t before = hamqtt_port_time_us();
+    while (hamqtt_port_time_us() == before) {
+    }
+
+    return 0;
+}
+
+int main(void) {
+    hamqtt_port_log_level = HAMQTT_PORT_LOG_NONE;
+
+    return test_subscriptions() || test_port_clock();
+}
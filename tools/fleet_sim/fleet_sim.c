@@ -0,0 +1,886 @@
+/*
+ * Copyright 2025 Ethan Barnes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file fleet_sim.c
+ * @brief Runs a fleet of simulated HAMQTT devices in one process against a real broker.
+ *
+ * Every device gets a random mix of binary sensors and buttons and its own POSIX transport,
+ * so the broker sees one connection per device just like a real fleet. Worker threads
+ * drive the device loops and flip the binary sensors on randomized periods, while an
+ * observer client subscribed to `#` and `$SYS/broker/#` watches the traffic.
+ *
+ * Measured:
+ * - State latency: from a binary sensor flipping to the observer receiving the new state.
+ * - Command latency: from the observer publishing `PRESS` to the button callback running.
+ * - Recovery time: from a scenario event until every device is connected again
+ *   (or, for `ha_restart`, has republished its discovery payload).
+ * - Message rates seen by the observer, and the broker's own `$SYS` load counters.
+ *
+ * Scenarios:
+ * - `steady`: no event, only steady-state traffic.
+ * - `mass_reboot`: every device is destroyed and recreated at the same moment.
+ * - `broker_restart`: runs `--broker-restart-cmd` (e.g. `systemctl restart mosquitto`).
+ * - `ha_restart`: publishes `offline` then `online` to `<prefix>/status`, like Home Assistant.
+ *
+ * Each device holds a socket and a network thread, so large fleets need `ulimit -n` raised
+ * and a broker configured with a matching `max_connections`.
+ *
+ * @author Ethan Barnes
+ * @date 2025
+ * @copyright Apache License 2.0
+ */
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <mosquitto.h>
+
+#include "HAMQTT.h"
+
+#define FLEET_MAX_COMPONENTS 16
+#define FLEET_LATENCY_SAMPLES 128
+#define FLEET_MAX_THREADS 64
+#define FLEET_ID_SIZE 48
+
+static const char *TAG = "Fleet_Sim";
+
+typedef enum {
+    FLEET_SCENARIO_STEADY,
+    FLEET_SCENARIO_MASS_REBOOT,
+    FLEET_SCENARIO_BROKER_RESTART,
+    FLEET_SCENARIO_HA_RESTART,
+} Fleet_Scenario;
+
+static const char *const scenario_names[] = { "steady", "mass_reboot", "broker_restart", "ha_restart" };
+
+typedef struct {
+    const char *uri;
+    const char *broker_restart_cmd;
+    Fleet_Scenario scenario;
+    size_t device_count;
+    size_t max_components;
+    size_t thread_count;
+    uint32_t duration_s;
+    uint32_t tick_ms;
+    uint32_t signal_period_ms;
+    uint32_t press_interval_ms;
+    uint64_t seed;
+    bool verbose;
+} Fleet_Options;
+
+/**
+ * @brief Fixed-size ring of latency samples, written by a single thread.
+ */
+typedef struct {
+    uint64_t samples_ns[FLEET_LATENCY_SAMPLES];
+    size_t count;
+} Fleet_Latency;
+
+typedef struct Fleet_Device Fleet_Device;
+
+typedef struct {
+    Fleet_Device *device;
+    HAMQTT_Component *component;
+    bool is_button;
+    char unique_id[FLEET_ID_SIZE];
+    char topic[HAMQTT_MAX_CHAR_BUF_SIZE];
+
+    union {
+        HAMQTT_Binary_Sensor_Config sensor_config;
+        HAMQTT_Button_Config button_config;
+    };
+
+    // Synthetic signal, owned by the device's worker
+    uint32_t period_ms;
+    uint64_t next_flip_ns;
+
+    atomic_bool state;
+    _Atomic uint64_t changed_ns;
+    _Atomic uint64_t press_sent_ns;
+} Fleet_Component;
+
+struct Fleet_Device {
+    char unique_id[FLEET_ID_SIZE];
+    char name[FLEET_ID_SIZE];
+    HAMQTT_Device_Config config;
+    HAMQTT_Device *device;
+    HAMQTT_Transport *transport;
+
+    Fleet_Component components[FLEET_MAX_COMPONENTS];
+    size_t component_count;
+
+    atomic_bool connected;
+    _Atomic uint64_t connected_ns;
+    _Atomic uint64_t discovered_ns;
+
+    Fleet_Latency state_latency;    // Written by the observer thread
+    Fleet_Latency command_latency;  // Written by the device's network thread
+};
+
+typedef struct {
+    Fleet_Options options;
+
+    Fleet_Device *devices;
+    size_t button_count;
+    size_t sensor_count;
+
+    atomic_bool stop;
+    _Atomic uint64_t reboot_generation;
+    _Atomic uint64_t connected_count;
+    _Atomic uint64_t boot_failures;
+    _Atomic uint64_t disconnects;
+
+    struct mosquitto *observer;
+    _Atomic uint64_t observed_discovery;
+    _Atomic uint64_t observed_availability;
+    _Atomic uint64_t observed_state;
+    _Atomic uint64_t observed_total;
+    _Atomic uint64_t presses_sent;
+    _Atomic uint64_t presses_received;
+
+    pthread_mutex_t sys_lock;
+    char sys_received_1min[32];
+    char sys_sent_1min[32];
+    char sys_clients[32];
+    char sys_subscriptions[32];
+} Fleet;
+
+typedef struct {
+    Fleet *fleet;
+    size_t first;
+    size_t count;
+    uint64_t rng;
+    pthread_t thread;
+} Fleet_Worker;
+
+/* ----- Helpers ----- */
+
+static uint64_t fleet_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void fleet_sleep_ms(uint32_t ms) {
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+static uint64_t fleet_rand(uint64_t *state) {
+    // xorshift64*
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief Returns a value uniformly distributed between half and one and a half times `mean`.
+ */
+static uint64_t fleet_jitter(uint64_t *state, uint64_t mean) {
+    return mean / 2 + fleet_rand(state) % (mean + 1);
+}
+
+static void fleet_latency_add(Fleet_Latency *latency, uint64_t ns) {
+    latency->samples_ns[latency->count % FLEET_LATENCY_SAMPLES] = ns;
+    latency->count++;
+}
+
+static int fleet_compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t fleet_percentile(uint64_t *samples, size_t count, double p) {
+    if (count == 0) return 0;
+
+    qsort(samples, count, sizeof(uint64_t), fleet_compare_u64);
+
+    size_t index = (size_t)(p / 100.0 * (double)(count - 1) + 0.5);
+    return samples[index < count ? index : count - 1];
+}
+
+/* ----- Simulated devices ----- */
+
+static bool fleet_sensor_get_state(void *args) {
+    return atomic_load(&((Fleet_Component *)args)->state);
+}
+
+static Fleet *fleet_instance;
+
+static void fleet_button_on_press(void *args) {
+    Fleet_Component *component = (Fleet_Component *)args;
+
+    uint64_t sent_ns = atomic_exchange(&component->press_sent_ns, 0);
+    if (!sent_ns) return;
+
+    fleet_latency_add(&component->device->command_latency, fleet_now_ns() - sent_ns);
+    atomic_fetch_add(&fleet_instance->presses_received, 1);
+}
+
+/**
+ * @brief Give a device its identity and a random set of components.
+ */
+static esp_err_t fleet_device_setup(Fleet *fleet, Fleet_Device *device, size_t index, uint64_t *rng) {
+    snprintf(device->unique_id, sizeof(device->unique_id), "fleet-%05zu", index);
+    snprintf(device->name, sizeof(device->name), "Fleet Device %zu", index);
+
+    device->config = hamqtt_device_config_default();
+    device->config.mqtt_uri = (char *)fleet->options.uri;
+    device->config.unique_id = device->unique_id;
+    device->config.name = device->name;
+    device->config.manufacturer = "HAMQTT";
+    device->config.model = "Fleet Simulator";
+
+    device->component_count = 1 + fleet_rand(rng) % fleet->options.max_components;
+
+    for (size_t i = 0; i < device->component_count; ++i) {
+        Fleet_Component *component = &device->components[i];
+        component->device = device;
+        component->is_button = fleet_rand(rng) % 2;
+        snprintf(component->unique_id, sizeof(component->unique_id), "fleet-%05zu_c%02zu", index, i);
+
+        // The ids and the topic are all stored in the device, so the topic is formatted apart
+        char topic[sizeof(component->topic)];
+        snprintf(topic, sizeof(topic), "%s/%s/%s", device->unique_id, component->unique_id, component->is_button ? "press" : "state");
+        memcpy(component->topic, topic, sizeof(topic));
+
+        if (component->is_button) {
+            component->button_config = hamqtt_button_config_default();
+            component->button_config.unique_id = component->unique_id;
+            component->button_config.name = "Fleet Button";
+            component->component = (HAMQTT_Component *)hamqtt_button_create(&component->button_config, fleet_button_on_press, component);
+            fleet->button_count++;
+        } else {
+            component->sensor_config = hamqtt_binary_sensor_config_default();
+            component->sensor_config.unique_id = component->unique_id;
+            component->sensor_config.name = "Fleet Sensor";
+            component->period_ms = (uint32_t)fleet_jitter(rng, fleet->options.signal_period_ms);
+            component->component = (HAMQTT_Component *)hamqtt_binary_sensor_create(&component->sensor_config, fleet_sensor_get_state, component);
+            fleet->sensor_count++;
+        }
+
+        ESP_RETURN_ON_FALSE(component->component, ESP_ERR_NO_MEM, TAG, "Unable to create component %s", component->unique_id);
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Create the HAMQTT device and its transport, and connect it. Called by the device's worker.
+ */
+static void fleet_device_boot(Fleet *fleet, Fleet_Device *device) {
+    device->transport = hamqtt_transport_posix_create();
+    device->device = hamqtt_device_create(&device->config);
+
+    if (!device->transport || !device->device) {
+        atomic_fetch_add(&fleet->boot_failures, 1);
+        return;
+    }
+
+    for (size_t i = 0; i < device->component_count; ++i) {
+        hamqtt_device_add_component(device->device, device->components[i].component);
+    }
+
+    hamqtt_device_set_transport(device->device, device->transport);
+
+    // A device that times out keeps retrying in the background, but never publishes discovery
+    if (hamqtt_device_connect(device->device) != ESP_OK) atomic_fetch_add(&fleet->boot_failures, 1);
+}
+
+static void fleet_device_shutdown(Fleet *fleet, Fleet_Device *device) {
+    if (atomic_exchange(&device->connected, false)) atomic_fetch_sub(&fleet->connected_count, 1);
+
+    hamqtt_device_destroy(device->device);
+    hamqtt_transport_destroy(device->transport);
+    device->device = NULL;
+    device->transport = NULL;
+}
+
+static void fleet_device_tick(Fleet *fleet, Fleet_Device *device, uint64_t now_ns, uint64_t *rng) {
+    if (!device->transport) return;
+
+    bool connected = hamqtt_transport_wait_connected(device->transport, 0) == ESP_OK;
+
+    if (connected != atomic_load(&device->connected)) {
+        atomic_store(&device->connected, connected);
+        if (connected) {
+            atomic_store(&device->connected_ns, now_ns);
+            atomic_fetch_add(&fleet->connected_count, 1);
+        } else {
+            atomic_fetch_sub(&fleet->connected_count, 1);
+            atomic_fetch_add(&fleet->disconnects, 1);
+        }
+    }
+
+    if (!connected) return;
+
+    for (size_t i = 0; i < device->component_count; ++i) {
+        Fleet_Component *component = &device->components[i];
+        if (component->is_button || now_ns < component->next_flip_ns) continue;
+
+        if (component->next_flip_ns) {
+            atomic_store(&component->changed_ns, now_ns);
+            atomic_store(&component->state, !atomic_load(&component->state));
+        }
+        component->next_flip_ns = now_ns + fleet_jitter(rng, component->period_ms) * 1000000ULL;
+    }
+
+    hamqtt_device_loop(device->device);
+}
+
+static void *fleet_worker_main(void *args) {
+    Fleet_Worker *worker = (Fleet_Worker *)args;
+    Fleet *fleet = worker->fleet;
+    Fleet_Device *devices = fleet->devices + worker->first;
+
+    uint64_t generation = atomic_load(&fleet->reboot_generation);
+
+    for (size_t i = 0; i < worker->count && !atomic_load(&fleet->stop); ++i) {
+        fleet_device_boot(fleet, &devices[i]);
+    }
+
+    while (!atomic_load(&fleet->stop)) {
+        uint64_t reboot_generation = atomic_load(&fleet->reboot_generation);
+
+        if (reboot_generation != generation) {
+            generation = reboot_generation;
+            for (size_t i = 0; i < worker->count; ++i) {
+                fleet_device_shutdown(fleet, &devices[i]);
+                fleet_device_boot(fleet, &devices[i]);
+            }
+        }
+
+        uint64_t now_ns = fleet_now_ns();
+        for (size_t i = 0; i < worker->count; ++i) {
+            fleet_device_tick(fleet, &devices[i], now_ns, &worker->rng);
+        }
+
+        fleet_sleep_ms(fleet->options.tick_ms);
+    }
+
+    for (size_t i = 0; i < worker->count; ++i) {
+        fleet_device_shutdown(fleet, &devices[i]);
+    }
+
+    return NULL;
+}
+
+/* ----- Observer ----- */
+
+static Fleet_Device *fleet_find_device(Fleet *fleet, const char *topic) {
+    const char *id = strstr(topic, "fleet-");
+    if (!id) return NULL;
+
+    size_t index = strtoul(id + 6, NULL, 10);
+    return index < fleet->options.device_count ? &fleet->devices[index] : NULL;
+}
+
+static void fleet_observer_on_connect(struct mosquitto *mosq, void *obj, int rc) {
+    if (rc != 0) {
+        ESP_LOGW(TAG, "Observer was refused by the broker: %s", mosquitto_connack_string(rc));
+        return;
+    }
+
+    mosquitto_subscribe(mosq, NULL, "#", 0);
+    mosquitto_subscribe(mosq, NULL, "$SYS/broker/#", 0);
+}
+
+static void fleet_observer_store_sys(Fleet *fleet, char *dest, size_t dest_size, const struct mosquitto_message *message) {
+    pthread_mutex_lock(&fleet->sys_lock);
+    int len = message->payloadlen < (int)dest_size - 1 ? message->payloadlen : (int)dest_size - 1;
+    memcpy(dest, message->payload, len);
+    dest[len] = '\0';
+    pthread_mutex_unlock(&fleet->sys_lock);
+}
+
+static bool fleet_topic_ends_with(const char *topic, const char *suffix) {
+    size_t topic_len = strlen(topic);
+    size_t suffix_len = strlen(suffix);
+    return topic_len >= suffix_len && strcmp(topic + topic_len - suffix_len, suffix) == 0;
+}
+
+static void fleet_observer_on_message(struct mosquitto *mosq, void *obj, const struct mosquitto_message *message) {
+    Fleet *fleet = (Fleet *)obj;
+    uint64_t now_ns = fleet_now_ns();
+    const char *topic = message->topic;
+
+    if (strncmp(topic, "$SYS/", 5) == 0) {
+        if (strcmp(topic, "$SYS/broker/load/messages/received/1min") == 0) {
+            fleet_observer_store_sys(fleet, fleet->sys_received_1min, sizeof(fleet->sys_received_1min), message);
+        } else if (strcmp(topic, "$SYS/broker/load/messages/sent/1min") == 0) {
+            fleet_observer_store_sys(fleet, fleet->sys_sent_1min, sizeof(fleet->sys_sent_1min), message);
+        } else if (strcmp(topic, "$SYS/broker/clients/connected") == 0) {
+            fleet_observer_store_sys(fleet, fleet->sys_clients, sizeof(fleet->sys_clients), message);
+        } else if (strcmp(topic, "$SYS/broker/subscriptions/count") == 0) {
+            fleet_observer_store_sys(fleet, fleet->sys_subscriptions, sizeof(fleet->sys_subscriptions), message);
+        }
+        return;
+    }
+
+    atomic_fetch_add(&fleet->observed_total, 1);
+
+    // Retained messages describe the past and carry no timing information
+    if (message->retain) return;
+
+    Fleet_Device *device = fleet_find_device(fleet, topic);
+    if (!device) return;
+
+    if (fleet_topic_ends_with(topic, "/config")) {
+        atomic_fetch_add(&fleet->observed_discovery, 1);
+        atomic_store(&device->discovered_ns, now_ns);
+    } else if (fleet_topic_ends_with(topic, "/availability")) {
+        atomic_fetch_add(&fleet->observed_availability, 1);
+    } else if (fleet_topic_ends_with(topic, "/state")) {
+        atomic_fetch_add(&fleet->observed_state, 1);
+
+        for (size_t i = 0; i < device->component_count; ++i) {
+            Fleet_Component *component = &device->components[i];
+            if (component->is_button || strcmp(component->topic, topic) != 0) continue;
+
+            uint64_t changed_ns = atomic_exchange(&component->changed_ns, 0);
+            if (changed_ns) fleet_latency_add(&device->state_latency, now_ns - changed_ns);
+            break;
+        }
+    }
+}
+
+static esp_err_t fleet_observer_start(Fleet *fleet) {
+    char host[HAMQTT_MAX_CHAR_BUF_SIZE];
+    int port = 1883;
+
+    const char *start = strstr(fleet->options.uri, "://");
+    start = start ? start + 3 : fleet->options.uri;
+    snprintf(host, sizeof(host), "%s", start);
+
+    char *colon = strrchr(host, ':');
+    if (colon) {
+        *colon = '\0';
+        port = atoi(colon + 1);
+    }
+
+    fleet->observer = mosquitto_new("hamqtt-fleet-observer", true, fleet);
+    ESP_RETURN_ON_FALSE(fleet->observer, ESP_ERR_NO_MEM, TAG, "Unable to create observer client");
+
+    mosquitto_connect_callback_set(fleet->observer, fleet_observer_on_connect);
+    mosquitto_message_callback_set(fleet->observer, fleet_observer_on_message);
+
+    int rc = mosquitto_connect_async(fleet->observer, host, port, 60);
+    ESP_RETURN_ON_FALSE(rc == MOSQ_ERR_SUCCESS, ESP_FAIL, TAG, "Observer failed to connect to %s:%d: %s", host, port, mosquitto_strerror(rc));
+
+    rc = mosquitto_loop_start(fleet->observer);
+    ESP_RETURN_ON_FALSE(rc == MOSQ_ERR_SUCCESS, ESP_FAIL, TAG, "Observer failed to start: %s", mosquitto_strerror(rc));
+
+    return ESP_OK;
+}
+
+static void fleet_observer_stop(Fleet *fleet) {
+    if (!fleet->observer) return;
+
+    mosquitto_disconnect(fleet->observer);
+    mosquitto_loop_stop(fleet->observer, false);
+    mosquitto_destroy(fleet->observer);
+    fleet->observer = NULL;
+}
+
+/**
+ * @brief Press a random button, as Home Assistant would.
+ */
+static void fleet_observer_press(Fleet *fleet, uint64_t *rng) {
+    Fleet_Device *device = &fleet->devices[fleet_rand(rng) % fleet->options.device_count];
+    Fleet_Component *component = &device->components[fleet_rand(rng) % device->component_count];
+
+    if (!component->is_button || !atomic_load(&device->connected)) return;
+
+    // One press in flight per button; a press lost to a reconnect is given up on after a second
+    uint64_t now_ns = fleet_now_ns();
+    uint64_t sent_ns = atomic_load(&component->press_sent_ns);
+    if (sent_ns && now_ns - sent_ns < 1000000000ULL) return;
+    atomic_store(&component->press_sent_ns, now_ns);
+
+    if (mosquitto_publish(fleet->observer, NULL, component->topic, 5, "PRESS", 1, false) == MOSQ_ERR_SUCCESS) {
+        atomic_fetch_add(&fleet->presses_sent, 1);
+    } else {
+        atomic_store(&component->press_sent_ns, 0);
+    }
+}
+
+/* ----- Scenario driver ----- */
+
+static void fleet_print_status(Fleet *fleet, uint64_t start_ns, uint64_t *last_total) {
+    uint64_t total = atomic_load(&fleet->observed_total);
+
+    pthread_mutex_lock(&fleet->sys_lock);
+    fprintf(stderr, "[%6.1fs] connected %llu/%zu, observed %llu msg/s, broker recv/sent 1min %s/%s, clients %s, subscriptions %s\n",
+            (double)(fleet_now_ns() - start_ns) / 1e9,
+            (unsigned long long)atomic_load(&fleet->connected_count),
+            fleet->options.device_count,
+            (unsigned long long)(total - *last_total),
+            fleet->sys_received_1min[0] ? fleet->sys_received_1min : "-",
+            fleet->sys_sent_1min[0] ? fleet->sys_sent_1min : "-",
+            fleet->sys_clients[0] ? fleet->sys_clients : "-",
+            fleet->sys_subscriptions[0] ? fleet->sys_subscriptions : "-");
+    pthread_mutex_unlock(&fleet->sys_lock);
+
+    *last_total = total;
+}
+
+/**
+ * @brief Count devices that have recovered since `event_ns`, and the time the last of them did.
+ */
+static size_t fleet_count_recovered(Fleet *fleet, uint64_t event_ns, uint64_t *last_ns) {
+    size_t recovered = 0;
+    *last_ns = event_ns;
+
+    for (size_t i = 0; i < fleet->options.device_count; ++i) {
+        Fleet_Device *device = &fleet->devices[i];
+        uint64_t ns = fleet->options.scenario == FLEET_SCENARIO_HA_RESTART
+                    ? atomic_load(&device->discovered_ns)
+                    : atomic_load(&device->connected_ns);
+
+        if (ns < event_ns) continue;
+        if (fleet->options.scenario != FLEET_SCENARIO_HA_RESTART && !atomic_load(&device->connected)) continue;
+
+        recovered++;
+        if (ns > *last_ns) *last_ns = ns;
+    }
+
+    return recovered;
+}
+
+static void fleet_trigger_event(Fleet *fleet) {
+    switch (fleet->options.scenario) {
+    case FLEET_SCENARIO_MASS_REBOOT:
+        atomic_fetch_add(&fleet->reboot_generation, 1);
+        break;
+
+    case FLEET_SCENARIO_BROKER_RESTART:
+        if (system(fleet->options.broker_restart_cmd) != 0) {
+            ESP_LOGW(TAG, "Broker restart command exited with an error");
+        }
+        break;
+
+    case FLEET_SCENARIO_HA_RESTART: {
+        const char *prefix = hamqtt_device_config_default().mqtt_config_topic_prefix;
+        char topic[HAMQTT_MAX_CHAR_BUF_SIZE];
+        snprintf(topic, sizeof(topic), "%s/status", prefix);
+        mosquitto_publish(fleet->observer, NULL, topic, 7, "offline", 1, false);
+        mosquitto_publish(fleet->observer, NULL, topic, 6, "online", 1, false);
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Print fleet-wide percentiles of one latency kind, and the worst per-device p99.
+ */
+static void fleet_report_latency(Fleet *fleet, const char *label, size_t offset) {
+    size_t capacity = fleet->options.device_count * FLEET_LATENCY_SAMPLES;
+    uint64_t *all = malloc(capacity * sizeof(uint64_t));
+    uint64_t *device_p99 = malloc(fleet->options.device_count * sizeof(uint64_t));
+    if (!all || !device_p99) {
+        free(all);
+        free(device_p99);
+        return;
+    }
+
+    size_t count = 0;
+    size_t device_count = 0;
+
+    for (size_t i = 0; i < fleet->options.device_count; ++i) {
+        Fleet_Latency *latency = (Fleet_Latency *)((char *)&fleet->devices[i] + offset);
+        size_t n = latency->count < FLEET_LATENCY_SAMPLES ? latency->count : FLEET_LATENCY_SAMPLES;
+        if (n == 0) continue;
+
+        memcpy(all + count, latency->samples_ns, n * sizeof(uint64_t));
+        device_p99[device_count++] = fleet_percentile(latency->samples_ns, n, 99);
+        count += n;
+    }
+
+    printf("%-22s samples %zu, p50 %.0f us, p90 %.0f us, p99 %.0f us, max %.0f us, worst device p99 %.0f us, median device p99 %.0f us\n",
+           label,
+           count,
+           fleet_percentile(all, count, 50) / 1e3,
+           fleet_percentile(all, count, 90) / 1e3,
+           fleet_percentile(all, count, 99) / 1e3,
+           fleet_percentile(all, count, 100) / 1e3,
+           fleet_percentile(device_p99, device_count, 100) / 1e3,
+           fleet_percentile(device_p99, device_count, 50) / 1e3);
+
+    free(all);
+    free(device_p99);
+}
+
+static void fleet_run(Fleet *fleet, Fleet_Worker *workers) {
+    const Fleet_Options *options = &fleet->options;
+    uint64_t rng = options->seed ^ 0x9E3779B97F4A7C15ULL;
+
+    uint64_t start_ns = fleet_now_ns();
+    uint64_t end_ns = start_ns + (uint64_t)options->duration_s * 1000000000ULL;
+    uint64_t event_ns = options->scenario == FLEET_SCENARIO_STEADY ? 0 : start_ns + (end_ns - start_ns) / 3;
+    uint64_t next_status_ns = start_ns + 1000000000ULL;
+    uint64_t next_press_ns = start_ns;
+    uint64_t connect_ns = 0;
+    uint64_t recovered_ns = 0;
+    uint64_t last_total = 0;
+    bool event_done = false;
+
+    for (size_t i = 0; i < options->thread_count; ++i) {
+        pthread_create(&workers[i].thread, NULL, fleet_worker_main, &workers[i]);
+    }
+
+    for (uint64_t now_ns = start_ns; now_ns < end_ns; now_ns = fleet_now_ns()) {
+        if (!connect_ns && atomic_load(&fleet->connected_count) == options->device_count) {
+            connect_ns = now_ns;
+        }
+
+        if (event_ns && !event_done && now_ns >= event_ns) {
+            fprintf(stderr, "[%6.1fs] triggering %s\n", (double)(now_ns - start_ns) / 1e9, scenario_names[options->scenario]);
+            event_ns = fleet_now_ns();
+            fleet_trigger_event(fleet);
+            event_done = true;
+        }
+
+        if (event_done && !recovered_ns) {
+            uint64_t last_ns;
+            if (fleet_count_recovered(fleet, event_ns, &last_ns) == options->device_count) recovered_ns = last_ns;
+        }
+
+        if (options->press_interval_ms && now_ns >= next_press_ns) {
+            fleet_observer_press(fleet, &rng);
+            next_press_ns = now_ns + options->press_interval_ms * 1000000ULL;
+        }
+
+        if (now_ns >= next_status_ns) {
+            fleet_print_status(fleet, start_ns, &last_total);
+            next_status_ns += 1000000000ULL;
+        }
+
+        fleet_sleep_ms(options->tick_ms);
+    }
+
+    uint64_t last_ns = 0;
+    size_t recovered = event_done ? fleet_count_recovered(fleet, event_ns, &last_ns) : 0;
+
+    atomic_store(&fleet->stop, true);
+    for (size_t i = 0; i < options->thread_count; ++i) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    printf("scenario               %s\n", scenario_names[options->scenario]);
+    printf("devices                %zu (%zu binary sensors, %zu buttons, %zu worker threads)\n",
+           options->device_count, fleet->sensor_count, fleet->button_count, options->thread_count);
+    if (connect_ns) {
+        printf("initial connect        %.1f ms\n", (double)(connect_ns - start_ns) / 1e6);
+    } else {
+        printf("initial connect        incomplete\n");
+    }
+    printf("boot failures          %llu\n", (unsigned long long)atomic_load(&fleet->boot_failures));
+    printf("disconnects seen       %llu\n", (unsigned long long)atomic_load(&fleet->disconnects));
+    if (event_done && recovered_ns) {
+        printf("recovery               %.1f ms (%zu/%zu devices)\n", (double)(recovered_ns - event_ns) / 1e6, recovered, options->device_count);
+    } else if (event_done) {
+        printf("recovery               incomplete (%zu/%zu devices)\n", recovered, options->device_count);
+    }
+    printf("observed messages      %llu total, %llu discovery, %llu availability, %llu state\n",
+           (unsigned long long)atomic_load(&fleet->observed_total),
+           (unsigned long long)atomic_load(&fleet->observed_discovery),
+           (unsigned long long)atomic_load(&fleet->observed_availability),
+           (unsigned long long)atomic_load(&fleet->observed_state));
+    printf("broker                 recv/sent 1min %s/%s, clients %s, subscriptions %s\n",
+           fleet->sys_received_1min[0] ? fleet->sys_received_1min : "-",
+           fleet->sys_sent_1min[0] ? fleet->sys_sent_1min : "-",
+           fleet->sys_clients[0] ? fleet->sys_clients : "-",
+           fleet->sys_subscriptions[0] ? fleet->sys_subscriptions : "-");
+    printf("presses                %llu sent, %llu received\n",
+           (unsigned long long)atomic_load(&fleet->presses_sent),
+           (unsigned long long)atomic_load(&fleet->presses_received));
+
+    fleet_report_latency(fleet, "state latency", offsetof(Fleet_Device, state_latency));
+    fleet_report_latency(fleet, "command latency", offsetof(Fleet_Device, command_latency));
+}
+
+/* ----- Command line ----- */
+
+static void fleet_usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --uri <uri>                  Broker URI (default mqtt://localhost:1883)\n"
+            "  --devices <n>                Number of simulated devices (default 100)\n"
+            "  --max-components <n>         Components per device, chosen from 1..n (default 8, max %d)\n"
+            "  --threads <n>                Worker threads driving the devices (default 4, max %d)\n"
+            "  --duration-s <s>             Length of the run (default 30)\n"
+            "  --scenario <name>            steady, mass_reboot, broker_restart or ha_restart (default steady)\n"
+            "  --broker-restart-cmd <cmd>   Shell command that restarts the broker, for broker_restart\n"
+            "  --signal-period-ms <ms>      Mean time between binary sensor flips (default 5000)\n"
+            "  --press-interval-ms <ms>     Time between random button presses, 0 to disable (default 50)\n"
+            "  --tick-ms <ms>               Device loop period (default 10)\n"
+            "  --seed <n>                   Seed for the random fleet layout and signals (default 1)\n"
+            "  --verbose                    Show HAMQTT warnings and info logs\n",
+            argv0, FLEET_MAX_COMPONENTS, FLEET_MAX_THREADS);
+}
+
+static esp_err_t fleet_parse_args(Fleet_Options *options, int argc, char **argv) {
+    *options = (Fleet_Options){
+        .uri = "mqtt://localhost:1883",
+        .scenario = FLEET_SCENARIO_STEADY,
+        .device_count = 100,
+        .max_components = 8,
+        .thread_count = 4,
+        .duration_s = 30,
+        .tick_ms = 10,
+        .signal_period_ms = 5000,
+        .press_interval_ms = 50,
+        .seed = 1,
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+
+        if (strcmp(arg, "--help") == 0) return ESP_ERR_INVALID_ARG;
+
+        if (strcmp(arg, "--verbose") == 0) {
+            options->verbose = true;
+            continue;
+        }
+
+        ESP_RETURN_ON_FALSE(i + 1 < argc, ESP_ERR_INVALID_ARG, TAG, "Missing value for %s", arg);
+        const char *value = argv[++i];
+
+        if (strcmp(arg, "--uri") == 0) {
+            options->uri = value;
+        } else if (strcmp(arg, "--devices") == 0) {
+            options->device_count = strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--max-components") == 0) {
+            options->max_components = strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--threads") == 0) {
+            options->thread_count = strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--duration-s") == 0) {
+            options->duration_s = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--broker-restart-cmd") == 0) {
+            options->broker_restart_cmd = value;
+        } else if (strcmp(arg, "--signal-period-ms") == 0) {
+            options->signal_period_ms = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--press-interval-ms") == 0) {
+            options->press_interval_ms = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--tick-ms") == 0) {
+            options->tick_ms = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--seed") == 0) {
+            options->seed = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--scenario") == 0) {
+            size_t scenario_count = sizeof(scenario_names) / sizeof(scenario_names[0]);
+            size_t s = 0;
+            while (s < scenario_count && strcmp(value, scenario_names[s]) != 0) s++;
+            ESP_RETURN_ON_FALSE(s < scenario_count, ESP_ERR_INVALID_ARG, TAG, "Unknown scenario %s", value);
+            options->scenario = (Fleet_Scenario)s;
+        } else {
+            ESP_LOGE(TAG, "Unknown argument %s", arg);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    ESP_RETURN_ON_FALSE(options->device_count > 0 && options->device_count < 100000, ESP_ERR_INVALID_ARG, TAG, "--devices must be between 1 and 99999");
+    ESP_RETURN_ON_FALSE(options->max_components > 0 && options->max_components <= FLEET_MAX_COMPONENTS
+                        && options->max_components <= HAMQTT_DEVICE_MAX_COMPONENTS,
+                        ESP_ERR_INVALID_ARG, TAG, "--max-components must be between 1 and %d",
+                        FLEET_MAX_COMPONENTS < HAMQTT_DEVICE_MAX_COMPONENTS ? FLEET_MAX_COMPONENTS : HAMQTT_DEVICE_MAX_COMPONENTS);
+    ESP_RETURN_ON_FALSE(options->thread_count > 0 && options->thread_count <= FLEET_MAX_THREADS, ESP_ERR_INVALID_ARG, TAG, "--threads must be between 1 and %d", FLEET_MAX_THREADS);
+    ESP_RETURN_ON_FALSE(options->signal_period_ms > 0 && options->tick_ms > 0, ESP_ERR_INVALID_ARG, TAG, "Periods must be greater than 0");
+    ESP_RETURN_ON_FALSE(options->scenario != FLEET_SCENARIO_BROKER_RESTART || options->broker_restart_cmd,
+                        ESP_ERR_INVALID_ARG, TAG, "broker_restart needs --broker-restart-cmd");
+
+    return ESP_OK;
+}
+
+int main(int argc, char **argv) {
+    static Fleet fleet;
+    static Fleet_Worker workers[FLEET_MAX_THREADS];
+
+    if (fleet_parse_args(&fleet.options, argc, argv) != ESP_OK) {
+        fleet_usage(argv[0]);
+        return 2;
+    }
+
+    // Every scenario disconnects devices on purpose, so their warnings are only noise by default
+    if (!fleet.options.verbose) hamqtt_port_log_level = HAMQTT_PORT_LOG_ERROR;
+
+    fleet_instance = &fleet;
+    pthread_mutex_init(&fleet.sys_lock, NULL);
+
+    int rc = 1;
+    uint64_t rng = fleet.options.seed ? fleet.options.seed : 1;
+
+    fleet.devices = calloc(fleet.options.device_count, sizeof(Fleet_Device));
+    if (!fleet.devices) {
+        ESP_LOGE(TAG, "Unable to allocate %zu devices", fleet.options.device_count);
+        return 1;
+    }
+
+    for (size_t i = 0; i < fleet.options.device_count; ++i) {
+        if (fleet_device_setup(&fleet, &fleet.devices[i], i, &rng) != ESP_OK) goto cleanup;
+    }
+
+    // hamqtt_transport_posix_create initializes libmosquitto, the observer needs it first
+    hamqtt_transport_destroy(hamqtt_transport_posix_create());
+    if (fleet_observer_start(&fleet) != ESP_OK) goto cleanup;
+
+    size_t per_worker = (fleet.options.device_count + fleet.options.thread_count - 1) / fleet.options.thread_count;
+    size_t first = 0;
+    for (size_t i = 0; i < fleet.options.thread_count; ++i) {
+        workers[i].fleet = &fleet;
+        workers[i].first = first;
+        workers[i].count = first < fleet.options.device_count
+                         ? (fleet.options.device_count - first < per_worker ? fleet.options.device_count - first : per_worker)
+                         : 0;
+        workers[i].rng = fleet_rand(&rng) | 1;
+        first += workers[i].count;
+    }
+
+    fleet_run(&fleet, workers);
+    rc = 0;
+
+cleanup:
+    fleet_observer_stop(&fleet);
+
+    for (size_t i = 0; i < fleet.options.device_count; ++i) {
+        Fleet_Device *device = &fleet.devices[i];
+        for (size_t j = 0; j < device->component_count; ++j) {
+            Fleet_Component *component = &device->components[j];
+            if (!component->component) continue;
+
+            if (component->is_button) {
+                hamqtt_button_destroy((HAMQTT_Button *)component->component);
+            } else {
+                hamqtt_binary_sensor_destroy((HAMQTT_Binary_Sensor *)component->component);
+            }
+        }
+    }
+
+    free(fleet.devices);
+    pthread_mutex_destroy(&fleet.sys_lock);
+
+    return rc;
+}
@@ -0,0 +1,361 @@
+#!/usr/bin/env python3
+#
+# Copyright 2025 Ethan Barnes
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Measure the flash and RAM footprint of HAMQTT per feature and per entity.
+
+Builds the library once per reference configuration: a base configuration with
+both component types and runtime discovery, then each optional feature switched
+on or off relative to it. For every build it reports the .text, .rodata, .data
+and .bss of the library archive. The heap held per entity comes from running
+bench_footprint for 1, 16 and 64 entities in a host build.
+
+The host target is always measured. Pass --esp32 to also build each
+configuration as an ESP-IDF project, which needs idf.py and the Xtensa toolchain
+on the PATH (run it from an ESP-IDF shell). The heap is only measured on the
+host, where pointers are 8 bytes, so an ESP32 holds somewhat less.
+
+Section sizes are those of the archive, before the linker drops unused
+functions with --gc-sections, so they are an upper bound on what an
+application pays. Keep the JSON output to track the numbers over time:
+
+    tools/hamqtt_footprint.py --format json --output footprint.json
+"""
+
+import argparse
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+REPO_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# The base configuration, which every other configuration changes one option of.
+BASE_OPTIONS = {
+    "CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR": True,
+    "CONFIG_HAMQTT_COMPONENT_BUTTON": True,
+    "CONFIG_HAMQTT_COMPONENT_GROUP": True,
+    "CONFIG_HAMQTT_RUNTIME_DISCOVERY": True,
+    "CONFIG_HAMQTT_TRANSPORT_MOCK": False,
+    "CONFIG_HAMQTT_TRANSPORT_RECORD": False,
+    "CONFIG_HAMQTT_LATENCY": False,
+    "CONFIG_HAMQTT_DIAGNOSTICS": False,
+    "CONFIG_HAMQTT_CONSOLE": False,
+    "CONFIG_HAMQTT_PIPELINE": False,
+    "CONFIG_HAMQTT_RULES": False,
+    "CONFIG_HAMQTT_SCENE": False,
+    "CONFIG_HAMQTT_ATTRIBUTES": False,
+    "CONFIG_HAMQTT_TRACE": False,
+}
+
+# (name, option, value, host only)
+FEATURES = [
+    ("no_binary_sensor", "CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR", False, False),
+    ("no_button", "CONFIG_HAMQTT_COMPONENT_BUTTON", False, False),
+    ("no_group", "CONFIG_HAMQTT_COMPONENT_GROUP", False, False),
+    ("no_runtime_discovery", "CONFIG_HAMQTT_RUNTIME_DISCOVERY", False, False),
+    ("transport_mock", "CONFIG_HAMQTT_TRANSPORT_MOCK", True, False),
+    ("transport_record", "CONFIG_HAMQTT_TRANSPORT_RECORD", True, False),
+    ("latency", "CONFIG_HAMQTT_LATENCY", True, False),
+    ("diagnostics", "CONFIG_HAMQTT_DIAGNOSTICS", True, False),
+    ("console", "CONFIG_HAMQTT_CONSOLE", True, False),
+    ("pipeline", "CONFIG_HAMQTT_PIPELINE", True, False),
+    ("rules", "CONFIG_HAMQTT_RULES", True, False),
+    ("scene", "CONFIG_HAMQTT_SCENE", True, False),
+    ("attributes", "CONFIG_HAMQTT_ATTRIBUTES", True, False),
+    ("trace", "CONFIG_HAMQTT_TRACE", True, True),
+]
+
+SECTIONS = ("text", "rodata", "data", "bss")
+
+# Largest entity count measured by bench_footprint.
+MAX_ENTITIES = 64
+
+ESP32_MAIN = """\
+#include "HAMQTT.h"
+
+static bool get_state(void *args) { return false; }
+static void on_press(void *args) {}
+
+void app_main(void) {
+    static HAMQTT_Device_Config device_config;
+    device_config = hamqtt_device_config_default();
+    device_config.mqtt_uri = "mqtt://footprint";
+    device_config.unique_id = "footprint";
+
+    HAMQTT_Device *device = hamqtt_device_create(&device_config);
+
+#if CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR
+    static HAMQTT_Binary_Sensor_Config sensor_config;
+    sensor_config = hamqtt_binary_sensor_config_default();
+    sensor_config.unique_id = "sensor";
+    hamqtt_device_add_component(device, (HAMQTT_Component *)hamqtt_binary_sensor_create(&sensor_config, get_state, NULL));
+#endif
+#if CONFIG_HAMQTT_COMPONENT_BUTTON
+    static HAMQTT_Button_Config button_config;
+    button_config = hamqtt_button_config_default();
+    button_config.unique_id = "button";
+    hamqtt_device_add_component(device, (HAMQTT_Component *)hamqtt_button_create(&button_config, on_press, NULL));
+#endif
+#if CONFIG_HAMQTT_COMPONENT_GROUP
+    static HAMQTT_Group_Config group_config;
+    group_config = hamqtt_group_config_default();
+    group_config.unique_id = "group";
+    hamqtt_device_add_component(device, (HAMQTT_Component *)hamqtt_group_create(&group_config, NULL, 0));
+#endif
+#if CONFIG_HAMQTT_RULES && CONFIG_HAMQTT_COMPONENT_BINARY_SENSOR && CONFIG_HAMQTT_COMPONENT_BUTTON
+    static const HAMQTT_Rule rules[] = {
+        { .trigger = "sensor", .when = HAMQTT_RULE_WHEN_ON, .action = HAMQTT_RULE_ACTION_PRESS, .target = "button" },
+    };
+    hamqtt_device_set_rules(device, rules, 1);
+#endif
+
+#if CONFIG_HAMQTT_SCENE
+    hamqtt_device_apply_scene(device, "{}", 2);
+#endif
+#if CONFIG_HAMQTT_ATTRIBUTES
+    static const HAMQTT_Attribute_Config attribute_slots[] = {
+        { .key = "firmware", .type = HAMQTT_ATTRIBUTE_STRING, .max_len = 16 },
+        { .key = "rssi", .type = HAMQTT_ATTRIBUTE_INT },
+    };
+    HAMQTT_Attributes *attributes = hamqtt_attributes_create(attribute_slots, 2);
+    hamqtt_component_set_attributes(hamqtt_device_get_component(device, 0), attributes);
+    hamqtt_attributes_set_string(attributes, 0, "1.0.0");
+    hamqtt_attributes_set_int(attributes, 1, -60);
+#endif
+
+    hamqtt_device_connect(device);
+    while (true) hamqtt_device_loop(device);
+}
+"""
+
+
+class FootprintError(Exception):
+    pass
+
+
+def run(cmd, cwd=None, capture=False):
+    result = subprocess.run(cmd, cwd=cwd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    if result.returncode != 0:
+        raise FootprintError("%s failed:\n%s" % (" ".join(cmd), result.stdout[-4000:]))
+    return result.stdout if capture else None
+
+
+def section_kind(name):
+    """Map an ELF section name to the column it is counted in, or None."""
+    if name.startswith((".text", ".literal", ".iram", ".flash.text")):
+        return "text"
+    if name.startswith((".rodata", ".srodata", ".flash.rodata")):
+        return "rodata"
+    if name.startswith((".data", ".sdata", ".dram")):
+        return "data"
+    if name.startswith((".bss", ".sbss")) or name == "COMMON":
+        return "bss"
+    return None
+
+
+def archive_sizes(size_tool, archive):
+    """Sum the sections of every object in an archive, from `size -A`."""
+    totals = dict.fromkeys(SECTIONS, 0)
+    output = run([size_tool, "-A", archive], capture=True)
+
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[1].isdigit():
+            kind = section_kind(fields[0])
+            if kind:
+                totals[kind] += int(fields[1])
+
+    return totals
+
+
+def cmake_bool(value):
+    return "ON" if value else "OFF"
+
+
+def read_cache_option(build_dir, option):
+    with open(os.path.join(build_dir, "CMakeCache.txt"), "r", encoding="utf-8") as f:
+        match = re.search(r"^%s:BOOL=(\w+)$" % option, f.read(), re.MULTILINE)
+    return match is not None and match.group(1).upper() in ("ON", "TRUE", "1", "YES")
+
+
+def build_host(work_dir, name, options, benchmarks=False):
+    build_dir = os.path.join(work_dir, "host-" + name)
+    cmd = ["cmake", "-S", REPO_DIR, "-B", build_dir,
+           "-DCMAKE_BUILD_TYPE=MinSizeRel",
+           "-DCONFIG_HAMQTT_DEVICE_MAX_COMPONENTS=%d" % MAX_ENTITIES,
+           "-DHAMQTT_BUILD_EXAMPLES=OFF",
+           "-DHAMQTT_BUILD_TOOLS=OFF",
+           "-DHAMQTT_BUILD_BENCHMARKS=%s" % cmake_bool(benchmarks)]
+    cmd += ["-D%s=%s" % (option, cmake_bool(value)) for option, value in options.items()]
+
+    run(cmd)
+    run(["cmake", "--build", build_dir, "-j%d" % (os.cpu_count() or 1)])
+
+    return build_dir
+
+
+def measure_host(work_dir, name, options):
+    """Returns the section sizes and the options in effect, as the host build switches off
+    options whose dependencies are missing."""
+    build_dir = build_host(work_dir, name, options)
+    effective = {option: value and read_cache_option(build_dir, option) for option, value in options.items()}
+    return archive_sizes("size", os.path.join(build_dir, "libhamqtt.a")), effective
+
+
+def measure_esp32(work_dir, name, options):
+    project_dir = os.path.join(work_dir, "esp32-" + name)
+    os.makedirs(os.path.join(project_dir, "main"), exist_ok=True)
+    os.makedirs(os.path.join(project_dir, "components"), exist_ok=True)
+
+    component_link = os.path.join(project_dir, "components", "HAMQTT")
+    if not os.path.lexists(component_link):
+        os.symlink(REPO_DIR, component_link)
+
+    files = {
+        "CMakeLists.txt": "cmake_minimum_required(VERSION 3.16)\n"
+                          "include($ENV{IDF_PATH}/tools/cmake/project.cmake)\n"
+                          "project(hamqtt_footprint)\n",
+        "main/CMakeLists.txt": 'idf_component_register(SRCS "main.c" REQUIRES HAMQTT)\n',
+        "main/main.c": ESP32_MAIN,
+        "sdkconfig.defaults": "".join("%s=%s\n" % (option, "y" if value else "n")
+                                      for option, value in options.items()
+                                      if option != "CONFIG_HAMQTT_TRACE"),
+    }
+    for path, content in files.items():
+        with open(os.path.join(project_dir, path), "w", encoding="utf-8") as f:
+            f.write(content)
+
+    run(["idf.py", "-C", project_dir, "set-target", "esp32"])
+    run(["idf.py", "-C", project_dir, "build"])
+
+    sizes = archive_sizes("xtensa-esp32-elf-size",
+                          os.path.join(project_dir, "build", "esp-idf", "HAMQTT", "libHAMQTT.a"))
+    return sizes, options
+
+
+def measure_heap(work_dir):
+    options = dict(BASE_OPTIONS, CONFIG_HAMQTT_TRANSPORT_MOCK=True)
+    build_dir = build_host(work_dir, "heap", options, benchmarks=True)
+
+    output = run([os.path.join(build_dir, "bench", "bench_footprint"), "--format", "json"], capture=True)
+    return json.loads(output[output.index("{"):])["results"]
+
+
+def size_rows(target, measure, work_dir, features):
+    base, base_options = measure(work_dir, "base", BASE_OPTIONS)
+    rows = [dict(target=target, config="base", **base)]
+
+    for option, value in BASE_OPTIONS.items():
+        if base_options[option] != value:
+            print("%s is not available for %s, the base is built without it" % (option, target), file=sys.stderr)
+
+    for name, option, value, host_only in features:
+        if (host_only and target != "host") or base_options[option] == value:
+            continue
+
+        sizes, options = measure(work_dir, name, dict(base_options, **{option: value}))
+        if options[option] != value:
+            print("Skipping %s %s, %s is not available" % (target, name, option), file=sys.stderr)
+            continue
+
+        row = dict(target=target, config=name, **sizes)
+        for section in SECTIONS:
+            row[section + "_delta"] = sizes[section] - base[section]
+        rows.append(row)
+
+    for row in rows:
+        row["flash"] = row["text"] + row["rodata"] + row["data"]
+        row["ram"] = row["data"] + row["bss"]
+
+    return rows
+
+
+def format_markdown(sizes, heap_rows):
+    lines = ["| Target | Config | .text | .rodata | .data | .bss | Flash | Static RAM |",
+             "| ------ | ------ | ----: | ------: | ----: | ---: | ----: | ---------: |"]
+    for row in sizes:
+        cells = []
+        for section in SECTIONS:
+            delta = row.get(section + "_delta")
+            cells.append("%d (%+d)" % (row[section], delta) if delta else "%d" % row[section])
+        lines.append("| %s | %s | %s | %d | %d |" % (row["target"], row["config"], " | ".join(cells), row["flash"], row["ram"]))
+
+    lines += ["",
+              "| Entities | Device heap | Heap per entity | Heap when connected | Per entity when connected | Connect peak |",
+              "| -------: | ----------: | --------------: | ------------------: | ------------------------: | -----------: |"]
+    for row in heap_rows:
+        lines.append("| %d | %d | %.1f | %d | %.1f | %d |" % (row["entities"], row["device_bytes"], row["bytes_per_entity"],
+                                                           row["connected_bytes"], row["connected_bytes_per_entity"],
+                                                           row["connect_peak_bytes"]))
+
+    return "\n".join(lines) + "\n"
+
+
+def format_csv(sizes, heap_rows):
+    lines = ["target,config,text,rodata,data,bss,flash,ram"]
+    lines += ["%s,%s,%d,%d,%d,%d,%d,%d" % (row["target"], row["config"], row["text"], row["rodata"],
+                                           row["data"], row["bss"], row["flash"], row["ram"]) for row in sizes]
+    lines += ["", "entities,device_bytes,bytes_per_entity,connected_bytes,connected_bytes_per_entity,connect_peak_bytes"]
+    lines += ["%d,%d,%.1f,%d,%.1f,%d" % (row["entities"], row["device_bytes"], row["bytes_per_entity"],
+                                         row["connected_bytes"], row["connected_bytes_per_entity"],
+                                         row["connect_peak_bytes"]) for row in heap_rows]
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--esp32", action="store_true", help="Also build for the ESP32 (needs idf.py on the PATH)")
+    parser.add_argument("--format", choices=("markdown", "csv", "json"), default="markdown", help="Output format")
+    parser.add_argument("--output", help="Write the report to this file instead of stdout")
+    parser.add_argument("--work-dir", help="Keep the builds in this directory instead of a temporary one")
+    args = parser.parse_args()
+
+    if args.esp32 and not shutil.which("idf.py"):
+        sys.exit("idf.py was not found, run from an ESP-IDF shell")
+
+    work_dir = args.work_dir or tempfile.mkdtemp(prefix="hamqtt_footprint_")
+
+    try:
+        sizes = size_rows("host", measure_host, work_dir, FEATURES)
+        if args.esp32:
+            sizes += size_rows("esp32", measure_esp32, work_dir, FEATURES)
+        heap = measure_heap(work_dir)
+    except FootprintError as e:
+        sys.exit(str(e))
+    finally:
+        if not args.work_dir:
+            shutil.rmtree(work_dir, ignore_errors=True)
+
+    if args.format == "json":
+        report = json.dumps({"sizes": sizes, "heap": heap}, indent=2) + "\n"
+    elif args.format == "csv":
+        report = format_csv(sizes, heap)
+    else:
+        report = format_markdown(sizes, heap)
+
+    if args.output:
+        with open(args.output, "w", encoding="utf-8") as f:
+            f.write(report)
+    else:
+        sys.stdout.write(report)
+
+
+if __name__ == "__main__":
+    main()
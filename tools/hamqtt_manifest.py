@@ -0,0 +1,425 @@
+#!/usr/bin/env python3
+#
+# Copyright 2025 Ethan Barnes
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Generate a HAMQTT discovery template and component table from a device manifest.
+
+The manifest is a JSON file describing the device metadata and its components.
+Everything except the per-unit device unique_id is known at build time, so the
+Home Assistant discovery payload is emitted as const fragments which the device
+joins with its unique_id when it connects.
+
+The device may set manufacturer, model, sw_version, hw_version, serial_number
+and origin_url. They are the same for every unit built from the manifest, so a
+per-unit serial number belongs in the runtime-discovery path instead. Strings are
+escaped with json.dumps, and the device rejects a unique_id that would need it.
+
+Example manifest:
+
+    {
+        "name": "hall_node",
+        "includes": ["hall_node.h"],
+        "device": {
+            "name": "Hall Sensor Node",
+            "manufacturer": "Eden Electronics",
+            "sw_version": "1.0.0"
+        },
+        "components": [
+            {
+                "type": "binary_sensor",
+                "unique_id": "hall_door_state",
+                "name": "Hall Door",
+                "device_class": "door",
+                "get_state_func": "door_open_get_state",
+                "json_attributes": [
+                    {"key": "rssi", "type": "int"},
+                    {"key": "firmware", "type": "string", "max_len": 16}
+                ]
+            },
+            {
+                "type": "button",
+                "unique_id": "hall_bell",
+                "name": "Hall Bell",
+                "on_press_func": "bell_on_press",
+                "on_press_func_args": "NULL"
+            }
+        ]
+    }
+
+The generated header declares:
+
+    extern const HAMQTT_Discovery_Template <name>_hamqtt_discovery;
+    esp_err_t <name>_hamqtt_register(HAMQTT_Device *device);
+
+and, for each component with "json_attributes", the attributes created by
+<name>_hamqtt_register and an enum of their slots:
+
+    extern HAMQTT_Attributes *<name>_<unique_id>_attributes;
+    enum { <NAME>_<UNIQUE_ID>_ATTR_<KEY>, ... };
+
+Slot types are "bool", "int", "float" (with an optional "precision") and
+"string" (with a required "max_len").
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+# Stands in for the device unique_id while the payload is serialized.
+UNIQUE_ID_PLACEHOLDER = "@@HAMQTT_DEVICE_UNIQUE_ID@@"
+
+# Omission rules mirror the discovery field tables in src/.
+COMPONENT_TYPES = {
+    "binary_sensor": {
+        "topic_key": "state_topic",
+        "topic_suffix": "state",
+        "callback": ("get_state_func", "bool"),
+        "defaults": {
+            "device_class": None,
+            "enabled_by_default": True,
+            "entity_picture": None,
+            "expire_after": -1,
+            "force_update": False,
+            "icon": None,
+            "off_delay": -1,
+        },
+        "optional": ["enabled_by_default", "force_update", "device_class", "entity_picture", "icon",
+                     "expire_after", "off_delay"],
+    },
+    "button": {
+        "topic_key": "command_topic",
+        "topic_suffix": "press",
+        "callback": ("on_press_func", "void"),
+        "defaults": {
+            "device_class": None,
+            "enabled_by_default": True,
+            "entity_picture": None,
+            "icon": None,
+        },
+        "optional": ["enabled_by_default", "device_class", "entity_picture", "icon"],
+    },
+}
+
+ATTRIBUTE_TYPES = {
+    "bool": "HAMQTT_ATTRIBUTE_BOOL",
+    "int": "HAMQTT_ATTRIBUTE_INT",
+    "float": "HAMQTT_ATTRIBUTE_FLOAT",
+    "string": "HAMQTT_ATTRIBUTE_STRING",
+}
+
+DEVICE_FIELDS = [("manufacturer", "mf"), ("model", "mdl"), ("sw_version", "sw"), ("hw_version", "hw"),
+                 ("serial_number", "sn")]
+ORIGIN_FIELDS = [("sw_version", "sw"), ("origin_url", "url")]
+
+
+class ManifestError(Exception):
+    pass
+
+
+def c_identifier(name):
+    ident = re.sub(r"[^0-9A-Za-z_]", "_", name)
+    if not ident or ident[0].isdigit():
+        ident = "_" + ident
+    return ident
+
+
+def c_string(value):
+    out = []
+    for byte in value.encode("utf-8"):
+        ch = chr(byte)
+        if ch == "\\":
+            out.append("\\\\")
+        elif ch == '"':
+            out.append('\\"')
+        elif byte < 0x20 or byte >= 0x7F:
+            # Octal escapes keep the output ASCII and never swallow the following character
+            out.append("\\%03o" % byte)
+        else:
+            out.append(ch)
+    return '"' + "".join(out) + '"'
+
+
+def c_value(value):
+    if value is None:
+        return "NULL"
+    if isinstance(value, bool):
+        return "true" if value else "false"
+    if isinstance(value, int):
+        return str(value)
+    return c_string(value)
+
+
+def require(obj, key, where):
+    if key not in obj or obj[key] in (None, ""):
+        raise ManifestError("%s is missing required field '%s'" % (where, key))
+    return obj[key]
+
+
+def check_attributes(component, where):
+    slots = component.get("json_attributes")
+    if slots is None:
+        return
+    if not isinstance(slots, list) or not slots:
+        raise ManifestError("%s has json_attributes that is not a list of slots" % where)
+
+    keys = set()
+    for index, slot in enumerate(slots):
+        slot_where = "%s.json_attributes[%d]" % (where, index)
+        key = require(slot, "key", slot_where)
+        # hamqtt_attributes_create rejects keys that would need escaping
+        if re.search(r'["\\\x00-\x1f]', key):
+            raise ManifestError("%s has a key that needs JSON escaping" % slot_where)
+        if c_identifier(key).upper() in keys:
+            raise ManifestError("%s reuses key '%s'" % (slot_where, key))
+        keys.add(c_identifier(key).upper())
+
+        stype = require(slot, "type", slot_where)
+        if stype not in ATTRIBUTE_TYPES:
+            raise ManifestError("%s has unknown type '%s'" % (slot_where, stype))
+        if stype == "float" and not 0 <= slot.get("precision", 0) <= 6:
+            raise ManifestError("%s has a precision outside 0 to 6" % slot_where)
+        if stype == "string" and not 1 <= require(slot, "max_len", slot_where) <= 255:
+            raise ManifestError("%s has a max_len outside 1 to 255" % slot_where)
+
+
+def build_payload(manifest):
+    device = manifest.get("device", {})
+    device_name = require(device, "name", "device")
+
+    device_json = {"ids": UNIQUE_ID_PLACEHOLDER, "name": device_name}
+    for key, short in DEVICE_FIELDS:
+        if device.get(key):
+            device_json[short] = device[key]
+
+    origin_json = {"name": device_name}
+    for key, short in ORIGIN_FIELDS:
+        if device.get(key):
+            origin_json[short] = device[key]
+
+    components_json = {}
+    for index, component in enumerate(manifest.get("components", [])):
+        where = "components[%d]" % index
+        ctype = require(component, "type", where)
+        if ctype not in COMPONENT_TYPES:
+            raise ManifestError("%s has unknown type '%s'" % (where, ctype))
+        spec = COMPONENT_TYPES[ctype]
+
+        unique_id = require(component, "unique_id", where)
+        # Strings are escaped by json.dumps below, but unique ids also end up raw in topics
+        if re.search(r"[+#/\x00-\x1f]", unique_id):
+            raise ManifestError("%s has a unique_id with an MQTT wildcard, a '/' or a control character" % where)
+        if unique_id in components_json:
+            raise ManifestError("%s reuses unique_id '%s'" % (where, unique_id))
+
+        fields = dict(spec["defaults"])
+        fields.update({k: v for k, v in component.items() if k in spec["defaults"]})
+
+        cmp_json = {
+            "p": ctype,
+            "name": require(component, "name", where),
+            spec["topic_key"]: "%s/%s/%s" % (UNIQUE_ID_PLACEHOLDER, unique_id, spec["topic_suffix"]),
+            "unique_id": unique_id,
+        }
+        for key in spec["optional"]:
+            if fields[key] != spec["defaults"][key]:
+                cmp_json[key] = fields[key]
+
+        # Matches the topic hamqtt_attributes_build_topic builds when the device renders the template
+        check_attributes(component, where)
+        if component.get("json_attributes"):
+            cmp_json["json_attributes_topic"] = "%s/%s/attributes" % (UNIQUE_ID_PLACEHOLDER, unique_id)
+
+        components_json[unique_id] = cmp_json
+
+    root = {
+        "device": device_json,
+        "origin": origin_json,
+        "cmps": components_json,
+        "availability_topic": "%s/availability" % UNIQUE_ID_PLACEHOLDER,
+        "qos": "1",
+    }
+
+    payload = json.dumps(root, separators=(",", ":"), ensure_ascii=False)
+    return payload.split(UNIQUE_ID_PLACEHOLDER)
+
+
+def generate(manifest, name):
+    prefix = c_identifier(manifest.get("name", name))
+    fragments = build_payload(manifest)
+    components = manifest.get("components", [])
+
+    header = []
+    header.append("/* Generated by tools/hamqtt_manifest.py. Do not edit. */")
+    header.append("")
+    header.append("#pragma once")
+    header.append("")
+    header.append('#include "HAMQTT.h"')
+    header.append("")
+    header.append("/** Discovery payload precomputed from the device manifest. */")
+    header.append("extern const HAMQTT_Discovery_Template %s_hamqtt_discovery;" % prefix)
+    header.append("")
+    header.append("/**")
+    header.append(" * @brief Create every component in the manifest, add them to the device and")
+    header.append(" *        install the precomputed discovery template.")
+    header.append(" */")
+    header.append("esp_err_t %s_hamqtt_register(HAMQTT_Device *device);" % prefix)
+    header.append("")
+    for component in components:
+        if not component.get("json_attributes"):
+            continue
+        ident = "%s_%s" % (prefix, c_identifier(component["unique_id"]))
+        header.append("/** Attributes of %s, created by %s_hamqtt_register. */" % (ident, prefix))
+        header.append("extern HAMQTT_Attributes *%s_attributes;" % ident)
+        header.append("")
+        header.append("enum {")
+        for slot in component["json_attributes"]:
+            header.append("    %s_ATTR_%s," % (ident.upper(), c_identifier(slot["key"]).upper()))
+        header.append("};")
+        header.append("")
+
+    source = []
+    source.append("/* Generated by tools/hamqtt_manifest.py. Do not edit. */")
+    source.append("")
+    source.append('#include "%s_hamqtt.h"' % name)
+    for include in manifest.get("includes", []):
+        source.append('#include "%s"' % include)
+    source.append("")
+    for ctype in sorted(set(component["type"] for component in components)):
+        option = "CONFIG_HAMQTT_COMPONENT_%s" % ctype.upper()
+        source.append("#if !%s" % option)
+        source.append('#error "The device manifest uses %s components, but %s is disabled"' % (ctype, option))
+        source.append("#endif")
+        source.append("")
+    if any(component.get("json_attributes") for component in components):
+        source.append("#if !CONFIG_HAMQTT_ATTRIBUTES")
+        source.append('#error "The device manifest uses json_attributes, but CONFIG_HAMQTT_ATTRIBUTES is disabled"')
+        source.append("#endif")
+        source.append("")
+    source.append('static const char *TAG = "HAMQTT_Manifest";')
+    source.append("")
+
+    # Without user headers, declare the callbacks named by the manifest ourselves
+    if not manifest.get("includes"):
+        declared = set()
+        for component in components:
+            func_key, ret = COMPONENT_TYPES[component["type"]]["callback"]
+            func = component.get(func_key)
+            if func and func not in declared:
+                declared.add(func)
+                source.append("%s %s(void *args);" % (ret, func))
+        if declared:
+            source.append("")
+
+    source.append("static const char *const %s_hamqtt_fragments[] = {" % prefix)
+    for fragment in fragments:
+        source.append("    %s," % c_string(fragment))
+    source.append("};")
+    source.append("")
+    source.append("const HAMQTT_Discovery_Template %s_hamqtt_discovery = {" % prefix)
+    source.append("    .fragments = %s_hamqtt_fragments," % prefix)
+    source.append("    .fragment_count = %d," % len(fragments))
+    source.append("    .component_count = %d," % len(components))
+    source.append("};")
+    source.append("")
+
+    # Descriptors are const and live in flash; only the runtime state is kept in RAM
+    for index, component in enumerate(components):
+        ctype = component["type"]
+        spec = COMPONENT_TYPES[ctype]
+        func_key, _ = spec["callback"]
+        func = component.get(func_key) or "NULL"
+        args = component.get(func_key + "_args") or "NULL"
+
+        fields = {"name": component["name"], "unique_id": component["unique_id"]}
+        for key, default in spec["defaults"].items():
+            if key in component and component[key] != default:
+                fields[key] = component[key]
+
+        source.append("HAMQTT_%s_DEFINE(%s_cmp_%d, %s, %s," % (ctype.upper(), prefix, index, func, args))
+        source.append(",\n".join("    .%s = %s" % (key, c_value(fields[key])) for key in sorted(fields)) + ");")
+        source.append("")
+
+        slots = component.get("json_attributes")
+        if slots:
+            source.append("static const HAMQTT_Attribute_Config %s_cmp_%d_attribute_slots[] = {" % (prefix, index))
+            for slot in slots:
+                source.append("    {.key = %s, .type = %s, .precision = %d, .max_len = %d},"
+                              % (c_string(slot["key"]), ATTRIBUTE_TYPES[slot["type"]],
+                                 slot.get("precision", 0), slot.get("max_len", 0)))
+            source.append("};")
+            source.append("")
+            source.append("HAMQTT_Attributes *%s_%s_attributes;" % (prefix, c_identifier(component["unique_id"])))
+            source.append("")
+
+    source.append("esp_err_t %s_hamqtt_register(HAMQTT_Device *device) {" % prefix)
+    for index, component in enumerate(components):
+        if component.get("json_attributes"):
+            attributes = "%s_%s_attributes" % (prefix, c_identifier(component["unique_id"]))
+            source.append("    %s = hamqtt_attributes_create(%s_cmp_%d_attribute_slots, %d);"
+                          % (attributes, prefix, index, len(component["json_attributes"])))
+            source.append('    ESP_RETURN_ON_FALSE(%s, ESP_ERR_NO_MEM, TAG, "Failed to create attributes of %%s", %s);'
+                          % (attributes, c_string(component["unique_id"])))
+            source.append('    ESP_RETURN_ON_ERROR(hamqtt_component_set_attributes((HAMQTT_Component *)&%s_cmp_%d, %s),'
+                          % (prefix, index, attributes))
+            source.append('                        TAG, "Failed to attach attributes to %%s", %s);' % c_string(component["unique_id"]))
+        source.append('    ESP_RETURN_ON_ERROR(hamqtt_device_add_component(device, (HAMQTT_Component *)&%s_cmp_%d),'
+                      % (prefix, index))
+        # Unique ids go through c_string, they may hold quotes or a '%'
+        source.append('                        TAG, "Failed to add %%s", %s);' % c_string(component["unique_id"]))
+    if components:
+        source.append("")
+    source.append("    return hamqtt_device_set_discovery_template(device, &%s_hamqtt_discovery);" % prefix)
+    source.append("}")
+    source.append("")
+
+    return "\n".join(header), "\n".join(source)
+
+
+def write_if_changed(path, content):
+    if os.path.exists(path):
+        with open(path, "r", encoding="utf-8") as f:
+            if f.read() == content:
+                return
+    with open(path, "w", encoding="utf-8") as f:
+        f.write(content)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--manifest", required=True, help="Path to the device manifest JSON")
+    parser.add_argument("--out-dir", required=True, help="Directory to write <name>_hamqtt.{c,h} to")
+    parser.add_argument("--name", help="Output file stem. Defaults to the manifest file name")
+    args = parser.parse_args()
+
+    name = args.name or os.path.splitext(os.path.basename(args.manifest))[0]
+
+    with open(args.manifest, "r", encoding="utf-8") as f:
+        manifest = json.load(f)
+
+    try:
+        header, source = generate(manifest, name)
+    except ManifestError as e:
+        sys.exit("%s: %s" % (args.manifest, e))
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    write_if_changed(os.path.join(args.out_dir, name + "_hamqtt.h"), header)
+    write_if_changed(os.path.join(args.out_dir, name + "_hamqtt.c"), source)
+
+
+if __name__ == "__main__":
+    main()